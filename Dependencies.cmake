@@ -23,6 +23,14 @@ FetchContent_Declare(
 )
 FetchContent_MakeAvailable(fastgltf)
 
+# -------- meshoptimizer --------
+FetchContent_Declare(
+        meshoptimizer
+        GIT_REPOSITORY https://github.com/zeux/meshoptimizer.git
+        GIT_TAG v0.22
+)
+FetchContent_MakeAvailable(meshoptimizer)
+
 # -------- Vulkan Memory Allocator (VMA) --------
 FetchContent_Declare(
         VMA
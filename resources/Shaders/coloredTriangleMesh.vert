@@ -1,34 +1,37 @@
 #version 450
 #extension GL_EXT_buffer_reference : require
+#extension GL_GOOGLE_include_directive : require
+
+#include "sceneData.glsl"
+#include "vertexInput.glsl"
 
 layout (location = 0) out vec3 outColor;
 layout (location = 1) out vec2 outUV;
-
-struct Vertex {
-    vec3 position;
-    float uv_x;
-    vec3 normal;
-    float uv_y;
-    vec4 color;
-};
-
-layout(buffer_reference, std430) readonly buffer VertexBuffer {
-    Vertex vertices[];
-};
+layout (location = 2) out vec3 outWorldPosition;
+layout (location = 3) out vec3 outNormal;
+layout (location = 4) out float outViewDepth;
+layout (location = 5) flat out uint outObjectId;
 
 //push constants block
 layout( push_constant ) uniform constants {	
-	mat4 renderMatrix;
 	VertexBuffer vertexBuffer;
+	uint objectId;
 } PushConstants;
 
 void main() {
     //load vertex data from device adress
 	Vertex v = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
 
+	mat4 worldMatrix = objects[PushConstants.objectId].transform;
+	vec4 worldPosition = worldMatrix * vec4(v.position, 1.0f);
+
     //output data
-	gl_Position = PushConstants.renderMatrix * vec4(v.position, 1.0f);
+	gl_Position = sceneData.viewProj * worldPosition;
 	outColor = v.color.xyz;
 	outUV.x = v.uv_x;
 	outUV.y = v.uv_y;
-}
\ No newline at end of file
+	outWorldPosition = worldPosition.xyz;
+	outNormal = mat3(worldMatrix) * v.normal;
+	outViewDepth = -(sceneData.view * worldPosition).z;
+	outObjectId = PushConstants.objectId;
+}
@@ -0,0 +1,53 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "tonemap.glsl"
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+layout (set = 0, binding = 0) uniform sampler2D hdrImage;
+layout (set = 0, binding = 1) uniform sampler2D bloomChain;
+
+// data1: uv scale of the rendered region, exposure, bloom intensity
+// data2: tonemap, dither, encode sRGB in the shader, frame index
+layout (push_constant) uniform constants {
+    vec4 data1;
+    vec4 data2;
+} PushConstants;
+
+vec3 linearToSrgb(vec3 color) {
+    return mix(color * 12.92, 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055, greaterThan(color, vec3(0.0031308)));
+}
+
+vec3 srgbToLinear(vec3 color) {
+    return mix(color / 12.92, pow((color + 0.055) / 1.055, vec3(2.4)), greaterThan(color, vec3(0.04045)));
+}
+
+// Jimenez interleaved gradient noise, offset every frame so the pattern does not stay fixed
+float gradientNoise(vec2 position, float frame) {
+    position += frame * 5.588238;
+    return fract(52.9829189 * fract(dot(position, vec2(0.06711056, 0.00583715))));
+}
+
+void main() {
+    vec2 uv = inUV * PushConstants.data1.xy;
+
+    vec3 hdr = texture(hdrImage, uv).rgb;
+    hdr += textureLod(bloomChain, uv, 0.0).rgb * PushConstants.data1.w;
+    hdr *= PushConstants.data1.z;
+
+    vec3 color = PushConstants.data2.x > 0.5 ? tonemapACES(hdr) : clamp(hdr, 0.0, 1.0);
+
+    // quantization happens on the encoded value, so the dither is applied there as well
+    vec3 encoded = linearToSrgb(color);
+
+    if (PushConstants.data2.y > 0.5) {
+        encoded += (gradientNoise(gl_FragCoord.xy, PushConstants.data2.w) - 0.5) / 255.0;
+    }
+
+    color = PushConstants.data2.z > 0.5 ? encoded : srgbToLinear(clamp(encoded, 0.0, 1.0));
+
+    outFragColor = vec4(color, 1.0);
+}
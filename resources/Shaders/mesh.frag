@@ -0,0 +1,117 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "sceneData.glsl"
+#include "virtualTexture.glsl"
+
+//shader input
+layout (location = 0) in vec3 inColor;
+layout (location = 1) in vec2 inUV;
+layout (location = 2) in vec3 inWorldPosition;
+layout (location = 3) in vec3 inNormal;
+layout (location = 4) in float inViewDepth;
+layout (location = 5) flat in uint inObjectId;
+
+//output write
+layout (location = 0) out vec4 outFragColor;
+
+layout (std430, set = 0, binding = 2) readonly buffer ClusterGrid {
+    uvec2 clusters[];
+};
+
+layout (std430, set = 0, binding = 3) readonly buffer LightIndexList {
+    uint indexCount;
+    uint lightIndices[];
+};
+
+layout (set = 0, binding = 4) uniform sampler2DArrayShadow shadowMap;
+
+float sampleShadow(vec3 worldPosition, vec3 normal, float viewDepth) {
+    if (viewDepth > sceneData.cascadeSplits[SHADOW_CASCADE_COUNT - 1]) {
+        return 1.0;
+    }
+
+    uint cascade = 0;
+    while (cascade < SHADOW_CASCADE_COUNT - 1 && viewDepth > sceneData.cascadeSplits[cascade]) {
+        cascade++;
+    }
+
+    // small normal offset against acne on surfaces at grazing angles
+    vec4 shadowCoord = sceneData.cascadeViewProj[cascade] * vec4(worldPosition + normal * 0.02, 1.0);
+    vec3 coord = shadowCoord.xyz / shadowCoord.w;
+    vec2 uv = coord.xy * 0.5 + 0.5;
+
+    // 3x3 taps of hardware 2x2 PCF
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float shadow = 0.0;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            shadow += texture(shadowMap, vec4(uv + vec2(x, y) * texelSize, float(cascade), coord.z));
+        }
+    }
+
+    return shadow / 9.0;
+}
+
+uint clusterIndex(vec2 fragCoord, float viewDepth) {
+    uvec3 grid = sceneData.clusterGrid.xyz;
+    vec2 tileSize = ceil(sceneData.clusterParams.xy / vec2(grid.xy));
+    uvec2 tile = min(uvec2(fragCoord / tileSize), grid.xy - 1);
+
+    // inverse of the exponential slice distribution used by clusterLights.comp
+    float zNear = sceneData.clusterParams.z;
+    float zFar = sceneData.clusterParams.w;
+    float slice = floor(log(viewDepth / zNear) / log(zFar / zNear) * float(grid.z));
+    uint z = uint(clamp(slice, 0.0, float(grid.z - 1)));
+
+    return tile.x + tile.y * grid.x + z * grid.x * grid.y;
+}
+
+vec3 evaluateLight(Light light, vec3 position, vec3 normal) {
+    vec3 toLight = light.positionRange.xyz - position;
+    float distanceSq = dot(toLight, toLight);
+    float rangeSq = light.positionRange.w * light.positionRange.w;
+    if (distanceSq >= rangeSq) {
+        return vec3(0.0);
+    }
+
+    vec3 L = toLight * inversesqrt(distanceSq);
+
+    // inverse square falloff windowed to reach zero at the light range
+    float ratio = distanceSq / rangeSq;
+    float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+    float attenuation = window * window / (distanceSq + 1.0);
+
+    if (uint(light.directionType.w) == LIGHT_TYPE_SPOT) {
+        float cosAngle = dot(-L, normalize(light.directionType.xyz));
+        attenuation *= smoothstep(light.spotCone.y, light.spotCone.x, cosAngle);
+    }
+
+    return light.colorIntensity.rgb * light.colorIntensity.w * max(dot(normal, L), 0.0) * attenuation;
+}
+
+void main() {
+    vec3 normal = normalize(inNormal);
+
+    uvec2 cluster = clusters[clusterIndex(gl_FragCoord.xy, inViewDepth)];
+
+    // only the lights binned into this cluster are visited, regardless of the total light count
+    vec3 lighting = sceneData.ambientColor.rgb;
+
+    float sunDiffuse = max(dot(normal, -sceneData.sunlightDirection.xyz), 0.0);
+    if (sunDiffuse > 0.0) {
+        float shadow = sampleShadow(inWorldPosition, normal, inViewDepth);
+        lighting += sceneData.sunlightColor.rgb * sceneData.sunlightColor.w * sunDiffuse * shadow;
+    }
+    for (uint i = 0; i < cluster.y; i++) {
+        lighting += evaluateLight(lights[lightIndices[cluster.x + i]], inWorldPosition, normal);
+    }
+
+    vec3 albedo = inColor;
+    vec3 virtualColor;
+    if (objects[inObjectId].materialIndex == VIRTUAL_TEXTURE_MATERIAL && sampleVirtualTexture(inUV, virtualColor)) {
+        albedo *= virtualColor;
+    }
+
+    outFragColor = vec4(albedo * lighting, 1.0f);
+}
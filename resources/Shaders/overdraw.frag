@@ -0,0 +1,8 @@
+#version 450
+
+// added to the count target, one per shaded fragment
+layout (location = 0) out float outCount;
+
+void main() {
+    outCount = 1.0;
+}
@@ -0,0 +1,13 @@
+#version 450
+
+layout (location = 0) in vec2 inCorner;
+layout (location = 1) in vec4 inColor;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main() {
+    // soft round sprite, premultiplied for the blend state
+    float falloff = max(1.0 - dot(inCorner, inCorner), 0.0);
+    float alpha = inColor.a * falloff * falloff;
+    outFragColor = vec4(inColor.rgb * alpha, alpha);
+}
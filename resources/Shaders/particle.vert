@@ -0,0 +1,37 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+#extension GL_GOOGLE_include_directive : require
+
+#include "particles.glsl"
+
+// six vertices per particle, drawn in the order of the sort keys so blending goes back to front
+layout (location = 0) out vec2 outCorner;
+layout (location = 1) out vec4 outColor;
+
+layout (push_constant) uniform constants {
+    mat4 viewProj;
+    // xyz camera right, w half size of a particle
+    vec4 cameraRight;
+    vec4 cameraUp;
+    ParticleBuffer particles;
+    SortKeyBuffer sortKeys;
+} PushConstants;
+
+const vec2 CORNERS[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+void main() {
+    uint index = PushConstants.sortKeys.keys[gl_VertexIndex / 6].y;
+    Particle p = PushConstants.particles.particles[index];
+    vec2 corner = CORNERS[gl_VertexIndex % 6];
+
+    vec3 offset = (corner.x * PushConstants.cameraRight.xyz + corner.y * PushConstants.cameraUp.xyz) * PushConstants.cameraRight.w;
+    gl_Position = PushConstants.viewProj * vec4(p.position + offset, 1.0);
+
+    // fades out over its life
+    float life = clamp(p.age / p.lifetime, 0.0, 1.0);
+    outColor = vec4(p.color.rgb, p.color.a * (1.0 - life));
+    outCorner = corner;
+}
@@ -0,0 +1,23 @@
+// push constants of every particle compute pass but the sort, ParticlePushConstants on the CPU
+
+#include "particles.glsl"
+
+layout (push_constant) uniform constants {
+    ParticleBuffer particles;
+    IndexBuffer deadList;
+    IndexBuffer aliveIn;
+    IndexBuffer aliveOut;
+    SortKeyBuffer sortKeys;
+    CounterBuffer counters;
+    // xyz center, w radius
+    vec4 emitterPosition;
+    // xyz initial velocity, w random speed added in any direction
+    vec4 emitterVelocity;
+    // xyz camera position, w time step
+    vec4 cameraPosition;
+    uint emitCount;
+    // parity selects which alive count is read, the other one is filled
+    uint frame;
+    uint capacity;
+    float lifetime;
+} PushConstants;
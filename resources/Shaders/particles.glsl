@@ -0,0 +1,44 @@
+// particle buffers shared by the particle compute passes and the particle draw, all reached through addresses
+
+struct Particle {
+    vec3 position;
+    float age;
+    vec3 velocity;
+    float lifetime;
+    vec4 color;
+};
+
+layout (buffer_reference, std430) buffer ParticleBuffer {
+    Particle particles[];
+};
+
+layout (buffer_reference, std430) buffer IndexBuffer {
+    uint indices[];
+};
+
+// x is the sort key, y the particle
+layout (buffer_reference, std430) buffer SortKeyBuffer {
+    uvec2 keys[];
+};
+
+// must match ParticleCounters, the dispatch and draw arguments are consumed as indirect commands
+layout (buffer_reference, std430) buffer CounterBuffer {
+    uint deadCount;
+    uint aliveCount[2];
+    uint emitCount;
+    uint emitDispatch[3];
+    uint simulateDispatch[3];
+    uint sortDispatch[3];
+    uint sortCount;
+    uint drawnCount;
+    uint draw[4];
+};
+
+// must match PARTICLE_GROUP_SIZE and PARTICLE_SORT_GROUP_SIZE
+#define PARTICLE_GROUP_SIZE 64
+#define SORT_GROUP_SIZE 256
+// every sort workgroup orders two keys per invocation
+#define SORT_BLOCK_SIZE (SORT_GROUP_SIZE * 2)
+
+// sorts after every live key, pads the sorted range up to a power of two
+const uint SORT_KEY_EMPTY = 0xFFFFFFFFu;
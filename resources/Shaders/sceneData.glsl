@@ -0,0 +1,44 @@
+// shared by every pass that binds the per-frame scene descriptor set
+
+#define SHADOW_CASCADE_COUNT 4
+
+layout (set = 0, binding = 0) uniform SceneData {
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    mat4 inverseProj;
+    vec4 cameraPosition;
+    vec4 ambientColor;
+    uvec4 clusterGrid;   // xyz cluster counts, w active light count
+    vec4 clusterParams;  // xy screen size, z near plane, w far plane
+    vec4 sunlightDirection; // xyz direction the light travels in
+    vec4 sunlightColor;     // rgb color, w intensity
+    mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+    vec4 cascadeSplits;     // view space far distance of every cascade
+    uvec4 virtualTexture;   // x first indirection level, y mip count, z 1 when a texture is loaded
+} sceneData;
+
+#define LIGHT_TYPE_POINT 0
+#define LIGHT_TYPE_SPOT 1
+
+struct Light {
+    vec4 positionRange;  // xyz world position, w range
+    vec4 colorIntensity; // rgb color, w intensity
+    vec4 directionType;  // xyz spot direction, w light type
+    vec4 spotCone;       // x cos of inner angle, y cos of outer angle
+};
+
+layout (std430, set = 0, binding = 1) readonly buffer LightBuffer {
+    Light lights[];
+};
+
+struct ObjectData {
+    mat4 transform;
+    vec4 boundingSphere; // object space, xyz center and w radius
+    uint materialIndex;
+};
+
+// GPU scene buffer, indexed by the object id of the draw
+layout (std430, set = 0, binding = 5) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
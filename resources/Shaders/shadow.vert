@@ -0,0 +1,22 @@
+#version 450
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_multiview : require
+#extension GL_GOOGLE_include_directive : require
+
+#include "sceneData.glsl"
+#include "vertexInput.glsl"
+
+//push constants block
+layout( push_constant ) uniform constants {
+	VertexBuffer vertexBuffer;
+	uint objectId;
+	uint cascadeOffset;
+} PushConstants;
+
+void main() {
+	Vertex v = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
+
+	// every view of the multiview pass renders one cascade layer
+	mat4 cascadeViewProj = sceneData.cascadeViewProj[PushConstants.cascadeOffset + gl_ViewIndex];
+	gl_Position = cascadeViewProj * objects[PushConstants.objectId].transform * vec4(v.position, 1.0f);
+}
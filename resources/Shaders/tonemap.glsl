@@ -0,0 +1,11 @@
+// shared by the in place tonemap pass and the final composite
+
+// Narkowicz fit of the ACES filmic curve
+vec3 tonemapACES(vec3 color) {
+    const float a = 2.51;
+    const float b = 0.03;
+    const float c = 2.43;
+    const float d = 0.59;
+    const float e = 0.14;
+    return clamp((color * (a * color + b)) / (color * (c * color + d) + e), 0.0, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 450
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+// cached UI layer, colors are premultiplied by alpha
+layout (set = 0, binding = 0) uniform sampler2D uiLayer;
+
+void main() {
+    outFragColor = texture(uiLayer, inUV);
+}
@@ -0,0 +1,53 @@
+// virtual texture lookup, shared by the geometry pass and the feedback pass. Needs sceneData.glsl
+
+// must match VkVirtualTexture.hpp
+#define VT_PAGE_SIZE 128
+#define VT_PAGE_BORDER 4
+#define VT_PAGE_STRIDE (VT_PAGE_SIZE + 2 * VT_PAGE_BORDER)
+#define VT_MAX_PAGES 128
+#define VT_FEEDBACK_DIVISOR 8
+#define VT_NO_PAGE 0xFFFFFFFFu
+#define VIRTUAL_TEXTURE_MATERIAL 1
+
+// one texel per page and mip: xy cache slot, z mip of the page actually resident, w 1 when valid
+layout (set = 0, binding = 6) uniform usampler2D vtIndirection;
+layout (set = 0, binding = 7) uniform sampler2D vtPageCache;
+
+// the texture's mip 0 lives in indirection level sceneData.virtualTexture.x
+uint virtualPageCount(uint mip) {
+    return uint(VT_MAX_PAGES) >> (sceneData.virtualTexture.x + mip);
+}
+
+// mip the pixel footprint asks for, lodBias compensates passes rendered at a lower resolution
+uint virtualMip(vec2 uv, float lodBias) {
+    float size = float(virtualPageCount(0) * VT_PAGE_SIZE);
+    vec2 dx = dFdx(uv) * size;
+    vec2 dy = dFdy(uv) * size;
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + lodBias;
+    return uint(clamp(lod, 0.0, float(sceneData.virtualTexture.y - 1)));
+}
+
+uvec2 virtualPage(vec2 uv, uint mip) {
+    uint pages = virtualPageCount(mip);
+    return min(uvec2(fract(uv) * float(pages)), uvec2(pages - 1));
+}
+
+uint packVirtualPage(uvec2 page, uint mip) {
+    return page.x | (page.y << 8) | (mip << 16);
+}
+
+// false when not even the coarsest page is resident yet
+bool sampleVirtualTexture(vec2 uv, out vec3 color) {
+    uint mip = virtualMip(uv, 0.0);
+    uvec4 entry = texelFetch(vtIndirection, ivec2(virtualPage(uv, mip)), int(sceneData.virtualTexture.x + mip));
+    if (entry.w == 0) {
+        color = vec3(0.0);
+        return false;
+    }
+
+    // a missing page falls back to its resident ancestor, which covers a larger part of the texture
+    vec2 inPage = fract(fract(uv) * float(virtualPageCount(entry.z)));
+    vec2 texel = vec2(entry.xy) * float(VT_PAGE_STRIDE) + float(VT_PAGE_BORDER) + inPage * float(VT_PAGE_SIZE);
+    color = textureLod(vtPageCache, texel / vec2(textureSize(vtPageCache, 0)), 0.0).rgb;
+    return true;
+}
@@ -0,0 +1,16 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "sceneData.glsl"
+#include "virtualTexture.glsl"
+
+layout (location = 1) in vec2 inUV;
+
+// page and mip this pixel wants, read back by the CPU
+layout (location = 0) out uint outPage;
+
+void main() {
+    // rendered at 1/VT_FEEDBACK_DIVISOR resolution, the derivatives are that many times larger
+    uint mip = virtualMip(inUV, -log2(float(VT_FEEDBACK_DIVISOR)));
+    outPage = packVirtualPage(virtualPage(inUV, mip), mip);
+}
@@ -0,0 +1,222 @@
+// Hellfire-Bake: turns source assets into the files the renderer streams
+//
+//   Hellfire-Bake lods <mesh.gltf> <output base> [--lods=N]
+//       writes <output base>.lod0.hmesh ... for --stream=<output base>, every LOD has about half the
+//       triangles of the previous one. All primitives are merged, node transforms are not applied
+//
+//   Hellfire-Bake vtex <image> <output.vtex>
+//       tiles an image into pages and mips for the virtual texture, it must be square and a power of two
+//       from VT_PAGE_SIZE to VT_PAGE_SIZE * VT_MAX_PAGES texels
+
+#include <fastgltf/core.hpp>
+#include <fastgltf/glm_element_traits.hpp>
+#include <fastgltf/tools.hpp>
+#include <meshoptimizer.h>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MeshLod.hpp"
+#include "VirtualTextureFile.hpp"
+
+// the finest LOD is the source mesh, a coarser one stops the chain once it no longer halves
+constexpr uint32_t DEFAULT_LOD_COUNT = 6;
+constexpr float LOD_MAX_ERROR = 0.05f;
+
+struct BakeMesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+static bool parseCount(std::string_view value, uint32_t& outValue) {
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), outValue);
+    return error == std::errc{} && end == value.data() + value.size();
+}
+
+static bool loadGltfMesh(const std::filesystem::path& path, BakeMesh& outMesh) {
+    auto data = fastgltf::GltfDataBuffer::FromPath(path);
+    if (data.error() != fastgltf::Error::None) {
+        std::cerr << std::format("Failed to read {}\n", path.string());
+        return false;
+    }
+
+    fastgltf::Parser parser;
+    auto asset = parser.loadGltf(data.get(), path.parent_path(), fastgltf::Options::LoadExternalBuffers);
+    if (asset.error() != fastgltf::Error::None) {
+        std::cerr << std::format("Failed to parse glTF: {}\n", fastgltf::getErrorMessage(asset.error()));
+        return false;
+    }
+
+    for (fastgltf::Mesh& mesh: asset->meshes) {
+        for (fastgltf::Primitive& primitive: mesh.primitives) {
+            const auto position = primitive.findAttribute("POSITION");
+            if (!primitive.indicesAccessor.has_value() || position == primitive.attributes.end()) {
+                continue;
+            }
+
+            const auto baseVertex = static_cast<uint32_t>(outMesh.vertices.size());
+
+            fastgltf::iterateAccessor<std::uint32_t>(asset.get(), asset->accessors[primitive.indicesAccessor.value()],
+                [&](std::uint32_t index) {
+                    outMesh.indices.push_back(baseVertex + index);
+                });
+
+            const fastgltf::Accessor& positionAccessor = asset->accessors[position->accessorIndex];
+            outMesh.vertices.resize(baseVertex + positionAccessor.count);
+            fastgltf::iterateAccessorWithIndex<glm::vec3>(asset.get(), positionAccessor, [&](glm::vec3 value, size_t index) {
+                Vertex& vertex = outMesh.vertices[baseVertex + index];
+                vertex.position = value;
+                vertex.normal = {1, 0, 0};
+                vertex.uv_x = 0;
+                vertex.uv_y = 0;
+                vertex.color = glm::vec4{1.f};
+            });
+
+            if (const auto normals = primitive.findAttribute("NORMAL"); normals != primitive.attributes.end()) {
+                fastgltf::iterateAccessorWithIndex<glm::vec3>(asset.get(), asset->accessors[normals->accessorIndex],
+                    [&](glm::vec3 value, size_t index) {
+                        outMesh.vertices[baseVertex + index].normal = value;
+                    });
+            }
+
+            if (const auto uv = primitive.findAttribute("TEXCOORD_0"); uv != primitive.attributes.end()) {
+                fastgltf::iterateAccessorWithIndex<glm::vec2>(asset.get(), asset->accessors[uv->accessorIndex],
+                    [&](glm::vec2 value, size_t index) {
+                        outMesh.vertices[baseVertex + index].uv_x = value.x;
+                        outMesh.vertices[baseVertex + index].uv_y = value.y;
+                    });
+            }
+
+            if (const auto colors = primitive.findAttribute("COLOR_0"); colors != primitive.attributes.end()) {
+                fastgltf::iterateAccessorWithIndex<glm::vec4>(asset.get(), asset->accessors[colors->accessorIndex],
+                    [&](glm::vec4 value, size_t index) {
+                        outMesh.vertices[baseVertex + index].color = value;
+                    });
+            }
+        }
+    }
+
+    if (outMesh.indices.empty()) {
+        std::cerr << std::format("{} has no indexed triangles\n", path.string());
+        return false;
+    }
+    return true;
+}
+
+// simplifies the source down to about targetIndexCount indices and drops the vertices it no longer uses
+static BakeMesh simplify(const BakeMesh& source, size_t targetIndexCount) {
+    BakeMesh lod;
+    lod.indices.resize(source.indices.size());
+    const size_t indexCount = meshopt_simplify(lod.indices.data(), source.indices.data(), source.indices.size(),
+                                               &source.vertices[0].position.x, source.vertices.size(), sizeof(Vertex),
+                                               targetIndexCount, LOD_MAX_ERROR, 0, nullptr);
+    lod.indices.resize(indexCount);
+
+    lod.vertices.resize(source.vertices.size());
+    const size_t vertexCount = meshopt_optimizeVertexFetch(lod.vertices.data(), lod.indices.data(), indexCount,
+                                                           source.vertices.data(), source.vertices.size(),
+                                                           sizeof(Vertex));
+    lod.vertices.resize(vertexCount);
+    return lod;
+}
+
+static int bakeLods(const std::filesystem::path& sourcePath, const std::filesystem::path& outputBase,
+                    uint32_t lodCount) {
+    BakeMesh source;
+    if (!loadGltfMesh(sourcePath, source)) {
+        return 1;
+    }
+
+    size_t previousIndexCount = source.indices.size();
+    for (uint32_t lodIndex = 0; lodIndex < lodCount; lodIndex++) {
+        BakeMesh lod = lodIndex == 0 ? source : simplify(source, source.indices.size() >> lodIndex);
+
+        // a chain that stopped shrinking would only stream the same triangles again
+        if (lodIndex > 0 && (lod.indices.empty() || lod.indices.size() * 10 > previousIndexCount * 9)) {
+            break;
+        }
+        previousIndexCount = lod.indices.size();
+
+        std::filesystem::path path = outputBase;
+        path += std::format(".lod{}.hmesh", lodIndex);
+        if (!saveMeshLod(path, lod.vertices, lod.indices)) {
+            std::cerr << std::format("Failed to write {}\n", path.string());
+            return 1;
+        }
+        std::cout << std::format("{}: {} triangles, {} vertices\n", path.string(), lod.indices.size() / 3,
+                                 lod.vertices.size());
+    }
+    return 0;
+}
+
+static int bakeVirtualTexture(const std::filesystem::path& imagePath, const std::filesystem::path& outputPath) {
+    int width;
+    int height;
+    int channels;
+    stbi_uc* image = stbi_load(imagePath.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (image == nullptr) {
+        std::cerr << std::format("Failed to load {}: {}\n", imagePath.string(), stbi_failure_reason());
+        return 1;
+    }
+
+    const auto size = static_cast<uint32_t>(width);
+    if (width != height || !std::has_single_bit(size) || size < VT_PAGE_SIZE || size > VT_PAGE_SIZE * VT_MAX_PAGES) {
+        std::cerr << std::format("{} is {}x{}, a virtual texture is square and a power of two from {} to {}\n",
+                                 imagePath.string(), width, height, VT_PAGE_SIZE, VT_PAGE_SIZE * VT_MAX_PAGES);
+        stbi_image_free(image);
+        return 1;
+    }
+
+    // RGBA8 in memory order, like the page cache
+    std::vector<uint32_t> pixels(static_cast<size_t>(size) * size);
+    std::memcpy(pixels.data(), image, pixels.size() * sizeof(uint32_t));
+    stbi_image_free(image);
+
+    if (!saveVirtualTexture(outputPath, size, pixels)) {
+        std::cerr << std::format("Failed to write {}\n", outputPath.string());
+        return 1;
+    }
+    std::cout << std::format("{}: {}x{}\n", outputPath.string(), size, size);
+    return 0;
+}
+
+static void printUsage() {
+    std::cerr << "usage: Hellfire-Bake lods <mesh.gltf> <output base> [--lods=N]\n"
+                 "       Hellfire-Bake vtex <image> <output.vtex>\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        printUsage();
+        return 1;
+    }
+
+    const std::string_view command = argv[1];
+    if (command == "lods") {
+        uint32_t lodCount = DEFAULT_LOD_COUNT;
+        for (int i = 4; i < argc; i++) {
+            const std::string_view argument = argv[i];
+            if (argument.starts_with("--lods=") && parseCount(argument.substr(7), lodCount) && lodCount > 0) {
+                continue;
+            }
+            std::cerr << std::format("Invalid argument {}\n", argument);
+            printUsage();
+            return 1;
+        }
+        return bakeLods(argv[2], argv[3], lodCount);
+    }
+    if (command == "vtex" && argc == 4) {
+        return bakeVirtualTexture(argv[2], argv[3]);
+    }
+
+    printUsage();
+    return 1;
+}
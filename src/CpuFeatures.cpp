@@ -0,0 +1,79 @@
+#include "CpuFeatures.hpp"
+
+#if CPU_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace CpuFeatures {
+#if CPU_X86
+    static void cpuid(int leaf, int subLeaf, int registers[4]) {
+#if defined(_MSC_VER)
+        __cpuidex(registers, leaf, subLeaf);
+#else
+        unsigned int eax, ebx, ecx, edx;
+        __cpuid_count(leaf, subLeaf, eax, ebx, ecx, edx);
+        registers[0] = static_cast<int>(eax);
+        registers[1] = static_cast<int>(ebx);
+        registers[2] = static_cast<int>(ecx);
+        registers[3] = static_cast<int>(edx);
+#endif
+    }
+
+    // whether the OS saves the AVX registers on context switches
+    static bool osSupportsAvx() {
+#if defined(_MSC_VER)
+        return (_xgetbv(0) & 0x6) == 0x6;
+#else
+        unsigned int eax, edx;
+        __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (eax & 0x6) == 0x6;
+#endif
+    }
+
+    static SimdLevel detectSimdLevel() {
+        int registers[4];
+        cpuid(0, 0, registers);
+        const int maxLeaf = registers[0];
+
+        cpuid(1, 0, registers);
+        const bool sse41 = registers[2] & (1 << 19);
+        const bool osxsave = registers[2] & (1 << 27);
+        const bool avx = registers[2] & (1 << 28);
+
+        bool avx2 = false;
+        if (maxLeaf >= 7 && avx && osxsave && osSupportsAvx()) {
+            cpuid(7, 0, registers);
+            avx2 = registers[1] & (1 << 5);
+        }
+
+        if (avx2) {
+            return SimdLevel::AVX2;
+        }
+        return sse41 ? SimdLevel::SSE41 : SimdLevel::Scalar;
+    }
+#else
+    static SimdLevel detectSimdLevel() {
+        return SimdLevel::Scalar;
+    }
+#endif
+
+    SimdLevel getSimdLevel() {
+        static const SimdLevel level = detectSimdLevel();
+        return level;
+    }
+
+    const char* getSimdLevelName(SimdLevel level) {
+        switch (level) {
+            case SimdLevel::AVX2:
+                return "AVX2";
+            case SimdLevel::SSE41:
+                return "SSE4.1";
+            default:
+                return "scalar";
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+// instruction set dependent code is compiled per function and picked at runtime, so the
+// binary still runs on CPUs without AVX2
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_X86 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TARGET_SSE41
+#define TARGET_AVX2
+#else
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define CPU_X86 0
+#endif
+
+enum class SimdLevel : uint8_t {
+    Scalar,
+    SSE41,
+    AVX2,
+};
+
+namespace CpuFeatures {
+    // highest level supported by both the CPU and the OS, detected once
+    SimdLevel getSimdLevel();
+
+    const char* getSimdLevelName(SimdLevel level);
+}
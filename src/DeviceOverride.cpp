@@ -0,0 +1,23 @@
+#include "DeviceOverride.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <string>
+
+bool matchesDevice(std::string_view preferredDevice, uint32_t index, std::string_view deviceName) {
+    if (std::all_of(preferredDevice.begin(), preferredDevice.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        // an index that does not even fit selects no device instead of throwing
+        uint32_t preferredIndex = 0;
+        const auto [end, error] = std::from_chars(preferredDevice.data(),
+                                                  preferredDevice.data() + preferredDevice.size(), preferredIndex);
+        return error == std::errc{} && preferredIndex == index;
+    }
+
+    const auto lower = [](std::string_view text) {
+        std::string result(text);
+        std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return std::tolower(c); });
+        return result;
+    };
+    return lower(deviceName).find(lower(preferredDevice)) != std::string::npos;
+}
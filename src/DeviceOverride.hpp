@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// the --device rule shared by the renderer and Hellfire-Replay: the index of the device in enumeration order
+// or part of its name, case insensitive. An index that does not parse matches no device
+bool matchesDevice(std::string_view preferredDevice, uint32_t index, std::string_view deviceName);
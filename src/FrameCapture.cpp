@@ -0,0 +1,176 @@
+#include "FrameCapture.hpp"
+
+#include <fstream>
+
+struct FrameCaptureHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t reserved;
+};
+
+template<typename T>
+static void writeValue(std::ofstream& file, const T& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static void writeArray(std::ofstream& file, std::span<const T> values) {
+    writeValue(file, static_cast<uint64_t>(values.size()));
+    file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size_bytes()));
+}
+
+template<typename T>
+static bool readValue(std::ifstream& file, T& outValue) {
+    file.read(reinterpret_cast<char*>(&outValue), sizeof(T));
+    return file.good();
+}
+
+// counts are checked against what is left of the file before anything is allocated
+template<typename T>
+static bool readArray(std::ifstream& file, uint64_t fileSize, std::vector<T>& outValues) {
+    uint64_t count;
+    if (!readValue(file, count) || count > (fileSize - static_cast<uint64_t>(file.tellg())) / sizeof(T)) {
+        return false;
+    }
+
+    outValues.resize(count);
+    file.read(reinterpret_cast<char*>(outValues.data()), static_cast<std::streamsize>(count * sizeof(T)));
+    return file.good();
+}
+
+// the replay creates descriptors and image views straight from a binding, so only what the engine writes is accepted.
+// Every device supports 256 array layers
+static bool isValidBinding(const CapturedBinding& binding) {
+    if (binding.type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && binding.type != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER &&
+        binding.type != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+        return false;
+    }
+    if (static_cast<uint32_t>(binding.imageKind) > static_cast<uint32_t>(CapturedImageKind::Uint)) {
+        return false;
+    }
+    if (binding.viewType == VK_IMAGE_VIEW_TYPE_2D) {
+        return binding.layerCount <= 1;
+    }
+    return binding.viewType == VK_IMAGE_VIEW_TYPE_2D_ARRAY && binding.layerCount <= 256;
+}
+
+bool saveFrameCapture(const std::filesystem::path& path, const FrameCapture& capture) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    writeValue(file, FrameCaptureHeader{
+        .magic = FRAME_CAPTURE_MAGIC,
+        .version = FRAME_CAPTURE_VERSION,
+        .vertexSize = sizeof(Vertex),
+        .reserved = 0,
+    });
+    writeValue(file, capture.extent);
+    writeValue(file, capture.colorFormat);
+
+    writeArray(file, std::span<const char>(capture.backgroundName));
+    writeArray(file, std::span<const uint32_t>(capture.backgroundShader));
+    writeValue(file, capture.backgroundConstants);
+
+    writeArray(file, std::span<const uint32_t>(capture.vertexShader));
+    writeArray(file, std::span<const uint32_t>(capture.fragmentShader));
+    writeValue(file, capture.geometryState);
+
+    writeValue(file, static_cast<uint64_t>(capture.sceneBindings.size()));
+    for (const CapturedBinding& binding: capture.sceneBindings) {
+        writeValue(file, binding.binding);
+        writeValue(file, binding.type);
+        writeValue(file, binding.imageKind);
+        writeValue(file, binding.viewType);
+        writeValue(file, binding.layerCount);
+        writeArray(file, std::span<const std::byte>(binding.data));
+    }
+
+    writeValue(file, static_cast<uint64_t>(capture.meshes.size()));
+    for (const CapturedMesh& mesh: capture.meshes) {
+        writeArray(file, std::span<const Vertex>(mesh.vertices));
+        writeArray(file, std::span<const uint32_t>(mesh.indices));
+    }
+
+    writeArray(file, std::span<const CapturedDraw>(capture.draws));
+    return file.good();
+}
+
+bool loadFrameCapture(const std::filesystem::path& path, FrameCapture& outCapture) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    const auto fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    FrameCaptureHeader header;
+    if (!readValue(file, header) || header.magic != FRAME_CAPTURE_MAGIC || header.version != FRAME_CAPTURE_VERSION ||
+        header.vertexSize != sizeof(Vertex)) {
+        return false;
+    }
+
+    FrameCapture capture;
+    std::vector<char> backgroundName;
+    if (!readValue(file, capture.extent) || !readValue(file, capture.colorFormat) ||
+        !readArray(file, fileSize, backgroundName) || !readArray(file, fileSize, capture.backgroundShader) ||
+        !readValue(file, capture.backgroundConstants) ||
+        !readArray(file, fileSize, capture.vertexShader) || !readArray(file, fileSize, capture.fragmentShader) ||
+        !readValue(file, capture.geometryState)) {
+        return false;
+    }
+    capture.backgroundName.assign(backgroundName.begin(), backgroundName.end());
+
+    uint64_t bindingCount;
+    if (!readValue(file, bindingCount) || bindingCount > 64) {
+        return false;
+    }
+    capture.sceneBindings.resize(bindingCount);
+    for (CapturedBinding& binding: capture.sceneBindings) {
+        if (!readValue(file, binding.binding) || !readValue(file, binding.type) ||
+            !readValue(file, binding.imageKind) || !readValue(file, binding.viewType) ||
+            !readValue(file, binding.layerCount) || !readArray(file, fileSize, binding.data) ||
+            !isValidBinding(binding)) {
+            return false;
+        }
+    }
+
+    uint64_t meshCount;
+    if (!readValue(file, meshCount) || meshCount > fileSize) {
+        return false;
+    }
+    capture.meshes.resize(meshCount);
+    for (CapturedMesh& mesh: capture.meshes) {
+        if (!readArray(file, fileSize, mesh.vertices) || !readArray(file, fileSize, mesh.indices)) {
+            return false;
+        }
+    }
+
+    if (!readArray(file, fileSize, capture.draws)) {
+        return false;
+    }
+
+    // a draw may only reference indices and vertices that were captured
+    for (const CapturedDraw& draw: capture.draws) {
+        if (draw.mesh >= capture.meshes.size()) {
+            return false;
+        }
+        const CapturedMesh& mesh = capture.meshes[draw.mesh];
+        if (static_cast<uint64_t>(draw.firstIndex) + draw.indexCount > mesh.indices.size()) {
+            return false;
+        }
+    }
+    for (const CapturedMesh& mesh: capture.meshes) {
+        for (const uint32_t index: mesh.indices) {
+            if (index >= mesh.vertices.size()) {
+                return false;
+            }
+        }
+    }
+
+    outCapture = std::move(capture);
+    return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "VkTypes.hpp"
+
+constexpr uint32_t FRAME_CAPTURE_MAGIC = 0x50414348; // "HCAP"
+constexpr uint32_t FRAME_CAPTURE_VERSION = 1;
+
+// what a shader samples from an image binding. Images are not captured, the replay binds a cleared
+// 1x1 placeholder of a matching kind instead
+enum class CapturedImageKind : uint32_t {
+    // depth with a compare sampler, cleared to the far plane
+    DepthCompare,
+    Float,
+    Uint,
+};
+
+// one binding of the scene descriptor set, buffers keep the bytes the frame read
+struct CapturedBinding {
+    uint32_t binding = 0;
+    VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    std::vector<std::byte> data;
+    // image bindings only
+    CapturedImageKind imageKind = CapturedImageKind::Float;
+    VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D;
+    uint32_t layerCount = 1;
+};
+
+// the parts of the geometry pipeline the engine varies, the rest is fixed by the pass
+struct CapturedPipelineState {
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+    VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+    // premultiplied alpha
+    uint32_t blending = 0;
+};
+
+struct CapturedMesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+struct CapturedDraw {
+    uint32_t mesh;
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    // the push constants of the draw, the vertex buffer address is the replay's upload of the mesh
+    uint32_t objectId;
+};
+
+// everything the background effect and the geometry pass of one frame consumed, enough to re-record
+// both without the application, its assets or the shader sources
+struct FrameCapture {
+    VkExtent2D extent{};
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+
+    std::string backgroundName;
+    std::vector<uint32_t> backgroundShader;
+    ComputePushConstants backgroundConstants{};
+
+    std::vector<uint32_t> vertexShader;
+    std::vector<uint32_t> fragmentShader;
+    CapturedPipelineState geometryState{};
+    std::vector<CapturedBinding> sceneBindings;
+
+    std::vector<CapturedMesh> meshes;
+    std::vector<CapturedDraw> draws;
+};
+
+// binary, little endian, for the machine-independent replay of a captured frame
+bool saveFrameCapture(const std::filesystem::path& path, const FrameCapture& capture);
+bool loadFrameCapture(const std::filesystem::path& path, FrameCapture& outCapture);
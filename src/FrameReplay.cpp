@@ -0,0 +1,849 @@
+// Hellfire-Replay: re-executes a frame capture written by the renderer without a window, its assets or
+// its state, and reports how long the GPU spent on every pass
+//
+//   Hellfire-Replay <capture> [--iterations=N] [--warmup=N] [--device=name or index]
+
+#define VMA_IMPLEMENTATION
+#include <vk_mem_alloc.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "DeviceOverride.hpp"
+#include "FrameCapture.hpp"
+#include "VkDescriptors.hpp"
+#include "VkImage.hpp"
+#include "VkPipeline.hpp"
+#include "VkSync.hpp"
+
+struct ReplayOptions {
+    std::filesystem::path capturePath;
+    uint32_t iterations = 100;
+    // submissions before the measured ones, while clocks and caches settle
+    uint32_t warmup = 5;
+    std::string device;
+};
+
+struct ReplayDevice {
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queueFamily = 0;
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    float timestampPeriod = 1.f;
+    bool fillModeNonSolid = false;
+    std::string name;
+};
+
+// the timestamps written around the passes of a replayed frame
+enum ReplayTimestamp : uint32_t {
+    TIMESTAMP_BEGIN,
+    TIMESTAMP_BACKGROUND,
+    TIMESTAMP_GEOMETRY,
+    TIMESTAMP_COUNT,
+};
+
+static bool parseCount(std::string_view value, uint32_t& outValue) {
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), outValue);
+    return error == std::errc{} && end == value.data() + value.size();
+}
+
+static bool parseArguments(int argc, char* argv[], ReplayOptions& outOptions) {
+    for (int i = 1; i < argc; i++) {
+        const std::string_view argument = argv[i];
+        if (argument.starts_with("--iterations=")) {
+            if (!parseCount(argument.substr(13), outOptions.iterations) || outOptions.iterations == 0) {
+                std::cerr << std::format("Invalid value for --iterations: {}", argument.substr(13)) << std::endl;
+                return false;
+            }
+        } else if (argument.starts_with("--warmup=")) {
+            if (!parseCount(argument.substr(9), outOptions.warmup)) {
+                std::cerr << std::format("Invalid value for --warmup: {}", argument.substr(9)) << std::endl;
+                return false;
+            }
+        } else if (argument.starts_with("--device=")) {
+            outOptions.device = argument.substr(9);
+        } else if (!argument.starts_with("--") && outOptions.capturePath.empty()) {
+            outOptions.capturePath = argument;
+        } else {
+            return false;
+        }
+    }
+
+    return !outOptions.capturePath.empty();
+}
+
+static uint32_t rankDeviceType(VkPhysicalDeviceType type) {
+    switch (type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            return 4;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return 3;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return 2;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// a queue family that runs both passes and can time them
+static bool findQueueFamily(VkPhysicalDevice device, uint32_t& outFamily) {
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, families.data());
+
+    for (uint32_t i = 0; i < familyCount; i++) {
+        constexpr VkQueueFlags required = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+        if ((families[i].queueFlags & required) == required && families[i].timestampValidBits > 0) {
+            outFamily = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool isDeviceSuitable(VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_3) {
+        return false;
+    }
+
+    VkPhysicalDeviceVulkan12Features features12{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+    };
+    VkPhysicalDeviceVulkan13Features features13{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+        .pNext = &features12,
+    };
+    VkPhysicalDeviceFeatures2 features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &features13,
+    };
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    uint32_t family;
+    return features12.bufferDeviceAddress && features13.dynamicRendering && features13.synchronization2 &&
+           findQueueFamily(device, family);
+}
+
+static bool createDevice(const std::string& preferredDevice, ReplayDevice& outDevice) {
+    constexpr VkApplicationInfo appInfo{
+        .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+        .pApplicationName = "Hellfire Replay",
+        .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+        .pEngineName = "Hellfire",
+        .engineVersion = VK_MAKE_VERSION(1, 0, 0),
+        .apiVersion = VK_API_VERSION_1_3
+    };
+
+    // headless, no surface extensions
+    VkInstanceCreateInfo instanceInfo{
+        .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+        .pApplicationInfo = &appInfo,
+    };
+
+#if defined(__APPLE__)
+    const char* portability = VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME;
+    instanceInfo.flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
+    instanceInfo.enabledExtensionCount = 1;
+    instanceInfo.ppEnabledExtensionNames = &portability;
+#endif
+
+    if (vkCreateInstance(&instanceInfo, nullptr, &outDevice.instance) != VK_SUCCESS) {
+        std::cerr << "Failed to create a Vulkan 1.3 instance" << std::endl;
+        return false;
+    }
+
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(outDevice.instance, &deviceCount, nullptr);
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(outDevice.instance, &deviceCount, devices.data());
+
+    // software rasterizers such as lavapipe are valid targets, they only rank below real GPUs
+    uint32_t bestRank = 0;
+    bool overridden = false;
+    for (uint32_t i = 0; i < deviceCount; i++) {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(devices[i], &properties);
+        const bool suitable = isDeviceSuitable(devices[i]);
+
+        std::cout << std::format("GPU {}: {} ({}){}", i, properties.deviceName,
+                                 string_VkPhysicalDeviceType(properties.deviceType),
+                                 suitable ? "" : ", unsuitable") << std::endl;
+
+        if (!suitable || overridden) {
+            continue;
+        }
+
+        const uint32_t rank = rankDeviceType(properties.deviceType) + 1;
+        if (!preferredDevice.empty() && matchesDevice(preferredDevice, i, properties.deviceName)) {
+            overridden = true;
+        } else if (rank <= bestRank) {
+            continue;
+        }
+
+        outDevice.physicalDevice = devices[i];
+        outDevice.timestampPeriod = properties.limits.timestampPeriod;
+        outDevice.name = properties.deviceName;
+        bestRank = rank;
+    }
+
+    if (outDevice.physicalDevice == VK_NULL_HANDLE) {
+        std::cerr << "No device supports Vulkan 1.3 with buffer device addresses and dynamic rendering" << std::endl;
+        return false;
+    }
+
+    if (!preferredDevice.empty() && !overridden) {
+        std::cerr << "No suitable GPU matches '" << preferredDevice << "', picking the highest rank instead"
+                << std::endl;
+    }
+
+    findQueueFamily(outDevice.physicalDevice, outDevice.queueFamily);
+
+    VkPhysicalDeviceFeatures supported{};
+    vkGetPhysicalDeviceFeatures(outDevice.physicalDevice, &supported);
+    outDevice.fillModeNonSolid = supported.fillModeNonSolid;
+
+    constexpr float queuePriority = 1.f;
+    const VkDeviceQueueCreateInfo queueInfo{
+        .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+        .queueFamilyIndex = outDevice.queueFamily,
+        .queueCount = 1,
+        .pQueuePriorities = &queuePriority,
+    };
+
+    VkPhysicalDeviceVulkan12Features features12{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .bufferDeviceAddress = VK_TRUE,
+    };
+    VkPhysicalDeviceVulkan13Features features13{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+        .pNext = &features12,
+        .synchronization2 = VK_TRUE,
+        .dynamicRendering = VK_TRUE,
+    };
+    const VkPhysicalDeviceFeatures2 features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &features13,
+        .features = {
+            .fillModeNonSolid = outDevice.fillModeNonSolid,
+        },
+    };
+
+    const VkDeviceCreateInfo deviceInfo{
+        .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = &features,
+        .queueCreateInfoCount = 1,
+        .pQueueCreateInfos = &queueInfo,
+    };
+
+    VK_CHECK(vkCreateDevice(outDevice.physicalDevice, &deviceInfo, nullptr, &outDevice.device));
+    vkGetDeviceQueue(outDevice.device, outDevice.queueFamily, 0, &outDevice.queue);
+
+    const VmaAllocatorCreateInfo allocatorInfo{
+        .flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT,
+        .physicalDevice = outDevice.physicalDevice,
+        .device = outDevice.device,
+        .instance = outDevice.instance,
+        .vulkanApiVersion = VK_API_VERSION_1_3,
+    };
+    VK_CHECK(vmaCreateAllocator(&allocatorInfo, &outDevice.allocator));
+
+    const VkCommandPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = outDevice.queueFamily,
+    };
+    VK_CHECK(vkCreateCommandPool(outDevice.device, &poolInfo, nullptr, &outDevice.commandPool));
+
+    const VkFenceCreateInfo fenceInfo{
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+    };
+    VK_CHECK(vkCreateFence(outDevice.device, &fenceInfo, nullptr, &outDevice.fence));
+
+    return true;
+}
+
+static void destroyDevice(ReplayDevice& device) {
+    vkDestroyFence(device.device, device.fence, nullptr);
+    vkDestroyCommandPool(device.device, device.commandPool, nullptr);
+    vmaDestroyAllocator(device.allocator);
+    vkDestroyDevice(device.device, nullptr);
+    vkDestroyInstance(device.instance, nullptr);
+}
+
+static VkCommandBuffer allocateCommandBuffer(const ReplayDevice& device) {
+    const VkCommandBufferAllocateInfo allocateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = device.commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    VkCommandBuffer cmd;
+    VK_CHECK(vkAllocateCommandBuffers(device.device, &allocateInfo, &cmd));
+    return cmd;
+}
+
+static void submitAndWait(const ReplayDevice& device, VkCommandBuffer cmd) {
+    const VkCommandBufferSubmitInfo cmdInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+        .commandBuffer = cmd,
+    };
+    const VkSubmitInfo2 submit{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+        .commandBufferInfoCount = 1,
+        .pCommandBufferInfos = &cmdInfo,
+    };
+
+    VK_CHECK(vkQueueSubmit2(device.queue, 1, &submit, device.fence));
+    VK_CHECK(vkWaitForFences(device.device, 1, &device.fence, true, UINT64_MAX));
+    VK_CHECK(vkResetFences(device.device, 1, &device.fence));
+}
+
+static void immediateSubmit(const ReplayDevice& device, const std::function<void(VkCommandBuffer)>& function) {
+    const VkCommandBuffer cmd = allocateCommandBuffer(device);
+
+    const VkCommandBufferBeginInfo beginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+    function(cmd);
+    VK_CHECK(vkEndCommandBuffer(cmd));
+
+    submitAndWait(device, cmd);
+    vkFreeCommandBuffers(device.device, device.commandPool, 1, &cmd);
+}
+
+static AllocatedBuffer createBuffer(const ReplayDevice& device, size_t size, VkBufferUsageFlags usage,
+                                    VmaMemoryUsage memoryUsage) {
+    const VkBufferCreateInfo bufferInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = usage,
+    };
+    const VmaAllocationCreateInfo allocationInfo{
+        .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+        .usage = memoryUsage,
+    };
+
+    AllocatedBuffer buffer{};
+    VK_CHECK(vmaCreateBuffer(device.allocator, &bufferInfo, &allocationInfo, &buffer.buffer, &buffer.allocation,
+                             &buffer.info));
+    return buffer;
+}
+
+// device local, like the buffers of the captured frame, so the timings compare
+static AllocatedBuffer uploadBuffer(const ReplayDevice& device, std::span<const std::byte> data,
+                                    VkBufferUsageFlags usage) {
+    // empty bindings still need a buffer to point at
+    const size_t size = std::max<size_t>(data.size(), 16);
+    const AllocatedBuffer buffer = createBuffer(device, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                VMA_MEMORY_USAGE_GPU_ONLY);
+    const AllocatedBuffer staging = createBuffer(device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                 VMA_MEMORY_USAGE_CPU_ONLY);
+    std::memset(staging.info.pMappedData, 0, size);
+    std::memcpy(staging.info.pMappedData, data.data(), data.size());
+
+    immediateSubmit(device, [&](VkCommandBuffer cmd) {
+        const VkBufferCopy region{
+            .size = size,
+        };
+        vkCmdCopyBuffer(cmd, staging.buffer, buffer.buffer, 1, &region);
+    });
+
+    vmaDestroyBuffer(device.allocator, staging.buffer, staging.allocation);
+    return buffer;
+}
+
+static VkDeviceAddress getBufferAddress(const ReplayDevice& device, const AllocatedBuffer& buffer) {
+    const VkBufferDeviceAddressInfo addressInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+        .buffer = buffer.buffer,
+    };
+    return vkGetBufferDeviceAddress(device.device, &addressInfo);
+}
+
+static AllocatedImage createImage(const ReplayDevice& device, VkFormat format, VkExtent2D extent,
+                                  VkImageUsageFlags usage, VkImageViewType viewType, uint32_t layerCount) {
+    AllocatedImage image{
+        .imageExtent = {extent.width, extent.height, 1},
+        .imageFormat = format,
+    };
+
+    const VkImageCreateInfo imageInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = image.imageExtent,
+        .mipLevels = 1,
+        .arrayLayers = layerCount,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage,
+    };
+    const VmaAllocationCreateInfo allocationInfo{
+        .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+        .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    };
+    VK_CHECK(vmaCreateImage(device.allocator, &imageInfo, &allocationInfo, &image.image, &image.allocation, nullptr));
+
+    const VkImageAspectFlags aspect = format == VK_FORMAT_D32_SFLOAT
+                                          ? VK_IMAGE_ASPECT_DEPTH_BIT
+                                          : VK_IMAGE_ASPECT_COLOR_BIT;
+    const VkImageViewCreateInfo viewInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = image.image,
+        .viewType = viewType,
+        .format = format,
+        .subresourceRange = {
+            .aspectMask = aspect,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = layerCount,
+        },
+    };
+    VK_CHECK(vkCreateImageView(device.device, &viewInfo, nullptr, &image.imageView));
+
+    return image;
+}
+
+// stands in for an image the capture left out: shadow maps are lit everywhere, textures are black
+static AllocatedImage createPlaceholder(const ReplayDevice& device, const CapturedBinding& binding) {
+    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    if (binding.imageKind == CapturedImageKind::DepthCompare) {
+        format = VK_FORMAT_D32_SFLOAT;
+    } else if (binding.imageKind == CapturedImageKind::Uint) {
+        format = VK_FORMAT_R8G8B8A8_UINT;
+    }
+
+    const uint32_t layerCount = std::max(binding.layerCount, 1u);
+    AllocatedImage image = createImage(device, format, {1, 1},
+                                       VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                       binding.viewType, layerCount);
+
+    immediateSubmit(device, [&](VkCommandBuffer cmd) {
+        const bool depth = format == VK_FORMAT_D32_SFLOAT;
+        const VkImageAspectFlags aspect = depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+        VkUtils::transitionImageLayers(cmd, image.image, VK_IMAGE_LAYOUT_UNDEFINED,
+                                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, aspect, 0, layerCount);
+
+        const VkImageSubresourceRange range{
+            .aspectMask = aspect,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = layerCount,
+        };
+        if (depth) {
+            const VkClearDepthStencilValue clear{1.f, 0};
+            vkCmdClearDepthStencilImage(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear, 1, &range);
+        } else {
+            const VkClearColorValue clear{};
+            vkCmdClearColorImage(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear, 1, &range);
+        }
+
+        VkUtils::transitionImageLayers(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, aspect, 0, layerCount);
+    });
+
+    return image;
+}
+
+static VkSampler createSampler(const ReplayDevice& device, VkFilter filter, bool compare) {
+    const VkSamplerCreateInfo samplerInfo{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = filter,
+        .minFilter = filter,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .compareEnable = compare,
+        .compareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+        .minLod = 0.f,
+        .maxLod = 1.f,
+    };
+
+    VkSampler sampler;
+    VK_CHECK(vkCreateSampler(device.device, &samplerInfo, nullptr, &sampler));
+    return sampler;
+}
+
+static VkShaderModule createShaderModule(const ReplayDevice& device, std::span<const uint32_t> code) {
+    const VkShaderModuleCreateInfo moduleInfo{
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = code.size_bytes(),
+        .pCode = code.data(),
+    };
+
+    VkShaderModule module;
+    VK_CHECK(vkCreateShaderModule(device.device, &moduleInfo, nullptr, &module));
+    return module;
+}
+
+static VkPipelineLayout createPipelineLayout(const ReplayDevice& device, VkDescriptorSetLayout setLayout,
+                                             VkShaderStageFlags stages, uint32_t pushConstantSize) {
+    const VkPushConstantRange pushConstant{
+        .stageFlags = stages,
+        .offset = 0,
+        .size = pushConstantSize,
+    };
+    const VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &setLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstant,
+    };
+
+    VkPipelineLayout layout;
+    VK_CHECK(vkCreatePipelineLayout(device.device, &layoutInfo, nullptr, &layout));
+    return layout;
+}
+
+struct ReplayMesh {
+    AllocatedBuffer vertexBuffer;
+    AllocatedBuffer indexBuffer;
+    VkDeviceAddress vertexBufferAddress;
+};
+
+struct PassTimings {
+    std::vector<double> milliseconds;
+
+    void print(std::string_view name) {
+        std::sort(milliseconds.begin(), milliseconds.end());
+        double total = 0.0;
+        for (const double value: milliseconds) {
+            total += value;
+        }
+
+        std::cout << std::format("{:<12} min {:8.3f} ms   median {:8.3f} ms   avg {:8.3f} ms   max {:8.3f} ms",
+                                 name, milliseconds.front(), milliseconds[milliseconds.size() / 2],
+                                 total / static_cast<double>(milliseconds.size()), milliseconds.back())
+                << std::endl;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    ReplayOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        std::cerr << "usage: Hellfire-Replay <capture> [--iterations=N] [--warmup=N] [--device=name or index]"
+                << std::endl;
+        return 1;
+    }
+
+    FrameCapture capture;
+    if (!loadFrameCapture(options.capturePath, capture)) {
+        std::cerr << "Failed to load frame capture " << options.capturePath.string() << std::endl;
+        return 1;
+    }
+
+    ReplayDevice device;
+    if (!createDevice(options.device, device)) {
+        return 1;
+    }
+    std::cout << "Using GPU: " << device.name << std::endl;
+
+    const VkDevice vkDevice = device.device;
+    DeletionQueue deletionQueue;
+
+    // color target, written by the background and loaded by the geometry pass like the draw image
+    const AllocatedImage colorImage = createImage(device, capture.colorFormat, capture.extent,
+                                                  VK_IMAGE_USAGE_STORAGE_BIT |
+                                                  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                                  VK_IMAGE_VIEW_TYPE_2D, 1);
+    deletionQueue.push_function([&, colorImage] {
+        vkDestroyImageView(vkDevice, colorImage.imageView, nullptr);
+        vmaDestroyImage(device.allocator, colorImage.image, colorImage.allocation);
+    });
+
+    std::vector<DescriptorAllocator::PoolSizeRatio> sizes = {
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 8},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 8},
+    };
+    DescriptorAllocator descriptorAllocator{};
+    descriptorAllocator.initPool(vkDevice, 2, sizes);
+    deletionQueue.push_function([&] { descriptorAllocator.destroyPool(vkDevice); });
+
+    // background effect
+    DescriptorLayoutBuilder backgroundLayoutBuilder;
+    backgroundLayoutBuilder.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    const VkDescriptorSetLayout backgroundSetLayout = backgroundLayoutBuilder.build(vkDevice,
+                                                                                    VK_SHADER_STAGE_COMPUTE_BIT);
+    const VkDescriptorSet backgroundSet = descriptorAllocator.allocate(vkDevice, backgroundSetLayout);
+
+    DescriptorWriter writer;
+    writer.writeImage(0, colorImage.imageView, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL,
+                      VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    writer.updateSet(vkDevice, backgroundSet);
+
+    const VkPipelineLayout backgroundLayout = createPipelineLayout(device, backgroundSetLayout,
+                                                                   VK_SHADER_STAGE_COMPUTE_BIT,
+                                                                   sizeof(ComputePushConstants));
+
+    const VkShaderModule backgroundShader = createShaderModule(device, capture.backgroundShader);
+    const VkComputePipelineCreateInfo backgroundInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = backgroundShader,
+            .pName = "main",
+        },
+        .layout = backgroundLayout,
+    };
+    VkPipeline backgroundPipeline;
+    VK_CHECK(vkCreateComputePipelines(vkDevice, VK_NULL_HANDLE, 1, &backgroundInfo, nullptr, &backgroundPipeline));
+    VkUtils::destroyShaderModule(vkDevice, backgroundShader);
+
+    deletionQueue.push_function([=] {
+        vkDestroyPipeline(vkDevice, backgroundPipeline, nullptr);
+        vkDestroyPipelineLayout(vkDevice, backgroundLayout, nullptr);
+        vkDestroyDescriptorSetLayout(vkDevice, backgroundSetLayout, nullptr);
+    });
+
+    // scene set, the captured buffers and a placeholder for every image
+    const VkSampler linearSampler = createSampler(device, VK_FILTER_LINEAR, false);
+    const VkSampler nearestSampler = createSampler(device, VK_FILTER_NEAREST, false);
+    const VkSampler compareSampler = createSampler(device, VK_FILTER_LINEAR, true);
+    deletionQueue.push_function([=] {
+        vkDestroySampler(vkDevice, linearSampler, nullptr);
+        vkDestroySampler(vkDevice, nearestSampler, nullptr);
+        vkDestroySampler(vkDevice, compareSampler, nullptr);
+    });
+
+    DescriptorLayoutBuilder sceneLayoutBuilder;
+    for (const CapturedBinding& binding: capture.sceneBindings) {
+        sceneLayoutBuilder.addBinding(binding.binding, binding.type);
+    }
+    const VkDescriptorSetLayout sceneSetLayout = sceneLayoutBuilder.build(
+        vkDevice, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+    const VkDescriptorSet sceneSet = descriptorAllocator.allocate(vkDevice, sceneSetLayout);
+    deletionQueue.push_function([=] { vkDestroyDescriptorSetLayout(vkDevice, sceneSetLayout, nullptr); });
+
+    writer.clear();
+    for (const CapturedBinding& binding: capture.sceneBindings) {
+        if (binding.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+            const AllocatedImage image = createPlaceholder(device, binding);
+            deletionQueue.push_function([&, image] {
+                vkDestroyImageView(vkDevice, image.imageView, nullptr);
+                vmaDestroyImage(device.allocator, image.image, image.allocation);
+            });
+
+            VkSampler sampler = linearSampler;
+            if (binding.imageKind == CapturedImageKind::DepthCompare) {
+                sampler = compareSampler;
+            } else if (binding.imageKind == CapturedImageKind::Uint) {
+                sampler = nearestSampler;
+            }
+            writer.writeImage(binding.binding, image.imageView, sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                              binding.type);
+            continue;
+        }
+
+        const VkBufferUsageFlags usage = binding.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+                                             ? VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+                                             : VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        const AllocatedBuffer buffer = uploadBuffer(device, binding.data, usage);
+        deletionQueue.push_function([&, buffer] {
+            vmaDestroyBuffer(device.allocator, buffer.buffer, buffer.allocation);
+        });
+        writer.writeBuffer(binding.binding, buffer.buffer, VK_WHOLE_SIZE, 0, binding.type);
+    }
+    writer.updateSet(vkDevice, sceneSet);
+
+    // geometry pipeline with the state the frame was drawn with, baked since nothing changes between draws
+    const VkPipelineLayout meshLayout = createPipelineLayout(device, sceneSetLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                                                             sizeof(GPUDrawPushConstants));
+    const VkShaderModule vertexShader = createShaderModule(device, capture.vertexShader);
+    const VkShaderModule fragmentShader = createShaderModule(device, capture.fragmentShader);
+
+    PipelineBuilder pipelineBuilder(nullptr);
+    pipelineBuilder.m_pipelineLayout = meshLayout;
+    pipelineBuilder.setShaders(vertexShader, fragmentShader);
+    pipelineBuilder.setInputTopology(capture.geometryState.topology);
+    pipelineBuilder.setPolygonMode(device.fillModeNonSolid ? capture.geometryState.polygonMode : VK_POLYGON_MODE_FILL);
+    pipelineBuilder.setCullMode(capture.geometryState.cullMode, capture.geometryState.frontFace);
+    pipelineBuilder.setMultiSamplingNone();
+    if (capture.geometryState.blending) {
+        pipelineBuilder.enableBlendingPremultiplied();
+    } else {
+        pipelineBuilder.disableBlending();
+    }
+    pipelineBuilder.disableDepthTest();
+    pipelineBuilder.setColorAttachmentFormat(capture.colorFormat);
+    const VkPipeline meshPipeline = pipelineBuilder.buildPipeline(vkDevice);
+
+    VkUtils::destroyShaderModule(vkDevice, vertexShader);
+    VkUtils::destroyShaderModule(vkDevice, fragmentShader);
+    deletionQueue.push_function([=] {
+        vkDestroyPipeline(vkDevice, meshPipeline, nullptr);
+        vkDestroyPipelineLayout(vkDevice, meshLayout, nullptr);
+    });
+
+    std::vector<ReplayMesh> meshes;
+    uint64_t triangleCount = 0;
+    for (const CapturedMesh& capturedMesh: capture.meshes) {
+        ReplayMesh& mesh = meshes.emplace_back();
+        mesh.vertexBuffer = uploadBuffer(device, std::as_bytes(std::span(capturedMesh.vertices)),
+                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                         VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+        mesh.indexBuffer = uploadBuffer(device, std::as_bytes(std::span(capturedMesh.indices)),
+                                        VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+        mesh.vertexBufferAddress = getBufferAddress(device, mesh.vertexBuffer);
+    }
+    deletionQueue.push_function([&] {
+        for (const ReplayMesh& mesh: meshes) {
+            vmaDestroyBuffer(device.allocator, mesh.vertexBuffer.buffer, mesh.vertexBuffer.allocation);
+            vmaDestroyBuffer(device.allocator, mesh.indexBuffer.buffer, mesh.indexBuffer.allocation);
+        }
+    });
+
+    for (const CapturedDraw& draw: capture.draws) {
+        triangleCount += draw.indexCount / 3;
+    }
+
+    const VkQueryPoolCreateInfo queryInfo{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = TIMESTAMP_COUNT,
+    };
+    VkQueryPool queryPool;
+    VK_CHECK(vkCreateQueryPool(vkDevice, &queryInfo, nullptr, &queryPool));
+    deletionQueue.push_function([=] { vkDestroyQueryPool(vkDevice, queryPool, nullptr); });
+
+    // recorded once, every iteration submits the identical commands
+    const VkCommandBuffer cmd = allocateCommandBuffer(device);
+    const VkCommandBufferBeginInfo beginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    };
+    VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+
+    vkCmdResetQueryPool(cmd, queryPool, 0, TIMESTAMP_COUNT);
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, TIMESTAMP_BEGIN);
+
+    VkUtils::transitionImage(cmd, colorImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, backgroundPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, backgroundLayout, 0, 1, &backgroundSet, 0, nullptr);
+    vkCmdPushConstants(cmd, backgroundLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants),
+                       &capture.backgroundConstants);
+    vkCmdDispatch(cmd, std::ceil(capture.extent.width / 16.0), std::ceil(capture.extent.height / 16.0), 1);
+
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, TIMESTAMP_BACKGROUND);
+
+    VkUtils::transitionImage(cmd, colorImage.image, VK_IMAGE_LAYOUT_GENERAL,
+                             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+    const VkRenderingAttachmentInfo colorAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .imageView = colorImage.imageView,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+    };
+    const VkRenderingInfo renderInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = capture.extent,
+        },
+        .layerCount = 1,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+    };
+    vkCmdBeginRendering(cmd, &renderInfo);
+
+    const VkViewport viewport{
+        .x = 0.f,
+        .y = 0.f,
+        .width = static_cast<float>(capture.extent.width),
+        .height = static_cast<float>(capture.extent.height),
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    };
+    const VkRect2D scissor{
+        .offset = {0, 0},
+        .extent = capture.extent,
+    };
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, meshPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, meshLayout, 0, 1, &sceneSet, 0, nullptr);
+
+    for (const CapturedDraw& draw: capture.draws) {
+        const ReplayMesh& mesh = meshes[draw.mesh];
+        const GPUDrawPushConstants pushConstants{
+            .vertexBuffer = mesh.vertexBufferAddress,
+            .objectId = draw.objectId,
+        };
+
+        vkCmdPushConstants(cmd, meshLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GPUDrawPushConstants),
+                           &pushConstants);
+        vkCmdBindIndexBuffer(cmd, mesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexed(cmd, draw.indexCount, 1, draw.firstIndex, 0, 0);
+    }
+
+    vkCmdEndRendering(cmd);
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, TIMESTAMP_GEOMETRY);
+
+    VK_CHECK(vkEndCommandBuffer(cmd));
+
+    std::cout << std::format("Replaying {} ({}x{}, background '{}', {} draws, {} meshes, {} triangles), "
+                             "{} iterations after {} warmup", options.capturePath.string(), capture.extent.width,
+                             capture.extent.height, capture.backgroundName, capture.draws.size(),
+                             capture.meshes.size(), triangleCount, options.iterations, options.warmup) << std::endl;
+
+    PassTimings background;
+    PassTimings geometry;
+    PassTimings frame;
+    for (uint32_t i = 0; i < options.warmup + options.iterations; i++) {
+        submitAndWait(device, cmd);
+        if (i < options.warmup) {
+            continue;
+        }
+
+        uint64_t timestamps[TIMESTAMP_COUNT];
+        VK_CHECK(vkGetQueryPoolResults(vkDevice, queryPool, 0, TIMESTAMP_COUNT, sizeof(timestamps), timestamps,
+                                       sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+        const auto milliseconds = [&](ReplayTimestamp begin, ReplayTimestamp end) {
+            return static_cast<double>(timestamps[end] - timestamps[begin]) * device.timestampPeriod / 1000000.0;
+        };
+        background.milliseconds.push_back(milliseconds(TIMESTAMP_BEGIN, TIMESTAMP_BACKGROUND));
+        geometry.milliseconds.push_back(milliseconds(TIMESTAMP_BACKGROUND, TIMESTAMP_GEOMETRY));
+        frame.milliseconds.push_back(milliseconds(TIMESTAMP_BEGIN, TIMESTAMP_GEOMETRY));
+    }
+
+    background.print("background");
+    geometry.print("geometry");
+    frame.print("frame");
+
+    vkFreeCommandBuffers(vkDevice, device.commandPool, 1, &cmd);
+    deletionQueue.flush();
+    destroyDevice(device);
+    return 0;
+}
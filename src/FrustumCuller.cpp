@@ -0,0 +1,305 @@
+#include "FrustumCuller.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
+#include "JobSystem.hpp"
+
+// xyz normal pointing into the frustum and w the distance, one per plane
+struct FrustumPlanes {
+    float x[6];
+    float y[6];
+    float z[6];
+    float w[6];
+};
+
+// the bounds of one batch, offset to its first object
+struct CullBatch {
+    const float* sphereX;
+    const float* sphereY;
+    const float* sphereZ;
+    const float* sphereRadius;
+    const float* boxCenterX;
+    const float* boxCenterY;
+    const float* boxCenterZ;
+    const float* boxExtentX;
+    const float* boxExtentY;
+    const float* boxExtentZ;
+    uint32_t first;
+    uint32_t count;
+};
+
+static FrustumPlanes extractPlanes(const glm::mat4& viewProj) {
+    const glm::vec4 row0{viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]};
+    const glm::vec4 row1{viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]};
+    const glm::vec4 row2{viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]};
+    const glm::vec4 row3{viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]};
+
+    // clip space depth runs from 0 to 1, so the near plane is the depth row on its own
+    const glm::vec4 planes[6] = {
+        row3 + row0,
+        row3 - row0,
+        row3 + row1,
+        row3 - row1,
+        row2,
+        row3 - row2,
+    };
+
+    FrustumPlanes result{};
+    for (int i = 0; i < 6; i++) {
+        const glm::vec4 plane = planes[i] / glm::length(glm::vec3(planes[i]));
+        result.x[i] = plane.x;
+        result.y[i] = plane.y;
+        result.z[i] = plane.z;
+        result.w[i] = plane.w;
+    }
+    return result;
+}
+
+static uint32_t cullBatchScalar(const CullBatch& batch, const FrustumPlanes& planes, uint32_t* outVisible) {
+    uint32_t visibleCount = 0;
+
+    for (uint32_t i = 0; i < batch.count; i++) {
+        bool visible = true;
+
+        for (int plane = 0; plane < 6 && visible; plane++) {
+            const float sphereDistance = planes.x[plane] * batch.sphereX[i] + planes.y[plane] * batch.sphereY[i] +
+                                         planes.z[plane] * batch.sphereZ[i] + planes.w[plane];
+
+            const float boxDistance = planes.x[plane] * batch.boxCenterX[i] + planes.y[plane] * batch.boxCenterY[i] +
+                                      planes.z[plane] * batch.boxCenterZ[i] + planes.w[plane];
+            const float boxRadius = std::abs(planes.x[plane]) * batch.boxExtentX[i] +
+                                    std::abs(planes.y[plane]) * batch.boxExtentY[i] +
+                                    std::abs(planes.z[plane]) * batch.boxExtentZ[i];
+
+            visible = sphereDistance >= -batch.sphereRadius[i] && boxDistance >= -boxRadius;
+        }
+
+        if (visible) {
+            outVisible[visibleCount++] = batch.first + i;
+        }
+    }
+
+    return visibleCount;
+}
+
+#if CPU_X86
+TARGET_SSE41 static uint32_t cullBatchSSE41(const CullBatch& batch, const FrustumPlanes& planes, uint32_t* outVisible) {
+    const __m128 signMask = _mm_set1_ps(-0.f);
+    uint32_t visibleCount = 0;
+
+    for (uint32_t i = 0; i < batch.count; i += 4) {
+        const __m128 sphereX = _mm_loadu_ps(batch.sphereX + i);
+        const __m128 sphereY = _mm_loadu_ps(batch.sphereY + i);
+        const __m128 sphereZ = _mm_loadu_ps(batch.sphereZ + i);
+        const __m128 negRadius = _mm_xor_ps(_mm_loadu_ps(batch.sphereRadius + i), signMask);
+        const __m128 boxX = _mm_loadu_ps(batch.boxCenterX + i);
+        const __m128 boxY = _mm_loadu_ps(batch.boxCenterY + i);
+        const __m128 boxZ = _mm_loadu_ps(batch.boxCenterZ + i);
+        const __m128 extentX = _mm_loadu_ps(batch.boxExtentX + i);
+        const __m128 extentY = _mm_loadu_ps(batch.boxExtentY + i);
+        const __m128 extentZ = _mm_loadu_ps(batch.boxExtentZ + i);
+
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (int plane = 0; plane < 6; plane++) {
+            const __m128 planeX = _mm_set1_ps(planes.x[plane]);
+            const __m128 planeY = _mm_set1_ps(planes.y[plane]);
+            const __m128 planeZ = _mm_set1_ps(planes.z[plane]);
+            const __m128 planeW = _mm_set1_ps(planes.w[plane]);
+
+            const __m128 sphereDistance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(planeX, sphereX), _mm_mul_ps(planeY, sphereY)),
+                _mm_add_ps(_mm_mul_ps(planeZ, sphereZ), planeW));
+
+            const __m128 boxDistance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(planeX, boxX), _mm_mul_ps(planeY, boxY)),
+                _mm_add_ps(_mm_mul_ps(planeZ, boxZ), planeW));
+            const __m128 boxRadius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, planeX), extentX),
+                           _mm_mul_ps(_mm_andnot_ps(signMask, planeY), extentY)),
+                _mm_mul_ps(_mm_andnot_ps(signMask, planeZ), extentZ));
+
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(sphereDistance, negRadius));
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(boxDistance, _mm_xor_ps(boxRadius, signMask)));
+        }
+
+        // lanes past the end of the batch read padding and are masked out
+        const uint32_t laneMask = batch.count - i >= 4 ? 0xf : (1u << (batch.count - i)) - 1;
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(visible)) & laneMask;
+        while (mask) {
+            outVisible[visibleCount++] = batch.first + i + std::countr_zero(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return visibleCount;
+}
+
+TARGET_AVX2 static uint32_t cullBatchAVX2(const CullBatch& batch, const FrustumPlanes& planes, uint32_t* outVisible) {
+    const __m256 signMask = _mm256_set1_ps(-0.f);
+    uint32_t visibleCount = 0;
+
+    for (uint32_t i = 0; i < batch.count; i += 8) {
+        const __m256 sphereX = _mm256_loadu_ps(batch.sphereX + i);
+        const __m256 sphereY = _mm256_loadu_ps(batch.sphereY + i);
+        const __m256 sphereZ = _mm256_loadu_ps(batch.sphereZ + i);
+        const __m256 negRadius = _mm256_xor_ps(_mm256_loadu_ps(batch.sphereRadius + i), signMask);
+        const __m256 boxX = _mm256_loadu_ps(batch.boxCenterX + i);
+        const __m256 boxY = _mm256_loadu_ps(batch.boxCenterY + i);
+        const __m256 boxZ = _mm256_loadu_ps(batch.boxCenterZ + i);
+        const __m256 extentX = _mm256_loadu_ps(batch.boxExtentX + i);
+        const __m256 extentY = _mm256_loadu_ps(batch.boxExtentY + i);
+        const __m256 extentZ = _mm256_loadu_ps(batch.boxExtentZ + i);
+
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (int plane = 0; plane < 6; plane++) {
+            const __m256 planeX = _mm256_set1_ps(planes.x[plane]);
+            const __m256 planeY = _mm256_set1_ps(planes.y[plane]);
+            const __m256 planeZ = _mm256_set1_ps(planes.z[plane]);
+            const __m256 planeW = _mm256_set1_ps(planes.w[plane]);
+
+            const __m256 sphereDistance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(planeX, sphereX), _mm256_mul_ps(planeY, sphereY)),
+                _mm256_add_ps(_mm256_mul_ps(planeZ, sphereZ), planeW));
+
+            const __m256 boxDistance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(planeX, boxX), _mm256_mul_ps(planeY, boxY)),
+                _mm256_add_ps(_mm256_mul_ps(planeZ, boxZ), planeW));
+            const __m256 boxRadius = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, planeX), extentX),
+                              _mm256_mul_ps(_mm256_andnot_ps(signMask, planeY), extentY)),
+                _mm256_mul_ps(_mm256_andnot_ps(signMask, planeZ), extentZ));
+
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(sphereDistance, negRadius, _CMP_GE_OQ));
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(boxDistance, _mm256_xor_ps(boxRadius, signMask), _CMP_GE_OQ));
+        }
+
+        // lanes past the end of the batch read padding and are masked out
+        const uint32_t laneMask = batch.count - i >= 8 ? 0xff : (1u << (batch.count - i)) - 1;
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(visible)) & laneMask;
+        while (mask) {
+            outVisible[visibleCount++] = batch.first + i + std::countr_zero(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return visibleCount;
+}
+#endif
+
+void FrustumCuller::init(JobSystem* jobSystem) {
+    m_jobSystem = jobSystem;
+    m_simdLevel = CpuFeatures::getSimdLevel();
+}
+
+uint32_t FrustumCuller::addObject(const glm::mat4& transform, const glm::vec4& boundingSphere) {
+    const uint32_t index = m_count++;
+
+    const size_t paddedCount = (m_count + 7) & ~size_t{7};
+    for (std::vector<float>* array : {&m_sphereX, &m_sphereY, &m_sphereZ, &m_sphereRadius,
+                                      &m_boxCenterX, &m_boxCenterY, &m_boxCenterZ,
+                                      &m_boxExtentX, &m_boxExtentY, &m_boxExtentZ}) {
+        array->resize(paddedCount, 0.f);
+    }
+
+    setObject(index, transform, boundingSphere);
+    return index;
+}
+
+void FrustumCuller::setObject(uint32_t index, const glm::mat4& transform, const glm::vec4& boundingSphere) {
+    const glm::vec3 center = transform * glm::vec4(glm::vec3(boundingSphere), 1.f);
+    const float radius = boundingSphere.w;
+
+    const glm::vec3 axisX{transform[0]};
+    const glm::vec3 axisY{transform[1]};
+    const glm::vec3 axisZ{transform[2]};
+
+    m_sphereX[index] = center.x;
+    m_sphereY[index] = center.y;
+    m_sphereZ[index] = center.z;
+    m_sphereRadius[index] = radius * std::max({glm::length(axisX), glm::length(axisY), glm::length(axisZ)});
+
+    // world box around the transformed cube that encloses the sphere, tighter under non uniform scale
+    m_boxCenterX[index] = center.x;
+    m_boxCenterY[index] = center.y;
+    m_boxCenterZ[index] = center.z;
+    m_boxExtentX[index] = radius * (std::abs(axisX.x) + std::abs(axisY.x) + std::abs(axisZ.x));
+    m_boxExtentY[index] = radius * (std::abs(axisX.y) + std::abs(axisY.y) + std::abs(axisZ.y));
+    m_boxExtentZ[index] = radius * (std::abs(axisX.z) + std::abs(axisY.z) + std::abs(axisZ.z));
+}
+
+void FrustumCuller::clear() {
+    m_count = 0;
+    for (std::vector<float>* array : {&m_sphereX, &m_sphereY, &m_sphereZ, &m_sphereRadius,
+                                      &m_boxCenterX, &m_boxCenterY, &m_boxCenterZ,
+                                      &m_boxExtentX, &m_boxExtentY, &m_boxExtentZ}) {
+        array->clear();
+    }
+}
+
+void FrustumCuller::cull(const glm::mat4& viewProj, std::vector<uint32_t>& outVisible) {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const FrustumPlanes planes = extractPlanes(viewProj);
+
+    const uint32_t batchCount = (m_count + FRUSTUM_CULL_BATCH - 1) / FRUSTUM_CULL_BATCH;
+    m_batchVisible.resize(batchCount * FRUSTUM_CULL_BATCH);
+    m_batchCounts.resize(batchCount);
+
+    m_jobSystem->parallelFor(batchCount, 1, [&](uint32_t batchBegin, uint32_t batchEnd) {
+        for (uint32_t batchIndex = batchBegin; batchIndex < batchEnd; batchIndex++) {
+            const uint32_t first = batchIndex * FRUSTUM_CULL_BATCH;
+            const CullBatch batch{
+                .sphereX = m_sphereX.data() + first,
+                .sphereY = m_sphereY.data() + first,
+                .sphereZ = m_sphereZ.data() + first,
+                .sphereRadius = m_sphereRadius.data() + first,
+                .boxCenterX = m_boxCenterX.data() + first,
+                .boxCenterY = m_boxCenterY.data() + first,
+                .boxCenterZ = m_boxCenterZ.data() + first,
+                .boxExtentX = m_boxExtentX.data() + first,
+                .boxExtentY = m_boxExtentY.data() + first,
+                .boxExtentZ = m_boxExtentZ.data() + first,
+                .first = first,
+                .count = std::min(FRUSTUM_CULL_BATCH, m_count - first),
+            };
+
+            uint32_t* batchVisible = m_batchVisible.data() + first;
+
+            switch (m_simdLevel) {
+#if CPU_X86
+                case SimdLevel::AVX2:
+                    m_batchCounts[batchIndex] = cullBatchAVX2(batch, planes, batchVisible);
+                    break;
+                case SimdLevel::SSE41:
+                    m_batchCounts[batchIndex] = cullBatchSSE41(batch, planes, batchVisible);
+                    break;
+#endif
+                default:
+                    m_batchCounts[batchIndex] = cullBatchScalar(batch, planes, batchVisible);
+                    break;
+            }
+        }
+    });
+
+    // stitch the batches together, they are already sorted
+    outVisible.clear();
+    for (uint32_t batchIndex = 0; batchIndex < batchCount; batchIndex++) {
+        const uint32_t* batchVisible = m_batchVisible.data() + batchIndex * FRUSTUM_CULL_BATCH;
+        outVisible.insert(outVisible.end(), batchVisible, batchVisible + m_batchCounts[batchIndex]);
+    }
+
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    m_stats.testedObjects = m_count;
+    m_stats.visibleObjects = static_cast<uint32_t>(outVisible.size());
+    m_stats.milliseconds = std::chrono::duration<float, std::milli>(end - start).count();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+#include "VkTypes.hpp"
+#include "CpuFeatures.hpp"
+
+class JobSystem;
+
+// objects are tested in batches, every batch compacts its survivors on its own thread
+constexpr uint32_t FRUSTUM_CULL_BATCH = 256;
+
+struct FrustumCullStats {
+    uint32_t testedObjects = 0;
+    uint32_t visibleObjects = 0;
+    float milliseconds = 0.f;
+};
+
+// CPU frustum culling over world space bounds kept as structure of arrays, so one SIMD register
+// holds the same component of 8 objects. An object is visible if both its bounding sphere and its
+// box are on the inner side of every plane. Used when the GPU does not cull the draws itself and
+// as the broad phase of CPU side systems
+class FrustumCuller {
+public:
+    void init(JobSystem* jobSystem);
+
+    // returns the index the object is culled as, which is also its index in the visible list
+    uint32_t addObject(const glm::mat4& transform, const glm::vec4& boundingSphere);
+    // boundingSphere is in object space, the world sphere and box are derived from the transform
+    void setObject(uint32_t index, const glm::mat4& transform, const glm::vec4& boundingSphere);
+    void clear();
+
+    // replaces outVisible with the indices of all objects inside the frustum, in ascending order
+    void cull(const glm::mat4& viewProj, std::vector<uint32_t>& outVisible);
+
+    [[nodiscard]] uint32_t getObjectCount() const { return m_count; }
+    [[nodiscard]] const FrustumCullStats& getStats() const { return m_stats; }
+    [[nodiscard]] SimdLevel getSimdLevel() const { return m_simdLevel; }
+
+private:
+    JobSystem* m_jobSystem = nullptr;
+    SimdLevel m_simdLevel = SimdLevel::Scalar;
+
+    uint32_t m_count = 0;
+
+    // every array is padded to a multiple of 8 so the last batch loads whole registers
+    std::vector<float> m_sphereX;
+    std::vector<float> m_sphereY;
+    std::vector<float> m_sphereZ;
+    std::vector<float> m_sphereRadius;
+    std::vector<float> m_boxCenterX;
+    std::vector<float> m_boxCenterY;
+    std::vector<float> m_boxCenterZ;
+    std::vector<float> m_boxExtentX;
+    std::vector<float> m_boxExtentY;
+    std::vector<float> m_boxExtentZ;
+
+    // per batch survivors, FRUSTUM_CULL_BATCH slots each
+    std::vector<uint32_t> m_batchVisible;
+    std::vector<uint32_t> m_batchCounts;
+
+    FrustumCullStats m_stats;
+};
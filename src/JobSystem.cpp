@@ -0,0 +1,257 @@
+#include "JobSystem.hpp"
+
+#include <cassert>
+#include <iostream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// spins before a worker without work goes to sleep
+constexpr uint32_t JOB_IDLE_SPINS = 256;
+
+static thread_local uint32_t s_threadIndex = UINT32_MAX;
+static thread_local uint32_t s_nextJob = 0;
+static thread_local uint32_t s_stealSeed = 0;
+
+static void pinThread(std::jthread& thread, uint32_t core) {
+#if defined(_WIN32)
+    if (SetThreadAffinityMask(thread.native_handle(), DWORD_PTR{1} << (core % 64)) == 0) {
+        std::cerr << "Failed to pin job thread to core " << core << std::endl;
+    }
+#elif defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core, &cpuSet);
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuSet) != 0) {
+        std::cerr << "Failed to pin job thread to core " << core << std::endl;
+    }
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
+
+void JobQueue::push(Job* job) {
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    // queued jobs hold a slot of the owner's pool, which has as many slots as the deque
+    assert(bottom - m_top.load(std::memory_order_relaxed) < JOB_QUEUE_SIZE && "job queue overflow");
+    m_jobs[bottom & (JOB_QUEUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+
+    // the job has to be visible before a thief can see the new bottom
+    m_bottom.store(bottom + 1, std::memory_order_release);
+}
+
+Job* JobQueue::pop() {
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        // already empty
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_jobs[bottom & (JOB_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+    if (top != bottom) {
+        return job;
+    }
+
+    // last job, race the thieves for it
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        job = nullptr;
+    }
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    return job;
+}
+
+Job* JobQueue::steal() {
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom) {
+        return nullptr;
+    }
+
+    Job* job = m_jobs[top & (JOB_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return job;
+}
+
+void JobSystem::init(uint32_t workerCount, bool pinThreads) {
+    if (workerCount == 0) {
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    const uint32_t threadCount = workerCount + 1;
+    for (uint32_t i = 0; i < threadCount; i++) {
+        m_queues.push_back(std::make_unique<JobQueue>());
+        m_jobPools.push_back(std::make_unique<Job[]>(JOB_QUEUE_SIZE));
+    }
+
+    // the calling thread is thread 0, it submits and helps out while waiting
+    s_threadIndex = 0;
+    s_stealSeed = 1;
+    m_running = true;
+
+    m_workers.reserve(workerCount);
+    for (uint32_t i = 1; i < threadCount; i++) {
+        m_workers.emplace_back([this, i] { workerLoop(i); });
+        if (pinThreads) {
+            pinThread(m_workers.back(), i);
+        }
+    }
+}
+
+void JobSystem::shutdown() {
+    // the owners free what queued jobs touch right after this, so they all run first
+    while (!isIdle()) {
+        helpOut();
+    }
+
+    m_running = false;
+    m_wakeSignal.fetch_add(1);
+    m_wakeSignal.notify_all();
+
+    m_workers.clear();
+    m_queues.clear();
+    m_jobPools.clear();
+}
+
+Job* JobSystem::allocateJob() {
+    assert(s_threadIndex < m_jobPools.size() && "jobs can only be submitted from job system threads");
+
+    // slots free up out of order, a long job keeps its slot while the ring is reused around it.
+    // The acquire pairs with execute's release, the previous job is fully done with the slot
+    Job* pool = m_jobPools[s_threadIndex].get();
+    while (true) {
+        for (uint32_t i = 0; i < JOB_QUEUE_SIZE; i++) {
+            Job* job = &pool[s_nextJob++ & (JOB_QUEUE_SIZE - 1)];
+            if (job->function.load(std::memory_order_acquire) == nullptr) {
+                return job;
+            }
+        }
+
+        // every job this thread submitted is still queued or running
+        helpOut();
+    }
+}
+
+bool JobSystem::isIdle() const {
+    for (const std::unique_ptr<Job[]>& pool : m_jobPools) {
+        for (uint32_t i = 0; i < JOB_QUEUE_SIZE; i++) {
+            if (pool[i].function.load(std::memory_order_acquire) != nullptr) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void JobSystem::helpOut() {
+    if (Job* job = findJob()) {
+        execute(job);
+    } else {
+        std::this_thread::yield();
+    }
+}
+
+void JobSystem::submit(Job* job) {
+    m_queues[s_threadIndex]->push(job);
+
+    // pairs with the sleeping worker's last look, either it sees the job or we see it asleep.
+    // Only pay for the wake up when somebody is asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleepingWorkers.load() > 0) {
+        m_wakeSignal.fetch_add(1);
+        m_wakeSignal.notify_one();
+    }
+}
+
+Job* JobSystem::findJob() {
+    if (Job* job = m_queues[s_threadIndex]->pop()) {
+        return job;
+    }
+
+    // xorshift, picks where to start stealing so the thieves spread out
+    s_stealSeed ^= s_stealSeed << 13;
+    s_stealSeed ^= s_stealSeed >> 17;
+    s_stealSeed ^= s_stealSeed << 5;
+
+    const auto queueCount = static_cast<uint32_t>(m_queues.size());
+    for (uint32_t i = 0; i < queueCount; i++) {
+        const uint32_t victim = (s_stealSeed + i) % queueCount;
+        if (victim == s_threadIndex) {
+            continue;
+        }
+        if (Job* job = m_queues[victim]->steal()) {
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+void JobSystem::execute(Job* job) {
+    // the slot can be reused as soon as it is released, so nothing is read from it afterwards
+    JobCounter* counter = job->counter;
+    job->function.load(std::memory_order_relaxed)(job->data);
+    job->function.store(nullptr, std::memory_order_release);
+
+    if (counter) {
+        counter->m_pending.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void JobSystem::wait(const JobCounter& counter) {
+    while (!counter.isDone()) {
+        helpOut();
+    }
+}
+
+void JobSystem::workerLoop(uint32_t threadIndex) {
+    s_threadIndex = threadIndex;
+    s_stealSeed = threadIndex * 2654435761u + 1;
+
+    uint32_t idleSpins = 0;
+    while (m_running.load(std::memory_order_relaxed)) {
+        if (Job* job = findJob()) {
+            execute(job);
+            idleSpins = 0;
+            continue;
+        }
+
+        if (++idleSpins < JOB_IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // announce the sleep before the last look, a job pushed in between then always wakes us
+        const uint32_t signal = m_wakeSignal.load();
+        m_sleepingWorkers.fetch_add(1);
+
+        if (Job* job = findJob()) {
+            m_sleepingWorkers.fetch_sub(1);
+            execute(job);
+            idleSpins = 0;
+            continue;
+        }
+
+        if (m_running.load()) {
+            m_wakeSignal.wait(signal);
+        }
+        m_sleepingWorkers.fetch_sub(1);
+        idleSpins = 0;
+    }
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// capacity of every worker's deque and job pool, the number of jobs one thread may have queued or running
+constexpr uint32_t JOB_QUEUE_SIZE = 4096;
+// bytes a job can capture by value
+constexpr size_t JOB_DATA_SIZE = 48;
+// parallelFor never splits into more jobs than this, whatever the grain
+constexpr uint32_t MAX_PARALLEL_FOR_JOBS = 256;
+
+// counts the unfinished jobs of a group. Jobs that depend on a group wait on its counter,
+// the waiting thread keeps running other jobs meanwhile
+class JobCounter {
+public:
+    [[nodiscard]] bool isDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_pending{0};
+};
+
+// one cache line: the call thunk, the counter to signal and the captured callable. The thunk is set while
+// the job is queued or running, a slot is only reused once it is cleared again
+struct alignas(64) Job {
+    std::atomic<void (*)(void* data)> function;
+    JobCounter* counter;
+    alignas(16) std::byte data[JOB_DATA_SIZE];
+};
+
+// Chase-Lev work stealing deque. The owning thread pushes and pops at the bottom, other threads
+// steal from the top
+class JobQueue {
+public:
+    void push(Job* job);
+    Job* pop();
+    Job* steal();
+
+private:
+    alignas(64) std::atomic<int64_t> m_top{0};
+    alignas(64) std::atomic<int64_t> m_bottom{0};
+    std::atomic<Job*> m_jobs[JOB_QUEUE_SIZE]{};
+};
+
+// work stealing thread pool shared by every subsystem. Each thread owns a deque and a ring of job
+// slots, so submitting a job never locks or allocates. A thread whose slots are all taken runs other
+// jobs until one frees up. The thread calling init takes part as thread 0, and only it and the
+// workers may submit jobs
+class JobSystem {
+public:
+    // workerCount 0 uses one worker per remaining hardware thread
+    void init(uint32_t workerCount = 0, bool pinThreads = false);
+    // runs every job still queued, including the ones they submit, then stops the workers
+    void shutdown();
+
+    // fn is copied into the job, it must fit JOB_DATA_SIZE bytes
+    template<typename Fn>
+    void run(Fn&& fn, JobCounter* counter = nullptr);
+
+    // runs other jobs until every job of the counter has finished
+    void wait(const JobCounter& counter);
+
+    // splits [0, count) into chunks of at least grain items and runs fn(begin, end) on them,
+    // returns once every chunk is done. The calling thread takes the first chunk
+    template<typename Fn>
+    void parallelFor(uint32_t count, uint32_t grain, const Fn& fn);
+
+    // co_await continues the coroutine on a worker thread
+    auto schedule() noexcept {
+        struct Awaiter {
+            JobSystem& jobSystem;
+
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { jobSystem.run([handle] { handle.resume(); }); }
+            void await_resume() noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    [[nodiscard]] uint32_t getThreadCount() const { return static_cast<uint32_t>(m_queues.size()); }
+
+private:
+    Job* allocateJob();
+    [[nodiscard]] bool isIdle() const;
+    void helpOut();
+    void submit(Job* job);
+    Job* findJob();
+    void execute(Job* job);
+    void workerLoop(uint32_t threadIndex);
+
+    std::vector<std::unique_ptr<JobQueue>> m_queues;
+    std::vector<std::unique_ptr<Job[]>> m_jobPools;
+    std::vector<std::jthread> m_workers;
+
+    std::atomic<bool> m_running{false};
+    // bumped on every submit while a worker sleeps, workers wait for it to change
+    std::atomic<uint32_t> m_wakeSignal{0};
+    std::atomic<uint32_t> m_sleepingWorkers{0};
+};
+
+template<typename Fn>
+void JobSystem::run(Fn&& fn, JobCounter* counter) {
+    using Callable = std::decay_t<Fn>;
+    static_assert(sizeof(Callable) <= JOB_DATA_SIZE, "job captures do not fit into the job");
+    static_assert(alignof(Callable) <= 16, "job captures are over aligned");
+
+    Job* job = allocateJob();
+    new (job->data) Callable(std::forward<Fn>(fn));
+    job->counter = counter;
+    // submit publishes the job, the store only has to mark the slot as taken
+    job->function.store([](void* data) {
+        auto* callable = std::launder(static_cast<Callable*>(data));
+        (*callable)();
+        callable->~Callable();
+    }, std::memory_order_relaxed);
+
+    if (counter) {
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    submit(job);
+}
+
+template<typename Fn>
+void JobSystem::parallelFor(uint32_t count, uint32_t grain, const Fn& fn) {
+    if (count == 0) {
+        return;
+    }
+
+    grain = std::max({grain, 1u, (count + MAX_PARALLEL_FOR_JOBS - 1) / MAX_PARALLEL_FOR_JOBS});
+
+    JobCounter counter;
+    for (uint32_t begin = grain; begin < count; begin += grain) {
+        const uint32_t end = std::min(begin + grain, count);
+        run([&fn, begin, end] { fn(begin, end); }, &counter);
+    }
+
+    fn(0u, std::min(grain, count));
+    wait(counter);
+}
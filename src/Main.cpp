@@ -1,9 +1,57 @@
+#include <charconv>
+#include <format>
+#include <iostream>
+
 #include "VkEngine.hpp"
 
-int main() {
+int main(int argc, char* argv[]) {
     VulkanEngine engine;
 
+    // --gpu=<index or name> picks the device, --stream=<base path> adds a mesh streamed from its LOD files,
+    // --vtex=<file> puts a virtual texture on the floor, --metrics=<port> serves Prometheus metrics on localhost,
+    // --record=<file> records every presented frame as raw video, every other argument is a glTF file to stream
+    // into the scene
+    std::vector<std::string> assets;
+    std::vector<std::string> streamedMeshes;
+    std::string virtualTexture;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view argument = argv[i];
+        if (argument.starts_with("--gpu=")) {
+            engine.setPreferredGpu(std::string(argument.substr(6)));
+        } else if (argument.starts_with("--stream=")) {
+            streamedMeshes.emplace_back(argument.substr(9));
+        } else if (argument.starts_with("--vtex=")) {
+            virtualTexture = argument.substr(7);
+        } else if (argument.starts_with("--metrics=")) {
+            // port 0 would leave the metrics off without saying so
+            const std::string_view value = argument.substr(10);
+            uint16_t port = 0;
+            const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), port);
+            if (error != std::errc{} || end != value.data() + value.size() || port == 0) {
+                std::cerr << std::format("Invalid value for --metrics: {}, expected a port from 1 to 65535", value)
+                        << std::endl;
+                return 1;
+            }
+            engine.setMetricsPort(port);
+        } else if (argument.starts_with("--record=")) {
+            engine.setRecordingPath(std::string(argument.substr(9)));
+        } else {
+            assets.emplace_back(argument);
+        }
+    }
+
     engine.init();
+
+    for (const std::string& asset : assets) {
+        engine.loadAsset(asset);
+    }
+    for (const std::string& mesh : streamedMeshes) {
+        engine.streamMesh(mesh);
+    }
+    if (!virtualTexture.empty()) {
+        engine.loadVirtualTexture(virtualTexture);
+    }
+
     engine.run();
     engine.cleanup();
 
@@ -0,0 +1,68 @@
+#include "MeshLod.hpp"
+
+#include <fstream>
+
+bool saveMeshLod(
+    const std::filesystem::path& path,
+    std::span<const Vertex> vertices,
+    std::span<const uint32_t> indices
+) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    const MeshLodHeader header{
+        .magic = MESH_LOD_MAGIC,
+        .vertexCount = static_cast<uint32_t>(vertices.size()),
+        .indexCount = static_cast<uint32_t>(indices.size()),
+        .reserved = 0,
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(vertices.data()), static_cast<std::streamsize>(vertices.size_bytes()));
+    file.write(reinterpret_cast<const char*>(indices.data()), static_cast<std::streamsize>(indices.size_bytes()));
+    return file.good();
+}
+
+bool loadMeshLodHeader(const std::filesystem::path& path, MeshLodHeader& outHeader) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.read(reinterpret_cast<char*>(&outHeader), sizeof(outHeader));
+    return file.good() && outHeader.magic == MESH_LOD_MAGIC;
+}
+
+bool loadMeshLod(
+    const std::filesystem::path& path,
+    std::vector<Vertex>& outVertices,
+    std::vector<uint32_t>& outIndices
+) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    const auto fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    MeshLodHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file.good() || header.magic != MESH_LOD_MAGIC) {
+        return false;
+    }
+
+    // a truncated file must not make us read past its end
+    const uint64_t expectedSize = sizeof(header) + header.vertexCount * sizeof(Vertex) +
+                                  header.indexCount * sizeof(uint32_t);
+    if (fileSize < expectedSize) {
+        return false;
+    }
+
+    outVertices.resize(header.vertexCount);
+    outIndices.resize(header.indexCount);
+    file.read(reinterpret_cast<char*>(outVertices.data()), static_cast<std::streamsize>(header.vertexCount * sizeof(Vertex)));
+    file.read(reinterpret_cast<char*>(outIndices.data()), static_cast<std::streamsize>(header.indexCount * sizeof(uint32_t)));
+    return file.good();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "VkTypes.hpp"
+
+// identifies a LOD file: MeshLodHeader, then the vertices and the indices
+constexpr uint32_t MESH_LOD_MAGIC = 0x444F4C48; // "HLOD"
+
+struct MeshLodHeader {
+    uint32_t magic;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t reserved;
+};
+
+// one LOD of a streamed mesh, written by Hellfire-Bake and read by the MeshStreamer
+bool saveMeshLod(const std::filesystem::path& path, std::span<const Vertex> vertices,
+                 std::span<const uint32_t> indices);
+bool loadMeshLodHeader(const std::filesystem::path& path, MeshLodHeader& outHeader);
+bool loadMeshLod(const std::filesystem::path& path, std::vector<Vertex>& outVertices,
+                 std::vector<uint32_t>& outIndices);
@@ -0,0 +1,386 @@
+#include "OcclusionCuller.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#if CPU_X86
+#include <immintrin.h>
+#endif
+
+#include "JobSystem.hpp"
+
+// triangles and bounds reaching behind this clip space w are not projected
+constexpr float OCCLUSION_NEAR_W = 1e-3f;
+constexpr uint32_t OCCLUSION_TEST_CHUNK = 64;
+
+// coverage of the tile whose top left pixel is (tileX, tileY), bit y * 8 + x is set when the center of
+// that pixel is inside. The row terms are hoisted the same way as in the SIMD paths, so every path rounds alike
+static uint64_t coverTileScalar(const OcclusionTriangle& t, float tileX, float tileY) {
+    uint64_t coverage = 0;
+    for (uint32_t y = 0; y < OCCLUSION_TILE_SIZE; y++) {
+        const float py = tileY + (static_cast<float>(y) + 0.5f);
+
+        float edgeRow[3];
+        for (int edge = 0; edge < 3; edge++) {
+            edgeRow[edge] = t.edgeB[edge] * py + t.edgeC[edge];
+        }
+
+        for (uint32_t x = 0; x < OCCLUSION_TILE_SIZE; x++) {
+            const float px = tileX + (static_cast<float>(x) + 0.5f);
+
+            bool inside = true;
+            for (int edge = 0; edge < 3; edge++) {
+                inside &= t.edgeA[edge] * px + edgeRow[edge] >= 0.f;
+            }
+            coverage |= static_cast<uint64_t>(inside) << (y * OCCLUSION_TILE_SIZE + x);
+        }
+    }
+    return coverage;
+}
+
+#if CPU_X86
+TARGET_SSE41 static uint64_t coverTileSSE41(const OcclusionTriangle& t, float tileX, float tileY) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 px[2] = {
+        _mm_add_ps(_mm_set1_ps(tileX), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f)),
+        _mm_add_ps(_mm_set1_ps(tileX), _mm_setr_ps(4.5f, 5.5f, 6.5f, 7.5f)),
+    };
+
+    __m128 edgeA[3];
+    for (int edge = 0; edge < 3; edge++) {
+        edgeA[edge] = _mm_set1_ps(t.edgeA[edge]);
+    }
+
+    uint64_t coverage = 0;
+    for (uint32_t y = 0; y < OCCLUSION_TILE_SIZE; y++) {
+        const float py = tileY + (static_cast<float>(y) + 0.5f);
+
+        __m128 edgeRow[3];
+        for (int edge = 0; edge < 3; edge++) {
+            edgeRow[edge] = _mm_set1_ps(t.edgeB[edge] * py + t.edgeC[edge]);
+        }
+
+        // a row of the tile is two registers
+        for (uint32_t half = 0; half < 2; half++) {
+            __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], px[half]), edgeRow[0]), zero);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], px[half]), edgeRow[1]), zero));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], px[half]), edgeRow[2]), zero));
+
+            coverage |= static_cast<uint64_t>(_mm_movemask_ps(inside)) << (y * OCCLUSION_TILE_SIZE + half * 4);
+        }
+    }
+    return coverage;
+}
+
+TARGET_AVX2 static uint64_t coverTileAVX2(const OcclusionTriangle& t, float tileX, float tileY) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 px = _mm256_add_ps(_mm256_set1_ps(tileX),
+                                    _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+
+    __m256 edgeA[3];
+    for (int edge = 0; edge < 3; edge++) {
+        edgeA[edge] = _mm256_set1_ps(t.edgeA[edge]);
+    }
+
+    uint64_t coverage = 0;
+    for (uint32_t y = 0; y < OCCLUSION_TILE_SIZE; y++) {
+        const float py = tileY + (static_cast<float>(y) + 0.5f);
+
+        __m256 edgeRow[3];
+        for (int edge = 0; edge < 3; edge++) {
+            edgeRow[edge] = _mm256_set1_ps(t.edgeB[edge] * py + t.edgeC[edge]);
+        }
+
+        __m256 inside = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edgeA[0], px), edgeRow[0]), zero, _CMP_GE_OQ);
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edgeA[1], px), edgeRow[1]), zero, _CMP_GE_OQ));
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edgeA[2], px), edgeRow[2]), zero, _CMP_GE_OQ));
+
+        // one row of the tile is one register
+        coverage |= static_cast<uint64_t>(_mm256_movemask_ps(inside)) << (y * OCCLUSION_TILE_SIZE);
+    }
+    return coverage;
+}
+#endif
+
+// farthest depth of the triangle's plane over the pixel centers of the tile, no farther than its farthest vertex
+static float getTileDepth(const OcclusionTriangle& t, float tileX, float tileY) {
+    constexpr float last = static_cast<float>(OCCLUSION_TILE_SIZE) - 0.5f;
+    const float depthX = std::max(t.depthA * (tileX + 0.5f), t.depthA * (tileX + last));
+    const float depthY = std::max(t.depthB * (tileY + 0.5f), t.depthB * (tileY + last));
+    return std::min(depthX + depthY + t.depthC, t.maxDepth);
+}
+
+// adds the covered part of a triangle to the working layer, which replaces the committed depth once the
+// whole tile is covered. Every layer keeps its farthest depth, so the result stays conservative
+static void mergeIntoTile(OcclusionTile& tile, uint64_t coverage, float depth) {
+    tile.coverage |= coverage;
+    tile.workingDepth = std::max(tile.workingDepth, depth);
+
+    if (tile.coverage == ~0ull) {
+        tile.committedDepth = std::min(tile.committedDepth, tile.workingDepth);
+        tile.coverage = 0;
+        tile.workingDepth = 0.f;
+    }
+}
+
+void OcclusionCuller::init(JobSystem* jobSystem, VkExtent2D viewExtent) {
+    m_jobSystem = jobSystem;
+    m_simdLevel = CpuFeatures::getSimdLevel();
+
+    // the buffer is made of whole tiles, so both sizes are multiples of the tile size
+    m_width = OCCLUSION_BUFFER_WIDTH;
+    const uint32_t height = OCCLUSION_BUFFER_WIDTH * viewExtent.height / std::max(viewExtent.width, 1u);
+    m_height = std::max((height + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE, 1u) * OCCLUSION_TILE_SIZE;
+
+    m_tilesX = m_width / OCCLUSION_TILE_SIZE;
+    m_tilesY = m_height / OCCLUSION_TILE_SIZE;
+
+    m_tiles.resize(m_tilesX * m_tilesY);
+}
+
+uint32_t OcclusionCuller::addOccluderMesh(std::span<const glm::vec3> positions, std::span<const uint32_t> indices) {
+    m_meshes.push_back(OccluderMesh{
+        .positions = {positions.begin(), positions.end()},
+        .indices = {indices.begin(), indices.end()},
+    });
+    return static_cast<uint32_t>(m_meshes.size() - 1);
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& viewProj) {
+    m_viewProj = viewProj;
+    m_stats.occluderTriangles = 0;
+    m_stats.rasterMilliseconds = 0.f;
+
+    m_triangles.clear();
+    std::fill(m_tiles.begin(), m_tiles.end(), OcclusionTile{
+        .coverage = 0,
+        .workingDepth = 0.f,
+        .committedDepth = FLT_MAX,
+    });
+}
+
+void OcclusionCuller::rasterizeOccluder(uint32_t meshId, const glm::mat4& transform) {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const OccluderMesh& mesh = m_meshes[meshId];
+    const glm::mat4 worldViewProj = m_viewProj * transform;
+
+    m_clipVertices.resize(mesh.positions.size());
+    for (size_t i = 0; i < mesh.positions.size(); i++) {
+        m_clipVertices[i] = worldViewProj * glm::vec4(mesh.positions[i], 1.f);
+    }
+
+    const auto width = static_cast<float>(m_width);
+    const auto height = static_cast<float>(m_height);
+
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        ScreenVertex screen[3];
+        bool behindNear = false;
+
+        for (int corner = 0; corner < 3; corner++) {
+            const glm::vec4& clip = m_clipVertices[mesh.indices[i + corner]];
+            // skipping a clipped occluder is conservative, it only hides less
+            if (clip.w <= OCCLUSION_NEAR_W) {
+                behindNear = true;
+                break;
+            }
+
+            const float invW = 1.f / clip.w;
+            screen[corner] = {
+                (clip.x * invW * 0.5f + 0.5f) * width,
+                (clip.y * invW * 0.5f + 0.5f) * height,
+                clip.z * invW,
+            };
+        }
+
+        if (!behindNear) {
+            setupTriangle(screen[0], screen[1], screen[2]);
+        }
+    }
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    m_stats.rasterMilliseconds += std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void OcclusionCuller::setupTriangle(ScreenVertex v0, ScreenVertex v1, ScreenVertex v2) {
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (std::abs(area) < 1e-6f) {
+        return;
+    }
+
+    // occluders are rasterized double sided, flip to a positive area so inside means all edges >= 0
+    if (area < 0.f) {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    const int minX = std::max(static_cast<int>(std::floor(std::min({v0.x, v1.x, v2.x}))), 0);
+    const int maxX = std::min(static_cast<int>(std::ceil(std::max({v0.x, v1.x, v2.x}))), static_cast<int>(m_width));
+    const int minY = std::max(static_cast<int>(std::floor(std::min({v0.y, v1.y, v2.y}))), 0);
+    const int maxY = std::min(static_cast<int>(std::ceil(std::max({v0.y, v1.y, v2.y}))), static_cast<int>(m_height));
+
+    if (minX >= maxX || minY >= maxY) {
+        return;
+    }
+
+    m_stats.occluderTriangles++;
+
+    OcclusionTriangle setup{};
+    setup.maxDepth = std::max({v0.z, v1.z, v2.z});
+    setup.tileMinX = static_cast<uint32_t>(minX) / OCCLUSION_TILE_SIZE;
+    setup.tileMaxX = static_cast<uint32_t>(maxX - 1) / OCCLUSION_TILE_SIZE;
+    setup.tileMinY = static_cast<uint32_t>(minY) / OCCLUSION_TILE_SIZE;
+    setup.tileMaxY = static_cast<uint32_t>(maxY - 1) / OCCLUSION_TILE_SIZE;
+    const ScreenVertex* vertices[3] = {&v0, &v1, &v2};
+
+    // edge i runs from vertex i to vertex i + 1 and is positive on the side of the opposite vertex
+    for (int edge = 0; edge < 3; edge++) {
+        const ScreenVertex& a = *vertices[edge];
+        const ScreenVertex& b = *vertices[(edge + 1) % 3];
+        setup.edgeA[edge] = -(b.y - a.y);
+        setup.edgeB[edge] = b.x - a.x;
+        setup.edgeC[edge] = -setup.edgeA[edge] * a.x - setup.edgeB[edge] * a.y;
+    }
+
+    // barycentrics of v1 and v2 are the edges 2 -> 0 and 0 -> 1 divided by the area
+    const float invArea = 1.f / area;
+    const float dz1 = (v1.z - v0.z) * invArea;
+    const float dz2 = (v2.z - v0.z) * invArea;
+    setup.depthA = dz1 * setup.edgeA[2] + dz2 * setup.edgeA[0];
+    setup.depthB = dz1 * setup.edgeB[2] + dz2 * setup.edgeB[0];
+    setup.depthC = v0.z + dz1 * setup.edgeC[2] + dz2 * setup.edgeC[0];
+
+    m_triangles.push_back(setup);
+}
+
+void OcclusionCuller::rasterizeTileRow(uint32_t tileY) {
+    OcclusionTile* row = m_tiles.data() + tileY * m_tilesX;
+    const auto tileYPixels = static_cast<float>(tileY * OCCLUSION_TILE_SIZE);
+
+    for (const OcclusionTriangle& triangle : m_triangles) {
+        if (tileY < triangle.tileMinY || tileY > triangle.tileMaxY) {
+            continue;
+        }
+
+        for (uint32_t tileX = triangle.tileMinX; tileX <= triangle.tileMaxX; tileX++) {
+            OcclusionTile& tile = row[tileX];
+            const auto tileXPixels = static_cast<float>(tileX * OCCLUSION_TILE_SIZE);
+
+            // behind what already hides the whole tile, the triangle cannot hide any more
+            const float depth = getTileDepth(triangle, tileXPixels, tileYPixels);
+            if (depth >= tile.committedDepth) {
+                continue;
+            }
+
+            uint64_t coverage;
+            switch (m_simdLevel) {
+#if CPU_X86
+                case SimdLevel::AVX2:
+                    coverage = coverTileAVX2(triangle, tileXPixels, tileYPixels);
+                    break;
+                case SimdLevel::SSE41:
+                    coverage = coverTileSSE41(triangle, tileXPixels, tileYPixels);
+                    break;
+#endif
+                default:
+                    coverage = coverTileScalar(triangle, tileXPixels, tileYPixels);
+                    break;
+            }
+
+            if (coverage != 0) {
+                mergeIntoTile(tile, coverage, depth);
+            }
+        }
+    }
+}
+
+void OcclusionCuller::endFrame() {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    // a row of tiles only ever belongs to one job, so the tiles need no synchronization
+    m_jobSystem->parallelFor(m_tilesY, 1, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t tileY = begin; tileY < end; tileY++) {
+            rasterizeTileRow(tileY);
+        }
+    });
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    m_stats.rasterMilliseconds += std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+bool OcclusionCuller::isOccluded(const RenderObject& object) const {
+    const glm::vec3 center = object.transform * glm::vec4(glm::vec3(object.boundingSphere), 1.f);
+    const float scale = std::max({
+        glm::length(glm::vec3(object.transform[0])),
+        glm::length(glm::vec3(object.transform[1])),
+        glm::length(glm::vec3(object.transform[2])),
+    });
+    const float radius = object.boundingSphere.w * scale;
+
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+    // project the box around the sphere
+    for (int corner = 0; corner < 8; corner++) {
+        const glm::vec3 offset{
+            (corner & 1) ? radius : -radius,
+            (corner & 2) ? radius : -radius,
+            (corner & 4) ? radius : -radius,
+        };
+        const glm::vec4 clip = m_viewProj * glm::vec4(center + offset, 1.f);
+
+        // bounds crossing the near plane are always visible
+        if (clip.w <= OCCLUSION_NEAR_W) {
+            return false;
+        }
+
+        const float invW = 1.f / clip.w;
+        const float x = (clip.x * invW * 0.5f + 0.5f) * static_cast<float>(m_width);
+        const float y = (clip.y * invW * 0.5f + 0.5f) * static_cast<float>(m_height);
+
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, clip.z * invW);
+    }
+
+    // off screen objects are left to frustum culling
+    if (maxX < 0.f || maxY < 0.f || minX >= static_cast<float>(m_width) || minY >= static_cast<float>(m_height)) {
+        return false;
+    }
+
+    const auto tileMinX = static_cast<uint32_t>(std::max(minX, 0.f)) / OCCLUSION_TILE_SIZE;
+    const auto tileMinY = static_cast<uint32_t>(std::max(minY, 0.f)) / OCCLUSION_TILE_SIZE;
+    const uint32_t tileMaxX = std::min(static_cast<uint32_t>(maxX) / OCCLUSION_TILE_SIZE, m_tilesX - 1);
+    const uint32_t tileMaxY = std::min(static_cast<uint32_t>(maxY) / OCCLUSION_TILE_SIZE, m_tilesY - 1);
+
+    // occluded only if every tile is fully covered by something closer than the whole box
+    for (uint32_t tileY = tileMinY; tileY <= tileMaxY; tileY++) {
+        for (uint32_t tileX = tileMinX; tileX <= tileMaxX; tileX++) {
+            if (m_tiles[tileY * m_tilesX + tileX].committedDepth >= minZ) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void OcclusionCuller::testObjects(std::span<const RenderObject> objects, std::span<uint8_t> outVisible) {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    m_jobSystem->parallelFor(static_cast<uint32_t>(objects.size()), OCCLUSION_TEST_CHUNK, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            outVisible[i] = isOccluded(objects[i]) ? 0 : 1;
+        }
+    });
+
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    m_stats.testedObjects = static_cast<uint32_t>(objects.size());
+    m_stats.occludedObjects = static_cast<uint32_t>(std::count(outVisible.begin(), outVisible.begin() + objects.size(), 0));
+    m_stats.testMilliseconds = std::chrono::duration<float, std::milli>(end - start).count();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "VkTypes.hpp"
+#include "CpuFeatures.hpp"
+
+class JobSystem;
+
+// the masked depth buffer is split into tiles of 8x8 pixels, the coverage of a tile fits one 64 bit mask
+constexpr uint32_t OCCLUSION_TILE_SIZE = 8;
+constexpr uint32_t OCCLUSION_BUFFER_WIDTH = 320;
+constexpr uint32_t NO_OCCLUDER_MESH = UINT32_MAX;
+
+struct OcclusionStats {
+    uint32_t occluderTriangles = 0;
+    uint32_t testedObjects = 0;
+    uint32_t occludedObjects = 0;
+    float rasterMilliseconds = 0.f;
+    float testMilliseconds = 0.f;
+};
+
+// edge functions and depth plane of one occluder triangle, all of the form a * x + b * y + c in pixels
+struct OcclusionTriangle {
+    float edgeA[3];
+    float edgeB[3];
+    float edgeC[3];
+    float depthA;
+    float depthB;
+    float depthC;
+    // farthest vertex, the plane is clamped to it
+    float maxDepth;
+    // covered tiles, inclusive
+    uint32_t tileMinX;
+    uint32_t tileMaxX;
+    uint32_t tileMinY;
+    uint32_t tileMaxY;
+};
+
+// masked depth of one tile. Triangles gather in a working layer, its coverage bits and farthest depth.
+// Once its coverage is complete the layer hides the whole tile and merges into the committed depth,
+// so partly covered tiles never occlude anything
+struct OcclusionTile {
+    uint64_t coverage;
+    float workingDepth;
+    // FLT_MAX until the tile is fully covered, smaller is closer
+    float committedDepth;
+};
+
+// software occlusion culling on the CPU. A few occluder meshes are set up into triangles, which worker
+// threads rasterize row by row of tiles into a low resolution masked depth buffer. Object bounds are
+// then tested against the tiles on worker threads, before any draw is recorded
+class OcclusionCuller {
+public:
+    // the height follows the aspect ratio of the view
+    void init(JobSystem* jobSystem, VkExtent2D viewExtent);
+
+    // keeps a CPU copy of the mesh, occluders only need positions
+    uint32_t addOccluderMesh(std::span<const glm::vec3> positions, std::span<const uint32_t> indices);
+
+    void beginFrame(const glm::mat4& viewProj);
+    // projects and sets up the triangles of the occluder, endFrame rasterizes them
+    void rasterizeOccluder(uint32_t meshId, const glm::mat4& transform);
+    // rasterizes every occluder of the frame into the tiles, call after the last occluder
+    void endFrame();
+
+    // writes 0 for every object hidden behind the occluders and 1 otherwise
+    void testObjects(std::span<const RenderObject> objects, std::span<uint8_t> outVisible);
+
+    [[nodiscard]] const OcclusionStats& getStats() const { return m_stats; }
+    [[nodiscard]] SimdLevel getSimdLevel() const { return m_simdLevel; }
+
+private:
+    struct OccluderMesh {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    // screen space vertex, xy in pixels and z the post projection depth
+    struct ScreenVertex {
+        float x;
+        float y;
+        float z;
+    };
+
+    void setupTriangle(ScreenVertex v0, ScreenVertex v1, ScreenVertex v2);
+    void rasterizeTileRow(uint32_t tileY);
+
+    [[nodiscard]] bool isOccluded(const RenderObject& object) const;
+
+    JobSystem* m_jobSystem = nullptr;
+    SimdLevel m_simdLevel = SimdLevel::Scalar;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_tilesX = 0;
+    uint32_t m_tilesY = 0;
+
+    glm::mat4 m_viewProj{1.f};
+
+    std::vector<OccluderMesh> m_meshes;
+    std::vector<glm::vec4> m_clipVertices;
+
+    // in submission order, every tile merges them in that order whichever thread rasterizes it
+    std::vector<OcclusionTriangle> m_triangles;
+    std::vector<OcclusionTile> m_tiles;
+
+    OcclusionStats m_stats;
+};
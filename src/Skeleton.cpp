@@ -0,0 +1,76 @@
+#include "Skeleton.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+static glm::vec4 sampleChannel(const AnimationChannel& channel, float time) {
+    const auto next = std::ranges::upper_bound(channel.times, time);
+    if (next == channel.times.begin()) {
+        return channel.values.front();
+    }
+    if (next == channel.times.end()) {
+        return channel.values.back();
+    }
+
+    const auto key = static_cast<size_t>(next - channel.times.begin()) - 1;
+    if (channel.step) {
+        return channel.values[key];
+    }
+
+    const float span = channel.times[key + 1] - channel.times[key];
+    const float t = span > 0.f ? (time - channel.times[key]) / span : 0.f;
+
+    if (channel.path == AnimationPath::Rotation) {
+        const glm::vec4 a = channel.values[key];
+        const glm::vec4 b = channel.values[key + 1];
+        const glm::quat rotation = glm::slerp(glm::quat(a.w, a.x, a.y, a.z), glm::quat(b.w, b.x, b.y, b.z), t);
+        return {rotation.x, rotation.y, rotation.z, rotation.w};
+    }
+
+    return glm::mix(channel.values[key], channel.values[key + 1], t);
+}
+
+void Skeleton::evaluate(uint32_t animation, float time, SkeletonPose& pose, std::span<glm::mat4> outJointMatrices) const {
+    pose.locals.assign(nodes.begin(), nodes.end());
+    pose.globals.resize(nodes.size());
+
+    if (animation < animations.size()) {
+        const Animation& clip = animations[animation];
+        const float clipTime = clip.duration > 0.f ? std::fmod(time, clip.duration) : 0.f;
+
+        for (const AnimationChannel& channel: clip.channels) {
+            if (channel.times.empty()) {
+                continue;
+            }
+
+            const glm::vec4 value = sampleChannel(channel, clipTime);
+            SkeletonNode& node = pose.locals[channel.node];
+            switch (channel.path) {
+                case AnimationPath::Translation:
+                    node.translation = glm::vec3(value);
+                    break;
+                case AnimationPath::Rotation:
+                    node.rotation = glm::normalize(glm::quat(value.w, value.x, value.y, value.z));
+                    break;
+                case AnimationPath::Scale:
+                    node.scale = glm::vec3(value);
+                    break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < pose.locals.size(); i++) {
+        const SkeletonNode& node = pose.locals[i];
+        const glm::mat4 local = glm::translate(glm::mat4{1.f}, node.translation) *
+                                glm::mat4_cast(node.rotation) *
+                                glm::scale(glm::mat4{1.f}, node.scale);
+        pose.globals[i] = node.parent >= 0 ? pose.globals[node.parent] * local : local;
+    }
+
+    const size_t jointCount = std::min(joints.size(), outJointMatrices.size());
+    for (size_t j = 0; j < jointCount; j++) {
+        outJointMatrices[j] = pose.globals[joints[j]] * inverseBindMatrices[j];
+    }
+}
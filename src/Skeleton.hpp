@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+constexpr uint32_t NO_ANIMATION = UINT32_MAX;
+
+enum class AnimationPath : uint8_t {
+    Translation,
+    Rotation,
+    Scale,
+};
+
+struct AnimationChannel {
+    uint32_t node = 0;
+    AnimationPath path = AnimationPath::Translation;
+    // step keys hold their value until the next key, all others are interpolated linearly
+    bool step = false;
+    std::vector<float> times;
+    // xyz for translation and scale, a xyzw quaternion for rotation
+    std::vector<glm::vec4> values;
+};
+
+struct Animation {
+    std::string name;
+    float duration = 0.f;
+    std::vector<AnimationChannel> channels;
+};
+
+struct SkeletonNode {
+    int32_t parent = -1;
+    glm::vec3 translation{0.f};
+    glm::quat rotation{1.f, 0.f, 0.f, 0.f};
+    glm::vec3 scale{1.f};
+};
+
+// scratch of one evaluation, kept by the caller so posing does not allocate every frame
+struct SkeletonPose {
+    std::vector<SkeletonNode> locals;
+    std::vector<glm::mat4> globals;
+};
+
+// node hierarchy of a glTF skin and the animations moving it. Nodes are ordered so that every
+// parent comes before its children, which lets the global transforms be computed in one pass
+struct Skeleton {
+    std::vector<SkeletonNode> nodes;
+    // node of every joint and the matrix taking the mesh into that joint's space in the bind pose
+    std::vector<uint32_t> joints;
+    std::vector<glm::mat4> inverseBindMatrices;
+    std::vector<Animation> animations;
+
+    // poses the skeleton at time seconds into the looping animation, or in its rest pose for NO_ANIMATION,
+    // and writes the skinning matrix of every joint
+    void evaluate(uint32_t animation, float time, SkeletonPose& pose, std::span<glm::mat4> outJointMatrices) const;
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template<typename T = void>
+class Task;
+
+namespace TaskDetail {
+    // resumes whoever awaited the finished task, straight away instead of through the caller's stack
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            const std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    struct PromiseBase {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    template<typename T>
+    struct Promise : PromiseBase {
+        std::optional<T> value;
+
+        Task<T> get_return_object();
+        void return_value(T result) { value.emplace(std::move(result)); }
+    };
+
+    template<>
+    struct Promise<void> : PromiseBase {
+        Task<void> get_return_object();
+        void return_void() {}
+    };
+}
+
+// lazily started coroutine, it runs once awaited and resumes the awaiting coroutine when it is done.
+// Which thread it continues on is up to the awaitables it suspends on
+template<typename T>
+class Task {
+public:
+    using promise_type = TaskDetail::Promise<T>;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+    Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept { return !handle || handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() {
+                if (handle.promise().exception) {
+                    std::rethrow_exception(handle.promise().exception);
+                }
+                if constexpr (!std::is_void_v<T>) {
+                    return std::move(*handle.promise().value);
+                }
+            }
+        };
+        return Awaiter{m_handle};
+    }
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+template<typename T>
+Task<T> TaskDetail::Promise<T>::get_return_object() {
+    return Task<T>{std::coroutine_handle<Promise>::from_promise(*this)};
+}
+
+inline Task<void> TaskDetail::Promise<void>::get_return_object() {
+    return Task<void>{std::coroutine_handle<Promise>::from_promise(*this)};
+}
+
+// eagerly started coroutine that owns itself and frees its frame when it finishes,
+// the root every chain of tasks is started from
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+// coroutines queued from any thread and resumed by the render thread, once per frame
+class MainThreadQueue {
+public:
+    auto schedule() noexcept {
+        struct Awaiter {
+            MainThreadQueue& queue;
+
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) {
+                std::lock_guard lock(queue.m_mutex);
+                queue.m_pending.push_back(handle);
+            }
+            void await_resume() noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    // resumes everything queued so far, coroutines queued meanwhile wait for the next call
+    void pump() {
+        {
+            std::lock_guard lock(m_mutex);
+            std::swap(m_pending, m_resuming);
+        }
+
+        for (const std::coroutine_handle<> handle : m_resuming) {
+            handle.resume();
+        }
+        m_resuming.clear();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::coroutine_handle<>> m_pending;
+    std::vector<std::coroutine_handle<>> m_resuming;
+};
@@ -0,0 +1,234 @@
+#include "Telemetry.hpp"
+
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// how often the server thread looks at its stop token while no scraper connects
+constexpr int TELEMETRY_POLL_MILLISECONDS = 200;
+// a scraper that sends nothing for this long is dropped
+constexpr int TELEMETRY_REQUEST_TIMEOUT_MILLISECONDS = 1000;
+constexpr size_t TELEMETRY_MAX_REQUEST_SIZE = 4096;
+
+#if defined(_WIN32)
+using SocketHandle = SOCKET;
+constexpr int TELEMETRY_SEND_FLAGS = 0;
+
+static void closeSocket(intptr_t socket) { closesocket(static_cast<SocketHandle>(socket)); }
+static int pollSocket(intptr_t socket, int timeoutMilliseconds) {
+    WSAPOLLFD descriptor{static_cast<SocketHandle>(socket), POLLIN, 0};
+    return WSAPoll(&descriptor, 1, timeoutMilliseconds);
+}
+#else
+using SocketHandle = int;
+// a scraper hanging up mid-response must not raise SIGPIPE in the renderer
+constexpr int TELEMETRY_SEND_FLAGS = MSG_NOSIGNAL;
+
+static void closeSocket(intptr_t socket) { close(static_cast<SocketHandle>(socket)); }
+static int pollSocket(intptr_t socket, int timeoutMilliseconds) {
+    pollfd descriptor{static_cast<SocketHandle>(socket), POLLIN, 0};
+    return poll(&descriptor, 1, timeoutMilliseconds);
+}
+#endif
+
+bool Telemetry::start(uint16_t port) {
+#if defined(_WIN32)
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "Failed to initialize Winsock, telemetry is disabled" << std::endl;
+        return false;
+    }
+#endif
+
+    const SocketHandle listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (static_cast<intptr_t>(listenSocket) < 0) {
+        std::cerr << "Failed to create the telemetry socket" << std::endl;
+        return false;
+    }
+
+    const int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    // loopback only, whatever scrapes the fleet runs next to the renderer
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(listenSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenSocket, 4) != 0) {
+        std::cerr << std::format("Failed to listen on 127.0.0.1:{}, telemetry is disabled", port) << std::endl;
+        closeSocket(static_cast<intptr_t>(listenSocket));
+        return false;
+    }
+
+    m_listenSocket = static_cast<intptr_t>(listenSocket);
+    m_server = std::jthread([this](const std::stop_token& stopToken) { serve(stopToken); });
+
+    std::cout << std::format("Serving metrics on http://127.0.0.1:{}/metrics", port) << std::endl;
+    return true;
+}
+
+void Telemetry::stop() {
+    if (!m_server.joinable()) {
+        return;
+    }
+
+    m_server.request_stop();
+    m_server.join();
+    closeSocket(m_listenSocket);
+    m_listenSocket = -1;
+
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+void Telemetry::recordFrameTime(double milliseconds) {
+    size_t bucket = 0;
+    while (bucket < FRAME_TIME_BUCKETS.size() && milliseconds > FRAME_TIME_BUCKETS[bucket]) {
+        bucket++;
+    }
+
+    m_pending.frameTimeBuckets[bucket]++;
+    m_pending.frameTimeSum += milliseconds;
+    m_pending.frames++;
+}
+
+void Telemetry::publish() {
+    const std::unique_lock lock(m_publishedMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        m_skippedPublishes.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    m_published = m_pending;
+}
+
+static std::string formatMetrics(const TelemetrySnapshot& snapshot, uint64_t skippedPublishes) {
+    std::string text;
+    auto out = std::back_inserter(text);
+
+    std::format_to(out, "# HELP hellfire_frame_time_milliseconds CPU time between the starts of consecutive frames.\n"
+                        "# TYPE hellfire_frame_time_milliseconds histogram\n");
+    // Prometheus buckets are cumulative
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < FRAME_TIME_BUCKETS.size(); i++) {
+        cumulative += snapshot.frameTimeBuckets[i];
+        std::format_to(out, "hellfire_frame_time_milliseconds_bucket{{le=\"{}\"}} {}\n", FRAME_TIME_BUCKETS[i],
+                       cumulative);
+    }
+    std::format_to(out, "hellfire_frame_time_milliseconds_bucket{{le=\"+Inf\"}} {}\n", snapshot.frames);
+    std::format_to(out, "hellfire_frame_time_milliseconds_sum {}\n", snapshot.frameTimeSum);
+    std::format_to(out, "hellfire_frame_time_milliseconds_count {}\n", snapshot.frames);
+
+    const auto counter = [&](std::string_view name, std::string_view help, uint64_t value) {
+        std::format_to(out, "# HELP {0} {1}\n# TYPE {0} counter\n{0} {2}\n", name, help, value);
+    };
+    const auto gauge = [&](std::string_view name, std::string_view help, uint64_t value) {
+        std::format_to(out, "# HELP {0} {1}\n# TYPE {0} gauge\n{0} {2}\n", name, help, value);
+    };
+
+    counter("hellfire_draws_total", "Draw calls recorded, an indirect draw counts once.", snapshot.drawsTotal);
+    counter("hellfire_dispatches_total", "Compute dispatches recorded, an indirect dispatch counts once.",
+            snapshot.dispatchesTotal);
+    counter("hellfire_upload_bytes_total", "Bytes copied from staging buffers by the frames.",
+            snapshot.uploadBytesTotal);
+    counter("hellfire_telemetry_skipped_publishes_total", "Frames whose metrics were not published during a scrape.",
+            skippedPublishes);
+
+    gauge("hellfire_frame_draws", "Draw calls of the latest frame.", snapshot.draws);
+    gauge("hellfire_frame_dispatches", "Compute dispatches of the latest frame.", snapshot.dispatches);
+    gauge("hellfire_render_objects", "Objects in the scene.", snapshot.renderObjects);
+    gauge("hellfire_visible_objects", "Objects that survived culling in the latest frame.", snapshot.visibleObjects);
+
+    std::format_to(out, "# HELP hellfire_gpu_pass_milliseconds Smoothed GPU time of a render pass.\n"
+                        "# TYPE hellfire_gpu_pass_milliseconds gauge\n");
+    for (const TelemetryPass& pass: snapshot.passes) {
+        std::format_to(out, "hellfire_gpu_pass_milliseconds{{pass=\"{}\"}} {}\n", pass.name, pass.milliseconds);
+    }
+
+    const auto heapGauge = [&](std::string_view name, std::string_view help, uint64_t TelemetryHeap::* field) {
+        std::format_to(out, "# HELP {0} {1}\n# TYPE {0} gauge\n", name, help);
+        for (size_t heap = 0; heap < snapshot.heaps.size(); heap++) {
+            std::format_to(out, "{}{{heap=\"{}\"}} {}\n", name, heap, snapshot.heaps[heap].*field);
+        }
+    };
+    heapGauge("hellfire_memory_usage_bytes", "Device memory used in a heap, by every process when the driver "
+              "reports a budget.", &TelemetryHeap::usageBytes);
+    heapGauge("hellfire_memory_budget_bytes", "Device memory the renderer can use in a heap.",
+              &TelemetryHeap::budgetBytes);
+    heapGauge("hellfire_memory_allocation_bytes", "Bytes of the renderer's allocations in a heap.",
+              &TelemetryHeap::allocationBytes);
+
+    return text;
+}
+
+void Telemetry::serve(const std::stop_token& stopToken) {
+    TelemetrySnapshot snapshot;
+
+    while (!stopToken.stop_requested()) {
+        if (pollSocket(m_listenSocket, TELEMETRY_POLL_MILLISECONDS) <= 0) {
+            continue;
+        }
+
+        const SocketHandle client = accept(static_cast<SocketHandle>(m_listenSocket), nullptr, nullptr);
+        if (static_cast<intptr_t>(client) < 0) {
+            continue;
+        }
+
+        // the request line is all that matters, read until the end of the headers
+        std::string request;
+        char buffer[512];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < TELEMETRY_MAX_REQUEST_SIZE &&
+               pollSocket(static_cast<intptr_t>(client), TELEMETRY_REQUEST_TIMEOUT_MILLISECONDS) > 0) {
+            const auto received = recv(client, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                break;
+            }
+            request.append(buffer, static_cast<size_t>(received));
+        }
+
+        std::string response;
+        if (request.starts_with("GET /metrics ") || request.starts_with("GET / ")) {
+            {
+                const std::lock_guard lock(m_publishedMutex);
+                snapshot = m_published;
+            }
+
+            const std::string body = formatMetrics(snapshot, m_skippedPublishes.load(std::memory_order_relaxed));
+            response = std::format("HTTP/1.1 200 OK\r\n"
+                                   "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                   "Content-Length: {}\r\n"
+                                   "Connection: close\r\n\r\n{}", body.size(), body);
+        } else {
+            response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        }
+
+        size_t sent = 0;
+        while (sent < response.size()) {
+            const auto written = send(client, response.data() + sent, static_cast<int>(response.size() - sent),
+                                      TELEMETRY_SEND_FLAGS);
+            if (written <= 0) {
+                break;
+            }
+            sent += static_cast<size_t>(written);
+        }
+
+        closeSocket(static_cast<intptr_t>(client));
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// upper bounds of the frame time histogram buckets in milliseconds, +Inf is implied
+constexpr std::array<double, 11> FRAME_TIME_BUCKETS = {2.0, 4.0, 6.0, 8.0, 11.1, 16.7, 20.0, 33.3, 50.0, 100.0, 250.0};
+
+struct TelemetryPass {
+    std::string name;
+    double milliseconds = 0.0;
+};
+
+struct TelemetryHeap {
+    uint64_t usageBytes = 0;
+    uint64_t budgetBytes = 0;
+    // bytes in VMA allocations, the rest of the usage is free space in blocks and other processes
+    uint64_t allocationBytes = 0;
+};
+
+// everything one scrape reports. Counters and the histogram accumulate over the lifetime of the process,
+// the rest describes the latest published frame
+struct TelemetrySnapshot {
+    std::array<uint64_t, FRAME_TIME_BUCKETS.size() + 1> frameTimeBuckets{};
+    double frameTimeSum = 0.0;
+    uint64_t frames = 0;
+
+    uint64_t drawsTotal = 0;
+    uint64_t dispatchesTotal = 0;
+    uint64_t uploadBytesTotal = 0;
+
+    uint32_t draws = 0;
+    uint32_t dispatches = 0;
+    uint32_t renderObjects = 0;
+    uint32_t visibleObjects = 0;
+
+    std::vector<TelemetryPass> passes;
+    std::vector<TelemetryHeap> heaps;
+};
+
+// serves the renderer's health in the Prometheus text format on http://127.0.0.1:<port>/metrics.
+// The render thread fills a private snapshot and hands it over with a try_lock, so it never waits
+// on a scrape, and the socket work runs on a thread of its own
+class Telemetry {
+public:
+    // returns false when the port cannot be bound, telemetry then stays off
+    bool start(uint16_t port);
+    void stop();
+
+    [[nodiscard]] bool isRunning() const { return m_server.joinable(); }
+
+    // render thread only, filled in place between publishes
+    TelemetrySnapshot& getPending() { return m_pending; }
+    void recordFrameTime(double milliseconds);
+
+    // copies the pending snapshot for the server, skipped while a scrape holds the published one.
+    // Steady state copies reuse the capacity of the published vectors and strings
+    void publish();
+
+private:
+    void serve(const std::stop_token& stopToken);
+
+    TelemetrySnapshot m_pending;
+
+    std::mutex m_publishedMutex;
+    TelemetrySnapshot m_published;
+    std::atomic<uint64_t> m_skippedPublishes{0};
+
+    // a SOCKET on Windows, a file descriptor elsewhere
+    intptr_t m_listenSocket = -1;
+    std::jthread m_server;
+};
@@ -0,0 +1,72 @@
+#include "VirtualTextureFile.hpp"
+
+#include <bit>
+#include <fstream>
+
+bool saveVirtualTexture(const std::filesystem::path& path, uint32_t size, std::span<const uint32_t> pixels) {
+    if (!std::has_single_bit(size) || size < VT_PAGE_SIZE || size > VT_PAGE_SIZE * VT_MAX_PAGES ||
+        pixels.size() != static_cast<size_t>(size) * size) {
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    const auto mipCount = static_cast<uint32_t>(std::countr_zero(size / VT_PAGE_SIZE)) + 1;
+    const VirtualTextureHeader header{
+        .magic = VIRTUAL_TEXTURE_MAGIC,
+        .size = size,
+        .mipCount = mipCount,
+        .reserved = 0,
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<uint32_t> mip(pixels.begin(), pixels.end());
+    std::vector<uint32_t> page(VT_PAGE_STRIDE * VT_PAGE_STRIDE);
+    uint32_t mipSize = size;
+
+    for (uint32_t level = 0; level < mipCount; level++) {
+        const uint32_t pages = mipSize / VT_PAGE_SIZE;
+        for (uint32_t pageY = 0; pageY < pages; pageY++) {
+            for (uint32_t pageX = 0; pageX < pages; pageX++) {
+                // the border wraps around like the uv coordinates do
+                for (uint32_t y = 0; y < VT_PAGE_STRIDE; y++) {
+                    const uint32_t sourceY = (pageY * VT_PAGE_SIZE + y + mipSize - VT_PAGE_BORDER) % mipSize;
+                    for (uint32_t x = 0; x < VT_PAGE_STRIDE; x++) {
+                        const uint32_t sourceX = (pageX * VT_PAGE_SIZE + x + mipSize - VT_PAGE_BORDER) % mipSize;
+                        page[y * VT_PAGE_STRIDE + x] = mip[sourceY * mipSize + sourceX];
+                    }
+                }
+                file.write(reinterpret_cast<const char*>(page.data()), VT_PAGE_BYTES);
+            }
+        }
+
+        // 2x2 box filter per channel for the next level
+        const uint32_t nextSize = mipSize / 2;
+        std::vector<uint32_t> next(static_cast<size_t>(nextSize) * nextSize);
+        for (uint32_t y = 0; y < nextSize; y++) {
+            for (uint32_t x = 0; x < nextSize; x++) {
+                const uint32_t texels[4] = {
+                    mip[(2 * y) * mipSize + 2 * x], mip[(2 * y) * mipSize + 2 * x + 1],
+                    mip[(2 * y + 1) * mipSize + 2 * x], mip[(2 * y + 1) * mipSize + 2 * x + 1],
+                };
+
+                uint32_t filtered = 0;
+                for (uint32_t channel = 0; channel < 32; channel += 8) {
+                    uint32_t sum = 2;
+                    for (const uint32_t texel: texels) {
+                        sum += (texel >> channel) & 0xFF;
+                    }
+                    filtered |= (sum / 4) << channel;
+                }
+                next[y * nextSize + x] = filtered;
+            }
+        }
+        mip = std::move(next);
+        mipSize = nextSize;
+    }
+
+    return file.good();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+// must match virtualTexture.glsl
+constexpr uint32_t VT_PAGE_SIZE = 128;
+// texels repeated from the neighbouring pages, so bilinear filtering never reads another page
+constexpr uint32_t VT_PAGE_BORDER = 4;
+constexpr uint32_t VT_PAGE_STRIDE = VT_PAGE_SIZE + 2 * VT_PAGE_BORDER;
+constexpr uint64_t VT_PAGE_BYTES = VT_PAGE_STRIDE * VT_PAGE_STRIDE * sizeof(uint32_t);
+constexpr uint32_t VT_MAX_PAGES = 128;
+
+// identifies a tiled texture file: VirtualTextureHeader, then every page of every mip from mip 0 on,
+// row by row, each VT_PAGE_STRIDE x VT_PAGE_STRIDE RGBA8 texels including the border
+constexpr uint32_t VIRTUAL_TEXTURE_MAGIC = 0x58455456; // "VTEX"
+
+struct VirtualTextureHeader {
+    uint32_t magic;
+    // square and a power of two, at least VT_PAGE_SIZE
+    uint32_t size;
+    uint32_t mipCount;
+    uint32_t reserved;
+};
+
+// tiles and mips an RGBA8 image of size x size texels, written by Hellfire-Bake and read by the VirtualTexture
+bool saveVirtualTexture(const std::filesystem::path& path, uint32_t size, std::span<const uint32_t> pixels);
@@ -0,0 +1,538 @@
+#include "VkAssetLoader.hpp"
+
+#include <fastgltf/core.hpp>
+#include <fastgltf/glm_element_traits.hpp>
+#include <fastgltf/tools.hpp>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+#include "VkEngine.hpp"
+#include "VkSync.hpp"
+#include "JobSystem.hpp"
+
+// same bounds as uploadMesh, computed on the worker that decoded the mesh
+static glm::vec4 computeBoundingSphere(std::span<const Vertex> vertices) {
+    glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+    glm::vec3 boundsMax{std::numeric_limits<float>::lowest()};
+    for (const Vertex& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+
+    const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius = 0.f;
+    for (const Vertex& vertex : vertices) {
+        radius = std::max(radius, glm::length(vertex.position - center));
+    }
+    return glm::vec4(center, radius);
+}
+
+// the whole node hierarchy, with the joints of the skin and the animations moving them
+static std::shared_ptr<const Skeleton> buildSkeleton(const fastgltf::Asset& asset, const fastgltf::Skin& skin) {
+    const size_t nodeCount = asset.nodes.size();
+    std::vector<int32_t> parents(nodeCount, -1);
+    for (size_t i = 0; i < nodeCount; i++) {
+        for (const size_t child : asset.nodes[i].children) {
+            parents[child] = static_cast<int32_t>(i);
+        }
+    }
+
+    // breadth first from the roots, so every parent comes before its children
+    std::vector<uint32_t> order;
+    for (size_t i = 0; i < nodeCount; i++) {
+        if (parents[i] < 0) {
+            order.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        for (const size_t child : asset.nodes[order[i]].children) {
+            order.push_back(static_cast<uint32_t>(child));
+        }
+    }
+
+    std::vector<uint32_t> remap(nodeCount, 0);
+    for (size_t i = 0; i < order.size(); i++) {
+        remap[order[i]] = static_cast<uint32_t>(i);
+    }
+
+    auto skeleton = std::make_shared<Skeleton>();
+    skeleton->nodes.resize(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        const fastgltf::Node& node = asset.nodes[order[i]];
+        SkeletonNode& out = skeleton->nodes[i];
+        out.parent = parents[order[i]] >= 0 ? static_cast<int32_t>(remap[parents[order[i]]]) : -1;
+
+        fastgltf::math::fvec3 translation{0.f};
+        fastgltf::math::fquat rotation{};
+        fastgltf::math::fvec3 scale{1.f};
+        if (const auto* trs = std::get_if<fastgltf::TRS>(&node.transform)) {
+            translation = trs->translation;
+            rotation = trs->rotation;
+            scale = trs->scale;
+        } else {
+            fastgltf::math::decomposeTransformMatrix(std::get<fastgltf::math::fmat4x4>(node.transform),
+                                                     scale, rotation, translation);
+        }
+
+        out.translation = {translation[0], translation[1], translation[2]};
+        out.rotation = glm::quat(rotation[3], rotation[0], rotation[1], rotation[2]);
+        out.scale = {scale[0], scale[1], scale[2]};
+    }
+
+    for (const size_t joint : skin.joints) {
+        skeleton->joints.push_back(remap[joint]);
+    }
+
+    skeleton->inverseBindMatrices.assign(skin.joints.size(), glm::mat4{1.f});
+    if (skin.inverseBindMatrices.has_value()) {
+        fastgltf::iterateAccessorWithIndex<glm::mat4>(asset, asset.accessors[skin.inverseBindMatrices.value()],
+            [&](const glm::mat4& matrix, size_t index) {
+                if (index < skeleton->inverseBindMatrices.size()) {
+                    skeleton->inverseBindMatrices[index] = matrix;
+                }
+            });
+    }
+
+    for (const fastgltf::Animation& animation : asset.animations) {
+        Animation& clip = skeleton->animations.emplace_back();
+        clip.name = std::string(animation.name);
+
+        for (const fastgltf::AnimationChannel& channel : animation.channels) {
+            if (!channel.nodeIndex.has_value() || channel.path == fastgltf::AnimationPath::Weights) {
+                continue;
+            }
+
+            const fastgltf::AnimationSampler& sampler = animation.samplers[channel.samplerIndex];
+            AnimationChannel& out = clip.channels.emplace_back();
+            out.node = remap[channel.nodeIndex.value()];
+            out.path = channel.path == fastgltf::AnimationPath::Translation ? AnimationPath::Translation
+                     : channel.path == fastgltf::AnimationPath::Rotation ? AnimationPath::Rotation
+                     : AnimationPath::Scale;
+            out.step = sampler.interpolation == fastgltf::AnimationInterpolation::Step;
+
+            fastgltf::iterateAccessor<float>(asset, asset.accessors[sampler.inputAccessor], [&](float time) {
+                out.times.push_back(time);
+            });
+
+            const fastgltf::Accessor& output = asset.accessors[sampler.outputAccessor];
+            if (out.path == AnimationPath::Rotation) {
+                fastgltf::iterateAccessor<glm::vec4>(asset, output, [&](glm::vec4 value) {
+                    out.values.push_back(value);
+                });
+            } else {
+                fastgltf::iterateAccessor<glm::vec3>(asset, output, [&](glm::vec3 value) {
+                    out.values.emplace_back(value, 0.f);
+                });
+            }
+
+            // cubic spline keys are (in tangent, value, out tangent), they are played back linearly
+            if (sampler.interpolation == fastgltf::AnimationInterpolation::CubicSpline) {
+                for (size_t key = 0; key < out.times.size() && key * 3 + 1 < out.values.size(); key++) {
+                    out.values[key] = out.values[key * 3 + 1];
+                }
+            }
+            out.values.resize(std::min(out.values.size(), out.times.size()));
+            out.times.resize(out.values.size());
+
+            if (!out.times.empty()) {
+                clip.duration = std::max(clip.duration, out.times.back());
+            }
+        }
+    }
+
+    return skeleton;
+}
+
+void AssetLoader::init(VulkanEngine* engine, JobSystem* jobSystem) {
+    m_engine = engine;
+    m_jobSystem = jobSystem;
+    const VkDevice device = engine->getContext()->getDevice();
+
+    const VkCommandPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = engine->getContext()->getQueueFamilies().graphicsFamily.value(),
+    };
+    VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &m_commandPool));
+
+    VkSemaphoreTypeCreateInfo timelineInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .pNext = nullptr,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+    const VkSemaphoreCreateInfo semaphoreInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &timelineInfo,
+        .flags = 0,
+    };
+    VK_CHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &m_timeline));
+}
+
+void AssetLoader::shutdown() {
+    // loads still reading or decoding stop at their next step, the device is idle so the uploads
+    // already submitted have signalled and only their render thread hops remain
+    m_cancelled = true;
+    while (m_stats.activeLoads > 0) {
+        update();
+        std::this_thread::yield();
+    }
+
+    const VkDevice device = m_engine->getContext()->getDevice();
+    vkDestroySemaphore(device, m_timeline, nullptr);
+    vkDestroyCommandPool(device, m_commandPool, nullptr);
+}
+
+void AssetLoader::load(const std::filesystem::path& path, const glm::mat4& transform) {
+    m_stats.activeLoads++;
+    runLoad(path, transform);
+}
+
+void AssetLoader::update() {
+    m_mainThread.pump();
+
+    if (m_uploadWaits.empty()) {
+        return;
+    }
+
+    // resuming may queue new waits, so collect the finished ones first
+    const uint64_t completed = getCompletedValue();
+    std::vector<std::coroutine_handle<>> ready;
+    std::erase_if(m_uploadWaits, [&](const UploadWait& wait) {
+        if (wait.timelineValue > completed) {
+            return false;
+        }
+        ready.push_back(wait.handle);
+        return true;
+    });
+
+    for (const std::coroutine_handle<> handle : ready) {
+        handle.resume();
+    }
+}
+
+uint64_t AssetLoader::getCompletedValue() const {
+    uint64_t value = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(m_engine->getContext()->getDevice(), m_timeline, &value));
+    return value;
+}
+
+DetachedTask AssetLoader::runLoad(std::filesystem::path path, glm::mat4 transform) {
+    std::vector<std::byte> bytes = co_await readFile(path);
+
+    std::vector<LoadedMesh> meshes;
+    if (!bytes.empty()) {
+        meshes = co_await decodeGltf(std::move(bytes), path.parent_path());
+    }
+
+    // buffer creation, submission and the scene all belong to the render thread
+    co_await m_mainThread.schedule();
+
+    if (m_cancelled) {
+        m_stats.activeLoads--;
+        co_return;
+    }
+
+    if (meshes.empty()) {
+        std::cerr << "Failed to load " << path << std::endl;
+        m_stats.failedLoads++;
+        m_stats.activeLoads--;
+        co_return;
+    }
+
+    std::vector<GPUMeshBuffers> buffers;
+    AllocatedBuffer staging{};
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    const uint64_t uploadValue = submitUpload(meshes, buffers, staging, cmd);
+
+    co_await waitForUpload(uploadValue);
+
+    m_engine->destroyBuffer(staging);
+    vkFreeCommandBuffers(m_engine->getContext()->getDevice(), m_commandPool, 1, &cmd);
+
+    // the scene is being torn down, the meshes never join it
+    if (m_cancelled) {
+        for (const GPUMeshBuffers& mesh : buffers) {
+            m_engine->destroyBuffer(mesh.indexBuffer);
+            m_engine->destroyBuffer(mesh.vertexBuffer);
+        }
+        m_stats.activeLoads--;
+        co_return;
+    }
+
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const auto indexCount = static_cast<uint32_t>(meshes[i].indices.size());
+        if (meshes[i].skeleton) {
+            m_engine->addSkinnedRenderObject(buffers[i], indexCount, transform, meshes[i].skinVertices,
+                                             meshes[i].skeleton);
+        } else {
+            m_engine->addRenderObject(buffers[i], indexCount, transform);
+        }
+    }
+
+    m_stats.finishedLoads++;
+    m_stats.activeLoads--;
+}
+
+Task<std::vector<std::byte>> AssetLoader::readFile(std::filesystem::path path) {
+    co_await m_jobSystem->schedule();
+    if (m_cancelled) {
+        co_return {};
+    }
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        co_return {};
+    }
+
+    std::vector<std::byte> bytes(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    co_return bytes;
+}
+
+Task<std::vector<LoadedMesh>> AssetLoader::decodeGltf(std::vector<std::byte> bytes, std::filesystem::path directory) {
+    co_await m_jobSystem->schedule();
+    if (m_cancelled) {
+        co_return {};
+    }
+
+    auto data = fastgltf::GltfDataBuffer::FromBytes(bytes.data(), bytes.size());
+    if (data.error() != fastgltf::Error::None) {
+        co_return {};
+    }
+
+    // parsers are cheap and not thread safe, every decode gets its own
+    fastgltf::Parser parser;
+    auto asset = parser.loadGltf(data.get(), directory, fastgltf::Options::LoadExternalBuffers);
+    if (asset.error() != fastgltf::Error::None) {
+        std::cerr << "Failed to parse glTF: " << fastgltf::getErrorMessage(asset.error()) << std::endl;
+        co_return {};
+    }
+
+    // parsing is the long part, do not convert what nobody will upload
+    if (m_cancelled) {
+        co_return {};
+    }
+
+    // a mesh is skinned when a node draws it with a skin
+    std::vector<int64_t> skinOfMesh(asset->meshes.size(), -1);
+    for (const fastgltf::Node& node : asset->nodes) {
+        if (node.meshIndex.has_value() && node.skinIndex.has_value()) {
+            skinOfMesh[node.meshIndex.value()] = static_cast<int64_t>(node.skinIndex.value());
+        }
+    }
+    std::vector<std::shared_ptr<const Skeleton>> skeletons(asset->skins.size());
+
+    std::vector<LoadedMesh> meshes;
+    for (size_t meshIndex = 0; meshIndex < asset->meshes.size(); meshIndex++) {
+        fastgltf::Mesh& mesh = asset->meshes[meshIndex];
+        LoadedMesh loaded{.name = std::string(mesh.name)};
+        const bool skinned = skinOfMesh[meshIndex] >= 0;
+
+        for (fastgltf::Primitive& primitive : mesh.primitives) {
+            const auto position = primitive.findAttribute("POSITION");
+            if (!primitive.indicesAccessor.has_value() || position == primitive.attributes.end()) {
+                continue;
+            }
+
+            const auto baseVertex = static_cast<uint32_t>(loaded.vertices.size());
+
+            const fastgltf::Accessor& indexAccessor = asset->accessors[primitive.indicesAccessor.value()];
+            loaded.indices.reserve(loaded.indices.size() + indexAccessor.count);
+            fastgltf::iterateAccessor<std::uint32_t>(asset.get(), indexAccessor, [&](std::uint32_t index) {
+                loaded.indices.push_back(baseVertex + index);
+            });
+
+            const fastgltf::Accessor& positionAccessor = asset->accessors[position->accessorIndex];
+            loaded.vertices.resize(baseVertex + positionAccessor.count);
+            fastgltf::iterateAccessorWithIndex<glm::vec3>(asset.get(), positionAccessor, [&](glm::vec3 value, size_t index) {
+                Vertex& vertex = loaded.vertices[baseVertex + index];
+                vertex.position = value;
+                vertex.normal = {1, 0, 0};
+                vertex.uv_x = 0;
+                vertex.uv_y = 0;
+                vertex.color = glm::vec4{1.f};
+            });
+
+            if (const auto normals = primitive.findAttribute("NORMAL"); normals != primitive.attributes.end()) {
+                fastgltf::iterateAccessorWithIndex<glm::vec3>(asset.get(), asset->accessors[normals->accessorIndex],
+                    [&](glm::vec3 value, size_t index) {
+                        loaded.vertices[baseVertex + index].normal = value;
+                    });
+            }
+
+            if (const auto uv = primitive.findAttribute("TEXCOORD_0"); uv != primitive.attributes.end()) {
+                fastgltf::iterateAccessorWithIndex<glm::vec2>(asset.get(), asset->accessors[uv->accessorIndex],
+                    [&](glm::vec2 value, size_t index) {
+                        loaded.vertices[baseVertex + index].uv_x = value.x;
+                        loaded.vertices[baseVertex + index].uv_y = value.y;
+                    });
+            }
+
+            if (const auto colors = primitive.findAttribute("COLOR_0"); colors != primitive.attributes.end()) {
+                fastgltf::iterateAccessorWithIndex<glm::vec4>(asset.get(), asset->accessors[colors->accessorIndex],
+                    [&](glm::vec4 value, size_t index) {
+                        loaded.vertices[baseVertex + index].color = value;
+                    });
+            }
+
+            if (skinned) {
+                // vertices without skin data follow the first joint
+                loaded.skinVertices.resize(loaded.vertices.size(), SkinVertex{glm::uvec4{0}, glm::vec4{1, 0, 0, 0}});
+
+                const auto joints = primitive.findAttribute("JOINTS_0");
+                const auto weights = primitive.findAttribute("WEIGHTS_0");
+                if (joints != primitive.attributes.end() && weights != primitive.attributes.end()) {
+                    fastgltf::iterateAccessorWithIndex<glm::uvec4>(asset.get(), asset->accessors[joints->accessorIndex],
+                        [&](glm::uvec4 value, size_t index) {
+                            loaded.skinVertices[baseVertex + index].joints = value;
+                        });
+                    fastgltf::iterateAccessorWithIndex<glm::vec4>(asset.get(), asset->accessors[weights->accessorIndex],
+                        [&](glm::vec4 value, size_t index) {
+                            loaded.skinVertices[baseVertex + index].weights = value;
+                        });
+                }
+            }
+        }
+
+        if (skinned && !loaded.indices.empty()) {
+            const auto skin = static_cast<size_t>(skinOfMesh[meshIndex]);
+            if (!skeletons[skin]) {
+                skeletons[skin] = buildSkeleton(asset.get(), asset->skins[skin]);
+            }
+            loaded.skeleton = skeletons[skin];
+        }
+
+        if (!loaded.indices.empty()) {
+            loaded.boundingSphere = computeBoundingSphere(loaded.vertices);
+            meshes.push_back(std::move(loaded));
+        }
+    }
+
+    co_return meshes;
+}
+
+uint64_t AssetLoader::submitUpload(
+    std::span<const LoadedMesh> meshes,
+    std::vector<GPUMeshBuffers>& outBuffers,
+    AllocatedBuffer& outStaging,
+    VkCommandBuffer& outCmd
+) {
+    const VkDevice device = m_engine->getContext()->getDevice();
+
+    size_t stagingSize = 0;
+    for (const LoadedMesh& mesh : meshes) {
+        stagingSize += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(uint32_t);
+    }
+    outStaging = m_engine->createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+    auto* staging = static_cast<uint8_t*>(outStaging.info.pMappedData);
+
+    const VkCommandBufferAllocateInfo allocateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = nullptr,
+        .commandPool = m_commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+    VK_CHECK(vkAllocateCommandBuffers(device, &allocateInfo, &outCmd));
+
+    constexpr VkCommandBufferBeginInfo beginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = nullptr,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr,
+    };
+    VK_CHECK(vkBeginCommandBuffer(outCmd, &beginInfo));
+
+    size_t stagingOffset = 0;
+    for (const LoadedMesh& mesh : meshes) {
+        const size_t vertexBufferSize = mesh.vertices.size() * sizeof(Vertex);
+        const size_t indexBufferSize = mesh.indices.size() * sizeof(uint32_t);
+
+        GPUMeshBuffers buffers{};
+        buffers.vertexBuffer = m_engine->createBuffer(vertexBufferSize,
+                                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                      VMA_MEMORY_USAGE_GPU_ONLY);
+        buffers.indexBuffer = m_engine->createBuffer(indexBufferSize,
+                                                     VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                     VMA_MEMORY_USAGE_GPU_ONLY);
+
+        const VkBufferDeviceAddressInfo deviceAddressInfo{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+            .buffer = buffers.vertexBuffer.buffer,
+        };
+        buffers.vertexBufferAddress = vkGetBufferDeviceAddress(device, &deviceAddressInfo);
+        buffers.boundingSphere = mesh.boundingSphere;
+
+        memcpy(staging + stagingOffset, mesh.vertices.data(), vertexBufferSize);
+        memcpy(staging + stagingOffset + vertexBufferSize, mesh.indices.data(), indexBufferSize);
+
+        const VkBufferCopy vertexCopy{
+            .srcOffset = stagingOffset,
+            .dstOffset = 0,
+            .size = vertexBufferSize,
+        };
+        vkCmdCopyBuffer(outCmd, outStaging.buffer, buffers.vertexBuffer.buffer, 1, &vertexCopy);
+
+        const VkBufferCopy indexCopy{
+            .srcOffset = stagingOffset + vertexBufferSize,
+            .dstOffset = 0,
+            .size = indexBufferSize,
+        };
+        vkCmdCopyBuffer(outCmd, outStaging.buffer, buffers.indexBuffer.buffer, 1, &indexCopy);
+
+        stagingOffset += vertexBufferSize + indexBufferSize;
+        outBuffers.push_back(buffers);
+    }
+
+    // frames submitted after the upload completes read the meshes without waiting on the semaphore
+    VkUtils::memoryBarrier(outCmd,
+                           VK_PIPELINE_STAGE_2_COPY_BIT,
+                           VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+                           VK_ACCESS_2_INDEX_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+
+    VK_CHECK(vkEndCommandBuffer(outCmd));
+
+    const uint64_t timelineValue = m_nextTimelineValue++;
+
+    const VkCommandBufferSubmitInfo cmdInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+        .pNext = nullptr,
+        .commandBuffer = outCmd,
+        .deviceMask = 0,
+    };
+
+    const VkSemaphoreSubmitInfo signalInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .semaphore = m_timeline,
+        .value = timelineValue,
+        .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        .deviceIndex = 0,
+    };
+
+    const VkSubmitInfo2 submitInfo{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+        .pNext = nullptr,
+        .waitSemaphoreInfoCount = 0,
+        .pWaitSemaphoreInfos = nullptr,
+        .commandBufferInfoCount = 1,
+        .pCommandBufferInfos = &cmdInfo,
+        .signalSemaphoreInfoCount = 1,
+        .pSignalSemaphoreInfos = &signalInfo,
+    };
+
+    VK_CHECK(vkQueueSubmit2(m_engine->getContext()->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE));
+
+    return timelineValue;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VkTypes.hpp"
+#include "VkSkinning.hpp"
+#include "Task.hpp"
+
+class VulkanEngine;
+class JobSystem;
+
+// CPU side geometry of one glTF primitive, decoded on a worker
+struct LoadedMesh {
+    std::string name;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    glm::vec4 boundingSphere;
+    // one entry per vertex when a skinned node uses the mesh, the skeleton is shared by the meshes of a skin
+    std::vector<SkinVertex> skinVertices;
+    std::shared_ptr<const Skeleton> skeleton;
+};
+
+struct AssetLoaderStats {
+    uint32_t activeLoads = 0;
+    uint32_t finishedLoads = 0;
+    uint32_t failedLoads = 0;
+};
+
+// loads glTF files without blocking the render thread. Every load is a coroutine that reads and
+// decodes on the job system, records its upload on the render thread and waits on a timeline
+// semaphore value before the meshes join the scene, so any number of loads overlap
+class AssetLoader {
+public:
+    void init(VulkanEngine* engine, JobSystem* jobSystem);
+    // cancels the loads that have not submitted their upload yet and waits for the others,
+    // the device has to be idle
+    void shutdown();
+
+    // starts the load and returns at once, the meshes are added with the given transform when done
+    void load(const std::filesystem::path& path, const glm::mat4& transform);
+
+    // resumes the loads waiting for the render thread or for their upload, once per frame
+    void update();
+
+    [[nodiscard]] const AssetLoaderStats& getStats() const { return m_stats; }
+
+private:
+    // suspends until the upload queue's timeline semaphore reaches the value
+    auto waitForUpload(uint64_t timelineValue) noexcept {
+        struct Awaiter {
+            AssetLoader& loader;
+            uint64_t value;
+
+            bool await_ready() const { return loader.getCompletedValue() >= value; }
+            void await_suspend(std::coroutine_handle<> handle) { loader.m_uploadWaits.push_back({value, handle}); }
+            void await_resume() noexcept {}
+        };
+        return Awaiter{*this, timelineValue};
+    }
+
+    struct UploadWait {
+        uint64_t timelineValue;
+        std::coroutine_handle<> handle;
+    };
+
+    DetachedTask runLoad(std::filesystem::path path, glm::mat4 transform);
+
+    Task<std::vector<std::byte>> readFile(std::filesystem::path path);
+    Task<std::vector<LoadedMesh>> decodeGltf(std::vector<std::byte> bytes, std::filesystem::path directory);
+    // records and submits the copies, returns the timeline value that signals their completion
+    uint64_t submitUpload(std::span<const LoadedMesh> meshes, std::vector<GPUMeshBuffers>& outBuffers,
+                          AllocatedBuffer& outStaging, VkCommandBuffer& outCmd);
+
+    [[nodiscard]] uint64_t getCompletedValue() const;
+
+    VulkanEngine* m_engine = nullptr;
+    JobSystem* m_jobSystem = nullptr;
+
+    MainThreadQueue m_mainThread;
+    std::vector<UploadWait> m_uploadWaits;
+
+    VkCommandPool m_commandPool = VK_NULL_HANDLE;
+    VkSemaphore m_timeline = VK_NULL_HANDLE;
+    uint64_t m_nextTimelineValue = 1;
+
+    // set by shutdown, loads check it whenever they resume
+    std::atomic<bool> m_cancelled{false};
+
+    // only touched on the render thread
+    AssetLoaderStats m_stats;
+};
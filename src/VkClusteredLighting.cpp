@@ -0,0 +1,129 @@
+#include "VkClusteredLighting.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "VkEngine.hpp"
+#include "VkPipeline.hpp"
+#include "VkSync.hpp"
+
+// must match local_size_x in clusterLights.comp
+constexpr uint32_t CLUSTER_CULL_GROUP_SIZE = 128;
+
+void ClusteredLighting::init(VulkanEngine* engine, VkDescriptorSetLayout sceneLayout) {
+    m_engine = engine;
+    const VkDevice device = engine->getContext()->getDevice();
+
+    m_lights.reserve(MAX_LIGHTS);
+
+    for (auto& staging: m_lightStaging) {
+        staging = engine->createBuffer(MAX_LIGHTS * sizeof(GPULight),
+                                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                       VMA_MEMORY_USAGE_CPU_ONLY);
+    }
+
+    m_lightBuffer = engine->createBuffer(MAX_LIGHTS * sizeof(GPULight),
+                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                         VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                         VMA_MEMORY_USAGE_GPU_ONLY);
+
+    m_clusterGridBuffer = engine->createBuffer(CLUSTER_COUNT * 2 * sizeof(uint32_t),
+                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                               VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                               VMA_MEMORY_USAGE_GPU_ONLY);
+
+    // the first uint is the allocation counter, reset with a fill every frame
+    m_lightIndexBuffer = engine->createBuffer((MAX_LIGHT_INDICES + 1) * sizeof(uint32_t),
+                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                              VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                              VMA_MEMORY_USAGE_GPU_ONLY);
+
+    const VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .setLayoutCount = 1,
+        .pSetLayouts = &sceneLayout,
+    };
+
+    VK_CHECK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &m_cullPipelineLayout));
+
+    VkShaderModule cullShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/clusterLights.comp.spv", device, &cullShader)) {
+        std::cerr << "Error when building the light culling compute shader" << std::endl;
+    }
+
+    const VkComputePipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = engine->getScenePipelineFlags(),
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = cullShader,
+            .pName = "main",
+        },
+        .layout = m_cullPipelineLayout,
+    };
+
+    VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_cullPipeline));
+
+    VkUtils::destroyShaderModule(device, cullShader);
+
+    engine->getMainDeletionQueue().push_function([this, device] {
+        vkDestroyPipeline(device, m_cullPipeline, nullptr);
+        vkDestroyPipelineLayout(device, m_cullPipelineLayout, nullptr);
+
+        m_engine->destroyBuffer(m_lightIndexBuffer);
+        m_engine->destroyBuffer(m_clusterGridBuffer);
+        m_engine->destroyBuffer(m_lightBuffer);
+        for (const auto& staging: m_lightStaging) {
+            m_engine->destroyBuffer(staging);
+        }
+    });
+}
+
+uint32_t ClusteredLighting::getActiveLightCount() const {
+    return static_cast<uint32_t>(std::min<size_t>(m_lights.size(), MAX_LIGHTS));
+}
+
+void ClusteredLighting::cullLights(VkCommandBuffer cmd, uint32_t frameIndex) const {
+    const uint32_t lightCount = getActiveLightCount();
+    const AllocatedBuffer& staging = m_lightStaging[frameIndex];
+
+    // the frame fence has been waited on, so the staging copy of this frame is free to overwrite
+    if (lightCount > 0) {
+        memcpy(staging.info.pMappedData, m_lights.data(), lightCount * sizeof(GPULight));
+
+        const VkBufferCopy lightCopy{
+            .srcOffset = 0,
+            .dstOffset = 0,
+            .size = lightCount * sizeof(GPULight)
+        };
+        vkCmdCopyBuffer(cmd, staging.buffer, m_lightBuffer.buffer, 1, &lightCopy);
+        m_engine->getFrameCounters().uploadBytes += lightCopy.size;
+    }
+
+    // reset the index list allocation counter
+    vkCmdFillBuffer(cmd, m_lightIndexBuffer.buffer, 0, sizeof(uint32_t), 0);
+
+    VkUtils::memoryBarrier(cmd,
+                           VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+                           VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+    m_engine->bindSceneDescriptors(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout);
+
+    // one invocation per cluster
+    vkCmdDispatch(cmd, (CLUSTER_COUNT + CLUSTER_CULL_GROUP_SIZE - 1) / CLUSTER_CULL_GROUP_SIZE, 1, 1);
+    m_engine->getFrameCounters().dispatches++;
+
+    // make the cluster lists visible to the shading passes
+    VkUtils::memoryBarrier(cmd,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                           VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+}
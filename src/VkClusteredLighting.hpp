@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+#include "VkTypes.hpp"
+
+class VulkanEngine;
+
+// froxel grid dimensions. 16x9 tiles keep clusters roughly square on 16:9 targets
+constexpr uint32_t CLUSTER_GRID_X = 16;
+constexpr uint32_t CLUSTER_GRID_Y = 9;
+constexpr uint32_t CLUSTER_GRID_Z = 24;
+constexpr uint32_t CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+
+constexpr uint32_t MAX_LIGHTS = 4096;
+constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+// average budget of light references per cluster for the compact index list
+constexpr uint32_t MAX_LIGHT_INDICES = CLUSTER_COUNT * 64;
+
+enum class LightType : uint32_t {
+    Point = 0,
+    Spot = 1,
+};
+
+// std430 layout, must match the Light struct in clusterLights.comp and mesh.frag
+struct GPULight {
+    glm::vec4 positionRange;  // xyz world position, w range
+    glm::vec4 colorIntensity; // rgb color, w intensity
+    glm::vec4 directionType;  // xyz spot direction, w LightType
+    glm::vec4 spotCone;       // x cos of inner angle, y cos of outer angle
+};
+
+// bins lights into a view-space froxel grid each frame so shading only loops over the lights of its own cluster
+class ClusteredLighting {
+public:
+    void init(VulkanEngine* engine, VkDescriptorSetLayout sceneLayout);
+
+    [[nodiscard]] std::vector<GPULight>& getLights() { return m_lights; }
+    [[nodiscard]] uint32_t getActiveLightCount() const;
+
+    [[nodiscard]] const AllocatedBuffer& getLightBuffer() const { return m_lightBuffer; }
+    [[nodiscard]] const AllocatedBuffer& getClusterGridBuffer() const { return m_clusterGridBuffer; }
+    [[nodiscard]] const AllocatedBuffer& getLightIndexBuffer() const { return m_lightIndexBuffer; }
+
+    // uploads the light list and dispatches the cluster culling pass. Must be recorded before any pass that shades
+    void cullLights(VkCommandBuffer cmd, uint32_t frameIndex) const;
+
+private:
+    VulkanEngine* m_engine = nullptr;
+
+    std::vector<GPULight> m_lights;
+
+    // host visible copy of the light list for every frame in flight
+    AllocatedBuffer m_lightStaging[FRAME_OVERLAP]{};
+    AllocatedBuffer m_lightBuffer{};
+    // one uvec2 (offset, count) per cluster
+    AllocatedBuffer m_clusterGridBuffer{};
+    // atomic counter followed by the compact light index list
+    AllocatedBuffer m_lightIndexBuffer{};
+
+    VkPipelineLayout m_cullPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_cullPipeline = VK_NULL_HANDLE;
+};
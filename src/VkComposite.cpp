@@ -0,0 +1,150 @@
+#include "VkComposite.hpp"
+
+#include "VkEngine.hpp"
+#include "VkPipeline.hpp"
+#include "VkPostProcess.hpp"
+
+static bool isSrgbFormat(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void CompositePass::init(
+    VulkanEngine* engine,
+    const PostProcess& postProcess,
+    const AllocatedImage& drawImage,
+    VkFormat targetFormat
+) {
+    m_engine = engine;
+    const VkDevice device = engine->getContext()->getDevice();
+
+    m_drawImageExtent = {drawImage.imageExtent.width, drawImage.imageExtent.height};
+    m_encodeSrgb = !isSrgbFormat(targetFormat);
+
+    {
+        DescriptorLayoutBuilder builder;
+        builder.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        builder.addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        m_descriptorLayout = builder.build(device, VK_SHADER_STAGE_FRAGMENT_BIT);
+    }
+
+    std::vector<DescriptorAllocator::PoolSizeRatio> sizes = {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2},
+    };
+    m_descriptorAllocator.initPool(device, 1, sizes);
+
+    // both images stay in the general layout, they are written by compute passes earlier in the frame
+    m_descriptorSet = m_descriptorAllocator.allocate(device, m_descriptorLayout);
+    {
+        DescriptorWriter writer;
+        writer.writeImage(0, drawImage.imageView, postProcess.getLinearSampler(), VK_IMAGE_LAYOUT_GENERAL,
+                          VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.writeImage(1, postProcess.getBloomView(), postProcess.getLinearSampler(), VK_IMAGE_LAYOUT_GENERAL,
+                          VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.updateSet(device, m_descriptorSet);
+    }
+
+    const VkPushConstantRange pushConstant{
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .offset = 0,
+        .size = sizeof(CompositePushConstants),
+    };
+
+    const VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .setLayoutCount = 1,
+        .pSetLayouts = &m_descriptorLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstant,
+    };
+
+    VK_CHECK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &m_pipelineLayout));
+
+    VkShaderModule vertexShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/fullscreen.vert.spv", device, &vertexShader)) {
+        std::cerr << "Error when building the full screen vertex shader module" << std::endl;
+    }
+
+    VkShaderModule fragmentShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/composite.frag.spv", device, &fragmentShader)) {
+        std::cerr << "Error when building the composite fragment shader module" << std::endl;
+    }
+
+    PipelineBuilder pipelineBuilder(engine->getContext());
+    pipelineBuilder.m_pipelineLayout = m_pipelineLayout;
+    pipelineBuilder.setShaders(vertexShader, fragmentShader);
+    pipelineBuilder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    pipelineBuilder.setPolygonMode(VK_POLYGON_MODE_FILL);
+    pipelineBuilder.setCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+    pipelineBuilder.setMultiSamplingNone();
+    pipelineBuilder.disableBlending();
+    pipelineBuilder.disableDepthTest();
+    pipelineBuilder.setColorAttachmentFormat(targetFormat);
+    pipelineBuilder.setDepthFormat(VK_FORMAT_UNDEFINED);
+
+    m_pipeline = engine->getPipelineRegistry().getPipeline(pipelineBuilder);
+
+    VkUtils::destroyShaderModule(device, fragmentShader);
+    VkUtils::destroyShaderModule(device, vertexShader);
+
+    engine->getMainDeletionQueue().push_function([this, device] {
+        vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+
+        m_descriptorAllocator.destroyPool(device);
+        vkDestroyDescriptorSetLayout(device, m_descriptorLayout, nullptr);
+    });
+}
+
+void CompositePass::draw(
+    VkCommandBuffer cmd,
+    const PostProcess& postProcess,
+    VkExtent2D drawExtent,
+    VkExtent2D targetExtent,
+    uint32_t frameNumber
+) const {
+    const VkViewport viewport{
+        .x = 0,
+        .y = 0,
+        .width = static_cast<float>(targetExtent.width),
+        .height = static_cast<float>(targetExtent.height),
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    };
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    const VkRect2D scissor{
+        .offset = {0, 0},
+        .extent = targetExtent,
+    };
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+
+    // the rendered region may be smaller than the draw image, the sampler scales it to the target
+    const CompositePushConstants pushConstants{
+        .data1 = glm::vec4(
+            static_cast<float>(drawExtent.width) / static_cast<float>(m_drawImageExtent.width),
+            static_cast<float>(drawExtent.height) / static_cast<float>(m_drawImageExtent.height),
+            postProcess.exposure,
+            postProcess.bloomEnabled ? postProcess.bloomIntensity : 0.f
+        ),
+        .data2 = glm::vec4(
+            postProcess.tonemapEnabled ? 1.f : 0.f,
+            ditherEnabled ? 1.f : 0.f,
+            m_encodeSrgb ? 1.f : 0.f,
+            static_cast<float>(frameNumber % 64)
+        ),
+    };
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(CompositePushConstants), &pushConstants);
+
+    vkCmdDraw(cmd, 3, 1, 0, 0);
+    m_engine->getFrameCounters().draws++;
+}
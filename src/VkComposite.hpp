@@ -0,0 +1,41 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkDescriptors.hpp"
+
+class VulkanEngine;
+class PostProcess;
+
+struct CompositePushConstants {
+    // uv scale of the rendered region, exposure, bloom intensity
+    glm::vec4 data1;
+    // tonemap, dither, encode sRGB in the shader, frame index
+    glm::vec4 data2;
+};
+
+// final full screen pass: samples the HDR draw image with the bloom chain, tonemaps, encodes to sRGB,
+// dithers and scales straight into the swapchain image. Replaces the blit and its transfer layouts
+class CompositePass {
+public:
+    void init(VulkanEngine* engine, const PostProcess& postProcess, const AllocatedImage& drawImage, VkFormat targetFormat);
+
+    // records the full screen triangle inside an already begun rendering pass covering the target
+    void draw(VkCommandBuffer cmd, const PostProcess& postProcess, VkExtent2D drawExtent, VkExtent2D targetExtent,
+              uint32_t frameNumber) const;
+
+    bool ditherEnabled = true;
+
+private:
+    VulkanEngine* m_engine = nullptr;
+
+    VkExtent2D m_drawImageExtent{};
+    // only needed when the target format does not encode sRGB on its own
+    bool m_encodeSrgb = false;
+
+    DescriptorAllocator m_descriptorAllocator{};
+    VkDescriptorSetLayout m_descriptorLayout = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+};
@@ -1,9 +1,14 @@
 #include "VkContext.hpp"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <set>
+#include <span>
 
 #include <SDL3/SDL_vulkan.h>
 
+#include "DeviceOverride.hpp"
 #include "VkEngine.hpp"
 #include "VkTypes.hpp"
 
@@ -17,11 +22,11 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     return VK_FALSE;
 }
 
-void VulkanContext::init() {
+void VulkanContext::init(const std::string& preferredDevice) {
     createInstance();
     setupDebugMessenger();
     createSurface();
-    pickPhysicalDevice();
+    pickPhysicalDevice(preferredDevice);
     createLogicalDevice();
 }
 
@@ -133,7 +138,13 @@ void VulkanContext::createSurface() {
     }
 }
 
-void VulkanContext::pickPhysicalDevice() {
+static bool hasExtension(std::span<const VkExtensionProperties> extensions, const char* name) {
+    return std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties& extension) {
+        return strcmp(extension.extensionName, name) == 0;
+    });
+}
+
+void VulkanContext::pickPhysicalDevice(const std::string& preferredDevice) {
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
     if (deviceCount == 0) {
@@ -143,16 +154,175 @@ void VulkanContext::pickPhysicalDevice() {
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
 
-    for (const auto &device: devices) {
-        if (isDeviceSuitable(device)) {
-            m_physicalDevice = device;
-            break;
+    std::string override = preferredDevice;
+    if (override.empty()) {
+        if (const char* environment = std::getenv("HELLFIRE_GPU")) {
+            override = environment;
+        }
+    }
+
+    uint64_t bestScore = 0;
+    bool overridden = false;
+
+    for (uint32_t i = 0; i < deviceCount; i++) {
+        const DeviceCapabilities capabilities = queryCapabilities(devices[i]);
+        const bool suitable = isDeviceSuitable(devices[i]);
+        const uint64_t score = suitable ? scoreDevice(capabilities) : 0;
+
+        std::cout << std::format("GPU {}: {} ({}), {}", i, capabilities.deviceName,
+                                 string_VkPhysicalDeviceType(capabilities.deviceType),
+                                 suitable ? std::format("score {}", score) : "unsuitable") << std::endl;
+
+        if (!suitable || overridden) {
+            continue;
+        }
+
+        if (!override.empty() && matchesDevice(override, i, capabilities.deviceName)) {
+            overridden = true;
+        } else if (m_physicalDevice != VK_NULL_HANDLE && score <= bestScore) {
+            continue;
         }
+
+        m_physicalDevice = devices[i];
+        m_capabilities = capabilities;
+        bestScore = score;
     }
 
     if (m_physicalDevice == VK_NULL_HANDLE) {
         throw std::runtime_error("Failed to find a suitable GPU!");
     }
+
+    if (!override.empty() && !overridden) {
+        std::cerr << "No suitable GPU matches '" << override << "', picking the highest score instead" << std::endl;
+    }
+
+    std::cout << "Using GPU: " << m_capabilities.deviceName << std::endl;
+}
+
+DeviceCapabilities VulkanContext::queryCapabilities(VkPhysicalDevice device) {
+    DeviceCapabilities capabilities{};
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(device, &properties);
+    capabilities.deviceName = properties.deviceName;
+    capabilities.deviceType = properties.deviceType;
+
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            capabilities.deviceLocalBytes += memoryProperties.memoryHeaps[i].size;
+        }
+    }
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+    // only structures of supported extensions may be chained into the query
+    VkPhysicalDeviceFeatures2 features2{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+    };
+    void** next = &features2.pNext;
+
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+    };
+    if (hasExtension(extensions, VK_EXT_MESH_SHADER_EXTENSION_NAME)) {
+        *next = &meshShaderFeatures;
+        next = &meshShaderFeatures.pNext;
+    }
+
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT,
+    };
+    if (hasExtension(extensions, VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME)) {
+        *next = &descriptorBufferFeatures;
+        next = &descriptorBufferFeatures.pNext;
+    }
+
+    VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT,
+    };
+    if (hasExtension(extensions, VK_EXT_SHADER_OBJECT_EXTENSION_NAME)) {
+        *next = &shaderObjectFeatures;
+        next = &shaderObjectFeatures.pNext;
+    }
+
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+    };
+    if (hasExtension(extensions, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+        hasExtension(extensions, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+        *next = &pipelineLibraryFeatures;
+        next = &pipelineLibraryFeatures.pNext;
+    }
+
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamicState3Features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+    };
+    if (hasExtension(extensions, VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME)) {
+        *next = &dynamicState3Features;
+        next = &dynamicState3Features.pNext;
+    }
+
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+    };
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+    };
+    if (hasExtension(extensions, VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+        hasExtension(extensions, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        *next = &presentIdFeatures;
+        presentIdFeatures.pNext = &presentWaitFeatures;
+        next = &presentWaitFeatures.pNext;
+    }
+
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+
+    capabilities.meshShader = meshShaderFeatures.meshShader && meshShaderFeatures.taskShader;
+    capabilities.descriptorBuffer = descriptorBufferFeatures.descriptorBuffer;
+    capabilities.shaderObject = shaderObjectFeatures.shaderObject;
+    capabilities.graphicsPipelineLibrary = pipelineLibraryFeatures.graphicsPipelineLibrary;
+    // the subset of dynamic state 3 the pipelines would make dynamic
+    capabilities.extendedDynamicState3 = dynamicState3Features.extendedDynamicState3PolygonMode &&
+                                         dynamicState3Features.extendedDynamicState3ColorBlendEnable &&
+                                         dynamicState3Features.extendedDynamicState3ColorBlendEquation &&
+                                         dynamicState3Features.extendedDynamicState3ColorWriteMask;
+    capabilities.presentWait = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+    capabilities.memoryBudget = hasExtension(extensions, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    capabilities.pipelineStatistics = features2.features.pipelineStatisticsQuery;
+
+    return capabilities;
+}
+
+uint64_t VulkanContext::scoreDevice(const DeviceCapabilities& capabilities) {
+    uint64_t typeRank = 0;
+    switch (capabilities.deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            typeRank = 4;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            typeRank = 3;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            typeRank = 2;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            typeRank = 1;
+            break;
+        default:
+            break;
+    }
+
+    const uint64_t featureCount = capabilities.meshShader + capabilities.descriptorBuffer +
+                                  capabilities.shaderObject + capabilities.graphicsPipelineLibrary +
+                                  capabilities.extendedDynamicState3 + capabilities.presentWait;
+
+    // a lavapipe or an integrated GPU never wins against a discrete one, whatever its heap sizes
+    return typeRank * 1'000'000'000ull + (capabilities.deviceLocalBytes >> 20) * 10 + featureCount * 1000;
 }
 
 void VulkanContext::createLogicalDevice() {
@@ -175,12 +345,25 @@ void VulkanContext::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    VkPhysicalDeviceFeatures deviceFeatures{};
+    // the bloom chain is written without a format qualifier so its packed format can vary per device
+    VkPhysicalDeviceFeatures deviceFeatures{
+        .shaderStorageImageWriteWithoutFormat = VK_TRUE,
+    };
+    // the profiler counts shader invocations per pass where the device can
+    deviceFeatures.pipelineStatisticsQuery = m_capabilities.pipelineStatistics ? VK_TRUE : VK_FALSE;
+
+    // Vulkan 1.1 features
+    VkPhysicalDeviceVulkan11Features features11{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES,
+        .multiview = VK_TRUE,
+    };
 
     // Vulkan 1.2 features
     VkPhysicalDeviceVulkan12Features features12{
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
         .descriptorIndexing = VK_TRUE,
+        // asset uploads signal their completion on a timeline semaphore
+        .timelineSemaphore = VK_TRUE,
         .bufferDeviceAddress = VK_TRUE,
     };
 
@@ -192,15 +375,71 @@ void VulkanContext::createLogicalDevice() {
     };
 
     // Link feature chains
+    features11.pNext = &features12;
     features12.pNext = &features13;
 
 #if __APPLE__
     m_deviceExtensions.push_back("VK_KHR_portability_subset");
 #endif
 
+    // optional extensions are only enabled once a path uses them
+    if (m_capabilities.memoryBudget) {
+        m_deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    void** next = &features13.pNext;
+
+    // the scene descriptors are written into a buffer instead of allocated from a pool
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT,
+        .descriptorBuffer = VK_TRUE,
+    };
+    if (m_capabilities.descriptorBuffer) {
+        m_deviceExtensions.push_back(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+        *next = &descriptorBufferFeatures;
+        next = &descriptorBufferFeatures.pNext;
+    }
+
+    // the geometry pass can draw with shader objects and set its state while recording
+    VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT,
+        .shaderObject = VK_TRUE,
+    };
+    if (m_capabilities.shaderObject) {
+        m_deviceExtensions.push_back(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+        *next = &shaderObjectFeatures;
+        next = &shaderObjectFeatures.pNext;
+    }
+
+    // pipelines are compiled in parts, fast linked and optimized in the background
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+        .graphicsPipelineLibrary = VK_TRUE,
+    };
+    if (m_capabilities.graphicsPipelineLibrary) {
+        m_deviceExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        m_deviceExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+        *next = &pipelineLibraryFeatures;
+        next = &pipelineLibraryFeatures.pNext;
+    }
+
+    // polygon mode and blending join the states dynamic pipelines leave to the command buffer
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamicState3Features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+        .extendedDynamicState3PolygonMode = VK_TRUE,
+        .extendedDynamicState3ColorBlendEnable = VK_TRUE,
+        .extendedDynamicState3ColorBlendEquation = VK_TRUE,
+        .extendedDynamicState3ColorWriteMask = VK_TRUE,
+    };
+    if (m_capabilities.extendedDynamicState3) {
+        m_deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+        *next = &dynamicState3Features;
+        next = &dynamicState3Features.pNext;
+    }
+
     VkDeviceCreateInfo createInfo{
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-        .pNext = &features12, // chain starts here
+        .pNext = &features11, // chain starts here
         .queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size()),
         .pQueueCreateInfos = queueCreateInfos.data(),
         .enabledExtensionCount = static_cast<uint32_t>(m_deviceExtensions.size()),
@@ -309,7 +548,9 @@ bool VulkanContext::isDeviceSuitable(VkPhysicalDevice device) const {
     vkGetPhysicalDeviceFeatures2(device, &features2);
 
     bool supportFeatures = features2.features.samplerAnisotropy &&
+                           features2.features.shaderStorageImageWriteWithoutFormat &&
                            features11.shaderDrawParameters &&
+                           features11.multiview &&
                            features13.dynamicRendering &&
                            features13.synchronization2 &&
                            dynamicStateFeatures.extendedDynamicState;
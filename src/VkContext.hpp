@@ -1,6 +1,7 @@
 #pragma once
 
 #include <optional>
+#include <string>
 #include <vector>
 
 #include <vulkan/vulkan.h>
@@ -18,9 +19,26 @@ struct QueueFamilyIndices {
     }
 };
 
+// optional device features, each one unlocks a faster path when present
+struct DeviceCapabilities {
+    std::string deviceName;
+    VkPhysicalDeviceType deviceType = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+    VkDeviceSize deviceLocalBytes = 0;
+
+    bool meshShader = false;
+    bool descriptorBuffer = false;
+    bool shaderObject = false;
+    bool graphicsPipelineLibrary = false;
+    bool extendedDynamicState3 = false;
+    bool presentWait = false;
+    bool memoryBudget = false;
+    bool pipelineStatistics = false;
+};
+
 class VulkanContext {
 public:
-    void init();
+    // preferredDevice is a device index or part of its name, HELLFIRE_GPU is used when it is empty
+    void init(const std::string& preferredDevice = {});
 
     void cleanup();
 
@@ -31,6 +49,7 @@ public:
     [[nodiscard]] VkQueue getGraphicsQueue() const { return m_graphicsQueue; }
     [[nodiscard]] VkQueue getPresentQueue() const { return m_presentQueue; }
     [[nodiscard]] QueueFamilyIndices getQueueFamilies() const { return m_queueFamilyIndices; }
+    [[nodiscard]] const DeviceCapabilities& getCapabilities() const { return m_capabilities; }
 
 private:
     void createInstance();
@@ -39,7 +58,7 @@ private:
 
     void createSurface();
 
-    void pickPhysicalDevice();
+    void pickPhysicalDevice(const std::string& preferredDevice);
 
     void createLogicalDevice();
 
@@ -47,6 +66,11 @@ private:
 
     [[nodiscard]] bool isDeviceSuitable(VkPhysicalDevice device) const;
 
+    [[nodiscard]] static DeviceCapabilities queryCapabilities(VkPhysicalDevice device);
+
+    // higher is faster, the device type dominates, then memory and optional features
+    [[nodiscard]] static uint64_t scoreDevice(const DeviceCapabilities& capabilities);
+
     VkInstance m_instance = VK_NULL_HANDLE;
     VkDebugUtilsMessengerEXT m_debugMessenger = VK_NULL_HANDLE;
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
@@ -56,6 +80,7 @@ private:
     VkQueue m_presentQueue = VK_NULL_HANDLE;
 
     QueueFamilyIndices m_queueFamilyIndices;
+    DeviceCapabilities m_capabilities;
 
     const std::vector<const char *> m_validationLayers = {
         "VK_LAYER_KHRONOS_validation"
@@ -2,6 +2,8 @@
 
 #include "VkTypes.hpp"
 
+#include <stdexcept>
+
 void DescriptorLayoutBuilder::addBinding(uint32_t binding, VkDescriptorType type) {
     const VkDescriptorSetLayoutBinding newBinding{
         .binding = binding,
@@ -83,7 +85,240 @@ VkDescriptorSet DescriptorAllocator::allocate(VkDevice device, VkDescriptorSetLa
     return descriptorSet;
 }
 
+void DescriptorWriter::writeImage(
+    uint32_t binding,
+    VkImageView image,
+    VkSampler sampler,
+    VkImageLayout layout,
+    VkDescriptorType type
+) {
+    const VkDescriptorImageInfo& info = imageInfos.emplace_back(VkDescriptorImageInfo{
+        .sampler = sampler,
+        .imageView = image,
+        .imageLayout = layout
+    });
+
+    writes.push_back(VkWriteDescriptorSet{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = VK_NULL_HANDLE, // left empty for now until we need to write it
+        .dstBinding = binding,
+        .descriptorCount = 1,
+        .descriptorType = type,
+        .pImageInfo = &info,
+    });
+}
+
+void DescriptorWriter::writeBuffer(uint32_t binding, VkBuffer buffer, size_t size, size_t offset, VkDescriptorType type) {
+    const VkDescriptorBufferInfo& info = bufferInfos.emplace_back(VkDescriptorBufferInfo{
+        .buffer = buffer,
+        .offset = offset,
+        .range = size
+    });
+
+    writes.push_back(VkWriteDescriptorSet{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = VK_NULL_HANDLE, // left empty for now until we need to write it
+        .dstBinding = binding,
+        .descriptorCount = 1,
+        .descriptorType = type,
+        .pBufferInfo = &info,
+    });
+}
+
+void DescriptorWriter::clear() {
+    imageInfos.clear();
+    bufferInfos.clear();
+    writes.clear();
+}
+
+void DescriptorWriter::updateSet(VkDevice device, VkDescriptorSet set) {
+    for (auto& write: writes) {
+        write.dstSet = set;
+    }
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void DescriptorBuffer::init(
+    VkDevice device,
+    VkPhysicalDevice physicalDevice,
+    VmaAllocator allocator,
+    VkDescriptorSetLayout setLayout,
+    uint32_t setCapacity
+) {
+    // extension entry points are not exported by the loader, fetch them from the device
+    getLayoutSize = reinterpret_cast<PFN_vkGetDescriptorSetLayoutSizeEXT>(
+        vkGetDeviceProcAddr(device, "vkGetDescriptorSetLayoutSizeEXT"));
+    getBindingOffset = reinterpret_cast<PFN_vkGetDescriptorSetLayoutBindingOffsetEXT>(
+        vkGetDeviceProcAddr(device, "vkGetDescriptorSetLayoutBindingOffsetEXT"));
+    getDescriptor = reinterpret_cast<PFN_vkGetDescriptorEXT>(
+        vkGetDeviceProcAddr(device, "vkGetDescriptorEXT"));
+    cmdBindBuffers = reinterpret_cast<PFN_vkCmdBindDescriptorBuffersEXT>(
+        vkGetDeviceProcAddr(device, "vkCmdBindDescriptorBuffersEXT"));
+    cmdSetOffsets = reinterpret_cast<PFN_vkCmdSetDescriptorBufferOffsetsEXT>(
+        vkGetDeviceProcAddr(device, "vkCmdSetDescriptorBufferOffsetsEXT"));
+
+    properties = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT};
+    VkPhysicalDeviceProperties2 deviceProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &properties,
+    };
+    vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProperties);
+
+    layout = setLayout;
+    maxSets = setCapacity;
+    setCount = 0;
+
+    // every set starts on an offset the device can bind
+    const VkDeviceSize alignment = properties.descriptorBufferOffsetAlignment;
+    getLayoutSize(device, layout, &setSize);
+    setSize = (setSize + alignment - 1) & ~(alignment - 1);
+
+    // one buffer holds both kinds, the scene set mixes buffers with a combined image sampler
+    const VkBufferCreateInfo bufferInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = setSize * maxSets,
+        .usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT |
+                 VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT |
+                 VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+    };
+
+    const VmaAllocationCreateInfo allocInfo{
+        .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+        .usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+    };
+
+    VmaAllocationInfo allocationInfo;
+    VK_CHECK(vmaCreateBufferWithAlignment(allocator, &bufferInfo, &allocInfo, alignment, &buffer, &allocation,
+                                          &allocationInfo));
+    mapped = static_cast<std::byte*>(allocationInfo.pMappedData);
+
+    const VkBufferDeviceAddressInfo addressInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+        .buffer = buffer,
+    };
+    address = vkGetBufferDeviceAddress(device, &addressInfo);
+}
+
+void DescriptorBuffer::destroy(VmaAllocator allocator) {
+    vmaDestroyBuffer(allocator, buffer, allocation);
+}
+
+uint32_t DescriptorBuffer::allocate() {
+    if (setCount >= maxSets) {
+        throw std::runtime_error("descriptor buffer is full");
+    }
+    return setCount++;
+}
+
+void DescriptorBuffer::writeBuffer(
+    VkDevice device,
+    uint32_t set,
+    uint32_t binding,
+    VkDeviceAddress bufferAddress,
+    size_t size,
+    VkDescriptorType type
+) {
+    // descriptor buffers take an explicit range, VK_WHOLE_SIZE is not allowed here
+    const VkDescriptorAddressInfoEXT addressInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
+        .address = bufferAddress,
+        .range = size,
+        .format = VK_FORMAT_UNDEFINED,
+    };
+
+    VkDescriptorGetInfoEXT getInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+        .type = type,
+    };
+    if (type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+        getInfo.data.pUniformBuffer = &addressInfo;
+    } else {
+        getInfo.data.pStorageBuffer = &addressInfo;
+    }
+
+    getDescriptor(device, &getInfo, getDescriptorSize(type), getDescriptorPointer(device, set, binding));
+}
+
+void DescriptorBuffer::writeImage(
+    VkDevice device,
+    uint32_t set,
+    uint32_t binding,
+    VkImageView image,
+    VkSampler sampler,
+    VkImageLayout imageLayout,
+    VkDescriptorType type
+) {
+    const VkDescriptorImageInfo imageInfo{
+        .sampler = sampler,
+        .imageView = image,
+        .imageLayout = imageLayout,
+    };
 
+    VkDescriptorGetInfoEXT getInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+        .type = type,
+    };
+    switch (type) {
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            getInfo.data.pCombinedImageSampler = &imageInfo;
+            break;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            getInfo.data.pSampledImage = &imageInfo;
+            break;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            getInfo.data.pStorageImage = &imageInfo;
+            break;
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+            getInfo.data.pSampler = &sampler;
+            break;
+        default:
+            throw std::runtime_error("unsupported image descriptor type");
+    }
 
+    getDescriptor(device, &getInfo, getDescriptorSize(type), getDescriptorPointer(device, set, binding));
+}
 
+void DescriptorBuffer::bind(
+    VkCommandBuffer cmd,
+    VkPipelineBindPoint bindPoint,
+    VkPipelineLayout pipelineLayout,
+    uint32_t firstSet,
+    uint32_t set
+) const {
+    const VkDescriptorBufferBindingInfoEXT bindingInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
+        .address = address,
+        .usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT,
+    };
+    cmdBindBuffers(cmd, 1, &bindingInfo);
+
+    constexpr uint32_t bufferIndex = 0;
+    const VkDeviceSize offset = setSize * set;
+    cmdSetOffsets(cmd, bindPoint, pipelineLayout, firstSet, 1, &bufferIndex, &offset);
+}
 
+size_t DescriptorBuffer::getDescriptorSize(VkDescriptorType type) const {
+    switch (type) {
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+            return properties.uniformBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+            return properties.storageBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            return properties.combinedImageSamplerDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            return properties.sampledImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            return properties.storageImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+            return properties.samplerDescriptorSize;
+        default:
+            throw std::runtime_error("unsupported descriptor type");
+    }
+}
+
+std::byte* DescriptorBuffer::getDescriptorPointer(VkDevice device, uint32_t set, uint32_t binding) const {
+    VkDeviceSize bindingOffset;
+    getBindingOffset(device, layout, binding, &bindingOffset);
+    return mapped + setSize * set + bindingOffset;
+}
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <deque>
 #include <vector>
 #include <span>
 
 #include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
 
 struct DescriptorLayoutBuilder {
     std::vector<VkDescriptorSetLayoutBinding> bindings;
@@ -36,3 +39,63 @@ struct DescriptorAllocator {
 
     VkDescriptorSet allocate(VkDevice device, VkDescriptorSetLayout layout);
 };
+
+struct DescriptorWriter {
+    // infos are kept in deques so the pointers stored in the writes stay valid
+    std::deque<VkDescriptorImageInfo> imageInfos;
+    std::deque<VkDescriptorBufferInfo> bufferInfos;
+    std::vector<VkWriteDescriptorSet> writes;
+
+    void writeImage(uint32_t binding, VkImageView image, VkSampler sampler, VkImageLayout layout, VkDescriptorType type);
+
+    void writeBuffer(uint32_t binding, VkBuffer buffer, size_t size, size_t offset, VkDescriptorType type);
+
+    void clear();
+
+    void updateSet(VkDevice device, VkDescriptorSet set);
+};
+
+// descriptors written straight into a mapped buffer with VK_EXT_descriptor_buffer. A set is an
+// offset into the buffer, so nothing is allocated from a pool or updated with vkUpdateDescriptorSets.
+// The layout must be built with VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT
+struct DescriptorBuffer {
+    VkBuffer buffer;
+    VmaAllocation allocation;
+    std::byte* mapped;
+    VkDeviceAddress address;
+
+    VkDescriptorSetLayout layout;
+    VkDeviceSize setSize;
+    uint32_t maxSets;
+    uint32_t setCount;
+
+    VkPhysicalDeviceDescriptorBufferPropertiesEXT properties;
+
+    PFN_vkGetDescriptorSetLayoutSizeEXT getLayoutSize;
+    PFN_vkGetDescriptorSetLayoutBindingOffsetEXT getBindingOffset;
+    PFN_vkGetDescriptorEXT getDescriptor;
+    PFN_vkCmdBindDescriptorBuffersEXT cmdBindBuffers;
+    PFN_vkCmdSetDescriptorBufferOffsetsEXT cmdSetOffsets;
+
+    void init(VkDevice device, VkPhysicalDevice physicalDevice, VmaAllocator allocator,
+              VkDescriptorSetLayout setLayout, uint32_t setCapacity);
+
+    void destroy(VmaAllocator allocator);
+
+    // returns the index of a fresh set, sets live as long as the buffer
+    uint32_t allocate();
+
+    void writeBuffer(VkDevice device, uint32_t set, uint32_t binding, VkDeviceAddress bufferAddress, size_t size,
+                     VkDescriptorType type);
+
+    void writeImage(VkDevice device, uint32_t set, uint32_t binding, VkImageView image, VkSampler sampler,
+                    VkImageLayout imageLayout, VkDescriptorType type);
+
+    void bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t firstSet,
+              uint32_t set) const;
+
+private:
+    [[nodiscard]] size_t getDescriptorSize(VkDescriptorType type) const;
+
+    std::byte* getDescriptorPointer(VkDevice device, uint32_t set, uint32_t binding) const;
+};
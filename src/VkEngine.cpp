@@ -8,16 +8,41 @@
 #include <imgui_impl_sdl3.h>
 #include <imgui_impl_vulkan.h>
 
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
 #include <thread>
 #include <iostream>
 #include <cassert>
+#include <random>
 
+#include "FrameCapture.hpp"
 #include "VkImage.hpp"
 #include "VkPipeline.hpp"
+#include "VkSync.hpp"
 
 VulkanEngine* s_engine = nullptr;
 
+// the scene set, binding N has type SCENE_BINDINGS[N]. Bindings 6 and 7 are the virtual texture
+// indirection and page cache
+static constexpr std::array SCENE_BINDINGS = {
+    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+};
+
 VulkanEngine& VulkanEngine::Get() {
     assert(s_engine != nullptr);
     return *s_engine;
@@ -42,12 +67,33 @@ void VulkanEngine::init() {
         std::cerr << std::format("Failed to create SDL Window");
     }
 
+    // workers are not pinned, the render thread and the OS scheduler share the cores with them
+    m_jobSystem.init();
+
     initVulkan();
 
     initDefaultData();
 
     initImGui();
 
+    m_assetLoader.init(this, &m_jobSystem);
+    m_meshStreamer.init(this, &m_jobSystem);
+    m_skinning.init(this);
+    m_particles.init(this, m_drawImage.imageFormat);
+    m_frameCapturer.init(this);
+    if (m_swapChain->isReadable()) {
+        m_frameReadback.init(this, m_swapChain->getImageFormat(), m_swapChain->getExtent());
+    } else {
+        std::cerr << "The swapChain cannot be copied from, screenshots and recordings are disabled" << std::endl;
+    }
+    if (!m_startupRecordingPath.empty()) {
+        m_frameReadback.startRecording(m_startupRecordingPath);
+    }
+
+    if (m_metricsPort != 0) {
+        m_telemetry.start(m_metricsPort);
+    }
+
     // everything went fine
     m_isInitialized = true;
 }
@@ -57,6 +103,12 @@ void VulkanEngine::cleanup() {
         //make sure the gpu has stopped doing its things
         vkDeviceWaitIdle(m_ctx->getDevice());
 
+        // loads still in flight register their meshes before the deletion queue runs
+        m_assetLoader.shutdown();
+        // jobs still reference the device and the subsystems, they all finish before anything is freed
+        m_jobSystem.shutdown();
+        m_telemetry.stop();
+
         //free per-frame structures and deletion queue
         for (auto& frame : m_frames) {
             vkDestroyCommandPool(m_ctx->getDevice(), frame.commandPool, nullptr);
@@ -103,7 +155,14 @@ void VulkanEngine::run() {
                 m_stopRendering = false;
             }
 
-            ImGui_ImplSDL3_ProcessEvent(&event);
+            if (event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_F1 && !event.key.repeat) {
+                m_showUi = !m_showUi;
+            }
+
+            // a hidden UI builds no frames, it must not collect input for when it is shown again
+            if (m_showUi) {
+                ImGui_ImplSDL3_ProcessEvent(&event);
+            }
         }
 
         // do not draw if we are minimized
@@ -113,37 +172,278 @@ void VulkanEngine::run() {
             continue;
         }
 
-        // ImGui new frame
-        ImGui_ImplVulkan_NewFrame();
-        ImGui_ImplSDL3_NewFrame();
-        ImGui::NewFrame();
+        m_assetLoader.update();
 
-        if (ImGui::Begin("background")) {
-            ComputeEffect& selected = m_backgroundEffects[m_currentBackgroundEffect];
+        if (m_showUi) {
+            buildUi();
+        }
 
-            ImGui::Text("Selected effect: ", selected.name);
+        draw();
+    }
+}
 
-            ImGui::SliderInt("Effect Index", &m_currentBackgroundEffect, 0, m_backgroundEffects.size() - 1);
+void VulkanEngine::buildUi() {
+    // ImGui new frame
+    ImGui_ImplVulkan_NewFrame();
+    ImGui_ImplSDL3_NewFrame();
+    ImGui::NewFrame();
+
+    if (ImGui::Begin("background")) {
+        ComputeEffect& selected = m_backgroundEffects[m_currentBackgroundEffect];
+
+        ImGui::Text("Selected effect: ", selected.name);
+
+        ImGui::SliderInt("Effect Index", &m_currentBackgroundEffect, 0, m_backgroundEffects.size() - 1);
+
+        ImGui::InputFloat4("data1", reinterpret_cast<float*>(&selected.data.data1));
+        ImGui::InputFloat4("data2", reinterpret_cast<float*>(&selected.data.data2));
+        ImGui::InputFloat4("data3", reinterpret_cast<float*>(&selected.data.data3));
+        ImGui::InputFloat4("data4", reinterpret_cast<float*>(&selected.data.data4));
+
+        ImGui::Checkbox("Dynamic", &selected.dynamic);
+        ImGui::Text("Evaluations: %u", m_backgroundEvaluations);
+
+        ImGui::SeparatorText("Particles");
+        ImGui::Checkbox("Enabled", &m_particles.enabled);
+        ImGui::Checkbox("Depth sort", &m_particles.sorting);
+        ImGui::SliderFloat("Emit rate", &m_particles.emitRate, 0.f, 1000000.f, "%.0f");
+        ImGui::SliderFloat("Lifetime", &m_particles.lifetime, 0.5f, 10.f);
+        ImGui::SliderFloat("Size", &m_particles.particleSize, 0.005f, 0.2f);
+        ImGui::SliderFloat3("Emitter", &m_particles.emitterPosition.x, -10.f, 10.f);
+        ImGui::SliderFloat3("Velocity", &m_particles.emitterVelocity.x, -10.f, 10.f);
+        if (ImGui::Button("Reset particles")) {
+            m_particles.reset();
+        }
+        // the alive count never leaves the GPU
+        ImGui::Text("Capacity: %u, sort dispatches: %u", PARTICLE_CAPACITY, m_particles.getSortDispatchCount());
+    }
+    ImGui::End();
+
+    if (ImGui::Begin("lights")) {
+        ImGui::SliderInt("Light Count", &m_lightCount, 0, MAX_LIGHTS);
+        ImGui::Checkbox("Animate", &m_animateLights);
+
+        ImGui::SliderFloat3("Sun Direction", &m_sunDirection.x, -1.f, 1.f);
+        ImGui::SliderFloat("Sun Intensity", &m_sunIntensity, 0.f, 10.f);
+
+        const ShadowStats& shadowStats = m_shadows.getStats();
+        ImGui::Text("Far cascade renders: %u, cache hits: %u",
+                    shadowStats.farCascadeRenders, shadowStats.farCascadeCacheHits);
+
+        const GpuSceneStats& sceneStats = m_gpuScene.getStats();
+        ImGui::Text("Scene upload: %u objects in %u copies, %u deferred",
+                    sceneStats.uploadedObjects, sceneStats.copyRegions, sceneStats.deferredObjects);
+
+        ImGui::SeparatorText("Culling");
+        ImGui::Checkbox("Frustum culling", &m_frustumCulling);
+        const FrustumCullStats& frustumStats = m_frustumCuller.getStats();
+        ImGui::Text("%s, %u of %u in frustum, %.3f ms", CpuFeatures::getSimdLevelName(m_frustumCuller.getSimdLevel()),
+                    frustumStats.visibleObjects, frustumStats.testedObjects, frustumStats.milliseconds);
+
+        ImGui::Checkbox("CPU occlusion culling", &m_occlusionCulling);
+        const OcclusionStats& occlusionStats = m_occlusionCuller.getStats();
+        ImGui::Text("%s, %u occluder triangles", CpuFeatures::getSimdLevelName(m_occlusionCuller.getSimdLevel()),
+                    occlusionStats.occluderTriangles);
+        ImGui::Text("Occluded %u of %u objects", occlusionStats.occludedObjects, occlusionStats.testedObjects);
+        ImGui::Text("Raster %.3f ms, test %.3f ms", occlusionStats.rasterMilliseconds, occlusionStats.testMilliseconds);
+    }
+    ImGui::End();
+
+    if (ImGui::Begin("device")) {
+        const DeviceCapabilities& capabilities = m_ctx->getCapabilities();
+        ImGui::Text("%s (%s)", capabilities.deviceName.c_str(), string_VkPhysicalDeviceType(capabilities.deviceType));
+        ImGui::Text("Device local memory: %llu MiB", static_cast<unsigned long long>(capabilities.deviceLocalBytes >> 20));
+
+        ImGui::SeparatorText("Optional features");
+        ImGui::Text("Mesh shaders: %s", capabilities.meshShader ? "yes" : "no");
+        ImGui::Text("Descriptor buffer: %s", capabilities.descriptorBuffer ? "yes" : "no");
+        ImGui::Text("Shader objects: %s", capabilities.shaderObject ? "yes" : "no");
+        ImGui::Text("Graphics pipeline library: %s", capabilities.graphicsPipelineLibrary ? "yes" : "no");
+        ImGui::Text("Extended dynamic state 3: %s", capabilities.extendedDynamicState3 ? "yes" : "no");
+        ImGui::Text("Present wait: %s", capabilities.presentWait ? "yes" : "no");
+        ImGui::Text("Memory budget: %s", capabilities.memoryBudget ? "yes" : "no");
+        ImGui::Text("Pipeline statistics: %s", capabilities.pipelineStatistics ? "yes" : "no");
+
+        ImGui::SeparatorText("Active paths");
+        ImGui::Text("Scene descriptors: %s", m_useDescriptorBuffer ? "descriptor buffer" : "pool");
+        ImGui::Text("Dynamic state 3: %s", m_dynamicState.hasDynamicState3() ? "polygon mode and blending" : "off");
+        bool cullBackFaces = m_geometryState.cullMode == VK_CULL_MODE_BACK_BIT;
+        if (ImGui::Checkbox("Cull back faces", &cullBackFaces)) {
+            m_geometryState.cullMode = cullBackFaces ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_NONE;
+        }
+        bool counterClockwise = m_geometryState.frontFace == VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        if (ImGui::Checkbox("Counter clockwise front faces", &counterClockwise)) {
+            m_geometryState.frontFace = counterClockwise ? VK_FRONT_FACE_COUNTER_CLOCKWISE : VK_FRONT_FACE_CLOCKWISE;
+        }
+        const PipelineRegistryStats& registryStats = m_pipelineRegistry.getStats();
+        ImGui::Text("Pipelines: %u, registry hits: %u, misses: %u",
+                    m_pipelineRegistry.getPipelineCount(), registryStats.hits, registryStats.misses);
+        if (m_usePipelineLibrary) {
+            const PipelineLibraryStats& libraryStats = m_pipelineLibrary.getStats();
+            ImGui::Text("Pipeline libraries: %u, fast linked: %u, optimized: %u",
+                        libraryStats.libraries, libraryStats.fastLinked, libraryStats.optimized);
+            ImGui::Text("Last link: fast %.3f ms, optimized %.2f ms",
+                        libraryStats.lastFastLinkMs, libraryStats.lastOptimizedMs);
+        }
+        if (m_meshVertexObject != VK_NULL_HANDLE) {
+            ImGui::Checkbox("Geometry with shader objects", &m_useShaderObjects);
+        } else {
+            ImGui::Text("Geometry: pipelines");
+        }
+
+        ImGui::SeparatorText("Capture");
+        ImGui::InputText("Capture path", m_capturePath, sizeof(m_capturePath));
+        if (ImGui::Button("Capture frame") && m_capturePath[0] != '\0') {
+            m_frameCapturer.request(m_capturePath);
+        }
 
-            ImGui::InputFloat4("data1", reinterpret_cast<float*>(&selected.data.data1));
-            ImGui::InputFloat4("data2", reinterpret_cast<float*>(&selected.data.data2));
-            ImGui::InputFloat4("data3", reinterpret_cast<float*>(&selected.data.data3));
-            ImGui::InputFloat4("data4", reinterpret_cast<float*>(&selected.data.data4));
+        ImGui::SeparatorText("Screenshots");
+        if (m_frameReadback.isSupported()) {
+            ImGui::InputText("Screenshot path", m_screenshotPath, sizeof(m_screenshotPath));
+            if (ImGui::Button("Screenshot") && m_screenshotPath[0] != '\0') {
+                m_frameReadback.requestScreenshot(m_screenshotPath);
+            }
+            ImGui::InputText("Recording path", m_recordingPath, sizeof(m_recordingPath));
+            if (m_frameReadback.isRecording()) {
+                if (ImGui::Button("Stop recording")) {
+                    m_frameReadback.stopRecording();
+                }
+            } else if (ImGui::Button("Record") && m_recordingPath[0] != '\0') {
+                m_frameReadback.startRecording(m_recordingPath);
+            }
+            const FrameReadbackStats readbackStats = m_frameReadback.getStats();
+            ImGui::Text("Frames written: %llu, dropped: %llu",
+                        static_cast<unsigned long long>(readbackStats.written),
+                        static_cast<unsigned long long>(readbackStats.dropped));
+        } else {
+            ImGui::Text("The swapChain cannot be read back");
         }
-        ImGui::End();
 
-        //make ImGui calculate internal draw structures
-        ImGui::Render();
+        ImGui::SeparatorText("CPU");
+        ImGui::Text("SIMD: %s, job threads: %u", CpuFeatures::getSimdLevelName(CpuFeatures::getSimdLevel()),
+                    m_jobSystem.getThreadCount());
+    }
+    ImGui::End();
 
-        draw();
+    if (ImGui::Begin("assets")) {
+        ImGui::InputText("glTF path", m_assetPath, sizeof(m_assetPath));
+        if (ImGui::Button("Load") && m_assetPath[0] != '\0') {
+            loadAsset(m_assetPath);
+        }
+
+        const AssetLoaderStats& loaderStats = m_assetLoader.getStats();
+        ImGui::Text("Loading: %u, finished: %u, failed: %u",
+                    loaderStats.activeLoads, loaderStats.finishedLoads, loaderStats.failedLoads);
+
+        ImGui::SeparatorText("Streaming");
+        const MeshStreamerStats& streamerStats = m_meshStreamer.getStats();
+        int budgetMiB = static_cast<int>(m_meshStreamer.getBudget() >> 20);
+        if (ImGui::SliderInt("Budget (MiB)", &budgetMiB, 16, 4096)) {
+            m_meshStreamer.setBudget(static_cast<uint64_t>(budgetMiB) << 20);
+        }
+        ImGui::Text("Resident: %.1f MiB in %u LODs", static_cast<double>(streamerStats.residentBytes) / (1 << 20),
+                    streamerStats.residentLods);
+        ImGui::Text("Loads in flight: %u, waiting: %u", streamerStats.loadsInFlight, streamerStats.pendingRequests);
+        ImGui::Text("Loaded: %u, failed: %u, evicted: %u",
+                    streamerStats.completedLoads, streamerStats.failedLoads, streamerStats.evictions);
+
+        ImGui::SeparatorText("Virtual texture");
+        ImGui::InputText("vtex path", m_virtualTexturePath, sizeof(m_virtualTexturePath));
+        if (ImGui::Button("Load virtual texture") && m_virtualTexturePath[0] != '\0') {
+            loadVirtualTexture(m_virtualTexturePath);
+        }
+        const VirtualTextureStats& vtStats = m_virtualTexture.getStats();
+        ImGui::Text("Resident pages: %u / %u", vtStats.residentPages, VT_CACHE_PAGES * VT_CACHE_PAGES);
+        ImGui::Text("Requested: %u, deferred: %u", vtStats.requestedPages, vtStats.deferredPages);
+        ImGui::Text("Uploaded: %u, evicted: %u", vtStats.uploadedPages, vtStats.evictedPages);
+
+        ImGui::SeparatorText("Skinning");
+        ImGui::Checkbox("Play animations", &m_skinning.playing);
+        ImGui::SliderFloat("Speed", &m_skinning.speed, 0.f, 4.f);
+        const SkinningStats& skinningStats = m_skinning.getStats();
+        ImGui::Text("Instances: %u, skinned this frame: %u", skinningStats.instances, skinningStats.dispatches);
+        ImGui::Text("Skipped hidden: %u, idle: %u", skinningStats.skippedHidden, skinningStats.skippedIdle);
+    }
+    ImGui::End();
+
+    if (ImGui::Begin("post process")) {
+        ImGui::Checkbox("Bloom", &m_postProcess.bloomEnabled);
+        ImGui::SliderFloat("Threshold", &m_postProcess.bloomThreshold, 0.f, 5.f);
+        ImGui::SliderFloat("Knee", &m_postProcess.bloomKnee, 0.f, 1.f);
+        ImGui::SliderFloat("Intensity", &m_postProcess.bloomIntensity, 0.f, 1.f);
+
+        ImGui::Checkbox("Tonemap", &m_postProcess.tonemapEnabled);
+        ImGui::SliderFloat("Exposure", &m_postProcess.exposure, 0.f, 8.f);
+
+        // the separate tonemap and blit path is kept to compare timings against
+        ImGui::Checkbox("Fused composite", &m_fusedComposite);
+        ImGui::Checkbox("Dither", &m_composite.ditherEnabled);
+
+        ImGui::SeparatorText("GPU timings");
+        if (!m_gpuProfiler.isSupported()) {
+            ImGui::Text("Timestamps are not supported on this queue");
+        }
+        if (m_gpuProfiler.isStatisticsSupported()) {
+            ImGui::Checkbox("Pipeline statistics", &m_gpuProfiler.statisticsEnabled);
+        }
+        const bool showStatistics = m_gpuProfiler.statisticsEnabled && m_gpuProfiler.isStatisticsSupported();
+        double geometryFragments = 0.0;
+        for (const GpuTimerResult& result: m_gpuProfiler.getResults()) {
+            ImGui::Text("%-18s %.3f ms", result.name.c_str(), result.milliseconds);
+            if (!showStatistics) {
+                continue;
+            }
+
+            const GpuPassStatistics& statistics = result.statistics;
+            ImGui::Text("  %u draws, %u dispatches", statistics.draws, statistics.dispatches);
+            ImGui::Text("  primitives %llu in, %llu clipped in, %llu out",
+                        static_cast<unsigned long long>(statistics.inputPrimitives),
+                        static_cast<unsigned long long>(statistics.clippingInvocations),
+                        static_cast<unsigned long long>(statistics.clippingPrimitives));
+            ImGui::Text("  invocations %llu vertex, %llu fragment, %llu compute",
+                        static_cast<unsigned long long>(statistics.vertexInvocations),
+                        static_cast<unsigned long long>(statistics.fragmentInvocations),
+                        static_cast<unsigned long long>(statistics.computeInvocations));
+            if (result.name == "geometry") {
+                geometryFragments = static_cast<double>(statistics.fragmentInvocations);
+            }
+        }
+
+        ImGui::SeparatorText("Overdraw");
+        ImGui::Checkbox("Overdraw heatmap", &m_showOverdraw);
+        ImGui::SliderFloat("Hottest at", &m_overdraw.maxFragments, 1.f, 32.f, "%.0f fragments");
+        if (showStatistics) {
+            // the geometry pass has no depth buffer, every covered fragment is shaded
+            const double pixels = static_cast<double>(m_drawExtent.width) * m_drawExtent.height;
+            ImGui::Text("Geometry fragments per pixel: %.2f", pixels > 0.0 ? geometryFragments / pixels : 0.0);
+        }
+
+        ImGui::SeparatorText("UI");
+        ImGui::Checkbox("Cache UI layer", &m_cacheUiLayer);
+        ImGui::Text("UI layer renders: %u (F1 hides the UI)", m_uiLayer.getRenderCount());
     }
+    ImGui::End();
+
+    //make ImGui calculate internal draw structures
+    ImGui::Render();
 }
 
 void VulkanEngine::draw() {
+    const auto frameStart = std::chrono::steady_clock::now();
+    if (m_telemetry.isRunning() && m_lastFrameStart != std::chrono::steady_clock::time_point{}) {
+        m_telemetry.recordFrameTime(std::chrono::duration<double, std::milli>(frameStart - m_lastFrameStart).count());
+    }
+    m_lastFrameStart = frameStart;
+
     // wait until the gpu has finished rendering the last frame. Timeout of 1 second
     VK_CHECK(vkWaitForFences(m_ctx->getDevice(), 1, &getCurrentFrame().renderFence, true, 1000000000));
 
     getCurrentFrame().deletionQueue.flush();
+    m_pipelineLibrary.update();
+    // this slot's feedback readback is complete now
+    m_virtualTexture.update(getCurrentFrameIndex());
+    // and so are the frame copies it recorded, they go to the writer thread
+    m_frameReadback.update(static_cast<uint64_t>(m_frameNumber));
 
     VK_CHECK(vkResetFences(m_ctx->getDevice(), 1, &getCurrentFrame().renderFence));
 
@@ -155,6 +455,7 @@ void VulkanEngine::draw() {
                                    nullptr, &swapChainImageIndex));
 
     VkCommandBuffer cmd = getCurrentFrame().commandBuffer;
+    m_frameCounters = {};
 
     // now that we are sure that the commands finished executing, we can safely
     // reset the command buffer to begin recording again.
@@ -163,6 +464,8 @@ void VulkanEngine::draw() {
     m_drawExtent.width = m_drawImage.imageExtent.width;
     m_drawExtent.height = m_drawImage.imageExtent.height;
 
+    updateScene();
+
     // begin the command buffer recording. We will use this command buffer exactly once,
     // so we want to let Vulkan know that
     constexpr VkCommandBufferBeginInfo cmdBeginInfo = {
@@ -175,44 +478,147 @@ void VulkanEngine::draw() {
     // start the command buffer recording
     VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
 
+    // the frame fence was waited on, so the timings this slot recorded last time are ready
+    m_gpuProfiler.beginFrame(cmd, getCurrentFrameIndex());
+
+    // only objects that changed since the last frame are sent to the GPU scene buffer
+    m_gpuScene.upload(cmd, getCurrentFrameIndex());
+    // finer LODs streamed in since the last frame
+    m_meshStreamer.upload(cmd);
+    m_virtualTexture.upload(cmd, getCurrentFrameIndex());
+
+    // posed once here, the shadow, feedback and geometry passes all draw the same skinned vertices
+    const uint32_t skinningScope = m_gpuProfiler.beginScope(cmd, "skinning");
+    m_skinning.dispatch(cmd, getCurrentFrameIndex());
+    m_gpuProfiler.endScope(cmd, skinningScope);
+
     // transition our main draw image into general layout so we can write into it
     // we will overwrite it all so we don't care about what was the older layout
     VkUtils::transitionImage(cmd, m_drawImage.image,
                              VK_IMAGE_LAYOUT_UNDEFINED,
                              VK_IMAGE_LAYOUT_GENERAL);
 
+    // bin this frame's lights into clusters before anything is shaded
+    const uint32_t cullScope = m_gpuProfiler.beginScope(cmd, "light culling");
+    m_lighting.cullLights(cmd, getCurrentFrameIndex());
+    m_gpuProfiler.endScope(cmd, cullScope);
+
+    const uint32_t shadowScope = m_gpuProfiler.beginScope(cmd, "shadows");
+    m_shadows.render(cmd, m_renderObjects);
+    m_gpuProfiler.endScope(cmd, shadowScope);
+
+    const uint32_t feedbackScope = m_gpuProfiler.beginScope(cmd, "vt feedback");
+    m_virtualTexture.renderFeedback(cmd, getCurrentFrameIndex(), m_renderObjects, m_drawList);
+    m_gpuProfiler.endScope(cmd, feedbackScope);
+
+    const uint32_t backgroundScope = m_gpuProfiler.beginScope(cmd, "background");
     drawBackground(cmd);
+    m_gpuProfiler.endScope(cmd, backgroundScope);
+
+    // emission, simulation and sorting are compute passes like the background effects
+    const uint32_t particleScope = m_gpuProfiler.beginScope(cmd, "particle simulation");
+    m_particles.simulate(cmd);
+    m_gpuProfiler.endScope(cmd, particleScope);
 
     VkUtils::transitionImage(cmd, m_drawImage.image,
                              VK_IMAGE_LAYOUT_GENERAL,
                              VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 
+    const uint32_t geometryScope = m_gpuProfiler.beginScope(cmd, "geometry");
     drawGeometry(cmd);
+    m_gpuProfiler.endScope(cmd, geometryScope);
+
+    const uint32_t particleDrawScope = m_gpuProfiler.beginScope(cmd, "particles");
+    m_particles.draw(cmd, m_drawImage.imageView, m_drawExtent, m_sceneData.view, m_sceneData.viewProj);
+    m_gpuProfiler.endScope(cmd, particleDrawScope);
 
-    // transition the draw image and the swapChain image into their correct transfer layouts
+    // bloom and tonemapping run in compute on the HDR image
     VkUtils::transitionImage(cmd, m_drawImage.image,
                              VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+                             VK_IMAGE_LAYOUT_GENERAL);
 
-    VkUtils::transitionImage(cmd, m_swapChain->getImages()[swapChainImageIndex],
-                             VK_IMAGE_LAYOUT_UNDEFINED,
-                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    // the heatmap is shown as it is, without bloom or the tonemapper of the composite pass
+    const bool fusedComposite = m_fusedComposite && !m_showOverdraw;
+    if (m_showOverdraw) {
+        const uint32_t overdrawScope = m_gpuProfiler.beginScope(cmd, "overdraw");
+        m_overdraw.count(cmd, m_drawExtent, m_geometryState, m_renderObjects, m_drawList);
+        m_overdraw.resolve(cmd, m_drawExtent);
+        m_gpuProfiler.endScope(cmd, overdrawScope);
+    } else if (fusedComposite) {
+        // the composite pass tonemaps while it resolves into the swapChain
+        m_postProcess.applyBloom(cmd, m_gpuProfiler, m_drawExtent);
+    } else {
+        m_postProcess.apply(cmd, m_gpuProfiler, m_drawExtent);
+    }
 
-    // execute a copy from the draw image into the swapChain
-    VkUtils::copyImageToImage(cmd, m_drawImage.image, m_swapChain->getImages()[swapChainImageIndex], 
-                              m_drawExtent, m_swapChain->getExtent());
+    // the cached UI layer has to be refreshed outside of the swapChain pass
+    if (m_showUi && m_cacheUiLayer) {
+        const uint32_t uiLayerScope = m_gpuProfiler.beginScope(cmd, "ui layer");
+        m_uiLayer.update(cmd, ImGui::GetDrawData());
+        m_gpuProfiler.endScope(cmd, uiLayerScope);
+    }
 
-    // set swapChain image layout to Attachment Optimal so we can draw it
-    VkUtils::transitionImage(cmd, m_swapChain->getImages()[swapChainImageIndex],
-                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    if (fusedComposite) {
+        VkUtils::memoryBarrier(cmd,
+                               VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                               VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                               VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
 
-    //draw imGui into the swapChain image
-    drawImGui(cmd, m_swapChain->getImageViews()[swapChainImageIndex]);
+        // every pixel is overwritten by the composite, so the old contents can be discarded
+        VkUtils::transitionImage(cmd, m_swapChain->getImages()[swapChainImageIndex],
+                                 VK_IMAGE_LAYOUT_UNDEFINED,
+                                 VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+        drawComposite(cmd, m_swapChain->getImageViews()[swapChainImageIndex]);
+    } else {
+        // transition the draw image and the swapChain image into their correct transfer layouts
+        VkUtils::transitionImage(cmd, m_drawImage.image,
+                                 VK_IMAGE_LAYOUT_GENERAL,
+                                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+        VkUtils::transitionImage(cmd, m_swapChain->getImages()[swapChainImageIndex],
+                                 VK_IMAGE_LAYOUT_UNDEFINED,
+                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+        // execute a copy from the draw image into the swapChain
+        const uint32_t blitScope = m_gpuProfiler.beginScope(cmd, "blit");
+        VkUtils::copyImageToImage(cmd, m_drawImage.image, m_swapChain->getImages()[swapChainImageIndex],
+                                  m_drawExtent, m_swapChain->getExtent());
+        m_gpuProfiler.endScope(cmd, blitScope);
+
+        // set swapChain image layout to Attachment Optimal so we can draw it
+        VkUtils::transitionImage(cmd, m_swapChain->getImages()[swapChainImageIndex],
+                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                 VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+        //draw imGui into the swapChain image
+        if (m_showUi) {
+            const uint32_t imguiScope = m_gpuProfiler.beginScope(cmd, "imgui");
+            if (m_cacheUiLayer) {
+                m_uiLayer.composite(cmd, m_swapChain->getImageViews()[swapChainImageIndex], m_swapChain->getExtent());
+            } else {
+                // the layer goes stale while the UI is drawn directly
+                m_uiLayer.invalidate();
+                drawImGui(cmd, m_swapChain->getImageViews()[swapChainImageIndex]);
+            }
+            m_gpuProfiler.endScope(cmd, imguiScope);
+        }
+    }
+
+    // screenshots and recordings copy the finished frame, it is written out a few frames later
+    VkImageLayout presentedLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    if (m_frameReadback.wantsFrame()) {
+        VkUtils::transitionImage(cmd, m_swapChain->getImages()[swapChainImageIndex],
+                                 VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        m_frameReadback.copy(cmd, m_swapChain->getImages()[swapChainImageIndex], static_cast<uint64_t>(m_frameNumber));
+        presentedLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    }
 
     // set swapChain image layout to Present so we can show it on the screen
     VkUtils::transitionImage(cmd, m_swapChain->getImages()[swapChainImageIndex],
-                             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                             presentedLayout,
                              VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
     // finalize the command buffer (we can no longer add commands, but it can now be executed)
@@ -261,6 +667,16 @@ void VulkanEngine::draw() {
     // renderFence will now block until the graphic commands finish execution
     VK_CHECK(vkQueueSubmit2(m_ctx->getGraphicsQueue(), 1, &submit, getCurrentFrame().renderFence));
 
+    if (m_frameCapturer.isRequested()) {
+        // everything the frame read is final once its fence signals
+        VK_CHECK(vkWaitForFences(m_ctx->getDevice(), 1, &getCurrentFrame().renderFence, true, UINT64_MAX));
+        captureFrame(m_frameCapturer.takeRequest());
+    }
+
+    if (m_telemetry.isRunning()) {
+        publishTelemetry();
+    }
+
     // prepare present
     // this will put the image we just rendered to into the visible window.
     // we want to wait on the renderSemaphore for that,
@@ -286,11 +702,20 @@ void VulkanEngine::draw() {
 void VulkanEngine::initVulkan() {
     // Vulkan init
     m_ctx = std::make_unique<VulkanContext>();
-    m_ctx->init();
+    m_ctx->init(m_preferredGpu);
+
+    // every pipeline built through the registry is destroyed with it
+    m_pipelineRegistry.init(m_ctx->getDevice());
+    m_mainDeletionQueue.push_function([&] {
+        m_pipelineRegistry.destroy();
+    });
+
     initSwapChain();
     initCommands();
     initSyncStructures();
     initDescriptors();
+    initLighting();
+    initPostProcess();
     initPipeline();
 }
 
@@ -299,11 +724,18 @@ void VulkanEngine::initSwapChain() {
     m_swapChain->init();
 
     // initialize the memory allocator
+    // with the budget extension VMA tracks the real heap usage instead of estimating it
+    VmaAllocatorCreateFlags allocatorFlags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+    if (m_ctx->getCapabilities().memoryBudget) {
+        allocatorFlags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
+
     const VmaAllocatorCreateInfo allocatorInfo{
-        .flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT,
+        .flags = allocatorFlags,
         .physicalDevice = m_ctx->getPhysicalDevice(),
         .device = m_ctx->getDevice(),
         .instance = m_ctx->getInstance(),
+        .vulkanApiVersion = VK_API_VERSION_1_3,
     };
     vmaCreateAllocator(&allocatorInfo, &m_allocator);
 
@@ -322,6 +754,7 @@ void VulkanEngine::initSwapChain() {
     drawImageUsages |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
     drawImageUsages |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
     drawImageUsages |= VK_IMAGE_USAGE_STORAGE_BIT;
+    drawImageUsages |= VK_IMAGE_USAGE_SAMPLED_BIT;
     drawImageUsages |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
     const VkImageCreateInfo drawImageInfo{
@@ -364,8 +797,25 @@ void VulkanEngine::initSwapChain() {
 
     VK_CHECK(vkCreateImageView(m_ctx->getDevice(), &drawImageView, nullptr, &m_drawImage.imageView));
 
+    // the background cache only needs to be written by the effects and copied from
+    m_backgroundCache.imageFormat = m_drawImage.imageFormat;
+    m_backgroundCache.imageExtent = drawImageExtent;
+
+    VkImageCreateInfo backgroundCacheInfo = drawImageInfo;
+    backgroundCacheInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+    VK_CHECK(vmaCreateImage(m_allocator, &backgroundCacheInfo, &drawImageAllocInfo,
+                            &m_backgroundCache.image, &m_backgroundCache.allocation, nullptr));
+
+    VkImageViewCreateInfo backgroundCacheView = drawImageView;
+    backgroundCacheView.image = m_backgroundCache.image;
+
+    VK_CHECK(vkCreateImageView(m_ctx->getDevice(), &backgroundCacheView, nullptr, &m_backgroundCache.imageView));
+
     //add to deletion queues
     m_mainDeletionQueue.push_function([&] {
+        vkDestroyImageView(m_ctx->getDevice(), m_backgroundCache.imageView, nullptr);
+        vmaDestroyImage(m_allocator, m_backgroundCache.image, m_backgroundCache.allocation);
         vkDestroyImageView(m_ctx->getDevice(), m_drawImage.imageView, nullptr);
         vmaDestroyImage(m_allocator, m_drawImage.image, m_drawImage.allocation);
     });
@@ -440,9 +890,12 @@ void VulkanEngine::initSyncStructures() {
 }
 
 void VulkanEngine::initDescriptors() {
-    // create a descriptor pool that will hold 10 sets with 1 image each
+    // create a descriptor pool that will hold 10 sets, enough for the draw image and per-frame scene sets
     std::vector<DescriptorAllocator::PoolSizeRatio> sizes = {
-        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1}
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3},
     };
 
     m_globalDescriptorAllocator.initPool(m_ctx->getDevice(), 10, sizes);
@@ -474,11 +927,142 @@ void VulkanEngine::initDescriptors() {
 
     vkUpdateDescriptorSets(m_ctx->getDevice(), 1, &drawImageWrite, 0, nullptr);
 
+    // same layout, but the effects write into the background cache
+    m_backgroundCacheDescriptor = m_globalDescriptorAllocator.allocate(m_ctx->getDevice(), m_drawImageDescriptorLayout);
+    {
+        DescriptorWriter writer;
+        writer.writeImage(0, m_backgroundCache.imageView, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL,
+                          VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.updateSet(m_ctx->getDevice(), m_backgroundCacheDescriptor);
+    }
+
+    // scene data, lights, cluster lists and shadow cascades are read by the light culling pass and the geometry shaders.
+    // With VK_EXT_descriptor_buffer the one layout is laid out for the buffer and no set comes from the pool
+    m_useDescriptorBuffer = m_ctx->getCapabilities().descriptorBuffer;
+    {
+        DescriptorLayoutBuilder builder;
+        for (uint32_t binding = 0; binding < SCENE_BINDINGS.size(); binding++) {
+            builder.addBinding(binding, SCENE_BINDINGS[binding]);
+        }
+        m_sceneDescriptorLayout = builder.build(m_ctx->getDevice(),
+                                                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT |
+                                                VK_SHADER_STAGE_COMPUTE_BIT,
+                                                nullptr,
+                                                m_useDescriptorBuffer
+                                                    ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT
+                                                    : 0);
+    }
+
     //make sure both the descriptor allocator and the new layout get cleaned up properly
     m_mainDeletionQueue.push_function([&] {
         m_globalDescriptorAllocator.destroyPool(m_ctx->getDevice());
         vkDestroyDescriptorSetLayout(m_ctx->getDevice(), m_drawImageDescriptorLayout, nullptr);
+        vkDestroyDescriptorSetLayout(m_ctx->getDevice(), m_sceneDescriptorLayout, nullptr);
     });
+
+    if (m_useDescriptorBuffer) {
+        m_sceneDescriptorBuffer.init(m_ctx->getDevice(), m_ctx->getPhysicalDevice(), m_allocator,
+                                     m_sceneDescriptorLayout, FRAME_OVERLAP);
+
+        m_mainDeletionQueue.push_function([&] {
+            m_sceneDescriptorBuffer.destroy(m_allocator);
+        });
+    }
+}
+
+void VulkanEngine::initLighting() {
+    m_lighting.init(this, m_sceneDescriptorLayout);
+    m_shadows.init(this, m_sceneDescriptorLayout);
+    m_gpuScene.init(this);
+    m_virtualTexture.init(this, &m_jobSystem, m_sceneDescriptorLayout,
+                          {m_drawImage.imageExtent.width, m_drawImage.imageExtent.height});
+
+    for (auto& frame: m_frames) {
+        frame.sceneDataBuffer = createBuffer(sizeof(GPUSceneData),
+                                             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                             VMA_MEMORY_USAGE_CPU_TO_GPU);
+        writeSceneDescriptors(frame);
+    }
+
+    m_mainDeletionQueue.push_function([&] {
+        for (const auto& frame: m_frames) {
+            destroyBuffer(frame.sceneDataBuffer);
+        }
+    });
+}
+
+void VulkanEngine::writeSceneDescriptors(FrameData& frame) {
+    // one entry per binding of SCENE_BINDINGS. Descriptor buffers reference buffers by address and
+    // need their exact ranges, so both paths write the same sizes
+    struct SceneResource {
+        const AllocatedBuffer* buffer = nullptr;
+        size_t size = 0;
+        VkImageView view = VK_NULL_HANDLE;
+        VkSampler sampler = VK_NULL_HANDLE;
+    };
+
+    const std::array<SceneResource, SCENE_BINDINGS.size()> resources{{
+        {.buffer = &frame.sceneDataBuffer, .size = sizeof(GPUSceneData)},
+        {.buffer = &m_lighting.getLightBuffer(), .size = MAX_LIGHTS * sizeof(GPULight)},
+        {.buffer = &m_lighting.getClusterGridBuffer(), .size = CLUSTER_COUNT * 2 * sizeof(uint32_t)},
+        {.buffer = &m_lighting.getLightIndexBuffer(), .size = (MAX_LIGHT_INDICES + 1) * sizeof(uint32_t)},
+        {.view = m_shadows.getShadowMapView(), .sampler = m_shadows.getShadowSampler()},
+        {.buffer = &m_gpuScene.getObjectBuffer(), .size = MAX_SCENE_OBJECTS * sizeof(GPUObjectData)},
+        {.view = m_virtualTexture.getIndirectionView(), .sampler = m_virtualTexture.getIndirectionSampler()},
+        {.view = m_virtualTexture.getPageCacheView(), .sampler = m_virtualTexture.getPageCacheSampler()},
+    }};
+
+    const VkDevice device = m_ctx->getDevice();
+    if (m_useDescriptorBuffer) {
+        frame.sceneBufferSet = m_sceneDescriptorBuffer.allocate();
+    } else {
+        frame.sceneDescriptor = m_globalDescriptorAllocator.allocate(device, m_sceneDescriptorLayout);
+    }
+
+    DescriptorWriter writer;
+    for (uint32_t binding = 0; binding < resources.size(); binding++) {
+        const SceneResource& resource = resources[binding];
+        const VkDescriptorType type = SCENE_BINDINGS[binding];
+        if (resource.buffer) {
+            if (m_useDescriptorBuffer) {
+                m_sceneDescriptorBuffer.writeBuffer(device, frame.sceneBufferSet, binding,
+                                                    getBufferAddress(*resource.buffer), resource.size, type);
+            } else {
+                writer.writeBuffer(binding, resource.buffer->buffer, resource.size, 0, type);
+            }
+        } else {
+            if (m_useDescriptorBuffer) {
+                m_sceneDescriptorBuffer.writeImage(device, frame.sceneBufferSet, binding, resource.view,
+                                                   resource.sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, type);
+            } else {
+                writer.writeImage(binding, resource.view, resource.sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                  type);
+            }
+        }
+    }
+
+    if (!m_useDescriptorBuffer) {
+        writer.updateSet(device, frame.sceneDescriptor);
+    }
+}
+
+VkPipelineCreateFlags VulkanEngine::getScenePipelineFlags() const {
+    return m_useDescriptorBuffer ? VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
+}
+
+void VulkanEngine::bindSceneDescriptors(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout) {
+    if (m_useDescriptorBuffer) {
+        m_sceneDescriptorBuffer.bind(cmd, bindPoint, layout, 0, getCurrentFrame().sceneBufferSet);
+    } else {
+        vkCmdBindDescriptorSets(cmd, bindPoint, layout, 0, 1, &getCurrentFrame().sceneDescriptor, 0, nullptr);
+    }
+}
+
+void VulkanEngine::initPostProcess() {
+    m_gpuProfiler.init(this);
+    m_postProcess.init(this, m_drawImage);
+    m_composite.init(this, m_postProcess, m_drawImage, m_swapChain->getImageFormat());
+    m_overdraw.init(this, m_sceneDescriptorLayout, m_drawImage, m_postProcess.getLinearSampler());
 }
 
 void VulkanEngine::initDefaultData() {
@@ -489,10 +1073,14 @@ void VulkanEngine::initDefaultData() {
     rectangleVertices[2].position = { -0.5,-0.5, 0 };
     rectangleVertices[3].position = { -0.5,0.5, 0 };
 
-    rectangleVertices[0].color = { 0,0, 0,1 };
+    rectangleVertices[0].color = { 0.8,0.8, 0.8,1 };
     rectangleVertices[1].color = { 0.5,0.5,0.5 ,1 };
-    rectangleVertices[2].color = { 1,0, 0,1 };
-    rectangleVertices[3].color = { 0,1, 0,1 };
+    rectangleVertices[2].color = { 1,0.8, 0.8,1 };
+    rectangleVertices[3].color = { 0.8,1, 0.8,1 };
+
+    for (auto& vertex : rectangleVertices) {
+        vertex.normal = { 0, 0, 1 };
+    }
 
     std::array<uint32_t, 6> rectangleIndices;
 
@@ -506,15 +1094,119 @@ void VulkanEngine::initDefaultData() {
 
     m_rectangle = uploadMesh(rectangleIndices, rectangleVertices);
 
-    //delete the rectangle data on engine shutdown
+    // unit cube with per-face normals, used as shadow casters in the demo scene
+    std::vector<Vertex> cubeVertices;
+    std::vector<uint32_t> cubeIndices;
+
+    const std::array<glm::vec3, 6> faceNormals = {
+        glm::vec3{1, 0, 0}, glm::vec3{-1, 0, 0},
+        glm::vec3{0, 1, 0}, glm::vec3{0, -1, 0},
+        glm::vec3{0, 0, 1}, glm::vec3{0, 0, -1},
+    };
+
+    for (const glm::vec3& normal : faceNormals) {
+        const glm::vec3 tangent = std::abs(normal.y) > 0.5f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+        const glm::vec3 bitangent = glm::cross(normal, tangent);
+        const auto baseIndex = static_cast<uint32_t>(cubeVertices.size());
+
+        for (int corner = 0; corner < 4; corner++) {
+            const float u = (corner & 1) ? 0.5f : -0.5f;
+            const float v = (corner & 2) ? 0.5f : -0.5f;
+
+            Vertex vertex{};
+            vertex.position = normal * 0.5f + tangent * u + bitangent * v;
+            vertex.normal = normal;
+            vertex.uv_x = u + 0.5f;
+            vertex.uv_y = v + 0.5f;
+            vertex.color = { 0.9, 0.9, 0.9, 1 };
+            cubeVertices.push_back(vertex);
+        }
+
+        for (const uint32_t index : {0u, 1u, 2u, 2u, 1u, 3u}) {
+            cubeIndices.push_back(baseIndex + index);
+        }
+    }
+
+    m_cube = uploadMesh(cubeIndices, cubeVertices);
+
+    // the pillars double as occluders, the culler only needs their positions
+    std::vector<glm::vec3> cubePositions;
+    cubePositions.reserve(cubeVertices.size());
+    for (const Vertex& vertex : cubeVertices) {
+        cubePositions.push_back(vertex.position);
+    }
+
+    m_frustumCuller.init(&m_jobSystem);
+    m_occlusionCuller.init(&m_jobSystem, m_windowExtent);
+    const uint32_t cubeOccluder = m_occlusionCuller.addOccluderMesh(cubePositions, cubeIndices);
+
+    //delete the rectangle and cube data on engine shutdown
     m_mainDeletionQueue.push_function([&]() {
         destroyBuffer(m_rectangle.indexBuffer);
         destroyBuffer(m_rectangle.vertexBuffer);
+        destroyBuffer(m_cube.indexBuffer);
+        destroyBuffer(m_cube.vertexBuffer);
      });
 
+    // lay the rectangle down as a floor, with a grid of static pillars and a few moving cubes on top
+    m_renderObjects.push_back(RenderObject{
+        .indexCount = static_cast<uint32_t>(rectangleIndices.size()),
+        .firstIndex = 0,
+        .indexBuffer = m_rectangle.indexBuffer.buffer,
+        .vertexBufferAddress = m_rectangle.vertexBufferAddress,
+        .boundingSphere = m_rectangle.boundingSphere,
+        .transform = glm::scale(glm::rotate(glm::mat4{ 1.f }, glm::radians(-90.f), glm::vec3(1, 0, 0)),
+                                glm::vec3(24.f)),
+        .isStatic = true,
+    });
+
+    for (int x = -2; x <= 2; x++) {
+        for (int z = -2; z <= 2; z++) {
+            const float height = 1.f + static_cast<float>((x + z) & 3);
+            m_renderObjects.push_back(RenderObject{
+                .indexCount = static_cast<uint32_t>(cubeIndices.size()),
+                .firstIndex = 0,
+                .indexBuffer = m_cube.indexBuffer.buffer,
+                .vertexBufferAddress = m_cube.vertexBufferAddress,
+                .boundingSphere = m_cube.boundingSphere,
+                .transform = glm::scale(glm::translate(glm::mat4{ 1.f }, glm::vec3(x * 4.f, height * 0.5f, z * 4.f)),
+                                        glm::vec3(0.6f, height, 0.6f)),
+                .isStatic = true,
+                .occluderMesh = cubeOccluder,
+            });
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        m_renderObjects.push_back(RenderObject{
+            .indexCount = static_cast<uint32_t>(cubeIndices.size()),
+            .firstIndex = 0,
+            .indexBuffer = m_cube.indexBuffer.buffer,
+            .vertexBufferAddress = m_cube.vertexBufferAddress,
+            .boundingSphere = m_cube.boundingSphere,
+            .transform = glm::mat4{ 1.f },
+            .isStatic = false,
+        });
+    }
+
+    // no materials yet, every object uses the default one
+    for (RenderObject& object : m_renderObjects) {
+        object.objectId = m_gpuScene.addObject(object.transform, object.boundingSphere, 0);
+        m_frustumCuller.addObject(object.transform, object.boundingSphere);
+    }
+    m_visibleObjects.assign(m_renderObjects.size(), 1);
+
+    m_staticSceneVersion++;
 }
 
 void VulkanEngine::initPipeline() {
+    m_dynamicState.init(m_ctx->getDevice(), m_ctx->getCapabilities().extendedDynamicState3);
+
+    m_usePipelineLibrary = m_ctx->getCapabilities().graphicsPipelineLibrary;
+    if (m_usePipelineLibrary) {
+        m_pipelineLibrary.init(this, &m_jobSystem);
+    }
+
     initBackgroundPipelines();
     initMeshPipeline();
 }
@@ -538,12 +1230,12 @@ void VulkanEngine::initBackgroundPipelines() {
     VK_CHECK(vkCreatePipelineLayout(m_ctx->getDevice(), &computeLayout, nullptr, &m_pipelineLayout));
 
     VkShaderModule gradientShader;
-    if (!VkUtils::loadShaderModule("../../../resources/Shaders/gradient.comp.spv", m_ctx->getDevice(), &gradientShader)) {
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/gradient.comp.spv", m_ctx->getDevice(), &gradientShader)) {
         std::cerr << "Error when building the compute shader" << std::endl;
     }
 
     VkShaderModule skyShader;
-    if (!VkUtils::loadShaderModule("../../../resources/Shaders/sky.comp.spv", m_ctx->getDevice(), &skyShader)) {
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/sky.comp.spv", m_ctx->getDevice(), &skyShader)) {
         std::cerr << "Error when building the compute shader" << std::endl;
     }
 
@@ -565,6 +1257,7 @@ void VulkanEngine::initBackgroundPipelines() {
     ComputeEffect gradient{};
     gradient.layout = m_pipelineLayout;
     gradient.name = "gradient";
+    gradient.shaderPath = HELLFIRE_SHADER_DIR "/gradient.comp.spv";
     gradient.data = {};
 
     // default colors
@@ -584,9 +1277,10 @@ void VulkanEngine::initBackgroundPipelines() {
     computePipelineCreateInfo.stage.module = skyShader;
 
     ComputeEffect sky{};
-    gradient.layout = m_pipelineLayout;
-    gradient.name = "sky";
-    gradient.data = {};
+    sky.layout = m_pipelineLayout;
+    sky.name = "sky";
+    sky.shaderPath = HELLFIRE_SHADER_DIR "/sky.comp.spv";
+    sky.data = {};
     //default sky parameters
     sky.data.data1 = glm::vec4(0.1, 0.2, 0.4, 0.97);
 
@@ -603,8 +1297,8 @@ void VulkanEngine::initBackgroundPipelines() {
     m_backgroundEffects.push_back(gradient);
     m_backgroundEffects.push_back(sky);
 
-    vkDestroyShaderModule(m_ctx->getDevice(), gradientShader, nullptr);
-    vkDestroyShaderModule(m_ctx->getDevice(), skyShader, nullptr);
+    VkUtils::destroyShaderModule(m_ctx->getDevice(), gradientShader);
+    VkUtils::destroyShaderModule(m_ctx->getDevice(), skyShader);
 
     m_mainDeletionQueue.push_function([&, sky, gradient] {
         vkDestroyPipelineLayout(m_ctx->getDevice(), m_pipelineLayout, nullptr);
@@ -615,14 +1309,14 @@ void VulkanEngine::initBackgroundPipelines() {
 
 void VulkanEngine::initMeshPipeline() {
     VkShaderModule triangleFragShader;
-    if (!VkUtils::loadShaderModule("../../../resources/Shaders/coloredTriangle.frag.spv", m_ctx->getDevice(), &triangleFragShader)) {
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/mesh.frag.spv", m_ctx->getDevice(), &triangleFragShader)) {
         std::cerr << std::format("Error when building the triangle fragment shader module");
     } else {
         std::cerr << std::format("Triangle fragment shader successfully loaded");
     }
 
     VkShaderModule triangleVertexShader;
-    if (!VkUtils::loadShaderModule("../../../resources/Shaders/coloredTriangleMesh.vert.spv", m_ctx->getDevice(), &triangleVertexShader)) {
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/coloredTriangleMesh.vert.spv", m_ctx->getDevice(), &triangleVertexShader)) {
         std::cerr << std::format("Error when building the triangle vertex shader module");
     } else {
         std::cerr << std::format("Triangle vertex shader successfully loaded");
@@ -636,6 +1330,8 @@ void VulkanEngine::initMeshPipeline() {
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .pNext = nullptr,
+        .setLayoutCount = 1,
+        .pSetLayouts = &m_sceneDescriptorLayout,
         .pushConstantRangeCount = 1,
         .pPushConstantRanges = &bufferRange,
     };
@@ -665,16 +1361,56 @@ void VulkanEngine::initMeshPipeline() {
     pipelineBuilder.setColorAttachmentFormat(m_drawImage.imageFormat);
     pipelineBuilder.setDepthFormat(VK_FORMAT_UNDEFINED);
 
+    // culling, topology and depth come from m_geometryState while recording
+    pipelineBuilder.enableDynamicState(m_dynamicState.hasDynamicState3());
+
+    pipelineBuilder.setCreateFlags(getScenePipelineFlags());
+
     //finally build the pipeline
-    m_meshPipeline = pipelineBuilder.buildPipeline(m_ctx->getDevice());
+    if (m_usePipelineLibrary) {
+        m_meshPipelineHandle = m_pipelineLibrary.createPipeline(pipelineBuilder);
+    } else {
+        m_meshPipeline = m_pipelineRegistry.getPipeline(pipelineBuilder);
+    }
 
     //clean structures
-    vkDestroyShaderModule(m_ctx->getDevice(), triangleFragShader, nullptr);
-    vkDestroyShaderModule(m_ctx->getDevice(), triangleVertexShader, nullptr);
+    VkUtils::destroyShaderModule(m_ctx->getDevice(), triangleFragShader);
+    VkUtils::destroyShaderModule(m_ctx->getDevice(), triangleVertexShader);
 
     m_mainDeletionQueue.push_function([&]() {
+        // the pipeline library or registry owns the pipeline, an optimized link may still use the layout
+        if (m_usePipelineLibrary) {
+            m_pipelineLibrary.waitForCompiles();
+        }
         vkDestroyPipelineLayout(m_ctx->getDevice(), m_meshPipelineLayout, nullptr);
-        vkDestroyPipeline(m_ctx->getDevice(), m_meshPipeline, nullptr);
+    });
+
+    // the pipeline stays as the fallback, shader objects are built next to it when supported
+    if (!m_ctx->getCapabilities().shaderObject) {
+        return;
+    }
+
+    m_shaderObjects.init(m_ctx->getDevice());
+
+    std::vector<uint32_t> vertexCode;
+    std::vector<uint32_t> fragmentCode;
+    if (!VkUtils::loadShaderCode(HELLFIRE_SHADER_DIR "/coloredTriangleMesh.vert.spv", vertexCode) ||
+        !VkUtils::loadShaderCode(HELLFIRE_SHADER_DIR "/mesh.frag.spv", fragmentCode)) {
+        std::cerr << std::format("Error when loading the mesh shader object code\n");
+        return;
+    }
+
+    if (!m_shaderObjects.createGraphicsShaders(m_ctx->getDevice(), vertexCode, fragmentCode,
+                                               {pipelineLayoutInfo.pSetLayouts, 1}, {&bufferRange, 1},
+                                               &m_meshVertexObject, &m_meshFragmentObject)) {
+        std::cerr << std::format("Error when creating the mesh shader objects\n");
+        return;
+    }
+    m_useShaderObjects = true;
+
+    m_mainDeletionQueue.push_function([&]() {
+        m_shaderObjects.destroyShader(m_ctx->getDevice(), m_meshFragmentObject);
+        m_shaderObjects.destroyShader(m_ctx->getDevice(), m_meshVertexObject);
     });
 }
 
@@ -736,6 +1472,9 @@ void VulkanEngine::initImGui() {
 
     ImGui_ImplVulkan_Init(&initInfo);
 
+    // rendered with the same pipeline as the swapchain, so it shares its format
+    m_uiLayer.init(this, colorFormat, m_swapChain->getExtent());
+
     // add to destroy the ImGui created structures
     m_mainDeletionQueue.push_function([&] {
         ImGui_ImplVulkan_Shutdown();
@@ -745,19 +1484,196 @@ void VulkanEngine::initImGui() {
 
 // Rendering Steps
 
-void VulkanEngine::drawBackground(VkCommandBuffer cmd) const {
-    ComputeEffect effect = m_backgroundEffects[m_currentBackgroundEffect];
+void VulkanEngine::updateScene() {
+    const float aspect = static_cast<float>(m_drawExtent.width) / static_cast<float>(m_drawExtent.height);
+
+    const float time = static_cast<float>(SDL_GetTicks()) / 1000.f;
+
+    m_sceneData.view = glm::lookAt(m_cameraPosition, m_cameraTarget, glm::vec3(0, 1, 0));
+    m_sceneData.proj = glm::perspective(glm::radians(m_cameraFovY), aspect, m_cameraNear, m_cameraFar);
+
+    // invert the Y direction on projection matrix so that we are more similar to opengl and gltf axis
+    m_sceneData.proj[1][1] *= -1;
+
+    m_sceneData.viewProj = m_sceneData.proj * m_sceneData.view;
+    m_sceneData.inverseProj = glm::inverse(m_sceneData.proj);
+    m_sceneData.cameraPosition = glm::vec4(m_cameraPosition, 1.f);
+    m_sceneData.ambientColor = glm::vec4(0.03f);
+
+    updateLights(time);
+    updateObjects(time);
+    updateCulling();
+
+    // LODs follow the screen coverage of the visible meshes, cached shadow cascades redraw when one changed
+    if (m_meshStreamer.update(m_renderObjects, m_drawList, m_cameraPosition,
+                              std::abs(m_sceneData.proj[1][1]) * 0.5f, static_cast<float>(m_drawExtent.height))) {
+        m_staticSceneVersion++;
+    }
+
+    m_skinning.update(time, getCurrentFrameIndex(), m_drawList);
+    m_particles.update(time, m_cameraPosition);
+
+    m_sceneData.clusterGrid = glm::uvec4(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z,
+                                         m_lighting.getActiveLightCount());
+    m_sceneData.clusterParams = glm::vec4(m_drawExtent.width, m_drawExtent.height, m_cameraNear, m_cameraFar);
+    m_sceneData.virtualTexture = m_virtualTexture.getShaderParams();
+
+    const glm::vec3 sunDirection = glm::length(m_sunDirection) > 0.f ? glm::normalize(m_sunDirection) : glm::vec3(0, -1, 0);
+    m_sceneData.sunlightDirection = glm::vec4(sunDirection, 0.f);
+    m_sceneData.sunlightColor = glm::vec4(1.f, 0.95f, 0.85f, m_sunIntensity);
+
+    m_shadows.update(m_sceneData, glm::radians(m_cameraFovY), aspect, m_cameraNear, m_staticSceneVersion);
+
+    memcpy(getCurrentFrame().sceneDataBuffer.info.pMappedData, &m_sceneData, sizeof(GPUSceneData));
+}
+
+void VulkanEngine::updateLights(const float time) {
+    std::vector<GPULight>& lights = m_lighting.getLights();
+    lights.resize(std::clamp<int>(m_lightCount, 0, MAX_LIGHTS));
+
+    // reseeded every frame so every light keeps its parameters while only the orbit angle advances
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    for (auto& light: lights) {
+        const float orbitRadius = 0.5f + unit(rng) * 11.f;
+        const float phase = unit(rng) * glm::two_pi<float>();
+        const float speed = 0.1f + unit(rng) * 0.5f;
+        const float height = 0.2f + unit(rng) * 1.5f;
+        const glm::vec3 color{unit(rng), unit(rng), unit(rng)};
+        const bool isSpot = unit(rng) < 0.25f;
+
+        const float angle = phase + (m_animateLights ? time * speed : 0.f);
+        const glm::vec3 position{std::cos(angle) * orbitRadius, height, std::sin(angle) * orbitRadius};
+
+        light.positionRange = glm::vec4(position, isSpot ? 4.f : 2.f);
+        light.colorIntensity = glm::vec4(color, isSpot ? 6.f : 3.f);
+        light.directionType = glm::vec4(0.f, -1.f, 0.f, static_cast<float>(static_cast<uint32_t>(isSpot ? LightType::Spot : LightType::Point)));
+        light.spotCone = glm::vec4(std::cos(glm::radians(20.f)), std::cos(glm::radians(35.f)), 0.f, 0.f);
+    }
+}
+
+void VulkanEngine::updateObjects(const float time) {
+    int dynamicIndex = 0;
+    for (uint32_t i = 0; i < m_renderObjects.size(); i++) {
+        RenderObject& object = m_renderObjects[i];
+        if (object.isStatic || object.isSkinned) {
+            continue;
+        }
+
+        const float angle = time * 0.5f + static_cast<float>(dynamicIndex) * glm::two_pi<float>() / 3.f;
+        const glm::vec3 position{std::cos(angle) * 6.f, 1.5f, std::sin(angle) * 6.f};
+        object.transform = glm::rotate(glm::translate(glm::mat4{ 1.f }, position), time, glm::vec3(0, 1, 0));
+        m_gpuScene.setTransform(object.objectId, object.transform);
+        m_frustumCuller.setObject(i, object.transform, object.boundingSphere);
+        dynamicIndex++;
+    }
+}
+
+void VulkanEngine::updateCulling() {
+    if (m_frustumCulling) {
+        m_frustumCuller.cull(m_sceneData.viewProj, m_drawList);
+    } else {
+        m_drawList.resize(m_renderObjects.size());
+        for (uint32_t i = 0; i < m_drawList.size(); i++) {
+            m_drawList[i] = i;
+        }
+    }
+
+    m_visibleObjects.resize(m_renderObjects.size());
+
+    if (!m_occlusionCulling) {
+        std::fill(m_visibleObjects.begin(), m_visibleObjects.end(), 1);
+        return;
+    }
+
+    m_occlusionCuller.beginFrame(m_sceneData.viewProj);
+    for (const RenderObject& object : m_renderObjects) {
+        if (object.occluderMesh != NO_OCCLUDER_MESH) {
+            m_occlusionCuller.rasterizeOccluder(object.occluderMesh, object.transform);
+        }
+    }
+    m_occlusionCuller.endFrame();
+
+    m_occlusionCuller.testObjects(m_renderObjects, m_visibleObjects);
+
+    std::erase_if(m_drawList, [this](uint32_t index) { return !m_visibleObjects[index]; });
+}
+
+void VulkanEngine::drawBackground(VkCommandBuffer cmd) {
+    const ComputeEffect& effect = m_backgroundEffects[m_currentBackgroundEffect];
 
+    // nothing to cache, evaluate straight into the draw image
+    if (effect.dynamic) {
+        m_backgroundCacheKey.valid = false;
+        m_backgroundEvaluations++;
+        dispatchBackground(cmd, effect, m_drawImageDescriptor);
+        return;
+    }
+
+    const bool cacheUpToDate = m_backgroundCacheKey.valid &&
+                               m_backgroundCacheKey.effectIndex == m_currentBackgroundEffect &&
+                               m_backgroundCacheKey.extent.width == m_drawExtent.width &&
+                               m_backgroundCacheKey.extent.height == m_drawExtent.height &&
+                               memcmp(&m_backgroundCacheKey.data, &effect.data, sizeof(ComputePushConstants)) == 0;
+
+    if (!cacheUpToDate) {
+        // also orders the write after the copy of the previous frame
+        VkUtils::transitionImage(cmd, m_backgroundCache.image,
+                                 m_backgroundCacheKey.valid ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED,
+                                 VK_IMAGE_LAYOUT_GENERAL);
+
+        dispatchBackground(cmd, effect, m_backgroundCacheDescriptor);
+
+        VkUtils::memoryBarrier(cmd,
+                               VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                               VK_PIPELINE_STAGE_2_COPY_BIT,
+                               VK_ACCESS_2_TRANSFER_READ_BIT);
+
+        m_backgroundCacheKey = {
+            .effectIndex = m_currentBackgroundEffect,
+            .data = effect.data,
+            .extent = m_drawExtent,
+            .valid = true,
+        };
+        m_backgroundEvaluations++;
+    }
+
+    const VkImageCopy copyRegion{
+        .srcSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .srcOffset = {0, 0, 0},
+        .dstSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .dstOffset = {0, 0, 0},
+        .extent = {m_drawExtent.width, m_drawExtent.height, 1},
+    };
+
+    vkCmdCopyImage(cmd, m_backgroundCache.image, VK_IMAGE_LAYOUT_GENERAL,
+                   m_drawImage.image, VK_IMAGE_LAYOUT_GENERAL, 1, &copyRegion);
+}
+
+void VulkanEngine::dispatchBackground(VkCommandBuffer cmd, const ComputeEffect& effect, VkDescriptorSet target) const {
     // bind the gradient drawing compute pipeline
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, effect.pipeline);
 
-    // bind the descriptor set containing the draw image for the compute pipeline
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_drawImageDescriptor, 0, nullptr);
+    // bind the descriptor set containing the target image for the compute pipeline
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &target, 0, nullptr);
 
     vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants), &effect.data);
 
     // execute the compute pipeline dispatch. We are using 16x16 workgroup size so we need to divide by it
     vkCmdDispatch(cmd, std::ceil(m_drawExtent.width / 16.0), std::ceil(m_drawExtent.height / 16.0), 1);
+    m_frameCounters.dispatches++;
 }
 
 void VulkanEngine::drawGeometry(VkCommandBuffer cmd) {
@@ -786,35 +1702,236 @@ void VulkanEngine::drawGeometry(VkCommandBuffer cmd) {
 
     vkCmdBeginRendering(cmd, &renderInfo);
 
-    //set dynamic viewport and scissor
-    VkViewport viewport{};
-    viewport.x = 0;
-    viewport.y = 0;
-    viewport.width = m_drawExtent.width;
-    viewport.height = m_drawExtent.height;
-    viewport.minDepth = 0.f;
-    viewport.maxDepth = 1.f;
+    if (m_useShaderObjects) {
+        m_shaderObjects.bindGraphicsShaders(cmd, m_meshVertexObject, m_meshFragmentObject);
+        m_shaderObjects.setState(cmd, m_geometryState, m_drawExtent);
+    } else {
+        //set dynamic viewport and scissor
+        VkViewport viewport{};
+        viewport.x = 0;
+        viewport.y = 0;
+        viewport.width = m_drawExtent.width;
+        viewport.height = m_drawExtent.height;
+        viewport.minDepth = 0.f;
+        viewport.maxDepth = 1.f;
+
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+        VkRect2D scissor = {};
+        scissor.offset.x = 0;
+        scissor.offset.y = 0;
+        scissor.extent.width = m_drawExtent.width;
+        scissor.extent.height = m_drawExtent.height;
+
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          m_usePipelineLibrary ? m_pipelineLibrary.getPipeline(m_meshPipelineHandle) : m_meshPipeline);
+        m_dynamicState.set(cmd, m_geometryState);
+    }
 
-    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    bindSceneDescriptors(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_meshPipelineLayout);
 
-    VkRect2D scissor = {};
-    scissor.offset.x = 0;
-    scissor.offset.y = 0;
-    scissor.extent.width = m_drawExtent.width;
-    scissor.extent.height = m_drawExtent.height;
+    for (const uint32_t index : m_drawList) {
+        const RenderObject& object = m_renderObjects[index];
+        GPUDrawPushConstants pushConstants{};
+        pushConstants.vertexBuffer = object.vertexBufferAddress;
+        pushConstants.objectId = object.objectId;
 
-    vkCmdSetScissor(cmd, 0, 1, &scissor);
+        vkCmdPushConstants(cmd, m_meshPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GPUDrawPushConstants), &pushConstants);
+        vkCmdBindIndexBuffer(cmd, object.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
 
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_meshPipeline);
+        vkCmdDrawIndexed(cmd, object.indexCount, 1, object.firstIndex, 0, 0);
+    }
+    m_frameCounters.draws += static_cast<uint32_t>(m_drawList.size());
+
+    vkCmdEndRendering(cmd);
+}
+
+void VulkanEngine::publishTelemetry() {
+    TelemetrySnapshot& snapshot = m_telemetry.getPending();
+    snapshot.draws = m_frameCounters.draws;
+    snapshot.dispatches = m_frameCounters.dispatches;
+    snapshot.drawsTotal += m_frameCounters.draws;
+    snapshot.dispatchesTotal += m_frameCounters.dispatches;
+    snapshot.uploadBytesTotal += m_frameCounters.uploadBytes;
+    snapshot.renderObjects = static_cast<uint32_t>(m_renderObjects.size());
+    snapshot.visibleObjects = static_cast<uint32_t>(m_drawList.size());
+
+    // assigned in place, the names keep their storage from frame to frame
+    const std::vector<GpuTimerResult>& results = m_gpuProfiler.getResults();
+    snapshot.passes.resize(results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        snapshot.passes[i].name = results[i].name;
+        snapshot.passes[i].milliseconds = results[i].milliseconds;
+    }
+
+    // the allocator refreshes the budgets once per frame index
+    vmaSetCurrentFrameIndex(m_allocator, static_cast<uint32_t>(m_frameNumber));
+    const VkPhysicalDeviceMemoryProperties* memoryProperties;
+    vmaGetMemoryProperties(m_allocator, &memoryProperties);
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(m_allocator, budgets);
+
+    snapshot.heaps.resize(memoryProperties->memoryHeapCount);
+    for (uint32_t heap = 0; heap < memoryProperties->memoryHeapCount; heap++) {
+        snapshot.heaps[heap] = {
+            .usageBytes = budgets[heap].usage,
+            .budgetBytes = budgets[heap].budget,
+            .allocationBytes = budgets[heap].statistics.allocationBytes,
+        };
+    }
+
+    m_telemetry.publish();
+}
+
+void VulkanEngine::captureFrame(const std::filesystem::path& path) {
+    FrameCapture capture{
+        .extent = m_drawExtent,
+        .colorFormat = m_drawImage.imageFormat,
+    };
+
+    const ComputeEffect& effect = m_backgroundEffects[m_currentBackgroundEffect];
+    capture.backgroundName = effect.name;
+    capture.backgroundConstants = effect.data;
+    if (!VkUtils::loadShaderCode(effect.shaderPath, capture.backgroundShader) ||
+        !VkUtils::loadShaderCode(HELLFIRE_SHADER_DIR "/coloredTriangleMesh.vert.spv", capture.vertexShader) ||
+        !VkUtils::loadShaderCode(HELLFIRE_SHADER_DIR "/mesh.frag.spv", capture.fragmentShader)) {
+        std::cerr << "Frame capture failed, the shaders could not be read\n";
+        return;
+    }
 
-    GPUDrawPushConstants pushConstants{};
-    pushConstants.worldMatrix = glm::mat4{ 1.f };
-    pushConstants.vertexBuffer = m_rectangle.vertexBufferAddress;
+    capture.geometryState = {
+        .topology = m_geometryState.topology,
+        .polygonMode = m_geometryState.polygonMode,
+        .cullMode = m_geometryState.cullMode,
+        .frontFace = m_geometryState.frontFace,
+        .blending = m_geometryState.blending ? 1u : 0u,
+    };
 
-    vkCmdPushConstants(cmd, m_meshPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GPUDrawPushConstants), &pushConstants);
-    vkCmdBindIndexBuffer(cmd, m_rectangle.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+    // meshes are shared by the draws pulling the same vertices through the same indices
+    std::map<std::pair<VkBuffer, VkDeviceAddress>, uint32_t> meshOfBuffers;
+    std::vector<const RenderObject*> meshObjects;
+    std::vector<uint32_t> meshIndexCounts;
+    uint32_t objectCount = 0;
+    for (const uint32_t index: m_drawList) {
+        const RenderObject& object = m_renderObjects[index];
+        const auto [mesh, inserted] = meshOfBuffers.try_emplace({object.indexBuffer, object.vertexBufferAddress},
+                                                                static_cast<uint32_t>(meshObjects.size()));
+        if (inserted) {
+            meshObjects.push_back(&object);
+            meshIndexCounts.push_back(0);
+        }
+        meshIndexCounts[mesh->second] = std::max(meshIndexCounts[mesh->second], object.firstIndex + object.indexCount);
+        objectCount = std::max(objectCount, object.objectId + 1);
+
+        capture.draws.push_back({
+            .mesh = mesh->second,
+            .indexCount = object.indexCount,
+            .firstIndex = object.firstIndex,
+            .objectId = object.objectId,
+        });
+    }
 
-    vkCmdDrawIndexed(cmd, 6, 1, 0, 0, 0);
+    capture.meshes.resize(meshObjects.size());
+    for (size_t i = 0; i < meshObjects.size(); i++) {
+        CapturedMesh& mesh = capture.meshes[i];
+        const std::vector<std::byte> indices = m_frameCapturer.readBuffer(meshObjects[i]->indexBuffer,
+                                                                          meshIndexCounts[i] * sizeof(uint32_t));
+        mesh.indices.resize(meshIndexCounts[i]);
+        memcpy(mesh.indices.data(), indices.data(), indices.size());
+
+        // only the vertices the indices reach, a streamed LOD may share a larger buffer
+        const uint32_t vertexCount = mesh.indices.empty() ? 0 : std::ranges::max(mesh.indices) + 1;
+        const std::vector<std::byte> vertices = m_frameCapturer.readAddress(meshObjects[i]->vertexBufferAddress,
+                                                                            vertexCount * sizeof(Vertex));
+        mesh.vertices.resize(vertexCount);
+        memcpy(mesh.vertices.data(), vertices.data(), vertices.size());
+    }
+
+    // the scene set as initLighting writes it. The shadow cascades and the virtual texture are images,
+    // which the replay stands in for
+    const auto* sceneData = static_cast<const std::byte*>(getCurrentFrame().sceneDataBuffer.info.pMappedData);
+    capture.sceneBindings.push_back({
+        .binding = 0,
+        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .data = {sceneData, sceneData + sizeof(GPUSceneData)},
+    });
+
+    const auto captureStorage = [&](uint32_t binding, const AllocatedBuffer& buffer, VkDeviceSize size) {
+        capture.sceneBindings.push_back({
+            .binding = binding,
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .data = m_frameCapturer.readAddress(getBufferAddress(buffer), size),
+        });
+    };
+    const auto captureImage = [&](uint32_t binding, CapturedImageKind kind, VkImageViewType viewType, uint32_t layers) {
+        capture.sceneBindings.push_back({
+            .binding = binding,
+            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .imageKind = kind,
+            .viewType = viewType,
+            .layerCount = layers,
+        });
+    };
+
+    captureStorage(1, m_lighting.getLightBuffer(), MAX_LIGHTS * sizeof(GPULight));
+    captureStorage(2, m_lighting.getClusterGridBuffer(), CLUSTER_COUNT * 2 * sizeof(uint32_t));
+    captureStorage(3, m_lighting.getLightIndexBuffer(), (MAX_LIGHT_INDICES + 1) * sizeof(uint32_t));
+    captureImage(4, CapturedImageKind::DepthCompare, VK_IMAGE_VIEW_TYPE_2D_ARRAY, SHADOW_CASCADE_COUNT);
+    captureStorage(5, m_gpuScene.getObjectBuffer(), std::max(objectCount, 1u) * sizeof(GPUObjectData));
+    captureImage(6, CapturedImageKind::Uint, VK_IMAGE_VIEW_TYPE_2D, 1);
+    captureImage(7, CapturedImageKind::Float, VK_IMAGE_VIEW_TYPE_2D, 1);
+
+    if (!saveFrameCapture(path, capture)) {
+        std::cerr << std::format("Failed to write frame capture {}\n", path.string());
+        return;
+    }
+
+    std::cerr << std::format("Captured {} draws of {} meshes into {}\n",
+                             capture.draws.size(), capture.meshes.size(), path.string());
+}
+
+void VulkanEngine::drawComposite(VkCommandBuffer cmd, VkImageView targetImageView) {
+    const VkRenderingAttachmentInfo colorAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .pNext = nullptr,
+        .imageView = targetImageView,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+    };
+
+    const VkRenderingInfo renderInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .pNext = nullptr,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = m_swapChain->getExtent(),
+        },
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+    };
+
+    vkCmdBeginRendering(cmd, &renderInfo);
+
+    const uint32_t compositeScope = m_gpuProfiler.beginScope(cmd, "composite");
+    m_composite.draw(cmd, m_postProcess, m_drawExtent, m_swapChain->getExtent(), static_cast<uint32_t>(m_frameNumber));
+    m_gpuProfiler.endScope(cmd, compositeScope);
+
+    // the UI goes on top in the same pass
+    if (m_showUi) {
+        const uint32_t imguiScope = m_gpuProfiler.beginScope(cmd, "imgui");
+        if (m_cacheUiLayer) {
+            m_uiLayer.compositeInPass(cmd);
+        } else {
+            m_uiLayer.invalidate();
+            ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+        }
+        m_gpuProfiler.endScope(cmd, imguiScope);
+    }
 
     vkCmdEndRendering(cmd);
 }
@@ -867,9 +1984,25 @@ GPUMeshBuffers VulkanEngine::uploadMesh(std::span<uint32_t> indices, std::span<V
     };
     newSurface.vertexBufferAddress = vkGetBufferDeviceAddress(m_ctx->getDevice(), &deviceAddressInfo);
 
-    // create index buffer
+    // bounding sphere around the center of the vertex bounds
+    glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+    glm::vec3 boundsMax{std::numeric_limits<float>::lowest()};
+    for (const Vertex& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+
+    const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius = 0.f;
+    for (const Vertex& vertex : vertices) {
+        radius = std::max(radius, glm::length(vertex.position - center));
+    }
+    newSurface.boundingSphere = glm::vec4(center, radius);
+
+    // create index buffer, frame captures read it back
     newSurface.indexBuffer = createBuffer(indexBufferSize, 
-                                          VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                          VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                                           VMA_MEMORY_USAGE_GPU_ONLY);
 
     AllocatedBuffer staging = createBuffer(vertexBufferSize + indexBufferSize, 
@@ -903,6 +2036,78 @@ GPUMeshBuffers VulkanEngine::uploadMesh(std::span<uint32_t> indices, std::span<V
     return newSurface;
 }
 
+void VulkanEngine::loadAsset(const std::filesystem::path& path, const glm::mat4& transform) {
+    m_assetLoader.load(path, transform);
+}
+
+uint32_t VulkanEngine::addRenderObject(const GPUMeshBuffers& mesh, uint32_t indexCount, const glm::mat4& transform) {
+    RenderObject object{
+        .indexCount = indexCount,
+        .firstIndex = 0,
+        .indexBuffer = mesh.indexBuffer.buffer,
+        .vertexBufferAddress = mesh.vertexBufferAddress,
+        .boundingSphere = mesh.boundingSphere,
+        .transform = transform,
+        .isStatic = true,
+    };
+    object.objectId = m_gpuScene.addObject(object.transform, object.boundingSphere, 0);
+    m_frustumCuller.addObject(object.transform, object.boundingSphere);
+
+    m_renderObjects.push_back(object);
+    m_visibleObjects.push_back(1);
+    m_staticSceneVersion++;
+
+    m_mainDeletionQueue.push_function([this, mesh] {
+        destroyBuffer(mesh.indexBuffer);
+        destroyBuffer(mesh.vertexBuffer);
+    });
+
+    return static_cast<uint32_t>(m_renderObjects.size() - 1);
+}
+
+uint32_t VulkanEngine::addSkinnedRenderObject(
+    const GPUMeshBuffers& mesh,
+    uint32_t indexCount,
+    const glm::mat4& transform,
+    std::span<const SkinVertex> skinVertices,
+    std::shared_ptr<const Skeleton> skeleton
+) {
+    const uint32_t instance = m_skinning.addInstance(mesh, skinVertices, std::move(skeleton));
+
+    // the object pulls the skinned copy, the base buffers are still owned and released through it
+    GPUMeshBuffers skinned = mesh;
+    skinned.vertexBufferAddress = m_skinning.getOutputAddress(instance);
+    skinned.boundingSphere.w *= SKINNED_BOUNDS_SCALE;
+    const uint32_t renderObject = addRenderObject(skinned, indexCount, transform);
+
+    // posed every frame, so it is never baked into the cached shadow cascades
+    m_renderObjects[renderObject].isStatic = false;
+    m_renderObjects[renderObject].isSkinned = true;
+    m_skinning.setRenderObject(instance, renderObject);
+
+    return renderObject;
+}
+
+void VulkanEngine::setMaterial(uint32_t renderObject, uint32_t materialIndex) {
+    RenderObject& object = m_renderObjects[renderObject];
+    object.materialIndex = materialIndex;
+    m_gpuScene.setMaterial(object.objectId, materialIndex);
+}
+
+bool VulkanEngine::loadVirtualTexture(const std::filesystem::path& path) {
+    if (!m_virtualTexture.load(path)) {
+        return false;
+    }
+
+    // the demo floor shows the texture
+    setMaterial(0, VIRTUAL_TEXTURE_MATERIAL);
+    return true;
+}
+
+bool VulkanEngine::streamMesh(const std::filesystem::path& basePath, const glm::mat4& transform) {
+    return m_meshStreamer.addMesh(basePath, transform);
+}
+
 AllocatedBuffer VulkanEngine::createBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) {
     // allocate buffer
     VkBufferCreateInfo bufferInfo{
@@ -929,6 +2134,14 @@ void VulkanEngine::destroyBuffer(const AllocatedBuffer& buffer) {
     vmaDestroyBuffer(m_allocator, buffer.buffer, buffer.allocation);
 }
 
+VkDeviceAddress VulkanEngine::getBufferAddress(const AllocatedBuffer& buffer) const {
+    const VkBufferDeviceAddressInfo addressInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+        .buffer = buffer.buffer
+    };
+    return vkGetBufferDeviceAddress(m_ctx->getDevice(), &addressInfo);
+}
+
 void VulkanEngine::immediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function) const {
     VK_CHECK(vkResetFences(m_ctx->getDevice(), 1, &m_immediateFence));
     VK_CHECK(vkResetCommandBuffer(m_immediateCommandBuffer, 0));
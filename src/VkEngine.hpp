@@ -1,19 +1,52 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
 
 #include "VkTypes.hpp"
 #include "VkContext.hpp"
 #include "VkDescriptors.hpp"
+#include "VkPipeline.hpp"
 #include "VkSwapChain.hpp"
-
-constexpr unsigned int FRAME_OVERLAP = 2;
+#include "VkClusteredLighting.hpp"
+#include "VkShadows.hpp"
+#include "VkGpuScene.hpp"
+#include "VkPostProcess.hpp"
+#include "VkGpuProfiler.hpp"
+#include "VkUiLayer.hpp"
+#include "VkComposite.hpp"
+#include "VkOverdraw.hpp"
+#include "JobSystem.hpp"
+#include "FrustumCuller.hpp"
+#include "OcclusionCuller.hpp"
+#include "VkAssetLoader.hpp"
+#include "VkShaderObject.hpp"
+#include "VkPipelineLibrary.hpp"
+#include "VkMeshStreamer.hpp"
+#include "VkVirtualTexture.hpp"
+#include "VkSkinning.hpp"
+#include "VkParticles.hpp"
+#include "VkFrameCapture.hpp"
+#include "VkFrameReadback.hpp"
+#include "Telemetry.hpp"
 
 struct ComputeEffect {
     const char* name;
+    // kept so a frame capture can embed the code
+    const char* shaderPath;
     VkPipeline pipeline;
     VkPipelineLayout layout;
     ComputePushConstants data;
+    // time dependent effects are re-evaluated every frame instead of being cached
+    bool dynamic = false;
+};
+
+// inputs the cached background was evaluated with
+struct BackgroundCacheKey {
+    int effectIndex = -1;
+    ComputePushConstants data{};
+    VkExtent2D extent{};
+    bool valid = false;
 };
 
 class VulkanEngine {
@@ -22,34 +55,85 @@ public:
 
     [[nodiscard]] struct SDL_Window* getWindow() const { return m_window; }
     [[nodiscard]] FrameData& getCurrentFrame() { return m_frames[m_frameNumber % FRAME_OVERLAP]; }
+    [[nodiscard]] uint32_t getCurrentFrameIndex() const { return m_frameNumber % FRAME_OVERLAP; }
+    [[nodiscard]] VulkanContext* getContext() const { return m_ctx.get(); }
+    [[nodiscard]] VmaAllocator getAllocator() const { return m_allocator; }
+    [[nodiscard]] DeletionQueue& getMainDeletionQueue() { return m_mainDeletionQueue; }
+    [[nodiscard]] PipelineRegistry& getPipelineRegistry() { return m_pipelineRegistry; }
+    [[nodiscard]] FrameCounters& getFrameCounters() { return m_frameCounters; }
+
+    // a device index or part of its name, overrides the scored pick. Call before init
+    void setPreferredGpu(const std::string& preferredGpu) { m_preferredGpu = preferredGpu; }
+    // serves Prometheus metrics on 127.0.0.1:<port>, 0 disables them. Call before init
+    void setMetricsPort(uint16_t port) { m_metricsPort = port; }
+    // records every presented frame to a raw video file from the first frame on. Call before init
+    void setRecordingPath(const std::string& path) { m_startupRecordingPath = path; }
 
     void init();
     void cleanup();
     void run();
     void draw();
 
+    GPUMeshBuffers uploadMesh(std::span<uint32_t> indices, std::span<Vertex> vertices);
+
+    // loads a glTF file in the background, its meshes appear once they are on the GPU
+    void loadAsset(const std::filesystem::path& path, const glm::mat4& transform = glm::mat4{1.f});
+    // streams the LOD chain <basePath>.lod<N>.hmesh, finer LODs are loaded as the mesh grows on screen
+    bool streamMesh(const std::filesystem::path& basePath, const glm::mat4& transform = glm::mat4{1.f});
+    // adds a static object drawing the whole mesh to the scene and to every system tracking objects,
+    // the engine takes ownership of the mesh buffers. Returns the index of the render object
+    uint32_t addRenderObject(const GPUMeshBuffers& mesh, uint32_t indexCount, const glm::mat4& transform);
+    void setMaterial(uint32_t renderObject, uint32_t materialIndex);
+    // adds an object drawing the mesh posed by its skeleton, the base vertices are only read by the skinning pass
+    uint32_t addSkinnedRenderObject(const GPUMeshBuffers& mesh, uint32_t indexCount, const glm::mat4& transform,
+                                    std::span<const SkinVertex> skinVertices, std::shared_ptr<const Skeleton> skeleton);
+
+    // replaces the virtual texture sampled by VIRTUAL_TEXTURE_MATERIAL objects
+    bool loadVirtualTexture(const std::filesystem::path& path);
+
+    AllocatedBuffer createBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
+    void destroyBuffer(const AllocatedBuffer& buffer);
+    // the buffer needs VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+    [[nodiscard]] VkDeviceAddress getBufferAddress(const AllocatedBuffer& buffer) const;
+
+    void immediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function) const;
+
+    // pipelines reading the scene set at set 0 are created with these flags
+    [[nodiscard]] VkPipelineCreateFlags getScenePipelineFlags() const;
+    // binds this frame's scene set at set 0, from the descriptor buffer when the device has one
+    void bindSceneDescriptors(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout);
+
 private:
     void initVulkan();
     void initSwapChain();
     void initCommands();
     void initSyncStructures();
     void initDescriptors();
+    void initLighting();
+    void writeSceneDescriptors(FrameData& frame);
+    void initPostProcess();
     void initDefaultData();
     void initPipeline();
     void initBackgroundPipelines();
     void initMeshPipeline();
     void initImGui();
 
-    void drawBackground(VkCommandBuffer cmd) const;
-    void drawGeometry(VkCommandBuffer cmd);
-    void drawImGui(VkCommandBuffer cmd, VkImageView targetImageView) const;
-
-    GPUMeshBuffers uploadMesh(std::span<uint32_t> indices, std::span<Vertex> vertices);
+    void buildUi();
 
-    AllocatedBuffer createBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
-    void destroyBuffer(const AllocatedBuffer& buffer);
+    void updateScene();
+    void updateLights(float time);
+    void updateObjects(float time);
+    void updateCulling();
 
-    void immediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function) const;
+    void drawBackground(VkCommandBuffer cmd);
+    void dispatchBackground(VkCommandBuffer cmd, const ComputeEffect& effect, VkDescriptorSet target) const;
+    void drawGeometry(VkCommandBuffer cmd);
+    // writes what the background and geometry passes of the frame just submitted consumed
+    void captureFrame(const std::filesystem::path& path);
+    // hands this frame's counters, pass timings and memory to the metrics server
+    void publishTelemetry();
+    void drawComposite(VkCommandBuffer cmd, VkImageView targetImageView);
+    void drawImGui(VkCommandBuffer cmd, VkImageView targetImageView) const;
 
     int m_frameNumber = 0;
     bool m_isInitialized = false;
@@ -58,6 +142,10 @@ private:
     VkExtent2D m_windowExtent = {1700, 900};
 
     DeletionQueue m_mainDeletionQueue;
+    // deduplicates graphics pipelines by their full description
+    PipelineRegistry m_pipelineRegistry;
+    // shared by culling and any other CPU work that can go wide
+    JobSystem m_jobSystem;
     VmaAllocator m_allocator;
 
     AllocatedImage m_drawImage;
@@ -68,6 +156,41 @@ private:
     VkDescriptorSet m_drawImageDescriptor;
     VkDescriptorSetLayout m_drawImageDescriptorLayout;
 
+    // static backgrounds are evaluated once into the cache and copied into the draw image afterwards
+    AllocatedImage m_backgroundCache;
+    VkDescriptorSet m_backgroundCacheDescriptor;
+    BackgroundCacheKey m_backgroundCacheKey;
+    uint32_t m_backgroundEvaluations = 0;
+
+    GPUSceneData m_sceneData{};
+    VkDescriptorSetLayout m_sceneDescriptorLayout;
+    // with VK_EXT_descriptor_buffer every pass reads the scene set from a buffer instead of a pool
+    bool m_useDescriptorBuffer = false;
+    DescriptorBuffer m_sceneDescriptorBuffer{};
+
+    glm::vec3 m_cameraPosition{0.f, 8.f, 14.f};
+    glm::vec3 m_cameraTarget{0.f, 0.f, 0.f};
+    float m_cameraFovY = 70.f;
+    float m_cameraNear = 0.1f;
+    float m_cameraFar = 200.f;
+
+    glm::vec3 m_sunDirection{-0.4f, -1.f, -0.3f};
+    float m_sunIntensity = 1.5f;
+    CascadedShadows m_shadows;
+
+    ClusteredLighting m_lighting;
+    int m_lightCount = 512;
+    bool m_animateLights = true;
+
+    PostProcess m_postProcess;
+    CompositePass m_composite;
+    // resolve, tonemap and UI in one swapChain pass instead of tonemap + blit + UI pass
+    bool m_fusedComposite = true;
+    GpuProfiler m_gpuProfiler;
+    // replaces the shaded image with the fragments every pixel shaded
+    OverdrawHeatmap m_overdraw;
+    bool m_showOverdraw = false;
+
     VkPipelineLayout m_pipelineLayout;
 
     VkFence m_immediateFence;
@@ -75,14 +198,68 @@ private:
     VkCommandPool m_immediateCommandPool;
 
     VkDescriptorPool m_imguiPool;
+    UiLayer m_uiLayer;
+    // re-rasterize the UI only when its draw data changes
+    bool m_cacheUiLayer = true;
+    // toggled with F1, a hidden UI skips ImGui entirely
+    bool m_showUi = true;
 
     int m_currentBackgroundEffect{0};
     std::vector<ComputeEffect> m_backgroundEffects;
 
     VkPipelineLayout m_meshPipelineLayout;
     VkPipeline m_meshPipeline;
+    // cull mode and friends are set while recording, changing them never needs another pipeline
+    DynamicStateCommands m_dynamicState;
+    GraphicsState m_geometryState{};
+    // with VK_EXT_graphics_pipeline_library the mesh pipeline is fast linked and optimized in the background
+    PipelineLibrary m_pipelineLibrary;
+    bool m_usePipelineLibrary = false;
+    uint32_t m_meshPipelineHandle = 0;
+    // the same shaders as shader objects, drawn with state set at record time when the device supports it
+    ShaderObjects m_shaderObjects;
+    VkShaderEXT m_meshVertexObject = VK_NULL_HANDLE;
+    VkShaderEXT m_meshFragmentObject = VK_NULL_HANDLE;
+    bool m_useShaderObjects = false;
 
     GPUMeshBuffers m_rectangle;
+    GPUMeshBuffers m_cube;
+
+    std::vector<RenderObject> m_renderObjects;
+    GpuScene m_gpuScene;
+    // bumped whenever a static object is added, removed or moved
+    uint64_t m_staticSceneVersion = 0;
+
+    AssetLoader m_assetLoader;
+    char m_assetPath[256] = {};
+    MeshStreamer m_meshStreamer;
+    VirtualTexture m_virtualTexture;
+    char m_virtualTexturePath[256] = {};
+    GpuSkinning m_skinning;
+    GpuParticles m_particles;
+    FrameCapturer m_frameCapturer;
+    char m_capturePath[256] = "frame.hcap";
+    FrameReadback m_frameReadback;
+    char m_screenshotPath[256] = "screenshot.png";
+    char m_recordingPath[256] = "recording.raw";
+    std::string m_startupRecordingPath;
+
+    Telemetry m_telemetry;
+    uint16_t m_metricsPort = 0;
+    FrameCounters m_frameCounters;
+    std::chrono::steady_clock::time_point m_lastFrameStart{};
+
+    // indexed like m_renderObjects
+    FrustumCuller m_frustumCuller;
+    bool m_frustumCulling = true;
+    OcclusionCuller m_occlusionCuller;
+    bool m_occlusionCulling = true;
+    // one entry per render object, 0 if the culler found it hidden this frame
+    std::vector<uint8_t> m_visibleObjects;
+    // indices of the render objects that survived culling, in draw order
+    std::vector<uint32_t> m_drawList;
+
+    std::string m_preferredGpu;
 
     SDL_Window* m_window = nullptr;
     std::unique_ptr<VulkanContext> m_ctx = nullptr;
@@ -0,0 +1,140 @@
+#include "VkFrameCapture.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "VkEngine.hpp"
+#include "VkPipeline.hpp"
+#include "VkSync.hpp"
+
+struct CaptureCopyPushConstants {
+    VkDeviceAddress source;
+    VkDeviceAddress destination;
+    uint32_t firstWord;
+    uint32_t wordCount;
+};
+
+// largest dispatch every device accepts
+constexpr uint32_t CAPTURE_COPY_MAX_GROUPS = 65535;
+
+void FrameCapturer::init(VulkanEngine* engine) {
+    m_engine = engine;
+    const VkDevice device = engine->getContext()->getDevice();
+
+    const VkPushConstantRange pushConstant{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(CaptureCopyPushConstants),
+    };
+
+    const VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .setLayoutCount = 0,
+        .pSetLayouts = nullptr,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstant,
+    };
+
+    VK_CHECK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &m_copyLayout));
+
+    VkShaderModule shader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/captureCopy.comp.spv", device, &shader)) {
+        std::cerr << "Error when building the capture copy compute shader" << std::endl;
+    }
+
+    const VkComputePipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = nullptr,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = shader,
+            .pName = "main",
+        },
+        .layout = m_copyLayout,
+    };
+
+    VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_copyPipeline));
+
+    VkUtils::destroyShaderModule(device, shader);
+
+    engine->getMainDeletionQueue().push_function([device, this] {
+        vkDestroyPipeline(device, m_copyPipeline, nullptr);
+        vkDestroyPipelineLayout(device, m_copyLayout, nullptr);
+    });
+}
+
+std::vector<std::byte> FrameCapturer::readAddress(VkDeviceAddress address, VkDeviceSize size) {
+    if (size == 0) {
+        return {};
+    }
+
+    const AllocatedBuffer staging = m_engine->createBuffer(size,
+                                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                           VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                           VMA_MEMORY_USAGE_GPU_TO_CPU);
+    const VkDeviceAddress destination = m_engine->getBufferAddress(staging);
+    const auto wordCount = static_cast<uint32_t>(size / sizeof(uint32_t));
+
+    m_engine->immediateSubmit([&](VkCommandBuffer cmd) {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_copyPipeline);
+
+        // large buffers are copied in several dispatches
+        constexpr uint32_t wordsPerDispatch = CAPTURE_COPY_MAX_GROUPS * CAPTURE_COPY_GROUP_SIZE;
+        for (uint32_t firstWord = 0; firstWord < wordCount; firstWord += wordsPerDispatch) {
+            const CaptureCopyPushConstants pushConstants{
+                .source = address,
+                .destination = destination,
+                .firstWord = firstWord,
+                .wordCount = wordCount,
+            };
+            vkCmdPushConstants(cmd, m_copyLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CaptureCopyPushConstants),
+                               &pushConstants);
+
+            const uint32_t words = std::min(wordCount - firstWord, wordsPerDispatch);
+            vkCmdDispatch(cmd, (words + CAPTURE_COPY_GROUP_SIZE - 1) / CAPTURE_COPY_GROUP_SIZE, 1, 1);
+        }
+
+        VkUtils::memoryBarrier(cmd,
+                               VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                               VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+    });
+
+    return readStaging(staging, size);
+}
+
+std::vector<std::byte> FrameCapturer::readBuffer(VkBuffer buffer, VkDeviceSize size) {
+    if (size == 0) {
+        return {};
+    }
+
+    const AllocatedBuffer staging = m_engine->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                           VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+    m_engine->immediateSubmit([&](VkCommandBuffer cmd) {
+        const VkBufferCopy region{
+            .srcOffset = 0,
+            .dstOffset = 0,
+            .size = size,
+        };
+        vkCmdCopyBuffer(cmd, buffer, staging.buffer, 1, &region);
+
+        VkUtils::memoryBarrier(cmd,
+                               VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+    });
+
+    return readStaging(staging, size);
+}
+
+std::vector<std::byte> FrameCapturer::readStaging(const AllocatedBuffer& staging, VkDeviceSize size) {
+    VK_CHECK(vmaInvalidateAllocation(m_engine->getAllocator(), staging.allocation, 0, size));
+
+    std::vector<std::byte> data(size);
+    std::memcpy(data.data(), staging.info.pMappedData, size);
+
+    m_engine->destroyBuffer(staging);
+    return data;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+#include "VkTypes.hpp"
+
+class VulkanEngine;
+
+// must match local_size in captureCopy.comp
+constexpr uint32_t CAPTURE_COPY_GROUP_SIZE = 64;
+
+// reads back what a finished frame consumed for a FrameCapture. Every read is its own blocking submission,
+// captures are rare and the frame they describe has already been presented
+class FrameCapturer {
+public:
+    void init(VulkanEngine* engine);
+
+    // the frame drawn next is captured once it has finished
+    void request(const std::filesystem::path& path) { m_requestedPath = path; }
+    [[nodiscard]] bool isRequested() const { return !m_requestedPath.empty(); }
+    std::filesystem::path takeRequest() { return std::exchange(m_requestedPath, {}); }
+
+    // any buffer with a device address, copied by a compute shader. The size must be a multiple of 4
+    std::vector<std::byte> readAddress(VkDeviceAddress address, VkDeviceSize size);
+    // the buffer needs VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+    std::vector<std::byte> readBuffer(VkBuffer buffer, VkDeviceSize size);
+
+private:
+    std::vector<std::byte> readStaging(const AllocatedBuffer& staging, VkDeviceSize size);
+
+    VulkanEngine* m_engine = nullptr;
+    VkPipelineLayout m_copyLayout = VK_NULL_HANDLE;
+    VkPipeline m_copyPipeline = VK_NULL_HANDLE;
+    std::filesystem::path m_requestedPath;
+};
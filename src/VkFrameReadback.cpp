@@ -0,0 +1,257 @@
+#include "VkFrameReadback.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include "VkEngine.hpp"
+#include "VkSync.hpp"
+
+// marks a write request that only closes the recording
+constexpr uint32_t READBACK_END_VIDEO = READBACK_RING_SIZE;
+
+void FrameReadback::init(VulkanEngine* engine, VkFormat format, VkExtent2D extent) {
+    m_engine = engine;
+    m_extent = extent;
+
+    switch (format) {
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            m_swizzle = true;
+            m_supported = true;
+            break;
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            m_supported = true;
+            break;
+        default:
+            break;
+    }
+
+    if (!m_supported) {
+        std::cerr << std::format("Frames in {} cannot be read back, screenshots and recordings are disabled",
+                                 string_VkFormat(format)) << std::endl;
+        return;
+    }
+
+    const VkDeviceSize frameSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+    for (Slot& slot: m_slots) {
+        slot.buffer = engine->createBuffer(frameSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+    }
+
+    m_writer = std::jthread([this](const std::stop_token& stopToken) { writeLoop(stopToken); });
+
+    engine->getMainDeletionQueue().push_function([this] {
+        // the device is idle by now, every copy still in the ring is complete and gets written
+        update(UINT64_MAX);
+        if (m_recording) {
+            stopRecording();
+        }
+
+        m_writer.request_stop();
+        m_writer.join();
+
+        for (const Slot& slot: m_slots) {
+            m_engine->destroyBuffer(slot.buffer);
+        }
+    });
+}
+
+void FrameReadback::requestScreenshot(const std::filesystem::path& path) {
+    m_screenshotPath = path;
+}
+
+void FrameReadback::startRecording(const std::filesystem::path& path) {
+    if (!m_supported) {
+        return;
+    }
+    if (m_recording) {
+        stopRecording();
+    }
+
+    // opened by the writer along with the first frame, so it never sees frames of an earlier recording
+    m_videoStartPath = path;
+    m_recording = true;
+
+    std::cout << std::format("Recording to {}, encode it with: ffmpeg -f rawvideo -pixel_format {} "
+                             "-video_size {}x{} -framerate 60 -i {} output.mp4",
+                             path.string(), m_swizzle ? "bgra" : "rgba", m_extent.width, m_extent.height,
+                             path.string()) << std::endl;
+}
+
+void FrameReadback::stopRecording() {
+    if (!m_recording) {
+        return;
+    }
+    m_recording = false;
+
+    // nothing was copied yet, there is no file to close
+    if (!m_videoStartPath.empty()) {
+        m_videoStartPath.clear();
+        return;
+    }
+
+    // the last frame closes the file once it is written, or it already went to the writer
+    Slot* lastVideoSlot = m_lastVideoSlot < READBACK_RING_SIZE ? &m_slots[m_lastVideoSlot] : nullptr;
+    if (lastVideoSlot != nullptr && lastVideoSlot->state.load(std::memory_order_acquire) == SlotState::Copying) {
+        lastVideoSlot->videoEnd = true;
+    } else {
+        submit(READBACK_END_VIDEO);
+    }
+}
+
+FrameReadbackStats FrameReadback::getStats() const {
+    return FrameReadbackStats{
+        .written = m_written.load(std::memory_order_relaxed),
+        .dropped = m_dropped,
+    };
+}
+
+void FrameReadback::update(uint64_t frameNumber) {
+    // a frame slot is waited on FRAME_OVERLAP frames after it was submitted
+    std::array<uint32_t, READBACK_RING_SIZE> finished{};
+    uint32_t finishedCount = 0;
+    for (uint32_t i = 0; i < READBACK_RING_SIZE; i++) {
+        const Slot& slot = m_slots[i];
+        if (slot.state.load(std::memory_order_acquire) == SlotState::Copying &&
+            (frameNumber == UINT64_MAX || slot.frameNumber + FRAME_OVERLAP <= frameNumber)) {
+            finished[finishedCount++] = i;
+        }
+    }
+
+    // a recording has to reach the writer in frame order
+    std::sort(finished.begin(), finished.begin() + finishedCount, [&](uint32_t a, uint32_t b) {
+        return m_slots[a].frameNumber < m_slots[b].frameNumber;
+    });
+
+    for (uint32_t i = 0; i < finishedCount; i++) {
+        Slot& slot = m_slots[finished[i]];
+        VK_CHECK(vmaInvalidateAllocation(m_engine->getAllocator(), slot.buffer.allocation, 0, VK_WHOLE_SIZE));
+        slot.state.store(SlotState::Writing, std::memory_order_release);
+        submit(finished[i]);
+    }
+}
+
+void FrameReadback::copy(VkCommandBuffer cmd, VkImage image, uint64_t frameNumber) {
+    const auto freeSlot = std::ranges::find_if(m_slots, [](const Slot& slot) {
+        return slot.state.load(std::memory_order_acquire) == SlotState::Free;
+    });
+    if (freeSlot == m_slots.end()) {
+        // a screenshot is simply taken a frame later, a recording loses the frame
+        if (m_recording) {
+            m_dropped++;
+        }
+        return;
+    }
+
+    Slot& slot = *freeSlot;
+    slot.frameNumber = frameNumber;
+    slot.video = m_recording;
+    slot.videoStartPath = m_recording ? std::exchange(m_videoStartPath, {}) : std::filesystem::path{};
+    slot.videoEnd = false;
+    slot.screenshotPath = std::exchange(m_screenshotPath, {});
+    slot.state.store(SlotState::Copying, std::memory_order_relaxed);
+    if (m_recording) {
+        m_lastVideoSlot = static_cast<uint32_t>(freeSlot - m_slots.begin());
+    }
+
+    const VkBufferImageCopy region{
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {m_extent.width, m_extent.height, 1},
+    };
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer.buffer, 1, &region);
+
+    // read by the writer once this frame slot comes around again
+    VkUtils::memoryBarrier(cmd, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+}
+
+void FrameReadback::submit(uint32_t slot) {
+    {
+        const std::lock_guard lock(m_queueMutex);
+        m_queue.push_back(slot);
+    }
+    m_queueCondition.notify_one();
+}
+
+void FrameReadback::writeLoop(const std::stop_token& stopToken) {
+    std::ofstream video;
+
+    while (true) {
+        uint32_t index;
+        {
+            std::unique_lock lock(m_queueMutex);
+            // keeps draining after a stop request, so the last frames of a session are not lost
+            if (!m_queueCondition.wait(lock, stopToken, [&] { return !m_queue.empty(); })) {
+                return;
+            }
+            index = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        if (index == READBACK_END_VIDEO) {
+            video.close();
+            continue;
+        }
+
+        Slot& slot = m_slots[index];
+
+        if (!slot.videoStartPath.empty()) {
+            video.close();
+            video.open(slot.videoStartPath, std::ios::binary);
+            if (!video.is_open()) {
+                std::cerr << std::format("Failed to open {} for recording", slot.videoStartPath.string()) << std::endl;
+            }
+        }
+
+        if (slot.video && video.is_open()) {
+            video.write(static_cast<const char*>(slot.buffer.info.pMappedData),
+                        static_cast<std::streamsize>(static_cast<size_t>(m_extent.width) * m_extent.height * 4));
+        }
+
+        if (!slot.screenshotPath.empty()) {
+            writeScreenshot(slot, slot.screenshotPath);
+        }
+
+        if (slot.videoEnd) {
+            video.close();
+        }
+
+        m_written.fetch_add(1, std::memory_order_relaxed);
+        slot.state.store(SlotState::Free, std::memory_order_release);
+    }
+}
+
+void FrameReadback::writeScreenshot(const Slot& slot, const std::filesystem::path& path) const {
+    const size_t pixelCount = static_cast<size_t>(m_extent.width) * m_extent.height;
+    const auto* source = static_cast<const uint8_t*>(slot.buffer.info.pMappedData);
+
+    // presented alpha is meaningless, the PNG is written opaque
+    std::vector<uint8_t> pixels(pixelCount * 4);
+    for (size_t i = 0; i < pixelCount; i++) {
+        pixels[i * 4 + 0] = source[i * 4 + (m_swizzle ? 2 : 0)];
+        pixels[i * 4 + 1] = source[i * 4 + 1];
+        pixels[i * 4 + 2] = source[i * 4 + (m_swizzle ? 0 : 2)];
+        pixels[i * 4 + 3] = 255;
+    }
+
+    if (stbi_write_png(path.string().c_str(), static_cast<int>(m_extent.width), static_cast<int>(m_extent.height),
+                       4, pixels.data(), static_cast<int>(m_extent.width * 4)) == 0) {
+        std::cerr << std::format("Failed to write the screenshot {}", path.string()) << std::endl;
+        return;
+    }
+
+    std::cout << std::format("Screenshot saved to {}", path.string()) << std::endl;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+#include "VkTypes.hpp"
+
+class VulkanEngine;
+
+// copies a frame can have in flight or queued for writing before further frames are dropped
+constexpr uint32_t READBACK_RING_SIZE = 4;
+
+struct FrameReadbackStats {
+    uint64_t written = 0;
+    // frames a recording skipped because every ring slot was still busy
+    uint64_t dropped = 0;
+};
+
+// copies presented frames into a ring of host visible buffers. A copy is picked up once the frame slot that
+// recorded it has been waited on, and a writer thread turns it into a PNG or appends it to a raw video,
+// so neither the render loop nor the GPU ever waits for a capture
+class FrameReadback {
+public:
+    // only 8 bit RGBA and BGRA images can be read back, isSupported is false otherwise
+    void init(VulkanEngine* engine, VkFormat format, VkExtent2D extent);
+
+    // the next frame is written as a PNG
+    void requestScreenshot(const std::filesystem::path& path);
+    // appends every frame to a headerless file, see the console for the ffmpeg settings to encode it
+    void startRecording(const std::filesystem::path& path);
+    void stopRecording();
+
+    [[nodiscard]] bool isSupported() const { return m_supported; }
+    [[nodiscard]] bool isRecording() const { return m_recording; }
+    // true when the frame being recorded should be copied
+    [[nodiscard]] bool wantsFrame() const { return m_supported && (m_recording || !m_screenshotPath.empty()); }
+    [[nodiscard]] FrameReadbackStats getStats() const;
+
+    // hands the copies of frames that finished to the writer. frameNumber is the frame about to be recorded,
+    // after its frame slot's fence has been waited on
+    void update(uint64_t frameNumber);
+
+    // copies the image, which must be in the transfer source layout, into a free ring slot
+    void copy(VkCommandBuffer cmd, VkImage image, uint64_t frameNumber);
+
+private:
+    enum class SlotState : uint8_t {
+        Free,
+        // the copy is recorded, the GPU may still be running it
+        Copying,
+        // owned by the writer thread until it sets the slot free again
+        Writing,
+    };
+
+    // the fields besides state belong to the writer while the slot is Writing
+    struct Slot {
+        AllocatedBuffer buffer{};
+        std::atomic<SlotState> state{SlotState::Free};
+        uint64_t frameNumber = 0;
+        bool video = false;
+        // the first frame of a recording opens its file, the last one closes it
+        std::filesystem::path videoStartPath;
+        bool videoEnd = false;
+        std::filesystem::path screenshotPath;
+    };
+
+    // a ring slot index, or READBACK_RING_SIZE to close the recording
+    void submit(uint32_t slot);
+    void writeLoop(const std::stop_token& stopToken);
+    void writeScreenshot(const Slot& slot, const std::filesystem::path& path) const;
+
+    VulkanEngine* m_engine = nullptr;
+    bool m_supported = false;
+    VkExtent2D m_extent{};
+    // PNG wants RGBA, the usual swapChain formats are BGRA
+    bool m_swizzle = false;
+
+    std::array<Slot, READBACK_RING_SIZE> m_slots;
+
+    std::filesystem::path m_screenshotPath;
+    bool m_recording = false;
+    std::filesystem::path m_videoStartPath;
+    uint32_t m_lastVideoSlot = READBACK_RING_SIZE;
+
+    std::mutex m_queueMutex;
+    std::condition_variable_any m_queueCondition;
+    std::deque<uint32_t> m_queue;
+    std::jthread m_writer;
+
+    std::atomic<uint64_t> m_written{0};
+    uint64_t m_dropped = 0;
+};
@@ -0,0 +1,188 @@
+#include "VkGpuProfiler.hpp"
+
+#include <array>
+
+#include "VkEngine.hpp"
+
+// weight of the newest sample in the smoothed timings
+constexpr double TIMER_SMOOTHING = 0.1;
+
+// results are written in bit order, which is the field order of GpuPassStatistics
+constexpr VkQueryPipelineStatisticFlags PASS_STATISTICS =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+constexpr uint32_t PASS_STATISTIC_COUNT = 6;
+
+void GpuProfiler::init(VulkanEngine* engine) {
+    m_engine = engine;
+    m_device = engine->getContext()->getDevice();
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(engine->getContext()->getPhysicalDevice(), &properties);
+
+    m_supported = properties.limits.timestampComputeAndGraphics;
+    m_timestampPeriod = properties.limits.timestampPeriod;
+
+    if (!m_supported) {
+        std::cerr << "GPU timestamps are not supported, pass timings are disabled" << std::endl;
+        return;
+    }
+
+    const VkQueryPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .pNext = nullptr,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = MAX_GPU_TIMER_SCOPES * 2,
+    };
+
+    const VkQueryPoolCreateInfo statisticsPoolInfo{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .pNext = nullptr,
+        .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+        .queryCount = MAX_GPU_TIMER_SCOPES,
+        .pipelineStatistics = PASS_STATISTICS,
+    };
+    m_statisticsPools = engine->getContext()->getCapabilities().pipelineStatistics;
+
+    for (auto& frame: m_frames) {
+        VK_CHECK(vkCreateQueryPool(m_device, &poolInfo, nullptr, &frame.queryPool));
+        if (m_statisticsPools) {
+            VK_CHECK(vkCreateQueryPool(m_device, &statisticsPoolInfo, nullptr, &frame.statisticsPool));
+        }
+        frame.scopes.reserve(MAX_GPU_TIMER_SCOPES);
+    }
+
+    engine->getMainDeletionQueue().push_function([this] {
+        for (const auto& frame: m_frames) {
+            vkDestroyQueryPool(m_device, frame.queryPool, nullptr);
+            if (frame.statisticsPool != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(m_device, frame.statisticsPool, nullptr);
+            }
+        }
+    });
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer cmd, uint32_t frameIndex) {
+    m_currentFrame = frameIndex;
+    m_activeStatisticsScope = MAX_GPU_TIMER_SCOPES;
+
+    if (!m_supported) {
+        return;
+    }
+
+    FrameQueries& frame = m_frames[frameIndex];
+    if (frame.hasResults) {
+        collect(frame);
+    }
+
+    frame.scopes.clear();
+    frame.hasResults = false;
+    frame.statistics = statisticsEnabled && m_statisticsPools;
+    vkCmdResetQueryPool(cmd, frame.queryPool, 0, MAX_GPU_TIMER_SCOPES * 2);
+    if (frame.statistics) {
+        vkCmdResetQueryPool(cmd, frame.statisticsPool, 0, MAX_GPU_TIMER_SCOPES);
+    }
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer cmd, const char* name) {
+    FrameQueries& frame = m_frames[m_currentFrame];
+    if (!m_supported || frame.scopes.size() >= MAX_GPU_TIMER_SCOPES) {
+        return MAX_GPU_TIMER_SCOPES;
+    }
+
+    const auto scope = static_cast<uint32_t>(frame.scopes.size());
+    const FrameCounters& counters = m_engine->getFrameCounters();
+    const bool statistics = frame.statistics && m_activeStatisticsScope == MAX_GPU_TIMER_SCOPES;
+    frame.scopes.push_back(ScopeRecord{name, counters.draws, counters.dispatches, statistics});
+    frame.hasResults = true;
+
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frame.queryPool, scope * 2);
+    if (statistics) {
+        vkCmdBeginQuery(cmd, frame.statisticsPool, scope, 0);
+        m_activeStatisticsScope = scope;
+    }
+
+    return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer cmd, uint32_t scope) {
+    if (scope >= MAX_GPU_TIMER_SCOPES) {
+        return;
+    }
+
+    FrameQueries& frame = m_frames[m_currentFrame];
+    ScopeRecord& record = frame.scopes[scope];
+    const FrameCounters& counters = m_engine->getFrameCounters();
+    record.draws = counters.draws - record.draws;
+    record.dispatches = counters.dispatches - record.dispatches;
+
+    if (record.statistics) {
+        vkCmdEndQuery(cmd, frame.statisticsPool, scope);
+        m_activeStatisticsScope = MAX_GPU_TIMER_SCOPES;
+    }
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frame.queryPool, scope * 2 + 1);
+}
+
+double GpuProfiler::getMilliseconds(const std::string& name) const {
+    const auto it = m_resultIndices.find(name);
+    return it != m_resultIndices.end() ? m_results[it->second].milliseconds : 0.0;
+}
+
+void GpuProfiler::collect(FrameQueries& frame) {
+    const auto scopeCount = static_cast<uint32_t>(frame.scopes.size());
+    const uint32_t queryCount = scopeCount * 2;
+    if (queryCount == 0) {
+        return;
+    }
+
+    std::array<uint64_t, MAX_GPU_TIMER_SCOPES * 2> timestamps{};
+
+    // the frame fence has already been waited on, so every query of this slot is available
+    const VkResult result = vkGetQueryPoolResults(m_device, frame.queryPool, 0, queryCount,
+                                                  queryCount * sizeof(uint64_t), timestamps.data(),
+                                                  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        return;
+    }
+
+    // scopes nested in another one never began their statistics query, WITH_AVAILABILITY leaves a zero
+    // behind their counters instead of failing the whole read
+    std::array<uint64_t, MAX_GPU_TIMER_SCOPES * (PASS_STATISTIC_COUNT + 1)> statistics{};
+    const bool hasStatistics = frame.statistics &&
+            vkGetQueryPoolResults(m_device, frame.statisticsPool, 0, scopeCount,
+                                  scopeCount * (PASS_STATISTIC_COUNT + 1) * sizeof(uint64_t), statistics.data(),
+                                  (PASS_STATISTIC_COUNT + 1) * sizeof(uint64_t),
+                                  VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) >= VK_SUCCESS;
+
+    for (size_t scope = 0; scope < scopeCount; scope++) {
+        const ScopeRecord& record = frame.scopes[scope];
+        const uint64_t ticks = timestamps[scope * 2 + 1] - timestamps[scope * 2];
+        const double milliseconds = static_cast<double>(ticks) * m_timestampPeriod / 1000000.0;
+
+        const auto [it, inserted] = m_resultIndices.try_emplace(record.name, m_results.size());
+        if (inserted) {
+            m_results.push_back(GpuTimerResult{record.name, milliseconds});
+        } else {
+            double& smoothed = m_results[it->second].milliseconds;
+            smoothed += (milliseconds - smoothed) * TIMER_SMOOTHING;
+        }
+
+        GpuPassStatistics& passStatistics = m_results[it->second].statistics;
+        passStatistics.draws = record.draws;
+        passStatistics.dispatches = record.dispatches;
+
+        const uint64_t* values = &statistics[scope * (PASS_STATISTIC_COUNT + 1)];
+        if (hasStatistics && record.statistics && values[PASS_STATISTIC_COUNT] != 0) {
+            passStatistics.inputPrimitives = values[0];
+            passStatistics.vertexInvocations = values[1];
+            passStatistics.clippingInvocations = values[2];
+            passStatistics.clippingPrimitives = values[3];
+            passStatistics.fragmentInvocations = values[4];
+            passStatistics.computeInvocations = values[5];
+        }
+    }
+}
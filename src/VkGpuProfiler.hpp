@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "VkTypes.hpp"
+
+class VulkanEngine;
+
+constexpr uint32_t MAX_GPU_TIMER_SCOPES = 32;
+
+// what a scope asked of the pipeline, the counters of the latest frame that recorded them
+struct GpuPassStatistics {
+    uint64_t inputPrimitives = 0;
+    uint64_t vertexInvocations = 0;
+    // primitives entering and leaving the clipper, the difference was culled or clipped away
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentInvocations = 0;
+    uint64_t computeInvocations = 0;
+    // recorded commands, an indirect draw or dispatch counts once
+    uint32_t draws = 0;
+    uint32_t dispatches = 0;
+};
+
+struct GpuTimerResult {
+    std::string name;
+    // exponentially smoothed duration
+    double milliseconds;
+    GpuPassStatistics statistics;
+};
+
+// timestamp queries around render passes. Results are read back when a frame slot is reused,
+// after its fence has been waited on, so reading them never stalls the render loop.
+// Pipeline statistics queries can be wrapped around the same scopes where the device supports them
+class GpuProfiler {
+public:
+    void init(VulkanEngine* engine);
+
+    // collects the results of the previous use of this frame slot and resets its queries
+    void beginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+
+    // returns a scope id to hand to endScope, names must outlive the frame (string literals)
+    uint32_t beginScope(VkCommandBuffer cmd, const char* name);
+    void endScope(VkCommandBuffer cmd, uint32_t scope);
+
+    [[nodiscard]] const std::vector<GpuTimerResult>& getResults() const { return m_results; }
+    [[nodiscard]] double getMilliseconds(const std::string& name) const;
+    [[nodiscard]] bool isSupported() const { return m_supported; }
+    [[nodiscard]] bool isStatisticsSupported() const { return m_statisticsPools; }
+
+    // takes effect from the next frame, statistics queries are not free on every driver
+    bool statisticsEnabled = false;
+
+private:
+    struct ScopeRecord {
+        const char* name;
+        // frame counters when the scope began, replaced by the scope's own counts when it ends
+        uint32_t draws;
+        uint32_t dispatches;
+        bool statistics;
+    };
+
+    struct FrameQueries {
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+        VkQueryPool statisticsPool = VK_NULL_HANDLE;
+        std::vector<ScopeRecord> scopes;
+        bool hasResults = false;
+        bool statistics = false;
+    };
+
+    void collect(FrameQueries& frame);
+
+    VulkanEngine* m_engine = nullptr;
+    VkDevice m_device = VK_NULL_HANDLE;
+    bool m_supported = false;
+    bool m_statisticsPools = false;
+    // nanoseconds per timestamp tick
+    double m_timestampPeriod = 1.0;
+
+    FrameQueries m_frames[FRAME_OVERLAP];
+    uint32_t m_currentFrame = 0;
+    // only one statistics query may be active at a time, nested scopes are timed only
+    uint32_t m_activeStatisticsScope = MAX_GPU_TIMER_SCOPES;
+
+    std::vector<GpuTimerResult> m_results;
+    std::unordered_map<std::string, size_t> m_resultIndices;
+};
@@ -0,0 +1,164 @@
+#include "VkGpuScene.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "VkEngine.hpp"
+#include "VkSync.hpp"
+
+void GpuScene::init(VulkanEngine* engine) {
+    m_engine = engine;
+
+    m_objects.reserve(MAX_SCENE_OBJECTS);
+    m_dirty.reserve(MAX_SCENE_OBJECTS);
+
+    m_objectBuffer = engine->createBuffer(MAX_SCENE_OBJECTS * sizeof(GPUObjectData),
+                                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                          VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                          VMA_MEMORY_USAGE_GPU_ONLY);
+
+    m_stagingRing = engine->createBuffer(SCENE_STAGING_RING_SIZE,
+                                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                         VMA_MEMORY_USAGE_CPU_ONLY);
+
+    engine->getMainDeletionQueue().push_function([this] {
+        m_engine->destroyBuffer(m_stagingRing);
+        m_engine->destroyBuffer(m_objectBuffer);
+    });
+}
+
+uint32_t GpuScene::addObject(const glm::mat4& transform, const glm::vec4& boundingSphere, uint32_t materialIndex) {
+    if (m_objects.size() >= MAX_SCENE_OBJECTS) {
+        std::cerr << "GPU scene is full, the object is dropped" << std::endl;
+        return 0;
+    }
+
+    const auto objectId = static_cast<uint32_t>(m_objects.size());
+
+    m_objects.push_back(GPUObjectData{
+        .transform = transform,
+        .boundingSphere = boundingSphere,
+        .materialIndex = materialIndex,
+    });
+    m_dirty.push_back(0);
+    markDirty(objectId);
+
+    return objectId;
+}
+
+void GpuScene::setTransform(uint32_t objectId, const glm::mat4& transform) {
+    m_objects[objectId].transform = transform;
+    markDirty(objectId);
+}
+
+void GpuScene::setMaterial(uint32_t objectId, uint32_t materialIndex) {
+    m_objects[objectId].materialIndex = materialIndex;
+    markDirty(objectId);
+}
+
+void GpuScene::markDirty(uint32_t objectId) {
+    m_dirty[objectId] = 1;
+    m_dirtyBegin = std::min(m_dirtyBegin, objectId);
+    m_dirtyEnd = std::max(m_dirtyEnd, objectId + 1);
+}
+
+bool GpuScene::allocateStaging(uint64_t size, uint64_t& outOffset) {
+    uint64_t start = m_ringHead;
+
+    // ranges never wrap, skip the rest of the ring instead
+    const uint64_t ringOffset = start % SCENE_STAGING_RING_SIZE;
+    if (ringOffset + size > SCENE_STAGING_RING_SIZE) {
+        start += SCENE_STAGING_RING_SIZE - ringOffset;
+    }
+
+    if (start + size - m_ringTail > SCENE_STAGING_RING_SIZE) {
+        return false;
+    }
+
+    m_ringHead = start + size;
+    outOffset = start % SCENE_STAGING_RING_SIZE;
+    return true;
+}
+
+void GpuScene::upload(VkCommandBuffer cmd, uint32_t frameIndex) {
+    // everything this slot staged last time has been consumed, as have all older frames
+    m_ringTail = std::max(m_ringTail, m_frameRingEnd[frameIndex]);
+
+    m_stats = {};
+    m_copies.clear();
+
+    const uint32_t scanBegin = m_dirtyBegin;
+    const uint32_t scanEnd = m_dirtyEnd;
+    m_dirtyBegin = UINT32_MAX;
+    m_dirtyEnd = 0;
+
+    auto* ring = static_cast<uint8_t*>(m_stagingRing.info.pMappedData);
+
+    uint32_t objectId = scanBegin;
+    while (objectId < scanEnd) {
+        if (!m_dirty[objectId]) {
+            objectId++;
+            continue;
+        }
+
+        // grow the run over dirty objects and small clean gaps
+        const uint32_t runBegin = objectId;
+        uint32_t runEnd = objectId + 1;
+        uint32_t cursor = runEnd;
+        while (cursor < scanEnd && cursor - runEnd <= SCENE_COPY_MERGE_GAP) {
+            if (m_dirty[cursor]) {
+                runEnd = cursor + 1;
+            }
+            cursor++;
+        }
+
+        const uint32_t runCount = runEnd - runBegin;
+        const uint64_t runSize = runCount * sizeof(GPUObjectData);
+
+        uint64_t stagingOffset = 0;
+        if (allocateStaging(runSize, stagingOffset)) {
+            memcpy(ring + stagingOffset, &m_objects[runBegin], runSize);
+
+            m_copies.push_back(VkBufferCopy{
+                .srcOffset = stagingOffset,
+                .dstOffset = runBegin * sizeof(GPUObjectData),
+                .size = runSize,
+            });
+
+            std::fill(m_dirty.begin() + runBegin, m_dirty.begin() + runEnd, 0);
+            m_stats.uploadedObjects += runCount;
+            m_engine->getFrameCounters().uploadBytes += runSize;
+        } else {
+            // keep the run dirty and retry next frame
+            m_dirtyBegin = std::min(m_dirtyBegin, runBegin);
+            m_dirtyEnd = std::max(m_dirtyEnd, runEnd);
+            m_stats.deferredObjects += runCount;
+        }
+
+        objectId = runEnd;
+    }
+
+    m_frameRingEnd[frameIndex] = m_ringHead;
+
+    if (m_copies.empty()) {
+        return;
+    }
+
+    m_stats.copyRegions = static_cast<uint32_t>(m_copies.size());
+
+    // the previous frame may still read the ranges that are about to be overwritten
+    VkUtils::memoryBarrier(cmd,
+                           VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_2_NONE,
+                           VK_PIPELINE_STAGE_2_COPY_BIT,
+                           VK_ACCESS_2_TRANSFER_WRITE_BIT);
+
+    vkCmdCopyBuffer(cmd, m_stagingRing.buffer, m_objectBuffer.buffer,
+                    static_cast<uint32_t>(m_copies.size()), m_copies.data());
+
+    VkUtils::memoryBarrier(cmd,
+                           VK_PIPELINE_STAGE_2_COPY_BIT,
+                           VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+}
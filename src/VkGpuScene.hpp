@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "VkTypes.hpp"
+
+class VulkanEngine;
+
+constexpr uint32_t MAX_SCENE_OBJECTS = 16384;
+// shared by every frame in flight, large enough to re-send the whole scene a few times over
+constexpr uint64_t SCENE_STAGING_RING_SIZE = 4 * MAX_SCENE_OBJECTS * sizeof(GPUObjectData);
+// clean objects between two dirty runs are re-sent if that saves a copy region
+constexpr uint32_t SCENE_COPY_MERGE_GAP = 4;
+
+struct GpuSceneStats {
+    uint32_t uploadedObjects = 0;
+    uint32_t copyRegions = 0;
+    // dirty objects that did not fit into the staging ring this frame
+    uint32_t deferredObjects = 0;
+};
+
+// persistent device local copy of every object's transform, bounds and material.
+// Changes only mark their object dirty, once per frame the dirty objects are coalesced into
+// contiguous ranges and copied through a staging ring shared by the frames in flight
+class GpuScene {
+public:
+    void init(VulkanEngine* engine);
+
+    uint32_t addObject(const glm::mat4& transform, const glm::vec4& boundingSphere, uint32_t materialIndex);
+
+    void setTransform(uint32_t objectId, const glm::mat4& transform);
+    void setMaterial(uint32_t objectId, uint32_t materialIndex);
+
+    // records the copies of all dirty ranges, the fence of this frame slot must have been waited on
+    void upload(VkCommandBuffer cmd, uint32_t frameIndex);
+
+    [[nodiscard]] const AllocatedBuffer& getObjectBuffer() const { return m_objectBuffer; }
+    [[nodiscard]] uint32_t getObjectCount() const { return static_cast<uint32_t>(m_objects.size()); }
+    [[nodiscard]] const GpuSceneStats& getStats() const { return m_stats; }
+
+private:
+    void markDirty(uint32_t objectId);
+
+    // reserves size bytes of the ring, fails if that would overwrite data a frame in flight still reads
+    bool allocateStaging(uint64_t size, uint64_t& outOffset);
+
+    VulkanEngine* m_engine = nullptr;
+
+    std::vector<GPUObjectData> m_objects;
+    std::vector<uint8_t> m_dirty;
+    // bounds of the dirty flags, so clean frames skip the scan
+    uint32_t m_dirtyBegin = UINT32_MAX;
+    uint32_t m_dirtyEnd = 0;
+
+    AllocatedBuffer m_objectBuffer{};
+    AllocatedBuffer m_stagingRing{};
+
+    // monotonic byte positions, the ring offset is position % SCENE_STAGING_RING_SIZE
+    uint64_t m_ringHead = 0;
+    uint64_t m_ringTail = 0;
+    uint64_t m_frameRingEnd[FRAME_OVERLAP]{};
+
+    std::vector<VkBufferCopy> m_copies;
+    GpuSceneStats m_stats;
+};
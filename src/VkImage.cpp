@@ -10,6 +10,37 @@ namespace VkUtils {
         const VkImageAspectFlags aspectMask = newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL
                                                   ? VK_IMAGE_ASPECT_DEPTH_BIT
                                                   : VK_IMAGE_ASPECT_COLOR_BIT;
+
+        transitionImageLayers(cmd, image, currentLayout, newLayout, aspectMask, 0, 1);
+    }
+
+    void transitionImageLayers(
+        const VkCommandBuffer cmd,
+        const VkImage image,
+        const VkImageLayout currentLayout,
+        const VkImageLayout newLayout,
+        const VkImageAspectFlags aspectMask,
+        const uint32_t baseArrayLayer,
+        const uint32_t layerCount
+    ) {
+        const VkImageSubresourceRange range{
+            .aspectMask = aspectMask,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = baseArrayLayer,
+            .layerCount = layerCount
+        };
+
+        transitionImageRange(cmd, image, currentLayout, newLayout, range);
+    }
+
+    void transitionImageRange(
+        const VkCommandBuffer cmd,
+        const VkImage image,
+        const VkImageLayout currentLayout,
+        const VkImageLayout newLayout,
+        const VkImageSubresourceRange& range
+    ) {
         VkImageMemoryBarrier2 imageBarrier{
             .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
             .pNext = nullptr,
@@ -20,13 +51,7 @@ namespace VkUtils {
             .oldLayout = currentLayout,
             .newLayout = newLayout,
             .image = image,
-            .subresourceRange = {
-                .aspectMask = aspectMask,
-                .baseMipLevel = 0,
-                .levelCount = 1,
-                .baseArrayLayer = 0,
-                .layerCount = 1
-            }
+            .subresourceRange = range
         };
 
 
@@ -10,6 +10,26 @@ namespace VkUtils {
         VkImageLayout newLayout
     );
 
+    // transition a range of array layers, used for layered targets such as shadow cascades
+    void transitionImageLayers(
+        VkCommandBuffer cmd,
+        VkImage image,
+        VkImageLayout currentLayout,
+        VkImageLayout newLayout,
+        VkImageAspectFlags aspectMask,
+        uint32_t baseArrayLayer,
+        uint32_t layerCount
+    );
+
+    // transition an arbitrary range of mips and layers
+    void transitionImageRange(
+        VkCommandBuffer cmd,
+        VkImage image,
+        VkImageLayout currentLayout,
+        VkImageLayout newLayout,
+        const VkImageSubresourceRange& range
+    );
+
     void copyImageToImage(
         VkCommandBuffer cmd,
         VkImage source,
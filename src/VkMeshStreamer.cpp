@@ -0,0 +1,363 @@
+#include "VkMeshStreamer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "VkEngine.hpp"
+#include "VkSync.hpp"
+
+void MeshStreamer::init(VulkanEngine* engine, JobSystem* jobSystem, uint64_t budgetBytes) {
+    m_engine = engine;
+    m_jobSystem = jobSystem;
+    m_budgetBytes = budgetBytes;
+
+    engine->getMainDeletionQueue().push_function([this] {
+        // a read still running would write into a freed load
+        for (const auto& load: m_loads) {
+            m_jobSystem->wait(load->counter);
+        }
+        m_loads.clear();
+
+        for (const PendingCopy& copy: m_copies) {
+            m_engine->destroyBuffer(copy.staging);
+        }
+        m_copies.clear();
+
+        // the coarsest LOD belongs to its render object
+        for (StreamedMesh& mesh: m_meshes) {
+            for (size_t i = 0; i + 1 < mesh.lods.size(); i++) {
+                if (mesh.lods[i].resident) {
+                    m_engine->destroyBuffer(mesh.lods[i].buffers.indexBuffer);
+                    m_engine->destroyBuffer(mesh.lods[i].buffers.vertexBuffer);
+                }
+            }
+        }
+        m_meshes.clear();
+    });
+}
+
+bool MeshStreamer::addMesh(const std::filesystem::path& basePath, const glm::mat4& transform) {
+    StreamedMesh mesh;
+    for (uint32_t i = 0;; i++) {
+        std::filesystem::path path = basePath;
+        path += std::format(".lod{}.hmesh", i);
+
+        MeshLodHeader header;
+        if (!loadMeshLodHeader(path, header)) {
+            break;
+        }
+
+        Lod& lod = mesh.lods.emplace_back();
+        lod.path = std::move(path);
+        lod.sizeBytes = header.vertexCount * sizeof(Vertex) + header.indexCount * sizeof(uint32_t);
+        lod.indexCount = header.indexCount;
+    }
+
+    if (mesh.lods.empty()) {
+        std::cerr << std::format("No LOD files found for {}\n", basePath.string());
+        return false;
+    }
+
+    // the coarsest LOD is small, it is uploaded right away and never evicted
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    Lod& coarsest = mesh.lods.back();
+    if (!loadMeshLod(coarsest.path, vertices, indices)) {
+        std::cerr << std::format("Failed to read {}\n", coarsest.path.string());
+        return false;
+    }
+
+    coarsest.buffers = m_engine->uploadMesh(indices, vertices);
+    coarsest.resident = true;
+
+    mesh.renderObject = m_engine->addRenderObject(coarsest.buffers, coarsest.indexCount, transform);
+    mesh.wantedLod = static_cast<uint32_t>(mesh.lods.size() - 1);
+    mesh.drawnLod = mesh.wantedLod;
+
+    if (m_meshOfObject.size() <= mesh.renderObject) {
+        m_meshOfObject.resize(mesh.renderObject + 1, UINT32_MAX);
+    }
+    m_meshOfObject[mesh.renderObject] = static_cast<uint32_t>(m_meshes.size());
+
+    m_meshes.push_back(std::move(mesh));
+    return true;
+}
+
+bool MeshStreamer::update(
+    std::span<RenderObject> objects,
+    std::span<const uint32_t> drawList,
+    const glm::vec3& cameraPosition,
+    float projectionScale,
+    float viewportHeight
+) {
+    m_frame++;
+    bool changed = false;
+
+    // take in the loads that finished reading
+    std::erase_if(m_loads, [this](const std::unique_ptr<PendingLoad>& load) {
+        if (!load->counter.isDone()) {
+            return false;
+        }
+
+        Lod& lod = m_meshes[load->mesh].lods[load->lod];
+        lod.loading = false;
+        m_inFlightBytes -= lod.sizeBytes;
+
+        if (load->succeeded) {
+            makeResident(lod, load->vertices, load->indices);
+            m_stats.completedLoads++;
+        } else {
+            std::cerr << std::format("Failed to stream {}\n", lod.path.string());
+            m_stats.failedLoads++;
+        }
+        return true;
+    });
+
+    // visible meshes pick their LOD from the pixels they cover, which falls with the camera distance
+    m_requests.clear();
+    for (const uint32_t index: drawList) {
+        if (index >= m_meshOfObject.size() || m_meshOfObject[index] == UINT32_MAX) {
+            continue;
+        }
+
+        StreamedMesh& mesh = m_meshes[m_meshOfObject[index]];
+        RenderObject& object = objects[index];
+
+        const glm::vec3 center = glm::vec3(object.transform * glm::vec4(glm::vec3(object.boundingSphere), 1.f));
+        const float scale = std::max({glm::length(glm::vec3(object.transform[0])),
+                                      glm::length(glm::vec3(object.transform[1])),
+                                      glm::length(glm::vec3(object.transform[2]))});
+        const float radius = object.boundingSphere.w * scale;
+        const float distance = glm::length(center - cameraPosition);
+
+        const float pixels = distance > radius
+                                 ? radius / distance * projectionScale * viewportHeight
+                                 : std::numeric_limits<float>::max();
+
+        // a degenerate sphere covers no pixels and gets the coarsest LOD, the clamp happens before the cast
+        // because the ratio grows without bound
+        const auto coarsestLod = static_cast<uint32_t>(mesh.lods.size() - 1);
+        const float lodSteps = pixels > 0.f ? std::log2(STREAMING_LOD0_PIXELS / pixels) : static_cast<float>(coarsestLod);
+        mesh.wantedLod = pixels >= STREAMING_LOD0_PIXELS
+                             ? 0
+                             : static_cast<uint32_t>(std::min(lodSteps, static_cast<float>(coarsestLod)));
+
+        // draw the finest resident LOD that is not finer than wanted
+        uint32_t drawn = mesh.wantedLod;
+        while (!mesh.lods[drawn].resident) {
+            drawn++;
+        }
+        mesh.lods[drawn].lastUsedFrame = m_frame;
+
+        if (drawn != mesh.drawnLod) {
+            const Lod& lod = mesh.lods[drawn];
+            object.indexBuffer = lod.buffers.indexBuffer.buffer;
+            object.vertexBufferAddress = lod.buffers.vertexBufferAddress;
+            object.indexCount = lod.indexCount;
+            mesh.drawnLod = drawn;
+            changed = true;
+        }
+
+        // the more LODs are missing on a large mesh, the more the load improves the image
+        if (drawn > mesh.wantedLod && !mesh.lods[mesh.wantedLod].loading) {
+            const float missingLods = static_cast<float>(drawn - mesh.wantedLod);
+            m_requests.push_back({m_meshOfObject[index], mesh.wantedLod, std::min(pixels, 1e6f) * missingLods});
+        }
+    }
+
+    // the budget may have been lowered, LODs drawn this frame are only evicted once they are not
+    while (m_stats.residentBytes + m_inFlightBytes > m_budgetBytes) {
+        if (!evictOldest(objects, changed)) {
+            break;
+        }
+    }
+
+    std::ranges::sort(m_requests, [](const LoadRequest& a, const LoadRequest& b) { return a.priority > b.priority; });
+
+    for (const LoadRequest& request: m_requests) {
+        if (m_loads.size() >= STREAMING_MAX_LOADS_IN_FLIGHT) {
+            break;
+        }
+
+        Lod& lod = m_meshes[request.mesh].lods[request.lod];
+        if (m_stats.residentBytes + m_inFlightBytes + lod.sizeBytes > m_budgetBytes &&
+            !evictFor(lod.sizeBytes, objects, changed)) {
+            continue;
+        }
+
+        lod.loading = true;
+        m_inFlightBytes += lod.sizeBytes;
+
+        auto load = std::make_unique<PendingLoad>();
+        load->mesh = request.mesh;
+        load->lod = request.lod;
+        load->path = lod.path;
+
+        PendingLoad* pending = load.get();
+        m_jobSystem->run([pending] {
+            pending->succeeded = loadMeshLod(pending->path, pending->vertices, pending->indices);
+        }, &pending->counter);
+
+        m_loads.push_back(std::move(load));
+    }
+
+    m_stats.loadsInFlight = static_cast<uint32_t>(m_loads.size());
+    m_stats.pendingRequests = static_cast<uint32_t>(m_requests.size());
+    return changed;
+}
+
+void MeshStreamer::upload(VkCommandBuffer cmd) {
+    if (m_copies.empty()) {
+        return;
+    }
+
+    for (const PendingCopy& copy: m_copies) {
+        const VkBufferCopy vertexCopy{
+            .srcOffset = 0,
+            .dstOffset = 0,
+            .size = copy.vertexBytes,
+        };
+        vkCmdCopyBuffer(cmd, copy.staging.buffer, copy.vertexBuffer, 1, &vertexCopy);
+
+        const VkBufferCopy indexCopy{
+            .srcOffset = copy.vertexBytes,
+            .dstOffset = 0,
+            .size = copy.indexBytes,
+        };
+        vkCmdCopyBuffer(cmd, copy.staging.buffer, copy.indexBuffer, 1, &indexCopy);
+        m_engine->getFrameCounters().uploadBytes += copy.vertexBytes + copy.indexBytes;
+
+        // the staging buffer is read until this frame's commands finished
+        const AllocatedBuffer staging = copy.staging;
+        m_engine->getCurrentFrame().deletionQueue.push_function([this, staging] {
+            m_engine->destroyBuffer(staging);
+        });
+    }
+    m_copies.clear();
+
+    // vertices are pulled in the vertex shader of the geometry and shadow passes
+    VkUtils::memoryBarrier(cmd,
+                           VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+                           VK_ACCESS_2_INDEX_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+}
+
+void MeshStreamer::makeResident(Lod& lod, std::span<const Vertex> vertices, std::span<const uint32_t> indices) {
+    const uint64_t vertexBytes = vertices.size_bytes();
+    const uint64_t indexBytes = indices.size_bytes();
+
+    lod.buffers.vertexBuffer = m_engine->createBuffer(vertexBytes,
+                                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                      VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                      VMA_MEMORY_USAGE_GPU_ONLY);
+    lod.buffers.vertexBufferAddress = m_engine->getBufferAddress(lod.buffers.vertexBuffer);
+    lod.buffers.indexBuffer = m_engine->createBuffer(indexBytes,
+                                                     VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                                                     VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                     VMA_MEMORY_USAGE_GPU_ONLY);
+
+    const AllocatedBuffer staging = m_engine->createBuffer(vertexBytes + indexBytes,
+                                                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                           VMA_MEMORY_USAGE_CPU_ONLY);
+    auto* data = static_cast<std::byte*>(staging.info.pMappedData);
+    std::memcpy(data, vertices.data(), vertexBytes);
+    std::memcpy(data + vertexBytes, indices.data(), indexBytes);
+
+    m_copies.push_back(PendingCopy{
+        .staging = staging,
+        .vertexBuffer = lod.buffers.vertexBuffer.buffer,
+        .indexBuffer = lod.buffers.indexBuffer.buffer,
+        .vertexBytes = vertexBytes,
+        .indexBytes = indexBytes,
+    });
+
+    lod.resident = true;
+    m_stats.residentBytes += lod.sizeBytes;
+    m_stats.residentLods++;
+}
+
+bool MeshStreamer::evictFor(uint64_t size, std::span<RenderObject> objects, bool& outChanged) {
+    if (size > m_budgetBytes) {
+        return false;
+    }
+
+    // don't throw LODs away for a load that would not fit anyway
+    uint64_t evictableBytes = 0;
+    for (const StreamedMesh& mesh: m_meshes) {
+        for (uint32_t i = 0; i + 1 < mesh.lods.size(); i++) {
+            const Lod& lod = mesh.lods[i];
+            if (lod.resident && lod.lastUsedFrame < m_frame) {
+                evictableBytes += lod.sizeBytes;
+            }
+        }
+    }
+    if (m_stats.residentBytes + m_inFlightBytes + size > m_budgetBytes + evictableBytes) {
+        return false;
+    }
+
+    while (m_stats.residentBytes + m_inFlightBytes + size > m_budgetBytes) {
+        if (!evictOldest(objects, outChanged)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MeshStreamer::evictOldest(std::span<RenderObject> objects, bool& outChanged) {
+    // least recently drawn LOD that is not drawn this frame, the coarsest LODs are never evicted
+    StreamedMesh* victimMesh = nullptr;
+    uint32_t victimLod = 0;
+    uint64_t oldestFrame = m_frame;
+    for (StreamedMesh& mesh: m_meshes) {
+        for (uint32_t i = 0; i + 1 < mesh.lods.size(); i++) {
+            const Lod& lod = mesh.lods[i];
+            if (lod.resident && lod.lastUsedFrame < oldestFrame) {
+                victimMesh = &mesh;
+                victimLod = i;
+                oldestFrame = lod.lastUsedFrame;
+            }
+        }
+    }
+
+    if (victimMesh == nullptr) {
+        return false;
+    }
+
+    Lod& lod = victimMesh->lods[victimLod];
+
+    // frames in flight may still draw it
+    const GPUMeshBuffers buffers = lod.buffers;
+    m_engine->getCurrentFrame().deletionQueue.push_function([this, buffers] {
+        m_engine->destroyBuffer(buffers.indexBuffer);
+        m_engine->destroyBuffer(buffers.vertexBuffer);
+    });
+
+    lod.resident = false;
+    lod.buffers = {};
+    m_stats.residentBytes -= lod.sizeBytes;
+    m_stats.residentLods--;
+    m_stats.evictions++;
+
+    // a mesh culled this frame may still point at the evicted LOD
+    if (victimMesh->drawnLod == victimLod) {
+        uint32_t drawn = victimLod;
+        while (!victimMesh->lods[drawn].resident) {
+            drawn++;
+        }
+
+        RenderObject& object = objects[victimMesh->renderObject];
+        const Lod& fallback = victimMesh->lods[drawn];
+        object.indexBuffer = fallback.buffers.indexBuffer.buffer;
+        object.vertexBufferAddress = fallback.buffers.vertexBufferAddress;
+        object.indexCount = fallback.indexCount;
+        victimMesh->drawnLod = drawn;
+        outChanged = true;
+    }
+    return true;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "VkTypes.hpp"
+#include "JobSystem.hpp"
+#include "MeshLod.hpp"
+
+class VulkanEngine;
+
+constexpr uint64_t DEFAULT_STREAMING_BUDGET = 256ull << 20;
+// a mesh covering this many pixels wants its finest LOD, every halving drops one LOD
+constexpr float STREAMING_LOD0_PIXELS = 512.f;
+constexpr uint32_t STREAMING_MAX_LOADS_IN_FLIGHT = 8;
+
+struct MeshStreamerStats {
+    uint64_t residentBytes = 0;
+    uint32_t residentLods = 0;
+    uint32_t loadsInFlight = 0;
+    // LODs wanted this frame but not resident, whether or not a load was started for them
+    uint32_t pendingRequests = 0;
+    uint32_t completedLoads = 0;
+    uint32_t failedLoads = 0;
+    uint32_t evictions = 0;
+};
+
+// out-of-core meshes. Only the coarsest LOD of a mesh is resident at first, finer LODs are read from
+// disk on the job system when the mesh covers enough of the screen. Loads are started in order of
+// visual impact within a memory budget, LODs not drawn for the longest time are evicted to make room
+class MeshStreamer {
+public:
+    void init(VulkanEngine* engine, JobSystem* jobSystem, uint64_t budgetBytes = DEFAULT_STREAMING_BUDGET);
+
+    // streams <basePath>.lod0.hmesh, .lod1.hmesh... from the finest to the coarsest LOD, as baked by
+    // Hellfire-Bake. The coarsest is uploaded at once and stays resident
+    bool addMesh(const std::filesystem::path& basePath, const glm::mat4& transform);
+
+    // picks the wanted LOD of the visible meshes, starts loads, takes in the finished ones and points the
+    // render objects at their finest resident LOD. Returns true when any render object changed its mesh
+    bool update(std::span<RenderObject> objects, std::span<const uint32_t> drawList, const glm::vec3& cameraPosition,
+                float projectionScale, float viewportHeight);
+
+    // records the copies of the LODs taken in by update, the fence of this frame slot must have been waited on
+    void upload(VkCommandBuffer cmd);
+
+    // a lower budget is met on the next update by evicting LODs that are not drawn
+    void setBudget(uint64_t budgetBytes) { m_budgetBytes = budgetBytes; }
+    [[nodiscard]] uint64_t getBudget() const { return m_budgetBytes; }
+    [[nodiscard]] const MeshStreamerStats& getStats() const { return m_stats; }
+
+private:
+    struct Lod {
+        std::filesystem::path path;
+        uint64_t sizeBytes = 0;
+        uint32_t indexCount = 0;
+        GPUMeshBuffers buffers{};
+        bool resident = false;
+        bool loading = false;
+        uint64_t lastUsedFrame = 0;
+    };
+
+    struct StreamedMesh {
+        // finest first, the last one is always resident
+        std::vector<Lod> lods;
+        uint32_t renderObject = 0;
+        uint32_t wantedLod = 0;
+        uint32_t drawnLod = 0;
+    };
+
+    struct PendingLoad {
+        uint32_t mesh = 0;
+        uint32_t lod = 0;
+        std::filesystem::path path;
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        // written by the worker, read once the counter is done
+        bool succeeded = false;
+        JobCounter counter;
+    };
+
+    struct LoadRequest {
+        uint32_t mesh;
+        uint32_t lod;
+        float priority;
+    };
+
+    // creates the buffers and queues the copies for upload, the LOD is drawable from this frame on
+    void makeResident(Lod& lod, std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+    // frees the least recently drawn LODs that are not drawn this frame until size more bytes fit, render
+    // objects drawing an evicted LOD fall back to the next coarser resident one. Evicts nothing and
+    // returns false when even evicting every such LOD would not make room
+    bool evictFor(uint64_t size, std::span<RenderObject> objects, bool& outChanged);
+    // frees the least recently drawn LOD that is not drawn this frame, false when there is none
+    bool evictOldest(std::span<RenderObject> objects, bool& outChanged);
+
+    VulkanEngine* m_engine = nullptr;
+    JobSystem* m_jobSystem = nullptr;
+
+    std::vector<StreamedMesh> m_meshes;
+    std::vector<std::unique_ptr<PendingLoad>> m_loads;
+    std::vector<LoadRequest> m_requests;
+    // mesh index of every render object, UINT32_MAX for objects that are not streamed
+    std::vector<uint32_t> m_meshOfObject;
+
+    // the copies recorded by the next upload, staging buffers are freed with the frame
+    struct PendingCopy {
+        AllocatedBuffer staging;
+        VkBuffer vertexBuffer;
+        VkBuffer indexBuffer;
+        uint64_t vertexBytes;
+        uint64_t indexBytes;
+    };
+    std::vector<PendingCopy> m_copies;
+
+    uint64_t m_budgetBytes = DEFAULT_STREAMING_BUDGET;
+    uint64_t m_inFlightBytes = 0;
+    uint64_t m_frame = 0;
+    MeshStreamerStats m_stats;
+};
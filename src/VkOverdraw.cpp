@@ -0,0 +1,281 @@
+#include "VkOverdraw.hpp"
+
+#include "VkEngine.hpp"
+#include "VkImage.hpp"
+#include "VkPipeline.hpp"
+
+// half floats count exactly up to 2048 layers, far past any useful heatmap
+constexpr VkFormat OVERDRAW_COUNT_FORMAT = VK_FORMAT_R16_SFLOAT;
+// must match local_size in overdrawHeatmap.comp
+constexpr uint32_t OVERDRAW_GROUP_SIZE = 16;
+
+void OverdrawHeatmap::init(
+    VulkanEngine* engine,
+    VkDescriptorSetLayout sceneLayout,
+    const AllocatedImage& drawImage,
+    VkSampler sampler
+) {
+    m_engine = engine;
+    const VkDevice device = engine->getContext()->getDevice();
+
+    m_countImage.imageFormat = OVERDRAW_COUNT_FORMAT;
+    m_countImage.imageExtent = {drawImage.imageExtent.width, drawImage.imageExtent.height, 1};
+
+    const VkImageCreateInfo imageInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = nullptr,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = m_countImage.imageFormat,
+        .extent = m_countImage.imageExtent,
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+    };
+
+    constexpr VmaAllocationCreateInfo allocInfo = {
+        .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+        .requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+
+    VK_CHECK(vmaCreateImage(engine->getAllocator(), &imageInfo, &allocInfo,
+                            &m_countImage.image, &m_countImage.allocation, nullptr));
+
+    const VkImageViewCreateInfo viewInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = nullptr,
+        .image = m_countImage.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = m_countImage.imageFormat,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        }
+    };
+
+    VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &m_countImage.imageView));
+
+    VkShaderModule vertexShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/coloredTriangleMesh.vert.spv", device, &vertexShader)) {
+        std::cerr << "Error when building the overdraw vertex shader module" << std::endl;
+    }
+
+    VkShaderModule fragmentShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/overdraw.frag.spv", device, &fragmentShader)) {
+        std::cerr << "Error when building the overdraw fragment shader module" << std::endl;
+    }
+
+    const VkPushConstantRange drawPushConstant{
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(GPUDrawPushConstants),
+    };
+
+    const VkPipelineLayoutCreateInfo countLayoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .setLayoutCount = 1,
+        .pSetLayouts = &sceneLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &drawPushConstant,
+    };
+
+    VK_CHECK(vkCreatePipelineLayout(device, &countLayoutInfo, nullptr, &m_countLayout));
+
+    // culling and topology follow the geometry pass while recording, blending adds one per fragment
+    PipelineBuilder pipelineBuilder(engine->getContext());
+    pipelineBuilder.m_pipelineLayout = m_countLayout;
+    pipelineBuilder.setShaders(vertexShader, fragmentShader);
+    pipelineBuilder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    pipelineBuilder.setPolygonMode(VK_POLYGON_MODE_FILL);
+    pipelineBuilder.setCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+    pipelineBuilder.setMultiSamplingNone();
+    pipelineBuilder.enableBlendingAdditive();
+    pipelineBuilder.disableDepthTest();
+    pipelineBuilder.setColorAttachmentFormat(OVERDRAW_COUNT_FORMAT);
+    pipelineBuilder.setDepthFormat(VK_FORMAT_UNDEFINED);
+    pipelineBuilder.enableDynamicState(false);
+    pipelineBuilder.setCreateFlags(engine->getScenePipelineFlags());
+
+    m_countPipeline = engine->getPipelineRegistry().getPipeline(pipelineBuilder);
+
+    VkUtils::destroyShaderModule(device, fragmentShader);
+    VkUtils::destroyShaderModule(device, vertexShader);
+
+    {
+        DescriptorLayoutBuilder builder;
+        builder.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        builder.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        m_resolveDescriptorLayout = builder.build(device, VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    std::vector<DescriptorAllocator::PoolSizeRatio> sizes = {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+    };
+    m_descriptorAllocator.initPool(device, 1, sizes);
+
+    m_resolveSet = m_descriptorAllocator.allocate(device, m_resolveDescriptorLayout);
+    {
+        DescriptorWriter writer;
+        writer.writeImage(0, m_countImage.imageView, sampler, VK_IMAGE_LAYOUT_GENERAL,
+                          VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.writeImage(1, drawImage.imageView, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL,
+                          VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.updateSet(device, m_resolveSet);
+    }
+
+    const VkPushConstantRange resolvePushConstant{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(ComputePushConstants),
+    };
+
+    const VkPipelineLayoutCreateInfo resolveLayoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .setLayoutCount = 1,
+        .pSetLayouts = &m_resolveDescriptorLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &resolvePushConstant,
+    };
+
+    VK_CHECK(vkCreatePipelineLayout(device, &resolveLayoutInfo, nullptr, &m_resolveLayout));
+
+    VkShaderModule resolveShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/overdrawHeatmap.comp.spv", device, &resolveShader)) {
+        std::cerr << "Error when building the overdraw heatmap compute shader module" << std::endl;
+    }
+
+    const VkComputePipelineCreateInfo resolvePipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = nullptr,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = resolveShader,
+            .pName = "main",
+        },
+        .layout = m_resolveLayout,
+    };
+
+    VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &resolvePipelineInfo, nullptr, &m_resolvePipeline));
+
+    VkUtils::destroyShaderModule(device, resolveShader);
+
+    engine->getMainDeletionQueue().push_function([this, device] {
+        vkDestroyPipeline(device, m_resolvePipeline, nullptr);
+        vkDestroyPipelineLayout(device, m_resolveLayout, nullptr);
+        m_descriptorAllocator.destroyPool(device);
+        vkDestroyDescriptorSetLayout(device, m_resolveDescriptorLayout, nullptr);
+
+        vkDestroyPipelineLayout(device, m_countLayout, nullptr);
+
+        vkDestroyImageView(device, m_countImage.imageView, nullptr);
+        vmaDestroyImage(m_engine->getAllocator(), m_countImage.image, m_countImage.allocation);
+    });
+}
+
+void OverdrawHeatmap::count(
+    VkCommandBuffer cmd,
+    VkExtent2D drawExtent,
+    const GraphicsState& state,
+    std::span<const RenderObject> objects,
+    std::span<const uint32_t> drawList
+) const {
+    VkUtils::transitionImage(cmd, m_countImage.image, VK_IMAGE_LAYOUT_UNDEFINED,
+                             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+    const VkRenderingAttachmentInfo colorAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .pNext = nullptr,
+        .imageView = m_countImage.imageView,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = {.color = {.float32 = {0.f, 0.f, 0.f, 0.f}}},
+    };
+
+    const VkRenderingInfo renderInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .pNext = nullptr,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = drawExtent,
+        },
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+    };
+
+    vkCmdBeginRendering(cmd, &renderInfo);
+
+    const VkViewport viewport{
+        .x = 0,
+        .y = 0,
+        .width = static_cast<float>(drawExtent.width),
+        .height = static_cast<float>(drawExtent.height),
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    };
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    const VkRect2D scissor{
+        .offset = {0, 0},
+        .extent = drawExtent,
+    };
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_countPipeline);
+    // only the core dynamic states, polygon mode and blending stay baked into the pipeline
+    vkCmdSetPrimitiveTopology(cmd, state.topology);
+    vkCmdSetCullMode(cmd, state.cullMode);
+    vkCmdSetFrontFace(cmd, state.frontFace);
+    vkCmdSetDepthTestEnable(cmd, VK_FALSE);
+    vkCmdSetDepthWriteEnable(cmd, VK_FALSE);
+    vkCmdSetDepthCompareOp(cmd, VK_COMPARE_OP_NEVER);
+
+    m_engine->bindSceneDescriptors(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_countLayout);
+
+    for (const uint32_t index: drawList) {
+        const RenderObject& object = objects[index];
+
+        const GPUDrawPushConstants pushConstants{
+            .vertexBuffer = object.vertexBufferAddress,
+            .objectId = object.objectId,
+        };
+        vkCmdPushConstants(cmd, m_countLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GPUDrawPushConstants),
+                           &pushConstants);
+        vkCmdBindIndexBuffer(cmd, object.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+        vkCmdDrawIndexed(cmd, object.indexCount, 1, object.firstIndex, 0, 0);
+    }
+    m_engine->getFrameCounters().draws += static_cast<uint32_t>(drawList.size());
+
+    vkCmdEndRendering(cmd);
+
+    VkUtils::transitionImage(cmd, m_countImage.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                             VK_IMAGE_LAYOUT_GENERAL);
+}
+
+void OverdrawHeatmap::resolve(VkCommandBuffer cmd, VkExtent2D drawExtent) const {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_resolvePipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_resolveLayout, 0, 1, &m_resolveSet, 0, nullptr);
+
+    const ComputePushConstants pushConstants{
+        .data1 = glm::vec4(static_cast<float>(drawExtent.width), static_cast<float>(drawExtent.height),
+                           maxFragments, 0.f),
+    };
+    vkCmdPushConstants(cmd, m_resolveLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants),
+                       &pushConstants);
+
+    vkCmdDispatch(cmd, (drawExtent.width + OVERDRAW_GROUP_SIZE - 1) / OVERDRAW_GROUP_SIZE,
+                  (drawExtent.height + OVERDRAW_GROUP_SIZE - 1) / OVERDRAW_GROUP_SIZE, 1);
+    m_engine->getFrameCounters().dispatches++;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <span>
+
+#include "VkTypes.hpp"
+#include "VkDescriptors.hpp"
+
+class VulkanEngine;
+struct GraphicsState;
+
+// debug view of wasted fragment work: the draw list is rasterized again into a side target that adds one
+// per shaded fragment, then the counts replace the draw image as a color ramp
+class OverdrawHeatmap {
+public:
+    void init(VulkanEngine* engine, VkDescriptorSetLayout sceneLayout, const AllocatedImage& drawImage,
+              VkSampler sampler);
+
+    // counts the fragments every pixel shades, culled like the geometry pass
+    void count(VkCommandBuffer cmd, VkExtent2D drawExtent, const GraphicsState& state,
+               std::span<const RenderObject> objects, std::span<const uint32_t> drawList) const;
+
+    // overwrites the draw image with the counts, it must be in the general layout
+    void resolve(VkCommandBuffer cmd, VkExtent2D drawExtent) const;
+
+    // fragments per pixel drawn with the hottest color of the ramp
+    float maxFragments = 8.f;
+
+private:
+    VulkanEngine* m_engine = nullptr;
+
+    AllocatedImage m_countImage{};
+
+    VkPipelineLayout m_countLayout = VK_NULL_HANDLE;
+    VkPipeline m_countPipeline = VK_NULL_HANDLE;
+
+    DescriptorAllocator m_descriptorAllocator{};
+    VkDescriptorSetLayout m_resolveDescriptorLayout = VK_NULL_HANDLE;
+    VkDescriptorSet m_resolveSet = VK_NULL_HANDLE;
+    VkPipelineLayout m_resolveLayout = VK_NULL_HANDLE;
+    VkPipeline m_resolvePipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,324 @@
+#include "VkParticles.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "VkEngine.hpp"
+#include "VkPipeline.hpp"
+#include "VkSync.hpp"
+
+static VkPipeline createComputePipeline(VkDevice device, VkPipelineLayout layout, const char* shaderPath) {
+    VkShaderModule shader;
+    if (!VkUtils::loadShaderModule(shaderPath, device, &shader)) {
+        std::cerr << "Error when building the compute shader " << shaderPath << std::endl;
+    }
+
+    const VkComputePipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = nullptr,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = shader,
+            .pName = "main",
+        },
+        .layout = layout,
+    };
+
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+
+    VkUtils::destroyShaderModule(device, shader);
+
+    return pipeline;
+}
+
+static VkPipelineLayout createPushConstantLayout(VkDevice device, VkShaderStageFlags stages, uint32_t size) {
+    const VkPushConstantRange pushConstant{
+        .stageFlags = stages,
+        .offset = 0,
+        .size = size,
+    };
+
+    const VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .setLayoutCount = 0,
+        .pSetLayouts = nullptr,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstant,
+    };
+
+    VkPipelineLayout layout;
+    VK_CHECK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout));
+    return layout;
+}
+
+// the next pass reads what the previous one wrote, including the arguments of its indirect dispatch
+static void passBarrier(VkCommandBuffer cmd) {
+    VkUtils::memoryBarrier(cmd,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                           VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+                           VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+}
+
+void GpuParticles::init(VulkanEngine* engine, VkFormat colorFormat) {
+    m_engine = engine;
+    const VkDevice device = engine->getContext()->getDevice();
+
+    constexpr VkBufferUsageFlags storageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    m_particles = engine->createBuffer(PARTICLE_CAPACITY * sizeof(GpuParticle), storageUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+    m_deadList = engine->createBuffer(PARTICLE_CAPACITY * sizeof(uint32_t), storageUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+    for (AllocatedBuffer& aliveList: m_aliveLists) {
+        aliveList = engine->createBuffer(PARTICLE_CAPACITY * sizeof(uint32_t), storageUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+    }
+    m_sortKeys = engine->createBuffer(PARTICLE_CAPACITY * sizeof(glm::uvec2), storageUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+    m_counters = engine->createBuffer(sizeof(ParticleCounters), storageUsage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                      VMA_MEMORY_USAGE_GPU_ONLY);
+
+    m_pushConstants.particles = engine->getBufferAddress(m_particles);
+    m_pushConstants.deadList = engine->getBufferAddress(m_deadList);
+    m_pushConstants.sortKeys = engine->getBufferAddress(m_sortKeys);
+    m_pushConstants.counters = engine->getBufferAddress(m_counters);
+    m_pushConstants.capacity = PARTICLE_CAPACITY;
+
+    // every pass reaches its buffers through addresses, none of them needs descriptors
+    m_passLayout = createPushConstantLayout(device, VK_SHADER_STAGE_COMPUTE_BIT, sizeof(ParticlePushConstants));
+    m_resetPipeline = createComputePipeline(device, m_passLayout, HELLFIRE_SHADER_DIR "/particleReset.comp.spv");
+    m_beginPipeline = createComputePipeline(device, m_passLayout, HELLFIRE_SHADER_DIR "/particleBegin.comp.spv");
+    m_emitPipeline = createComputePipeline(device, m_passLayout, HELLFIRE_SHADER_DIR "/particleEmit.comp.spv");
+    m_simulatePipeline = createComputePipeline(device, m_passLayout,
+                                               HELLFIRE_SHADER_DIR "/particleSimulate.comp.spv");
+    m_endPipeline = createComputePipeline(device, m_passLayout, HELLFIRE_SHADER_DIR "/particleEnd.comp.spv");
+
+    m_sortLayout = createPushConstantLayout(device, VK_SHADER_STAGE_COMPUTE_BIT, sizeof(ParticleSortPushConstants));
+    m_sortPipeline = createComputePipeline(device, m_sortLayout, HELLFIRE_SHADER_DIR "/particleSort.comp.spv");
+
+    VkShaderModule vertexShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/particle.vert.spv", device, &vertexShader)) {
+        std::cerr << "Error when building the particle vertex shader module" << std::endl;
+    }
+
+    VkShaderModule fragmentShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/particle.frag.spv", device, &fragmentShader)) {
+        std::cerr << "Error when building the particle fragment shader module" << std::endl;
+    }
+
+    m_drawLayout = createPushConstantLayout(device, VK_SHADER_STAGE_VERTEX_BIT, sizeof(ParticleDrawPushConstants));
+
+    // the geometry pass has no depth buffer, particles are ordered by the sort alone
+    PipelineBuilder pipelineBuilder(engine->getContext());
+    pipelineBuilder.m_pipelineLayout = m_drawLayout;
+    pipelineBuilder.setShaders(vertexShader, fragmentShader);
+    pipelineBuilder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    pipelineBuilder.setPolygonMode(VK_POLYGON_MODE_FILL);
+    pipelineBuilder.setCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+    pipelineBuilder.setMultiSamplingNone();
+    pipelineBuilder.enableBlendingPremultiplied();
+    pipelineBuilder.disableDepthTest();
+    pipelineBuilder.setColorAttachmentFormat(colorFormat);
+
+    m_drawPipeline = engine->getPipelineRegistry().getPipeline(pipelineBuilder);
+
+    VkUtils::destroyShaderModule(device, fragmentShader);
+    VkUtils::destroyShaderModule(device, vertexShader);
+
+    engine->getMainDeletionQueue().push_function([this, device] {
+        vkDestroyPipelineLayout(device, m_drawLayout, nullptr);
+        vkDestroyPipeline(device, m_sortPipeline, nullptr);
+        vkDestroyPipelineLayout(device, m_sortLayout, nullptr);
+        for (const VkPipeline pipeline: {m_resetPipeline, m_beginPipeline, m_emitPipeline, m_simulatePipeline,
+                                         m_endPipeline}) {
+            vkDestroyPipeline(device, pipeline, nullptr);
+        }
+        vkDestroyPipelineLayout(device, m_passLayout, nullptr);
+
+        m_engine->destroyBuffer(m_counters);
+        m_engine->destroyBuffer(m_sortKeys);
+        for (const AllocatedBuffer& aliveList: m_aliveLists) {
+            m_engine->destroyBuffer(aliveList);
+        }
+        m_engine->destroyBuffer(m_deadList);
+        m_engine->destroyBuffer(m_particles);
+    });
+}
+
+void GpuParticles::update(float time, const glm::vec3& cameraPosition) {
+    // long hitches are not caught up, the emitter would burst its whole budget at once
+    const float deltaTime = m_lastTime < 0.f ? 0.f : std::clamp(time - m_lastTime, 0.f, 0.1f);
+    m_lastTime = time;
+
+    const float emitted = emitRate * deltaTime + m_emitRemainder;
+    const float emitCount = std::floor(emitted);
+    m_emitRemainder = emitted - emitCount;
+
+    m_pushConstants.emitterPosition = glm::vec4(emitterPosition, 0.25f);
+    m_pushConstants.emitterVelocity = glm::vec4(emitterVelocity, 2.5f);
+    m_pushConstants.cameraPosition = glm::vec4(cameraPosition, deltaTime);
+    m_pushConstants.emitCount = static_cast<uint32_t>(std::min(emitCount, static_cast<float>(PARTICLE_CAPACITY)));
+    m_pushConstants.lifetime = lifetime;
+}
+
+void GpuParticles::dispatchPass(VkCommandBuffer cmd, VkPipeline pipeline, uint32_t groupCount) const {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdPushConstants(cmd, m_passLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticlePushConstants),
+                       &m_pushConstants);
+    vkCmdDispatch(cmd, groupCount, 1, 1);
+    m_engine->getFrameCounters().dispatches++;
+}
+
+void GpuParticles::dispatchPassIndirect(VkCommandBuffer cmd, VkPipeline pipeline, VkDeviceSize offset) const {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdPushConstants(cmd, m_passLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticlePushConstants),
+                       &m_pushConstants);
+    vkCmdDispatchIndirect(cmd, m_counters.buffer, offset);
+    m_engine->getFrameCounters().dispatches++;
+}
+
+void GpuParticles::simulate(VkCommandBuffer cmd) {
+    if (!enabled) {
+        return;
+    }
+
+    // the previous frame may still be drawing from the buffers rewritten below
+    VkUtils::memoryBarrier(cmd,
+                           VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                           VK_ACCESS_2_NONE,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+    // the alive lists swap roles every step, the shaders pick the matching counter from the parity
+    m_pushConstants.frame = m_step;
+    m_pushConstants.aliveIn = m_engine->getBufferAddress(m_aliveLists[m_step & 1]);
+    m_pushConstants.aliveOut = m_engine->getBufferAddress(m_aliveLists[(m_step & 1) ^ 1]);
+
+    if (m_resetPending) {
+        dispatchPass(cmd, m_resetPipeline, PARTICLE_CAPACITY / PARTICLE_GROUP_SIZE);
+        passBarrier(cmd);
+        m_resetPending = false;
+    }
+
+    dispatchPass(cmd, m_beginPipeline, 1);
+    passBarrier(cmd);
+    dispatchPassIndirect(cmd, m_emitPipeline, offsetof(ParticleCounters, emitDispatch));
+    passBarrier(cmd);
+    dispatchPassIndirect(cmd, m_simulatePipeline, offsetof(ParticleCounters, simulateDispatch));
+    passBarrier(cmd);
+    dispatchPass(cmd, m_endPipeline, 1);
+    passBarrier(cmd);
+
+    m_sortDispatches = 0;
+    if (sorting) {
+        recordSort(cmd);
+    }
+
+    VkUtils::memoryBarrier(cmd,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                           VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+
+    m_step++;
+}
+
+void GpuParticles::recordSort(VkCommandBuffer cmd) {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_sortPipeline);
+
+    // every step is sized by the range the end pass picked, steps taller than it return at once
+    const auto sortStep = [&](ParticleSortStep step, uint32_t height) {
+        const ParticleSortPushConstants pushConstants{
+            .sortKeys = m_pushConstants.sortKeys,
+            .counters = m_pushConstants.counters,
+            .height = height,
+            .step = step,
+        };
+        vkCmdPushConstants(cmd, m_sortLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticleSortPushConstants),
+                           &pushConstants);
+        vkCmdDispatchIndirect(cmd, m_counters.buffer, offsetof(ParticleCounters, sortDispatch));
+        passBarrier(cmd);
+        m_sortDispatches++;
+        m_engine->getFrameCounters().dispatches++;
+    };
+
+    sortStep(ParticleSortStep::LocalSort, PARTICLE_SORT_BLOCK_SIZE);
+
+    for (uint32_t height = PARTICLE_SORT_BLOCK_SIZE * 2; height <= PARTICLE_CAPACITY; height *= 2) {
+        sortStep(ParticleSortStep::BigFlip, height);
+
+        for (uint32_t disperse = height / 2; disperse > 1; disperse /= 2) {
+            // the remaining steps fit in a block and run in shared memory
+            if (disperse <= PARTICLE_SORT_BLOCK_SIZE) {
+                sortStep(ParticleSortStep::LocalDisperse, disperse);
+                break;
+            }
+            sortStep(ParticleSortStep::BigDisperse, disperse);
+        }
+    }
+}
+
+void GpuParticles::draw(VkCommandBuffer cmd, VkImageView colorView, VkExtent2D extent, const glm::mat4& view,
+                        const glm::mat4& viewProj) const {
+    if (!enabled) {
+        return;
+    }
+
+    const VkRenderingAttachmentInfo colorAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .pNext = nullptr,
+        .imageView = colorView,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+    };
+
+    const VkRenderingInfo renderInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .pNext = nullptr,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = extent,
+        },
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+    };
+
+    vkCmdBeginRendering(cmd, &renderInfo);
+
+    const VkViewport viewport{
+        .x = 0.f,
+        .y = 0.f,
+        .width = static_cast<float>(extent.width),
+        .height = static_cast<float>(extent.height),
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    };
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    const VkRect2D scissor{
+        .offset = {0, 0},
+        .extent = extent,
+    };
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_drawPipeline);
+
+    // the rows of the view rotation are the camera axes in world space
+    const ParticleDrawPushConstants pushConstants{
+        .viewProj = viewProj,
+        .cameraRight = glm::vec4(view[0][0], view[1][0], view[2][0], particleSize),
+        .cameraUp = glm::vec4(view[0][1], view[1][1], view[2][1], 0.f),
+        .particles = m_pushConstants.particles,
+        .sortKeys = m_pushConstants.sortKeys,
+    };
+    vkCmdPushConstants(cmd, m_drawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ParticleDrawPushConstants),
+                       &pushConstants);
+
+    vkCmdDrawIndirect(cmd, m_counters.buffer, offsetof(ParticleCounters, draw), 1, sizeof(VkDrawIndirectCommand));
+    m_engine->getFrameCounters().draws++;
+
+    vkCmdEndRendering(cmd);
+}
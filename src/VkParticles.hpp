@@ -0,0 +1,142 @@
+#pragma once
+
+#include "VkTypes.hpp"
+
+class VulkanEngine;
+
+// power of two, the bitonic sort orders the whole range in the worst case
+constexpr uint32_t PARTICLE_CAPACITY = 1 << 20;
+// must match PARTICLE_GROUP_SIZE and SORT_GROUP_SIZE in particles.glsl
+constexpr uint32_t PARTICLE_GROUP_SIZE = 64;
+constexpr uint32_t PARTICLE_SORT_GROUP_SIZE = 256;
+constexpr uint32_t PARTICLE_SORT_BLOCK_SIZE = PARTICLE_SORT_GROUP_SIZE * 2;
+
+// std430 layout of Particle in particles.glsl
+struct GpuParticle {
+    glm::vec3 position;
+    float age;
+    glm::vec3 velocity;
+    float lifetime;
+    glm::vec4 color;
+};
+
+// std430 layout of CounterBuffer in particles.glsl, written only by the GPU
+struct ParticleCounters {
+    uint32_t deadCount;
+    uint32_t aliveCount[2];
+    uint32_t emitCount;
+    VkDispatchIndirectCommand emitDispatch;
+    VkDispatchIndirectCommand simulateDispatch;
+    VkDispatchIndirectCommand sortDispatch;
+    uint32_t sortCount;
+    uint32_t drawnCount;
+    VkDrawIndirectCommand draw;
+};
+
+struct ParticlePushConstants {
+    VkDeviceAddress particles;
+    VkDeviceAddress deadList;
+    VkDeviceAddress aliveIn;
+    VkDeviceAddress aliveOut;
+    VkDeviceAddress sortKeys;
+    VkDeviceAddress counters;
+    // xyz center, w radius
+    glm::vec4 emitterPosition;
+    // xyz initial velocity, w random speed added in any direction
+    glm::vec4 emitterVelocity;
+    // xyz camera position, w time step
+    glm::vec4 cameraPosition;
+    uint32_t emitCount;
+    uint32_t frame;
+    uint32_t capacity;
+    float lifetime;
+};
+
+// must match the STEP_ defines in particleSort.comp
+enum class ParticleSortStep : uint32_t {
+    LocalSort,
+    LocalDisperse,
+    BigFlip,
+    BigDisperse,
+};
+
+struct ParticleSortPushConstants {
+    VkDeviceAddress sortKeys;
+    VkDeviceAddress counters;
+    uint32_t height;
+    ParticleSortStep step;
+};
+
+struct ParticleDrawPushConstants {
+    glm::mat4 viewProj;
+    // xyz camera right, w half size of a particle
+    glm::vec4 cameraRight;
+    glm::vec4 cameraUp;
+    VkDeviceAddress particles;
+    VkDeviceAddress sortKeys;
+};
+
+// particles living entirely on the GPU. Emission, simulation, compaction of the dead and the depth sort
+// are compute passes whose sizes come from counters the previous pass wrote, and the draw reads its
+// vertex count from the same buffer, so the CPU never learns how many particles are alive
+class GpuParticles {
+public:
+    void init(VulkanEngine* engine, VkFormat colorFormat);
+
+    // advances the emitter clock, the simulation itself is recorded by simulate
+    void update(float time, const glm::vec3& cameraPosition);
+
+    void simulate(VkCommandBuffer cmd);
+
+    // blends the particles over the color attachment, after the opaque geometry
+    void draw(VkCommandBuffer cmd, VkImageView colorView, VkExtent2D extent, const glm::mat4& view,
+              const glm::mat4& viewProj) const;
+
+    // kills every particle at the next simulate
+    void reset() { m_resetPending = true; }
+
+    [[nodiscard]] uint32_t getSortDispatchCount() const { return m_sortDispatches; }
+
+    // off until switched on from the UI, a demo sized emitter then keeps about 20000 particles alive.
+    // Raise the rate towards PARTICLE_CAPACITY for stress tests
+    bool enabled = false;
+    // without the sort particles blend in the order they survived, which is only right for additive looks
+    bool sorting = true;
+    float emitRate = 5000.f;
+    float lifetime = 4.f;
+    float particleSize = 0.03f;
+    glm::vec3 emitterPosition{0.f, 2.f, 0.f};
+    glm::vec3 emitterVelocity{0.f, 6.f, 0.f};
+
+private:
+    void dispatchPass(VkCommandBuffer cmd, VkPipeline pipeline, uint32_t groupCount) const;
+    void dispatchPassIndirect(VkCommandBuffer cmd, VkPipeline pipeline, VkDeviceSize offset) const;
+    void recordSort(VkCommandBuffer cmd);
+
+    VulkanEngine* m_engine = nullptr;
+
+    AllocatedBuffer m_particles{};
+    AllocatedBuffer m_deadList{};
+    // ping-pong, the simulation reads one and appends the survivors to the other
+    AllocatedBuffer m_aliveLists[2]{};
+    AllocatedBuffer m_sortKeys{};
+    AllocatedBuffer m_counters{};
+
+    VkPipelineLayout m_passLayout = VK_NULL_HANDLE;
+    VkPipeline m_resetPipeline = VK_NULL_HANDLE;
+    VkPipeline m_beginPipeline = VK_NULL_HANDLE;
+    VkPipeline m_emitPipeline = VK_NULL_HANDLE;
+    VkPipeline m_simulatePipeline = VK_NULL_HANDLE;
+    VkPipeline m_endPipeline = VK_NULL_HANDLE;
+    VkPipelineLayout m_sortLayout = VK_NULL_HANDLE;
+    VkPipeline m_sortPipeline = VK_NULL_HANDLE;
+    VkPipelineLayout m_drawLayout = VK_NULL_HANDLE;
+    VkPipeline m_drawPipeline = VK_NULL_HANDLE;
+
+    ParticlePushConstants m_pushConstants{};
+    bool m_resetPending = true;
+    float m_lastTime = -1.f;
+    float m_emitRemainder = 0.f;
+    uint32_t m_step = 0;
+    uint32_t m_sortDispatches = 0;
+};
@@ -1,15 +1,37 @@
 #include "VkPipeline.hpp"
 
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <vector>
 #include <fstream>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+
+// FNV-1a over 64 bit words
+static uint64_t hashWords(std::span<const uint64_t> words) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const uint64_t word: words) {
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// written when a module is loaded and erased when it is destroyed, so a reused handle never finds a stale entry
+static std::mutex s_shaderHashMutex;
+static std::unordered_map<VkShaderModule, uint64_t> s_shaderHashes;
+
+// the vertex shader belongs to the pre-rasterization part, every other stage to the fragment shader part
+static bool ownsStage(VkGraphicsPipelineLibraryFlagsEXT parts, VkShaderStageFlagBits stage) {
+    if (stage == VK_SHADER_STAGE_VERTEX_BIT) {
+        return parts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+    }
+    return parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+}
 
 namespace VkUtils {
-    bool loadShaderModule(
-        const char* filePath,
-        VkDevice device,
-        VkShaderModule* outShaderModule
-    ) {
+    bool loadShaderCode(const char* filePath, std::vector<uint32_t>& outCode) {
         // open the file. With cursor at the end
         std::ifstream file(filePath, std::ios::ate | std::ios::binary);
 
@@ -23,16 +45,28 @@ namespace VkUtils {
 
         // spir-v expects the buffer to be on uint32, so make sure to reserve a int
         // vector big enough for the entire file
-        std::vector<uint32_t> buffer(fileSize / sizeof(uint32_t));
+        outCode.resize(fileSize / sizeof(uint32_t));
 
         // put file cursor at beginning
         file.seekg(0);
 
         // load the entire file into the buffer
-        file.read(reinterpret_cast<char *>(buffer.data()), fileSize);
+        file.read(reinterpret_cast<char *>(outCode.data()), fileSize);
 
         // now that the file is loaded into the buffer, we can close it
         file.close();
+        return true;
+    }
+
+    bool loadShaderModule(
+        const char* filePath,
+        VkDevice device,
+        VkShaderModule* outShaderModule
+    ) {
+        std::vector<uint32_t> buffer;
+        if (!loadShaderCode(filePath, buffer)) {
+            return false;
+        }
 
         // create a new shader module, using the buffer we loaded
         VkShaderModuleCreateInfo createInfo = {};
@@ -50,8 +84,27 @@ namespace VkUtils {
             return false;
         }
         *outShaderModule = shaderModule;
+
+        std::vector<uint64_t> words(buffer.begin(), buffer.end());
+        std::lock_guard lock(s_shaderHashMutex);
+        s_shaderHashes[shaderModule] = hashWords(words);
         return true;
     }
+
+    uint64_t getShaderModuleHash(VkShaderModule module) {
+        std::lock_guard lock(s_shaderHashMutex);
+        const auto it = s_shaderHashes.find(module);
+        // modules created elsewhere fall back to their handle
+        return it != s_shaderHashes.end() ? it->second : std::bit_cast<uint64_t>(module);
+    }
+
+    void destroyShaderModule(VkDevice device, VkShaderModule module) {
+        {
+            std::lock_guard lock(s_shaderHashMutex);
+            s_shaderHashes.erase(module);
+        }
+        vkDestroyShaderModule(device, module, nullptr);
+    }
 }
 
 void PipelineBuilder::clear() {
@@ -79,6 +132,10 @@ void PipelineBuilder::clear() {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO
     };
 
+    m_createFlags = 0;
+    m_dynamicState = false;
+    m_dynamicState3 = false;
+
     m_shaderStages.clear();
 }
 
@@ -106,6 +163,20 @@ void PipelineBuilder::setShaders(VkShaderModule vertexShader, VkShaderModule fra
     m_shaderStages.push_back(fragmentShaderStageCreateInfo);
 }
 
+void PipelineBuilder::setVertexShader(VkShaderModule vertexShader) {
+    m_shaderStages.clear();
+
+    const VkPipelineShaderStageCreateInfo vertexShaderStageCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .pNext = nullptr,
+        .stage = VK_SHADER_STAGE_VERTEX_BIT,
+        .module = vertexShader,
+        .pName = "main",
+    };
+
+    m_shaderStages.push_back(vertexShaderStageCreateInfo);
+}
+
 void PipelineBuilder::setInputTopology(VkPrimitiveTopology topology) {
     m_inputAssembly.topology = topology;
     // we are not going to use primitive restart on the entire tutorial so leave
@@ -123,6 +194,12 @@ void PipelineBuilder::setCullMode(VkCullModeFlags cullMode, VkFrontFace frontFac
     m_rasterizer.frontFace = frontFace;
 }
 
+void PipelineBuilder::setDepthBias(float constantFactor, float slopeFactor) {
+    m_rasterizer.depthBiasEnable = VK_TRUE;
+    m_rasterizer.depthBiasConstantFactor = constantFactor;
+    m_rasterizer.depthBiasSlopeFactor = slopeFactor;
+}
+
 void PipelineBuilder::setMultiSamplingNone() {
     m_multisampling.sampleShadingEnable = VK_FALSE;
     // multisampling defaulted to no multisampling (1 sample per pixel)
@@ -142,6 +219,31 @@ void PipelineBuilder::disableBlending() {
     m_colorBlendAttachment.blendEnable = VK_FALSE;
 }
 
+void PipelineBuilder::enableBlendingPremultiplied() {
+    m_colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                            VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    m_colorBlendAttachment.blendEnable = VK_TRUE;
+    // outColor = srcColor + dstColor * (1 - srcAlpha)
+    m_colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    m_colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    m_colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    m_colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    m_colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    m_colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+}
+
+void PipelineBuilder::enableBlendingAdditive() {
+    m_colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                            VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    m_colorBlendAttachment.blendEnable = VK_TRUE;
+    m_colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    m_colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    m_colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    m_colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    m_colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    m_colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+}
+
 void PipelineBuilder::setColorAttachmentFormat(VkFormat format) {
     m_colorAttachmentFormat = format;
     // connect the format to the renderInfo  structure
@@ -165,7 +267,200 @@ void PipelineBuilder::disableDepthTest() {
     m_depthStencil.maxDepthBounds = 1.f;
 }
 
+void PipelineBuilder::enableDepthTest(bool depthWriteEnable, VkCompareOp op) {
+    m_depthStencil.depthTestEnable = VK_TRUE;
+    m_depthStencil.depthWriteEnable = depthWriteEnable;
+    m_depthStencil.depthCompareOp = op;
+    m_depthStencil.depthBoundsTestEnable = VK_FALSE;
+    m_depthStencil.stencilTestEnable = VK_FALSE;
+    m_depthStencil.front = {};
+    m_depthStencil.back = {};
+    m_depthStencil.minDepthBounds = 0.f;
+    m_depthStencil.maxDepthBounds = 1.f;
+}
+
+void PipelineBuilder::setViewMask(uint32_t viewMask) {
+    m_renderInfo.viewMask = viewMask;
+}
+
+void PipelineBuilder::enableDynamicState(bool dynamicState3) {
+    m_dynamicState = true;
+    m_dynamicState3 = dynamicState3;
+}
+
+void PipelineBuilder::setCreateFlags(VkPipelineCreateFlags flags) {
+    m_createFlags = flags;
+}
+
 VkPipeline PipelineBuilder::buildPipeline(VkDevice device) {
+    return build(device, &m_renderInfo, m_createFlags, m_shaderStages);
+}
+
+PipelineKey PipelineBuilder::getKey() const {
+    return getKey(VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT |
+                  VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT |
+                  VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT |
+                  VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT);
+}
+
+PipelineKey PipelineBuilder::getKey(VkGraphicsPipelineLibraryFlagsEXT parts) const {
+    PipelineKey key;
+    std::vector<uint64_t>& words = key.words;
+    const auto add = [&words](auto value) {
+        if constexpr (std::is_floating_point_v<decltype(value)>) {
+            words.push_back(std::bit_cast<uint32_t>(value));
+        } else {
+            words.push_back(static_cast<uint64_t>(value));
+        }
+    };
+
+    const bool vertexInput = parts & VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+    const bool preRasterization = parts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+    const bool fragmentShader = parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+    const bool fragmentOutput = parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+
+    add(parts);
+    for (const VkPipelineShaderStageCreateInfo& stage: m_shaderStages) {
+        if (!ownsStage(parts, stage.stage)) {
+            continue;
+        }
+        add(stage.stage);
+        add(VkUtils::getShaderModuleHash(stage.module));
+        add(std::hash<std::string_view>{}(stage.pName));
+    }
+
+    // states set while recording are left out, pipelines differing only in them are the same pipeline
+    if (vertexInput) {
+        if (!m_dynamicState) {
+            add(m_inputAssembly.topology);
+        }
+        add(m_inputAssembly.primitiveRestartEnable);
+    }
+
+    if (preRasterization) {
+        add(m_rasterizer.depthClampEnable);
+        add(m_rasterizer.rasterizerDiscardEnable);
+        if (!m_dynamicState3) {
+            add(m_rasterizer.polygonMode);
+        }
+        if (!m_dynamicState) {
+            add(m_rasterizer.cullMode);
+            add(m_rasterizer.frontFace);
+        }
+        add(m_rasterizer.depthBiasEnable);
+        add(m_rasterizer.depthBiasConstantFactor);
+        add(m_rasterizer.depthBiasClamp);
+        add(m_rasterizer.depthBiasSlopeFactor);
+        add(m_rasterizer.lineWidth);
+    }
+
+    if (fragmentOutput && !m_dynamicState3) {
+        add(m_colorBlendAttachment.blendEnable);
+        add(m_colorBlendAttachment.srcColorBlendFactor);
+        add(m_colorBlendAttachment.dstColorBlendFactor);
+        add(m_colorBlendAttachment.colorBlendOp);
+        add(m_colorBlendAttachment.srcAlphaBlendFactor);
+        add(m_colorBlendAttachment.dstAlphaBlendFactor);
+        add(m_colorBlendAttachment.alphaBlendOp);
+        add(m_colorBlendAttachment.colorWriteMask);
+    }
+
+    if (fragmentShader || fragmentOutput) {
+        add(m_multisampling.rasterizationSamples);
+        add(m_multisampling.sampleShadingEnable);
+        add(m_multisampling.minSampleShading);
+        add(m_multisampling.alphaToCoverageEnable);
+        add(m_multisampling.alphaToOneEnable);
+    }
+
+    if (fragmentShader) {
+        if (!m_dynamicState) {
+            add(m_depthStencil.depthTestEnable);
+            add(m_depthStencil.depthWriteEnable);
+            add(m_depthStencil.depthCompareOp);
+        }
+        add(m_depthStencil.depthBoundsTestEnable);
+        add(m_depthStencil.stencilTestEnable);
+        add(m_depthStencil.minDepthBounds);
+        add(m_depthStencil.maxDepthBounds);
+    }
+
+    add(m_renderInfo.viewMask);
+    if (fragmentShader || fragmentOutput) {
+        add(m_renderInfo.colorAttachmentCount);
+        if (m_renderInfo.colorAttachmentCount > 0) {
+            add(m_colorAttachmentFormat);
+        }
+        add(m_renderInfo.depthAttachmentFormat);
+        add(m_renderInfo.stencilAttachmentFormat);
+    }
+
+    // layouts live as long as the engine, their handles are never reused
+    if (preRasterization || fragmentShader) {
+        add(std::bit_cast<uint64_t>(m_pipelineLayout));
+    }
+    add(m_createFlags);
+    add(m_dynamicState);
+    add(m_dynamicState3);
+
+    key.hash = hashWords(words);
+    return key;
+}
+
+VkPipeline PipelineBuilder::buildLibrary(VkDevice device, VkGraphicsPipelineLibraryFlagsEXT parts) {
+    // each part only takes the shader stages it owns
+    std::vector<VkPipelineShaderStageCreateInfo> stages;
+    for (const VkPipelineShaderStageCreateInfo& stage: m_shaderStages) {
+        if (ownsStage(parts, stage.stage)) {
+            stages.push_back(stage);
+        }
+    }
+
+    // state that does not belong to the parts is ignored by the driver
+    const VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+        .pNext = &m_renderInfo,
+        .flags = parts,
+    };
+
+    return build(device, &libraryInfo,
+                 m_createFlags | VK_PIPELINE_CREATE_LIBRARY_BIT_KHR |
+                 VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT,
+                 stages);
+}
+
+VkPipeline PipelineBuilder::linkLibraries(
+    VkDevice device,
+    std::span<const VkPipeline> libraries,
+    VkPipelineLayout layout,
+    VkPipelineCreateFlags flags,
+    bool optimized
+) {
+    const VkPipelineLibraryCreateInfoKHR libraryInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+        .libraryCount = static_cast<uint32_t>(libraries.size()),
+        .pLibraries = libraries.data(),
+    };
+
+    const VkGraphicsPipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = &libraryInfo,
+        .flags = flags | (optimized ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0),
+        .layout = layout,
+    };
+
+    VkPipeline newPipeline;
+    VK_CHECK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline));
+
+    return newPipeline;
+}
+
+VkPipeline PipelineBuilder::build(
+    VkDevice device,
+    const void* pNext,
+    VkPipelineCreateFlags flags,
+    std::span<const VkPipelineShaderStageCreateInfo> stages
+) {
     // make viewport state from our stored viewport and scissor.
     // at the moment we won't support multiple viewports or scissors
     const VkPipelineViewportStateCreateInfo viewportState = {
@@ -182,7 +477,8 @@ VkPipeline PipelineBuilder::buildPipeline(VkDevice device) {
         .pNext = nullptr,
         .logicOpEnable = VK_FALSE,
         .logicOp = VK_LOGIC_OP_COPY,
-        .attachmentCount = 1,
+        // depth-only pipelines have no color attachment to blend
+        .attachmentCount = m_renderInfo.colorAttachmentCount,
         .pAttachments = &m_colorBlendAttachment,
     };
 
@@ -196,10 +492,11 @@ VkPipeline PipelineBuilder::buildPipeline(VkDevice device) {
     // to create the pipeline
     VkGraphicsPipelineCreateInfo pipelineInfo = {.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
     // connect the renderInfo to the pNext extension mechanism
-    pipelineInfo.pNext = &m_renderInfo;
+    pipelineInfo.pNext = pNext;
+    pipelineInfo.flags = flags;
 
-    pipelineInfo.stageCount = static_cast<uint32_t>(m_shaderStages.size());
-    pipelineInfo.pStages = m_shaderStages.data();
+    pipelineInfo.stageCount = static_cast<uint32_t>(stages.size());
+    pipelineInfo.pStages = stages.data();
     pipelineInfo.pVertexInputState = &vertexInputInfo;
     pipelineInfo.pInputAssemblyState = &m_inputAssembly;
     pipelineInfo.pViewportState = &viewportState;
@@ -209,11 +506,30 @@ VkPipeline PipelineBuilder::buildPipeline(VkDevice device) {
     pipelineInfo.pDepthStencilState = &m_depthStencil;
     pipelineInfo.layout = m_pipelineLayout;
 
-    std::array state = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    std::vector state = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    if (m_dynamicState) {
+        // core since Vulkan 1.3, the baked values of these states are ignored
+        state.insert(state.end(), {
+            VK_DYNAMIC_STATE_CULL_MODE,
+            VK_DYNAMIC_STATE_FRONT_FACE,
+            VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY,
+            VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+            VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
+            VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
+        });
+    }
+    if (m_dynamicState3) {
+        state.insert(state.end(), {
+            VK_DYNAMIC_STATE_POLYGON_MODE_EXT,
+            VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT,
+            VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT,
+            VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT,
+        });
+    }
 
     const VkPipelineDynamicStateCreateInfo dynamicInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-        .dynamicStateCount = 2,
+        .dynamicStateCount = static_cast<uint32_t>(state.size()),
         .pDynamicStates = state.data(),
     };
 
@@ -222,8 +538,93 @@ VkPipeline PipelineBuilder::buildPipeline(VkDevice device) {
     // it's easy to error out on create graphics pipeline, so we handle it a bit
     // better than the common VK_CHECK case
     VkPipeline newPipeline;
-    VK_CHECK(vkCreateGraphicsPipelines(m_ctx->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline));
+    VK_CHECK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline));
 
     return newPipeline;
 }
 
+
+void DynamicStateCommands::init(VkDevice device, bool dynamicState3) {
+    m_dynamicState3 = dynamicState3;
+    if (!dynamicState3) {
+        return;
+    }
+
+    // extension entry points are not exported by the loader, fetch them from the device
+    m_cmdSetPolygonMode = reinterpret_cast<PFN_vkCmdSetPolygonModeEXT>(
+        vkGetDeviceProcAddr(device, "vkCmdSetPolygonModeEXT"));
+    m_cmdSetColorBlendEnable = reinterpret_cast<PFN_vkCmdSetColorBlendEnableEXT>(
+        vkGetDeviceProcAddr(device, "vkCmdSetColorBlendEnableEXT"));
+    m_cmdSetColorBlendEquation = reinterpret_cast<PFN_vkCmdSetColorBlendEquationEXT>(
+        vkGetDeviceProcAddr(device, "vkCmdSetColorBlendEquationEXT"));
+    m_cmdSetColorWriteMask = reinterpret_cast<PFN_vkCmdSetColorWriteMaskEXT>(
+        vkGetDeviceProcAddr(device, "vkCmdSetColorWriteMaskEXT"));
+}
+
+void DynamicStateCommands::set(VkCommandBuffer cmd, const GraphicsState& state) const {
+    vkCmdSetPrimitiveTopology(cmd, state.topology);
+    vkCmdSetCullMode(cmd, state.cullMode);
+    vkCmdSetFrontFace(cmd, state.frontFace);
+    vkCmdSetDepthTestEnable(cmd, state.depthTest);
+    vkCmdSetDepthWriteEnable(cmd, state.depthWrite);
+    vkCmdSetDepthCompareOp(cmd, state.depthCompareOp);
+
+    if (!m_dynamicState3) {
+        return;
+    }
+
+    m_cmdSetPolygonMode(cmd, state.polygonMode);
+
+    // attachments are few, fixed arrays avoid allocating while recording
+    constexpr uint32_t maxAttachments = 8;
+    const uint32_t attachmentCount = std::min(state.colorAttachmentCount, maxAttachments);
+    if (attachmentCount == 0) {
+        return;
+    }
+
+    std::array<VkBool32, maxAttachments> blendEnables{};
+    std::array<VkColorComponentFlags, maxAttachments> writeMasks{};
+    std::array<VkColorBlendEquationEXT, maxAttachments> equations{};
+    for (uint32_t i = 0; i < attachmentCount; i++) {
+        blendEnables[i] = state.blending;
+        writeMasks[i] = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        // outColor = srcColor + dstColor * (1 - srcAlpha)
+        equations[i] = {
+            .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+            .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+            .colorBlendOp = VK_BLEND_OP_ADD,
+            .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+            .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+            .alphaBlendOp = VK_BLEND_OP_ADD,
+        };
+    }
+
+    m_cmdSetColorBlendEnable(cmd, 0, attachmentCount, blendEnables.data());
+    m_cmdSetColorWriteMask(cmd, 0, attachmentCount, writeMasks.data());
+    m_cmdSetColorBlendEquation(cmd, 0, attachmentCount, equations.data());
+}
+
+void PipelineRegistry::init(VkDevice device) {
+    m_device = device;
+}
+
+void PipelineRegistry::destroy() {
+    for (const auto& [key, pipeline]: m_pipelines) {
+        vkDestroyPipeline(m_device, pipeline, nullptr);
+    }
+    m_pipelines.clear();
+}
+
+VkPipeline PipelineRegistry::getPipeline(PipelineBuilder& builder) {
+    PipelineKey key = builder.getKey();
+    if (const auto it = m_pipelines.find(key); it != m_pipelines.end()) {
+        m_stats.hits++;
+        return it->second;
+    }
+
+    m_stats.misses++;
+    const VkPipeline pipeline = builder.buildPipeline(m_device);
+    m_pipelines.emplace(std::move(key), pipeline);
+    return pipeline;
+}
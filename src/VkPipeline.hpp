@@ -1,18 +1,75 @@
 #pragma once
 
+#include <span>
+#include <unordered_map>
 #include <vector>
 
 #include "VkTypes.hpp"
 #include "VkContext.hpp"
 
 namespace VkUtils {
+    // reads a SPIR-V file, for consumers that take the code itself such as shader objects
+    bool loadShaderCode(const char* filePath, std::vector<uint32_t>& outCode);
+
     bool loadShaderModule(
         const char* filePath,
         VkDevice device,
         VkShaderModule* outShaderModule
     );
+
+    // hash of the code a module was loaded from, so a freed handle reused by another module never aliases it
+    uint64_t getShaderModuleHash(VkShaderModule module);
+
+    // destroys a module from loadShaderModule and forgets its hash before the handle can be reused
+    void destroyShaderModule(VkDevice device, VkShaderModule module);
 }
 
+// the full state of a PipelineBuilder flattened into words, equal keys build equal pipelines
+struct PipelineKey {
+    std::vector<uint64_t> words;
+    uint64_t hash = 0;
+
+    bool operator==(const PipelineKey& other) const { return hash == other.hash && words == other.words; }
+};
+
+struct PipelineKeyHash {
+    size_t operator()(const PipelineKey& key) const { return static_cast<size_t>(key.hash); }
+};
+
+// the states a pipeline built with enableDynamicState, or a shader object draw, takes from the command buffer.
+// Polygon mode and blending are only dynamic with VK_EXT_extended_dynamic_state3
+struct GraphicsState {
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+    VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+    bool depthTest = false;
+    bool depthWrite = false;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_NEVER;
+
+    // premultiplied alpha when enabled, like PipelineBuilder::enableBlendingPremultiplied
+    bool blending = false;
+    uint32_t colorAttachmentCount = 1;
+};
+
+// records a GraphicsState, the dynamic state 3 commands are fetched from the device
+class DynamicStateCommands {
+public:
+    void init(VkDevice device, bool dynamicState3);
+
+    void set(VkCommandBuffer cmd, const GraphicsState& state) const;
+
+    [[nodiscard]] bool hasDynamicState3() const { return m_dynamicState3; }
+
+private:
+    bool m_dynamicState3 = false;
+    PFN_vkCmdSetPolygonModeEXT m_cmdSetPolygonMode = nullptr;
+    PFN_vkCmdSetColorBlendEnableEXT m_cmdSetColorBlendEnable = nullptr;
+    PFN_vkCmdSetColorBlendEquationEXT m_cmdSetColorBlendEquation = nullptr;
+    PFN_vkCmdSetColorWriteMaskEXT m_cmdSetColorWriteMask = nullptr;
+};
+
 class PipelineBuilder {
 public:
     PipelineBuilder(VulkanContext* ctx) : m_ctx(ctx) {
@@ -23,24 +80,64 @@ public:
 
     void setShaders(VkShaderModule vertexShader, VkShaderModule fragmentShader);
 
+    // vertex stage only, for depth-only passes
+    void setVertexShader(VkShaderModule vertexShader);
+
     void setInputTopology(VkPrimitiveTopology topology);
 
     void setPolygonMode(VkPolygonMode mode);
 
     void setCullMode(VkCullModeFlags cullMode, VkFrontFace frontFace);
 
+    void setDepthBias(float constantFactor, float slopeFactor);
+
     void setMultiSamplingNone();
 
     void disableBlending();
 
+    // source colors are already multiplied by their alpha, such as an offscreen UI layer
+    void enableBlendingPremultiplied();
+
+    // outColor = srcColor + dstColor, such as counting fragments
+    void enableBlendingAdditive();
+
     void setColorAttachmentFormat(VkFormat format);
 
     void setDepthFormat(VkFormat format);
 
     void disableDepthTest();
 
+    void enableDepthTest(bool depthWriteEnable, VkCompareOp op);
+
+    // render into every layer set in the mask in a single pass (multiview)
+    void setViewMask(uint32_t viewMask);
+
+    // cull mode, front face, topology and the depth states are set while recording, so pipelines that
+    // only differ in them collapse into one. With dynamic state 3 polygon mode and blending join them
+    void enableDynamicState(bool dynamicState3);
+
+    // pipelines reading descriptor buffers need VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT
+    void setCreateFlags(VkPipelineCreateFlags flags);
+
     VkPipeline buildPipeline(VkDevice device);
 
+    // shaders, topology, rasterizer, blend, depth, formats, layout and flags
+    [[nodiscard]] PipelineKey getKey() const;
+    // only the shaders and state that the given VK_EXT_graphics_pipeline_library parts compile
+    [[nodiscard]] PipelineKey getKey(VkGraphicsPipelineLibraryFlagsEXT parts) const;
+
+    // compiles only the given parts of the state as a VK_EXT_graphics_pipeline_library library
+    VkPipeline buildLibrary(VkDevice device, VkGraphicsPipelineLibraryFlagsEXT parts);
+
+    // links the four parts into a complete pipeline, optimized links take far longer
+    static VkPipeline linkLibraries(
+        VkDevice device,
+        std::span<const VkPipeline> libraries,
+        VkPipelineLayout layout,
+        VkPipelineCreateFlags flags,
+        bool optimized
+    );
+
     std::vector<VkPipelineShaderStageCreateInfo> m_shaderStages;
 
     VkPipelineInputAssemblyStateCreateInfo m_inputAssembly;
@@ -51,7 +148,37 @@ public:
     VkPipelineDepthStencilStateCreateInfo m_depthStencil;
     VkPipelineRenderingCreateInfo m_renderInfo;
     VkFormat m_colorAttachmentFormat;
+    VkPipelineCreateFlags m_createFlags;
+    bool m_dynamicState;
+    bool m_dynamicState3;
 
 private:
+    VkPipeline build(VkDevice device, const void* pNext, VkPipelineCreateFlags flags,
+                     std::span<const VkPipelineShaderStageCreateInfo> stages);
+
     VulkanContext* m_ctx;
 };
+
+struct PipelineRegistryStats {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+};
+
+// owns every pipeline built through it and hands out the existing one when an identical description
+// is built again
+class PipelineRegistry {
+public:
+    void init(VkDevice device);
+
+    void destroy();
+
+    VkPipeline getPipeline(PipelineBuilder& builder);
+
+    [[nodiscard]] const PipelineRegistryStats& getStats() const { return m_stats; }
+    [[nodiscard]] uint32_t getPipelineCount() const { return static_cast<uint32_t>(m_pipelines.size()); }
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::unordered_map<PipelineKey, VkPipeline, PipelineKeyHash> m_pipelines;
+    PipelineRegistryStats m_stats;
+};
@@ -0,0 +1,167 @@
+#include "VkPipelineLibrary.hpp"
+
+#include "VkEngine.hpp"
+#include "VkPipeline.hpp"
+
+#include <chrono>
+#include <cstring>
+
+static float millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PipelineLibrary::init(VulkanEngine* engine, JobSystem* jobSystem) {
+    m_engine = engine;
+    m_jobSystem = jobSystem;
+
+    engine->getMainDeletionQueue().push_function([this] {
+        const VkDevice device = m_engine->getContext()->getDevice();
+
+        waitForCompiles();
+
+        for (const auto& pipeline: m_pipelines) {
+            vkDestroyPipeline(device, pipeline->current, nullptr);
+            if (!pipeline->swapped && pipeline->optimized != VK_NULL_HANDLE) {
+                vkDestroyPipeline(device, pipeline->optimized, nullptr);
+            }
+        }
+        // the parts are shared, they are destroyed once
+        for (const auto& [key, library]: m_vertexInputLibraries) {
+            vkDestroyPipeline(device, library, nullptr);
+        }
+        for (const auto& [key, library]: m_fragmentOutputLibraries) {
+            vkDestroyPipeline(device, library, nullptr);
+        }
+        for (const auto& [key, library]: m_shaderLibraries) {
+            vkDestroyPipeline(device, library, nullptr);
+        }
+
+        m_pipelines.clear();
+        m_vertexInputLibraries.clear();
+        m_fragmentOutputLibraries.clear();
+        m_shaderLibraries.clear();
+    });
+}
+
+uint32_t PipelineLibrary::createPipeline(PipelineBuilder& builder) {
+    const VkDevice device = m_engine->getContext()->getDevice();
+    auto pipeline = std::make_unique<LinkedPipeline>();
+
+    pipeline->libraries[0] = getVertexInputLibrary(builder);
+    pipeline->libraries[1] = getShaderLibrary(builder, VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT);
+    pipeline->libraries[2] = getShaderLibrary(builder, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT);
+    pipeline->libraries[3] = getFragmentOutputLibrary(builder);
+    pipeline->layout = builder.m_pipelineLayout;
+    pipeline->flags = builder.m_createFlags;
+
+    // linking without optimization only patches the parts together, compiling missing parts is not timed
+    const auto start = std::chrono::steady_clock::now();
+    pipeline->current = PipelineBuilder::linkLibraries(device, pipeline->libraries, pipeline->layout,
+                                                       pipeline->flags, false);
+    m_stats.fastLinked++;
+    m_stats.lastFastLinkMs = millisecondsSince(start);
+
+    LinkedPipeline* linked = pipeline.get();
+    m_jobSystem->run([this, linked] { compileOptimized(linked); }, &linked->counter);
+
+    m_pipelines.push_back(std::move(pipeline));
+    return static_cast<uint32_t>(m_pipelines.size() - 1);
+}
+
+void PipelineLibrary::waitForCompiles() {
+    for (const auto& pipeline: m_pipelines) {
+        m_jobSystem->wait(pipeline->counter);
+    }
+}
+
+void PipelineLibrary::update() {
+    for (const auto& pipeline: m_pipelines) {
+        if (pipeline->swapped || !pipeline->counter.isDone()) {
+            continue;
+        }
+
+        // frames in flight may still draw with the fast linked pipeline, it goes once this slot comes around
+        VkPipeline fastLinked = pipeline->current;
+        m_engine->getCurrentFrame().deletionQueue.push_function([this, fastLinked] {
+            vkDestroyPipeline(m_engine->getContext()->getDevice(), fastLinked, nullptr);
+        });
+
+        pipeline->current = pipeline->optimized;
+        pipeline->swapped = true;
+        m_stats.optimized++;
+        m_stats.lastOptimizedMs = pipeline->optimizedMs;
+    }
+}
+
+VkPipeline PipelineLibrary::getVertexInputLibrary(PipelineBuilder& builder) {
+    VertexInputKey key{};
+    key.topology = builder.m_inputAssembly.topology;
+    key.primitiveRestartEnable = builder.m_inputAssembly.primitiveRestartEnable;
+    key.flags = builder.m_createFlags;
+    key.dynamicState = builder.m_dynamicState;
+    key.dynamicState3 = builder.m_dynamicState3;
+
+    for (const auto& [existing, library]: m_vertexInputLibraries) {
+        if (std::memcmp(&existing, &key, sizeof(VertexInputKey)) == 0) {
+            return library;
+        }
+    }
+
+    VkPipeline library = builder.buildLibrary(m_engine->getContext()->getDevice(),
+                                              VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT);
+    m_vertexInputLibraries.emplace_back(key, library);
+    m_stats.libraries++;
+    return library;
+}
+
+VkPipeline PipelineLibrary::getFragmentOutputLibrary(PipelineBuilder& builder) {
+    FragmentOutputKey key{};
+    key.colorFormat = builder.m_colorAttachmentFormat;
+    key.depthFormat = builder.m_renderInfo.depthAttachmentFormat;
+    key.colorAttachmentCount = builder.m_renderInfo.colorAttachmentCount;
+    key.viewMask = builder.m_renderInfo.viewMask;
+    // blending set while recording does not tell the parts apart
+    if (!builder.m_dynamicState3) {
+        key.blend = builder.m_colorBlendAttachment;
+    }
+    key.rasterizationSamples = builder.m_multisampling.rasterizationSamples;
+    key.sampleShadingEnable = builder.m_multisampling.sampleShadingEnable;
+    key.minSampleShading = builder.m_multisampling.minSampleShading;
+    key.alphaToCoverageEnable = builder.m_multisampling.alphaToCoverageEnable;
+    key.alphaToOneEnable = builder.m_multisampling.alphaToOneEnable;
+    key.flags = builder.m_createFlags;
+    key.dynamicState = builder.m_dynamicState;
+    key.dynamicState3 = builder.m_dynamicState3;
+
+    // every member is 32 bits wide, there is no padding to trip the comparison
+    for (const auto& [existing, library]: m_fragmentOutputLibraries) {
+        if (std::memcmp(&existing, &key, sizeof(FragmentOutputKey)) == 0) {
+            return library;
+        }
+    }
+
+    VkPipeline library = builder.buildLibrary(m_engine->getContext()->getDevice(),
+                                              VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT);
+    m_fragmentOutputLibraries.emplace_back(key, library);
+    m_stats.libraries++;
+    return library;
+}
+
+VkPipeline PipelineLibrary::getShaderLibrary(PipelineBuilder& builder, VkGraphicsPipelineLibraryFlagsEXT part) {
+    PipelineKey key = builder.getKey(part);
+    if (const auto it = m_shaderLibraries.find(key); it != m_shaderLibraries.end()) {
+        return it->second;
+    }
+
+    VkPipeline library = builder.buildLibrary(m_engine->getContext()->getDevice(), part);
+    m_shaderLibraries.emplace(std::move(key), library);
+    m_stats.libraries++;
+    return library;
+}
+
+void PipelineLibrary::compileOptimized(LinkedPipeline* pipeline) const {
+    const auto start = std::chrono::steady_clock::now();
+    pipeline->optimized = PipelineBuilder::linkLibraries(m_engine->getContext()->getDevice(), pipeline->libraries,
+                                                         pipeline->layout, pipeline->flags, true);
+    pipeline->optimizedMs = millisecondsSince(start);
+}
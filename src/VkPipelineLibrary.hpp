@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "VkTypes.hpp"
+#include "VkPipeline.hpp"
+#include "JobSystem.hpp"
+
+class VulkanEngine;
+
+struct PipelineLibraryStats {
+    uint32_t libraries = 0;
+    uint32_t fastLinked = 0;
+    uint32_t optimized = 0;
+    float lastFastLinkMs = 0.f;
+    float lastOptimizedMs = 0.f;
+};
+
+// VK_EXT_graphics_pipeline_library: a pipeline is compiled as four independent parts. Every part is
+// shared between pipelines with the same shaders and state, a new combination is fast linked in
+// microseconds and used until the link time optimized pipeline, compiled on a worker, replaces it
+class PipelineLibrary {
+public:
+    void init(VulkanEngine* engine, JobSystem* jobSystem);
+
+    // compiles the builder's state and returns a handle to it, the pipeline is usable at once
+    uint32_t createPipeline(PipelineBuilder& builder);
+
+    // the optimized pipeline once it is ready, the fast linked one until then
+    [[nodiscard]] VkPipeline getPipeline(uint32_t handle) const { return m_pipelines[handle]->current; }
+
+    // swaps in the optimized pipelines that finished, once per frame after its fence was waited on
+    void update();
+
+    // the background compiles use the pipeline layouts, wait for them before destroying one
+    void waitForCompiles();
+
+    [[nodiscard]] const PipelineLibraryStats& getStats() const { return m_stats; }
+
+private:
+    struct LinkedPipeline {
+        // vertex input, pre-rasterization, fragment shader and fragment output
+        std::array<VkPipeline, 4> libraries{};
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        VkPipelineCreateFlags flags = 0;
+
+        VkPipeline current = VK_NULL_HANDLE;
+        // written by the worker, read once its counter is done
+        VkPipeline optimized = VK_NULL_HANDLE;
+        float optimizedMs = 0.f;
+        JobCounter counter;
+        bool swapped = false;
+    };
+
+    // the dynamic state flags change the pipeline's dynamic state list, so they are part of both keys
+    struct VertexInputKey {
+        VkPrimitiveTopology topology;
+        VkBool32 primitiveRestartEnable;
+        VkPipelineCreateFlags flags;
+        VkBool32 dynamicState;
+        VkBool32 dynamicState3;
+    };
+
+    struct FragmentOutputKey {
+        VkFormat colorFormat;
+        VkFormat depthFormat;
+        uint32_t colorAttachmentCount;
+        uint32_t viewMask;
+        VkPipelineColorBlendAttachmentState blend;
+        // the sample mask is always null and left out
+        VkSampleCountFlagBits rasterizationSamples;
+        VkBool32 sampleShadingEnable;
+        float minSampleShading;
+        VkBool32 alphaToCoverageEnable;
+        VkBool32 alphaToOneEnable;
+        VkPipelineCreateFlags flags;
+        VkBool32 dynamicState;
+        VkBool32 dynamicState3;
+    };
+
+    // the parts that only depend on a few states are shared between pipelines
+    VkPipeline getVertexInputLibrary(PipelineBuilder& builder);
+    VkPipeline getFragmentOutputLibrary(PipelineBuilder& builder);
+    // pre-rasterization and fragment shader parts, keyed by their shader hashes, state and layout
+    VkPipeline getShaderLibrary(PipelineBuilder& builder, VkGraphicsPipelineLibraryFlagsEXT part);
+
+    void compileOptimized(LinkedPipeline* pipeline) const;
+
+    VulkanEngine* m_engine = nullptr;
+    JobSystem* m_jobSystem = nullptr;
+
+    // pointers stay stable for the workers while the vector grows
+    std::vector<std::unique_ptr<LinkedPipeline>> m_pipelines;
+
+    std::vector<std::pair<VertexInputKey, VkPipeline>> m_vertexInputLibraries;
+    std::vector<std::pair<FragmentOutputKey, VkPipeline>> m_fragmentOutputLibraries;
+    std::unordered_map<PipelineKey, VkPipeline, PipelineKeyHash> m_shaderLibraries;
+
+    PipelineLibraryStats m_stats;
+};
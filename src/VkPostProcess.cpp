@@ -0,0 +1,316 @@
+#include "VkPostProcess.hpp"
+
+#include <algorithm>
+
+#include "VkEngine.hpp"
+#include "VkGpuProfiler.hpp"
+#include "VkImage.hpp"
+#include "VkPipeline.hpp"
+#include "VkSync.hpp"
+
+// must match local_size in bloomDownsample.comp / bloomUpsample.comp and tonemap.comp
+constexpr uint32_t BLOOM_GROUP_SIZE = 8;
+constexpr uint32_t TONEMAP_GROUP_SIZE = 16;
+
+static VkPipeline createComputePipeline(VkDevice device, VkPipelineLayout layout, const char* shaderPath) {
+    VkShaderModule shader;
+    if (!VkUtils::loadShaderModule(shaderPath, device, &shader)) {
+        std::cerr << "Error when building the compute shader " << shaderPath << std::endl;
+    }
+
+    const VkComputePipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = nullptr,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = shader,
+            .pName = "main",
+        },
+        .layout = layout,
+    };
+
+    VkPipeline pipeline;
+    VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+
+    VkUtils::destroyShaderModule(device, shader);
+
+    return pipeline;
+}
+
+static VkFormat chooseBloomFormat(VkPhysicalDevice physicalDevice) {
+    // packed 32 bit float halves the bandwidth of every bloom pass compared to RGBA16F
+    constexpr VkFormatFeatureFlags required = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT |
+                                              VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                              VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    VkFormatProperties properties{};
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_B10G11R11_UFLOAT_PACK32, &properties);
+
+    if ((properties.optimalTilingFeatures & required) == required) {
+        return VK_FORMAT_B10G11R11_UFLOAT_PACK32;
+    }
+
+    return VK_FORMAT_R16G16B16A16_SFLOAT;
+}
+
+void PostProcess::init(VulkanEngine* engine, const AllocatedImage& drawImage) {
+    m_engine = engine;
+    const VkDevice device = engine->getContext()->getDevice();
+
+    m_bloomChain.imageFormat = chooseBloomFormat(engine->getContext()->getPhysicalDevice());
+    m_bloomChain.imageExtent = {
+        std::max(drawImage.imageExtent.width / 2, 1u),
+        std::max(drawImage.imageExtent.height / 2, 1u),
+        1
+    };
+
+    const VkImageCreateInfo imageInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = nullptr,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = m_bloomChain.imageFormat,
+        .extent = m_bloomChain.imageExtent,
+        .mipLevels = BLOOM_MIP_COUNT,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+    };
+
+    constexpr VmaAllocationCreateInfo allocInfo = {
+        .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+        .requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+
+    VK_CHECK(vmaCreateImage(engine->getAllocator(), &imageInfo, &allocInfo,
+                            &m_bloomChain.image, &m_bloomChain.allocation, nullptr));
+
+    VkImageViewCreateInfo viewInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = nullptr,
+        .image = m_bloomChain.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = m_bloomChain.imageFormat,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = BLOOM_MIP_COUNT,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        }
+    };
+
+    VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &m_bloomChainView));
+
+    for (uint32_t mip = 0; mip < BLOOM_MIP_COUNT; mip++) {
+        viewInfo.subresourceRange.baseMipLevel = mip;
+        viewInfo.subresourceRange.levelCount = 1;
+        VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &m_bloomMipViews[mip]));
+
+        m_bloomMipExtents[mip] = {
+            std::max(m_bloomChain.imageExtent.width >> mip, 1u),
+            std::max(m_bloomChain.imageExtent.height >> mip, 1u),
+        };
+    }
+
+    // the chain is read and written by compute only, it lives in the general layout
+    engine->immediateSubmit([&](VkCommandBuffer cmd) {
+        const VkImageSubresourceRange range{
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = BLOOM_MIP_COUNT,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        };
+        VkUtils::transitionImageRange(cmd, m_bloomChain.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, range);
+    });
+
+    const VkSamplerCreateInfo samplerInfo{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = nullptr,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .minLod = 0.f,
+        .maxLod = static_cast<float>(BLOOM_MIP_COUNT),
+    };
+
+    VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_linearSampler));
+
+    // every pass samples one image and writes another
+    {
+        DescriptorLayoutBuilder builder;
+        builder.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        builder.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        m_descriptorLayout = builder.build(device, VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    std::vector<DescriptorAllocator::PoolSizeRatio> sizes = {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+    };
+    m_descriptorAllocator.initPool(device, BLOOM_MIP_COUNT * 2, sizes);
+
+    for (uint32_t mip = 0; mip < BLOOM_MIP_COUNT; mip++) {
+        m_downsampleSets[mip] = m_descriptorAllocator.allocate(device, m_descriptorLayout);
+
+        DescriptorWriter writer;
+        writer.writeImage(0, mip == 0 ? drawImage.imageView : m_bloomChainView, m_linearSampler,
+                          VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.writeImage(1, m_bloomMipViews[mip], VK_NULL_HANDLE,
+                          VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.updateSet(device, m_downsampleSets[mip]);
+    }
+
+    for (uint32_t mip = 0; mip < BLOOM_MIP_COUNT - 1; mip++) {
+        m_upsampleSets[mip] = m_descriptorAllocator.allocate(device, m_descriptorLayout);
+
+        DescriptorWriter writer;
+        writer.writeImage(0, m_bloomChainView, m_linearSampler,
+                          VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.writeImage(1, m_bloomMipViews[mip], VK_NULL_HANDLE,
+                          VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.updateSet(device, m_upsampleSets[mip]);
+    }
+
+    m_tonemapSet = m_descriptorAllocator.allocate(device, m_descriptorLayout);
+    {
+        DescriptorWriter writer;
+        writer.writeImage(0, m_bloomChainView, m_linearSampler,
+                          VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.writeImage(1, drawImage.imageView, VK_NULL_HANDLE,
+                          VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.updateSet(device, m_tonemapSet);
+    }
+
+    const VkPushConstantRange pushConstant{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(ComputePushConstants),
+    };
+
+    const VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .setLayoutCount = 1,
+        .pSetLayouts = &m_descriptorLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstant,
+    };
+
+    VK_CHECK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &m_pipelineLayout));
+
+    m_downsamplePipeline = createComputePipeline(device, m_pipelineLayout, HELLFIRE_SHADER_DIR "/bloomDownsample.comp.spv");
+    m_upsamplePipeline = createComputePipeline(device, m_pipelineLayout, HELLFIRE_SHADER_DIR "/bloomUpsample.comp.spv");
+    m_tonemapPipeline = createComputePipeline(device, m_pipelineLayout, HELLFIRE_SHADER_DIR "/tonemap.comp.spv");
+
+    engine->getMainDeletionQueue().push_function([this, device] {
+        vkDestroyPipeline(device, m_tonemapPipeline, nullptr);
+        vkDestroyPipeline(device, m_upsamplePipeline, nullptr);
+        vkDestroyPipeline(device, m_downsamplePipeline, nullptr);
+        vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+
+        m_descriptorAllocator.destroyPool(device);
+        vkDestroyDescriptorSetLayout(device, m_descriptorLayout, nullptr);
+
+        vkDestroySampler(device, m_linearSampler, nullptr);
+        for (const auto view: m_bloomMipViews) {
+            vkDestroyImageView(device, view, nullptr);
+        }
+        vkDestroyImageView(device, m_bloomChainView, nullptr);
+        vmaDestroyImage(m_engine->getAllocator(), m_bloomChain.image, m_bloomChain.allocation);
+    });
+}
+
+void PostProcess::apply(VkCommandBuffer cmd, GpuProfiler& profiler, VkExtent2D drawExtent) const {
+    applyBloom(cmd, profiler, drawExtent);
+
+    if (!tonemapEnabled) {
+        return;
+    }
+
+    const uint32_t tonemapScope = profiler.beginScope(cmd, "tonemap");
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_tonemapPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_tonemapSet, 0, nullptr);
+
+    ComputePushConstants pushConstants{};
+    pushConstants.data1 = glm::vec4(exposure, bloomEnabled ? bloomIntensity : 0.f, 0.f, 0.f);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants), &pushConstants);
+
+    vkCmdDispatch(cmd,
+                  (drawExtent.width + TONEMAP_GROUP_SIZE - 1) / TONEMAP_GROUP_SIZE,
+                  (drawExtent.height + TONEMAP_GROUP_SIZE - 1) / TONEMAP_GROUP_SIZE,
+                  1);
+    m_engine->getFrameCounters().dispatches++;
+
+    profiler.endScope(cmd, tonemapScope);
+}
+
+void PostProcess::applyBloom(VkCommandBuffer cmd, GpuProfiler& profiler, VkExtent2D drawExtent) const {
+    if (!bloomEnabled) {
+        return;
+    }
+
+    // the draw image was last written as an attachment or storage image
+    VkUtils::memoryBarrier(cmd,
+                           VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                           VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+
+    const auto dispatchLevel = [&](VkExtent2D extent) {
+        vkCmdDispatch(cmd,
+                      (extent.width + BLOOM_GROUP_SIZE - 1) / BLOOM_GROUP_SIZE,
+                      (extent.height + BLOOM_GROUP_SIZE - 1) / BLOOM_GROUP_SIZE,
+                      1);
+        m_engine->getFrameCounters().dispatches++;
+
+        VkUtils::memoryBarrier(cmd,
+                               VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                               VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+    };
+
+    const uint32_t downsampleScope = profiler.beginScope(cmd, "bloom downsample");
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_downsamplePipeline);
+
+    for (uint32_t mip = 0; mip < BLOOM_MIP_COUNT; mip++) {
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_downsampleSets[mip], 0, nullptr);
+
+        // the first level prefilters the draw image, the others read the previous chain level
+        ComputePushConstants pushConstants{};
+        pushConstants.data1 = glm::vec4(mip == 0 ? 0.f : static_cast<float>(mip - 1),
+                                        bloomThreshold, bloomKnee, mip == 0 ? 1.f : 0.f);
+        pushConstants.data2 = glm::vec4(static_cast<float>(drawExtent.width), static_cast<float>(drawExtent.height), 0.f, 0.f);
+        vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants), &pushConstants);
+
+        dispatchLevel(m_bloomMipExtents[mip]);
+    }
+
+    profiler.endScope(cmd, downsampleScope);
+
+    const uint32_t upsampleScope = profiler.beginScope(cmd, "bloom upsample");
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_upsamplePipeline);
+
+    // walk back up the chain, every level accumulates the tent filtered level below it
+    for (int mip = static_cast<int>(BLOOM_MIP_COUNT) - 2; mip >= 0; mip--) {
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_upsampleSets[mip], 0, nullptr);
+
+        ComputePushConstants pushConstants{};
+        pushConstants.data1 = glm::vec4(static_cast<float>(mip + 1), 0.f, 0.f, 0.f);
+        vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants), &pushConstants);
+
+        dispatchLevel(m_bloomMipExtents[mip]);
+    }
+
+    profiler.endScope(cmd, upsampleScope);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkDescriptors.hpp"
+
+class VulkanEngine;
+class GpuProfiler;
+
+// the chain starts at half resolution, six levels reach a wide enough radius at 1080p
+constexpr uint32_t BLOOM_MIP_COUNT = 6;
+
+// HDR post stack: progressive bloom downsample/upsample chain followed by a filmic tonemapper.
+// Every stage is a compute pass that tiles its source footprint through shared memory
+class PostProcess {
+public:
+    void init(VulkanEngine* engine, const AllocatedImage& drawImage);
+
+    // bloom and tonemap the draw image in place, it must be in the general layout
+    void apply(VkCommandBuffer cmd, GpuProfiler& profiler, VkExtent2D drawExtent) const;
+
+    // bloom only, for passes that apply the tonemapper themselves
+    void applyBloom(VkCommandBuffer cmd, GpuProfiler& profiler, VkExtent2D drawExtent) const;
+
+    [[nodiscard]] VkImageView getBloomView() const { return m_bloomChainView; }
+    [[nodiscard]] VkSampler getLinearSampler() const { return m_linearSampler; }
+    [[nodiscard]] VkFormat getBloomFormat() const { return m_bloomChain.imageFormat; }
+
+    bool bloomEnabled = true;
+    bool tonemapEnabled = true;
+    // luminance where bloom starts, with a soft knee below it
+    float bloomThreshold = 1.f;
+    float bloomKnee = 0.5f;
+    float bloomIntensity = 0.05f;
+    float exposure = 1.f;
+
+private:
+    VulkanEngine* m_engine = nullptr;
+
+    AllocatedImage m_bloomChain{};
+    // whole chain for sampling, single levels for storage writes
+    VkImageView m_bloomChainView = VK_NULL_HANDLE;
+    VkImageView m_bloomMipViews[BLOOM_MIP_COUNT]{};
+    VkExtent2D m_bloomMipExtents[BLOOM_MIP_COUNT]{};
+
+    VkSampler m_linearSampler = VK_NULL_HANDLE;
+
+    DescriptorAllocator m_descriptorAllocator{};
+    VkDescriptorSetLayout m_descriptorLayout = VK_NULL_HANDLE;
+    // prefilter reads the draw image, every other level reads the chain
+    VkDescriptorSet m_downsampleSets[BLOOM_MIP_COUNT]{};
+    VkDescriptorSet m_upsampleSets[BLOOM_MIP_COUNT - 1]{};
+    VkDescriptorSet m_tonemapSet = VK_NULL_HANDLE;
+
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_downsamplePipeline = VK_NULL_HANDLE;
+    VkPipeline m_upsamplePipeline = VK_NULL_HANDLE;
+    VkPipeline m_tonemapPipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,122 @@
+#include "VkShaderObject.hpp"
+
+#include "VkTypes.hpp"
+
+#include <array>
+
+template<typename T>
+static void loadFunction(VkDevice device, const char* name, T& outFunction) {
+    outFunction = reinterpret_cast<T>(vkGetDeviceProcAddr(device, name));
+}
+
+void ShaderObjects::init(VkDevice device) {
+    // extension entry points are not exported by the loader, fetch them from the device
+    loadFunction(device, "vkCreateShadersEXT", m_createShaders);
+    loadFunction(device, "vkDestroyShaderEXT", m_destroyShader);
+    loadFunction(device, "vkCmdBindShadersEXT", m_cmdBindShaders);
+    loadFunction(device, "vkCmdSetVertexInputEXT", m_cmdSetVertexInput);
+    loadFunction(device, "vkCmdSetRasterizationSamplesEXT", m_cmdSetRasterizationSamples);
+    loadFunction(device, "vkCmdSetSampleMaskEXT", m_cmdSetSampleMask);
+    loadFunction(device, "vkCmdSetAlphaToCoverageEnableEXT", m_cmdSetAlphaToCoverageEnable);
+
+    m_dynamicState.init(device, true);
+}
+
+bool ShaderObjects::createGraphicsShaders(
+    VkDevice device,
+    std::span<const uint32_t> vertexCode,
+    std::span<const uint32_t> fragmentCode,
+    std::span<const VkDescriptorSetLayout> setLayouts,
+    std::span<const VkPushConstantRange> pushConstantRanges,
+    VkShaderEXT* outVertexShader,
+    VkShaderEXT* outFragmentShader
+) const {
+    // linked stages let the driver optimize across the interface like it would for a pipeline
+    const std::array createInfos{
+        VkShaderCreateInfoEXT{
+            .sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+            .flags = VK_SHADER_CREATE_LINK_STAGE_BIT_EXT,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .nextStage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+            .codeSize = vertexCode.size_bytes(),
+            .pCode = vertexCode.data(),
+            .pName = "main",
+            .setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
+            .pSetLayouts = setLayouts.data(),
+            .pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size()),
+            .pPushConstantRanges = pushConstantRanges.data(),
+        },
+        VkShaderCreateInfoEXT{
+            .sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+            .flags = VK_SHADER_CREATE_LINK_STAGE_BIT_EXT,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .nextStage = 0,
+            .codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+            .codeSize = fragmentCode.size_bytes(),
+            .pCode = fragmentCode.data(),
+            .pName = "main",
+            .setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
+            .pSetLayouts = setLayouts.data(),
+            .pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size()),
+            .pPushConstantRanges = pushConstantRanges.data(),
+        },
+    };
+
+    std::array<VkShaderEXT, 2> shaders{};
+    if (m_createShaders(device, static_cast<uint32_t>(createInfos.size()), createInfos.data(), nullptr,
+                        shaders.data()) != VK_SUCCESS) {
+        return false;
+    }
+
+    *outVertexShader = shaders[0];
+    *outFragmentShader = shaders[1];
+    return true;
+}
+
+void ShaderObjects::destroyShader(VkDevice device, VkShaderEXT shader) const {
+    m_destroyShader(device, shader, nullptr);
+}
+
+void ShaderObjects::bindGraphicsShaders(VkCommandBuffer cmd, VkShaderEXT vertexShader, VkShaderEXT fragmentShader) const {
+    // tessellation and geometry are not enabled on the device, so only these two stages are bound
+    constexpr std::array stages = {VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT};
+    const std::array shaders = {vertexShader, fragmentShader};
+    m_cmdBindShaders(cmd, static_cast<uint32_t>(stages.size()), stages.data(), shaders.data());
+}
+
+void ShaderObjects::setState(VkCommandBuffer cmd, const GraphicsState& state, VkExtent2D extent) const {
+    const VkViewport viewport{
+        .x = 0.f,
+        .y = 0.f,
+        .width = static_cast<float>(extent.width),
+        .height = static_cast<float>(extent.height),
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    };
+    const VkRect2D scissor{
+        .offset = {0, 0},
+        .extent = extent,
+    };
+    vkCmdSetViewportWithCount(cmd, 1, &viewport);
+    vkCmdSetScissorWithCount(cmd, 1, &scissor);
+
+    // vertices are pulled from buffer device addresses, there is no vertex input
+    m_cmdSetVertexInput(cmd, 0, nullptr, 0, nullptr);
+    vkCmdSetPrimitiveRestartEnable(cmd, VK_FALSE);
+
+    vkCmdSetRasterizerDiscardEnable(cmd, VK_FALSE);
+    vkCmdSetDepthBiasEnable(cmd, VK_FALSE);
+    if (state.polygonMode == VK_POLYGON_MODE_LINE) {
+        vkCmdSetLineWidth(cmd, 1.f);
+    }
+
+    constexpr VkSampleMask sampleMask = ~0u;
+    m_cmdSetRasterizationSamples(cmd, VK_SAMPLE_COUNT_1_BIT);
+    m_cmdSetSampleMask(cmd, VK_SAMPLE_COUNT_1_BIT, &sampleMask);
+    m_cmdSetAlphaToCoverageEnable(cmd, VK_FALSE);
+    vkCmdSetStencilTestEnable(cmd, VK_FALSE);
+
+    // everything a dynamic pipeline would leave to the command buffer as well
+    m_dynamicState.set(cmd, state);
+}
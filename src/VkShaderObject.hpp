@@ -0,0 +1,45 @@
+#pragma once
+
+#include <span>
+
+#include <vulkan/vulkan.h>
+
+#include "VkPipeline.hpp"
+
+// VK_EXT_shader_object: shaders are compiled once without any fixed function state, so a new state
+// combination never has to wait for a pipeline compile
+class ShaderObjects {
+public:
+    void init(VkDevice device);
+
+    // vertex and fragment stage linked in one call, the layouts must match the pipeline layout
+    // used for push constants and descriptors
+    bool createGraphicsShaders(
+        VkDevice device,
+        std::span<const uint32_t> vertexCode,
+        std::span<const uint32_t> fragmentCode,
+        std::span<const VkDescriptorSetLayout> setLayouts,
+        std::span<const VkPushConstantRange> pushConstantRanges,
+        VkShaderEXT* outVertexShader,
+        VkShaderEXT* outFragmentShader
+    ) const;
+
+    void destroyShader(VkDevice device, VkShaderEXT shader) const;
+
+    void bindGraphicsShaders(VkCommandBuffer cmd, VkShaderEXT vertexShader, VkShaderEXT fragmentShader) const;
+
+    // sets every piece of state a draw with shader objects requires, viewport and scissor cover the extent
+    void setState(VkCommandBuffer cmd, const GraphicsState& state, VkExtent2D extent) const;
+
+private:
+    PFN_vkCreateShadersEXT m_createShaders = nullptr;
+    PFN_vkDestroyShaderEXT m_destroyShader = nullptr;
+    PFN_vkCmdBindShadersEXT m_cmdBindShaders = nullptr;
+    PFN_vkCmdSetVertexInputEXT m_cmdSetVertexInput = nullptr;
+    PFN_vkCmdSetRasterizationSamplesEXT m_cmdSetRasterizationSamples = nullptr;
+    PFN_vkCmdSetSampleMaskEXT m_cmdSetSampleMask = nullptr;
+    PFN_vkCmdSetAlphaToCoverageEnableEXT m_cmdSetAlphaToCoverageEnable = nullptr;
+
+    // the extension exposes every dynamic state 3 command a pipeline could leave dynamic
+    DynamicStateCommands m_dynamicState;
+};
@@ -0,0 +1,333 @@
+#include "VkShadows.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+#include "VkEngine.hpp"
+#include "VkImage.hpp"
+#include "VkPipeline.hpp"
+
+constexpr VkFormat SHADOW_MAP_FORMAT = VK_FORMAT_D32_SFLOAT;
+
+void CascadedShadows::init(VulkanEngine* engine, VkDescriptorSetLayout sceneLayout) {
+    m_engine = engine;
+    const VkDevice device = engine->getContext()->getDevice();
+
+    m_shadowMap.imageFormat = SHADOW_MAP_FORMAT;
+    m_shadowMap.imageExtent = {SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION, 1};
+
+    const VkImageCreateInfo imageInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = nullptr,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = m_shadowMap.imageFormat,
+        .extent = m_shadowMap.imageExtent,
+        .mipLevels = 1,
+        .arrayLayers = SHADOW_CASCADE_COUNT,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+    };
+
+    constexpr VmaAllocationCreateInfo allocInfo = {
+        .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+        .requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+
+    VK_CHECK(vmaCreateImage(engine->getAllocator(), &imageInfo, &allocInfo,
+                            &m_shadowMap.image, &m_shadowMap.allocation, nullptr));
+
+    VkImageViewCreateInfo viewInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = nullptr,
+        .image = m_shadowMap.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+        .format = m_shadowMap.imageFormat,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = SHADOW_CASCADE_COUNT,
+        }
+    };
+
+    VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &m_shadowMapArrayView));
+
+    // with multiview, view index i renders into layer baseArrayLayer + i of the attachment
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        viewInfo.subresourceRange.baseArrayLayer = pass * SHADOW_CASCADES_PER_PASS;
+        viewInfo.subresourceRange.layerCount = SHADOW_CASCADES_PER_PASS;
+        VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &m_passViews[pass]));
+    }
+
+    // hardware depth comparison, bilinear filtering gives 2x2 PCF per tap
+    const VkSamplerCreateInfo samplerInfo{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = nullptr,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .compareEnable = VK_TRUE,
+        .compareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+        .minLod = 0.f,
+        .maxLod = 1.f,
+        .borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
+    };
+
+    VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_shadowSampler));
+
+    // the cascades are sampled before their first render, start them in the read layout
+    engine->immediateSubmit([&](VkCommandBuffer cmd) {
+        VkUtils::transitionImageLayers(cmd, m_shadowMap.image,
+                                       VK_IMAGE_LAYOUT_UNDEFINED,
+                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                       VK_IMAGE_ASPECT_DEPTH_BIT, 0, SHADOW_CASCADE_COUNT);
+    });
+
+    VkShaderModule shadowVertexShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/shadow.vert.spv", device, &shadowVertexShader)) {
+        std::cerr << "Error when building the shadow vertex shader module" << std::endl;
+    }
+
+    const VkPushConstantRange pushConstant{
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(ShadowPushConstants),
+    };
+
+    const VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .setLayoutCount = 1,
+        .pSetLayouts = &sceneLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstant,
+    };
+
+    VK_CHECK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &m_pipelineLayout));
+
+    PipelineBuilder pipelineBuilder(engine->getContext());
+    pipelineBuilder.m_pipelineLayout = m_pipelineLayout;
+    pipelineBuilder.setVertexShader(shadowVertexShader);
+    pipelineBuilder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    pipelineBuilder.setPolygonMode(VK_POLYGON_MODE_FILL);
+    pipelineBuilder.setCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+    pipelineBuilder.setDepthBias(1.25f, 1.75f);
+    pipelineBuilder.setMultiSamplingNone();
+    pipelineBuilder.disableBlending();
+    pipelineBuilder.enableDepthTest(true, VK_COMPARE_OP_LESS_OR_EQUAL);
+    pipelineBuilder.setDepthFormat(SHADOW_MAP_FORMAT);
+    pipelineBuilder.setViewMask(SHADOW_VIEW_MASK);
+    pipelineBuilder.setCreateFlags(engine->getScenePipelineFlags());
+
+    m_pipeline = engine->getPipelineRegistry().getPipeline(pipelineBuilder);
+
+    VkUtils::destroyShaderModule(device, shadowVertexShader);
+
+    engine->getMainDeletionQueue().push_function([this, device] {
+        vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+        vkDestroySampler(device, m_shadowSampler, nullptr);
+        for (const auto view: m_passViews) {
+            vkDestroyImageView(device, view, nullptr);
+        }
+        vkDestroyImageView(device, m_shadowMapArrayView, nullptr);
+        vmaDestroyImage(m_engine->getAllocator(), m_shadowMap.image, m_shadowMap.allocation);
+    });
+}
+
+void CascadedShadows::update(
+    GPUSceneData& sceneData,
+    const float fovY,
+    const float aspect,
+    const float near,
+    const uint64_t staticSceneVersion
+) {
+    const glm::vec3 lightDirection = glm::normalize(glm::vec3(sceneData.sunlightDirection));
+    const glm::mat4 inverseView = glm::inverse(sceneData.view);
+
+    // a light space basis that does not depend on the camera, so snapped cascade placements stay stable
+    const glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+    const glm::mat4 lightView = glm::lookAt(glm::vec3(0.f), lightDirection, up);
+
+    bool farDirty = m_farCascadesDirty ||
+                    lightDirection != m_cachedLightDirection ||
+                    staticSceneVersion != m_cachedStaticVersion;
+
+    const float tanHalfFovY = std::tan(fovY * 0.5f);
+    const float tanHalfFovX = tanHalfFovY * aspect;
+
+    float sliceNear = near;
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        // practical split scheme, blending logarithmic and uniform distribution
+        const float p = static_cast<float>(i + 1) / static_cast<float>(SHADOW_CASCADE_COUNT);
+        const float logSplit = near * std::pow(shadowDistance / near, p);
+        const float uniformSplit = near + (shadowDistance - near) * p;
+        const float sliceFar = splitLambda * logSplit + (1.f - splitLambda) * uniformSplit;
+
+        glm::vec3 corners[8];
+        for (uint32_t c = 0; c < 8; c++) {
+            const float depth = (c & 4) ? sliceFar : sliceNear;
+            const glm::vec3 viewCorner{
+                ((c & 1) ? 1.f : -1.f) * depth * tanHalfFovX,
+                ((c & 2) ? 1.f : -1.f) * depth * tanHalfFovY,
+                -depth
+            };
+            corners[c] = glm::vec3(inverseView * glm::vec4(viewCorner, 1.f));
+        }
+
+        // bounding sphere of the slice. Its radius only depends on the projection,
+        // so the cascade does not change size while the camera turns
+        glm::vec3 center{0.f};
+        for (const auto& corner: corners) {
+            center += corner;
+        }
+        center /= 8.f;
+
+        float radius = 0.f;
+        for (const auto& corner: corners) {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        radius = std::ceil(radius * 16.f) / 16.f;
+
+        // near cascades snap to whole texels to avoid shimmering. Cached cascades snap to a coarse grid and grow
+        // by one step so they keep covering their slice until the camera has moved a quarter of the cascade
+        const bool cached = i >= SHADOW_NEAR_CASCADE_COUNT;
+        const float snap = cached ? radius * 0.25f : 2.f * radius / static_cast<float>(SHADOW_MAP_RESOLUTION);
+        const float extent = cached ? radius + snap : radius;
+
+        const glm::vec3 lightCenter = glm::round(glm::vec3(lightView * glm::vec4(center, 1.f)) / snap) * snap;
+        const glm::vec4 placement{lightCenter, extent};
+
+        if (cached && placement != m_cachedPlacement[i]) {
+            farDirty = true;
+        }
+        m_cachedPlacement[i] = placement;
+
+        // casters between the light and the slice must still land in the depth range
+        const float depthExtent = extent + shadowDistance;
+        const glm::mat4 lightProj = glm::ortho(lightCenter.x - extent, lightCenter.x + extent,
+                                               lightCenter.y - extent, lightCenter.y + extent,
+                                               -lightCenter.z - depthExtent, -lightCenter.z + extent);
+
+        sceneData.cascadeViewProj[i] = lightProj * lightView;
+        sceneData.cascadeSplits[i] = sliceFar;
+
+        sliceNear = sliceFar;
+    }
+
+    m_farCascadesDirty = farDirty;
+    m_cachedLightDirection = lightDirection;
+    m_cachedStaticVersion = staticSceneVersion;
+}
+
+void CascadedShadows::render(VkCommandBuffer cmd, std::span<const RenderObject> objects) {
+    VkUtils::transitionImageLayers(cmd, m_shadowMap.image,
+                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                   VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                   VK_IMAGE_ASPECT_DEPTH_BIT, 0, SHADOW_NEAR_CASCADE_COUNT);
+
+    drawCascades(cmd, objects, 0, false);
+
+    VkUtils::transitionImageLayers(cmd, m_shadowMap.image,
+                                   VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                   VK_IMAGE_ASPECT_DEPTH_BIT, 0, SHADOW_NEAR_CASCADE_COUNT);
+
+    m_stats.nearCascadeRenders++;
+
+    // the far cascades keep last render's contents unless their inputs changed
+    if (!m_farCascadesDirty) {
+        m_stats.farCascadeCacheHits++;
+        return;
+    }
+
+    VkUtils::transitionImageLayers(cmd, m_shadowMap.image,
+                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                   VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                   VK_IMAGE_ASPECT_DEPTH_BIT, SHADOW_NEAR_CASCADE_COUNT, SHADOW_CASCADES_PER_PASS);
+
+    drawCascades(cmd, objects, SHADOW_NEAR_CASCADE_COUNT, true);
+
+    VkUtils::transitionImageLayers(cmd, m_shadowMap.image,
+                                   VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                   VK_IMAGE_ASPECT_DEPTH_BIT, SHADOW_NEAR_CASCADE_COUNT, SHADOW_CASCADES_PER_PASS);
+
+    m_stats.farCascadeRenders++;
+    m_farCascadesDirty = false;
+}
+
+void CascadedShadows::drawCascades(
+    VkCommandBuffer cmd,
+    std::span<const RenderObject> objects,
+    const uint32_t firstCascade,
+    const bool staticOnly
+) const {
+    VkRenderingAttachmentInfo depthAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .pNext = nullptr,
+        .imageView = m_passViews[firstCascade / SHADOW_CASCADES_PER_PASS],
+        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+    };
+    depthAttachment.clearValue.depthStencil.depth = 1.f;
+
+    const VkRenderingInfo renderInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .pNext = nullptr,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = {SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION},
+        },
+        .layerCount = 1, // ignored, the view mask selects the layers
+        .viewMask = SHADOW_VIEW_MASK, // every cascade of this pass in one go
+        .colorAttachmentCount = 0,
+        .pDepthAttachment = &depthAttachment,
+    };
+
+    vkCmdBeginRendering(cmd, &renderInfo);
+
+    const VkViewport viewport{
+        .x = 0,
+        .y = 0,
+        .width = static_cast<float>(SHADOW_MAP_RESOLUTION),
+        .height = static_cast<float>(SHADOW_MAP_RESOLUTION),
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    };
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    const VkRect2D scissor{
+        .offset = {0, 0},
+        .extent = {SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION},
+    };
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+    m_engine->bindSceneDescriptors(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout);
+
+    for (const RenderObject& object: objects) {
+        if (staticOnly && !object.isStatic) {
+            continue;
+        }
+
+        ShadowPushConstants pushConstants{};
+        pushConstants.vertexBuffer = object.vertexBufferAddress;
+        pushConstants.objectId = object.objectId;
+        pushConstants.cascadeOffset = firstCascade;
+
+        vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ShadowPushConstants), &pushConstants);
+        vkCmdBindIndexBuffer(cmd, object.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+        vkCmdDrawIndexed(cmd, object.indexCount, 1, object.firstIndex, 0, 0);
+        m_engine->getFrameCounters().draws++;
+    }
+
+    vkCmdEndRendering(cmd);
+}
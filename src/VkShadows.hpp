@@ -0,0 +1,81 @@
+#pragma once
+
+#include <span>
+
+#include "VkTypes.hpp"
+
+class VulkanEngine;
+
+// the nearest cascades are redrawn every frame with all geometry. The remaining ones only hold static
+// geometry and are cached until the light, the static set or their snapped placement changes.
+// Each half is rendered in one multiview pass, so both share a pipeline with the same view mask
+constexpr uint32_t SHADOW_CASCADES_PER_PASS = SHADOW_CASCADE_COUNT / 2;
+constexpr uint32_t SHADOW_NEAR_CASCADE_COUNT = SHADOW_CASCADES_PER_PASS;
+constexpr uint32_t SHADOW_VIEW_MASK = (1u << SHADOW_CASCADES_PER_PASS) - 1;
+constexpr uint32_t SHADOW_MAP_RESOLUTION = 2048;
+
+static_assert(SHADOW_CASCADE_COUNT % 2 == 0, "cascades are split evenly between the near and far pass");
+
+// push constants of the shadow passes, the cascade offset maps gl_ViewIndex to the cascade
+struct ShadowPushConstants {
+    VkDeviceAddress vertexBuffer;
+    uint32_t objectId;
+    uint32_t cascadeOffset;
+};
+
+struct ShadowStats {
+    uint32_t nearCascadeRenders = 0;
+    uint32_t farCascadeRenders = 0;
+    uint32_t farCascadeCacheHits = 0;
+};
+
+// cascaded shadow maps for the main directional light, every cascade is a layer of one depth array
+// and a group of cascades is rendered in a single multiview pass
+class CascadedShadows {
+public:
+    void init(VulkanEngine* engine, VkDescriptorSetLayout sceneLayout);
+
+    // computes the cascade matrices and splits into sceneData and decides whether the cached cascades are stale
+    void update(GPUSceneData& sceneData, float fovY, float aspect, float near, uint64_t staticSceneVersion);
+
+    void render(VkCommandBuffer cmd, std::span<const RenderObject> objects);
+
+    [[nodiscard]] VkImageView getShadowMapView() const { return m_shadowMapArrayView; }
+    [[nodiscard]] VkSampler getShadowSampler() const { return m_shadowSampler; }
+    [[nodiscard]] const ShadowStats& getStats() const { return m_stats; }
+
+    void invalidateCache() { m_farCascadesDirty = true; }
+
+    float shadowDistance = 80.f;
+    // blend between uniform (0) and logarithmic (1) split placement
+    float splitLambda = 0.75f;
+
+private:
+    void drawCascades(
+        VkCommandBuffer cmd,
+        std::span<const RenderObject> objects,
+        uint32_t firstCascade,
+        bool staticOnly
+    ) const;
+
+    VulkanEngine* m_engine = nullptr;
+
+    AllocatedImage m_shadowMap{};
+    // all cascades, sampled by the lighting passes
+    VkImageView m_shadowMapArrayView = VK_NULL_HANDLE;
+    // layered attachments of the near and far pass
+    VkImageView m_passViews[2]{};
+    VkSampler m_shadowSampler = VK_NULL_HANDLE;
+
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+
+    // cache key of the far cascades
+    glm::vec3 m_cachedLightDirection{0.f};
+    uint64_t m_cachedStaticVersion = ~0ull;
+    // light space snapped center (xyz) and half extent (w) of every cascade
+    glm::vec4 m_cachedPlacement[SHADOW_CASCADE_COUNT]{};
+    bool m_farCascadesDirty = true;
+
+    ShadowStats m_stats;
+};
@@ -0,0 +1,231 @@
+#include "VkSkinning.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "VkEngine.hpp"
+#include "VkPipeline.hpp"
+#include "VkSync.hpp"
+
+void GpuSkinning::init(VulkanEngine* engine) {
+    m_engine = engine;
+    const VkDevice device = engine->getContext()->getDevice();
+
+    // every buffer is reached through its address, the pass needs no descriptors
+    const VkPushConstantRange pushConstant{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(SkinningPushConstants),
+    };
+
+    const VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .setLayoutCount = 0,
+        .pSetLayouts = nullptr,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstant,
+    };
+
+    VK_CHECK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &m_pipelineLayout));
+
+    VkShaderModule shader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/skinning.comp.spv", device, &shader)) {
+        std::cerr << "Error when building the skinning compute shader" << std::endl;
+    }
+
+    const VkComputePipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = nullptr,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = shader,
+            .pName = "main",
+        },
+        .layout = m_pipelineLayout,
+    };
+
+    VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline));
+
+    VkUtils::destroyShaderModule(device, shader);
+
+    engine->getMainDeletionQueue().push_function([this, device] {
+        for (const PendingCopy& copy: m_copies) {
+            m_engine->destroyBuffer(copy.staging);
+        }
+        m_copies.clear();
+
+        for (const Instance& instance: m_instances) {
+            for (const AllocatedBuffer& joints: instance.jointMatrices) {
+                m_engine->destroyBuffer(joints);
+            }
+            m_engine->destroyBuffer(instance.output);
+            m_engine->destroyBuffer(instance.skinVertices);
+        }
+        m_instances.clear();
+
+        vkDestroyPipeline(device, m_pipeline, nullptr);
+        vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+    });
+}
+
+uint32_t GpuSkinning::addInstance(
+    const GPUMeshBuffers& baseMesh,
+    std::span<const SkinVertex> skinVertices,
+    std::shared_ptr<const Skeleton> skeleton
+) {
+    Instance& instance = m_instances.emplace_back();
+    instance.skeleton = std::move(skeleton);
+    instance.baseAddress = baseMesh.vertexBufferAddress;
+    instance.vertexCount = static_cast<uint32_t>(skinVertices.size());
+
+    instance.skinVertices = m_engine->createBuffer(skinVertices.size_bytes(),
+                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                   VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                   VMA_MEMORY_USAGE_GPU_ONLY);
+
+    instance.output = m_engine->createBuffer(skinVertices.size() * sizeof(Vertex),
+                                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                             VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                             VMA_MEMORY_USAGE_GPU_ONLY);
+    instance.outputAddress = m_engine->getBufferAddress(instance.output);
+
+    const size_t jointBytes = std::max<size_t>(instance.skeleton->joints.size(), 1) * sizeof(glm::mat4);
+    for (AllocatedBuffer& joints: instance.jointMatrices) {
+        joints = m_engine->createBuffer(jointBytes,
+                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                        VMA_MEMORY_USAGE_CPU_TO_GPU);
+    }
+
+    const AllocatedBuffer staging = m_engine->createBuffer(skinVertices.size_bytes(),
+                                                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                           VMA_MEMORY_USAGE_CPU_ONLY);
+    std::memcpy(staging.info.pMappedData, skinVertices.data(), skinVertices.size_bytes());
+    m_copies.push_back({staging, instance.skinVertices.buffer, skinVertices.size_bytes()});
+
+    m_stats.instances = static_cast<uint32_t>(m_instances.size());
+    return static_cast<uint32_t>(m_instances.size() - 1);
+}
+
+void GpuSkinning::setRenderObject(uint32_t instance, uint32_t renderObject) {
+    m_instances[instance].renderObject = renderObject;
+
+    if (m_instanceOfObject.size() <= renderObject) {
+        m_instanceOfObject.resize(renderObject + 1, UINT32_MAX);
+    }
+    m_instanceOfObject[renderObject] = instance;
+}
+
+void GpuSkinning::update(float time, uint32_t frameIndex, std::span<const uint32_t> drawList) {
+    const float deltaTime = m_lastTime < 0.f ? 0.f : time - m_lastTime;
+    m_lastTime = time;
+
+    m_stats.dispatches = 0;
+    m_stats.skippedHidden = 0;
+    m_stats.skippedIdle = 0;
+
+    for (Instance& instance: m_instances) {
+        instance.dispatchThisFrame = false;
+
+        // a skeleton without animations stays in its rest pose, skinned once
+        if (playing && speed != 0.f && deltaTime > 0.f && !instance.skeleton->animations.empty()) {
+            instance.time += deltaTime * speed;
+            instance.poseDirty = true;
+        }
+    }
+
+    // only what the camera sees is reposed, shadows of culled instances keep their last pose
+    for (const uint32_t index: drawList) {
+        if (index < m_instanceOfObject.size() && m_instanceOfObject[index] != UINT32_MAX) {
+            Instance& instance = m_instances[m_instanceOfObject[index]];
+            instance.dispatchThisFrame = instance.poseDirty;
+        }
+    }
+
+    for (Instance& instance: m_instances) {
+        if (!instance.skinned) {
+            instance.dispatchThisFrame = true;
+        }
+
+        if (!instance.dispatchThisFrame) {
+            if (instance.poseDirty) {
+                m_stats.skippedHidden++;
+            } else {
+                m_stats.skippedIdle++;
+            }
+            continue;
+        }
+
+        const Skeleton& skeleton = *instance.skeleton;
+        const uint32_t animation = skeleton.animations.empty() ? NO_ANIMATION : 0;
+        auto* joints = static_cast<glm::mat4*>(instance.jointMatrices[frameIndex].info.pMappedData);
+        skeleton.evaluate(animation, instance.time, instance.pose, {joints, skeleton.joints.size()});
+
+        instance.poseDirty = false;
+        instance.skinned = true;
+        m_stats.dispatches++;
+    }
+}
+
+void GpuSkinning::dispatch(VkCommandBuffer cmd, uint32_t frameIndex) {
+    if (!m_copies.empty()) {
+        for (const PendingCopy& copy: m_copies) {
+            const VkBufferCopy region{
+                .srcOffset = 0,
+                .dstOffset = 0,
+                .size = copy.size,
+            };
+            vkCmdCopyBuffer(cmd, copy.staging.buffer, copy.skinVertices, 1, &region);
+            m_engine->getFrameCounters().uploadBytes += copy.size;
+
+            const AllocatedBuffer staging = copy.staging;
+            m_engine->getCurrentFrame().deletionQueue.push_function([this, staging] {
+                m_engine->destroyBuffer(staging);
+            });
+        }
+        m_copies.clear();
+
+        VkUtils::memoryBarrier(cmd,
+                               VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+    }
+
+    if (m_stats.dispatches == 0) {
+        return;
+    }
+
+    // the previous frame may still be drawing the vertices about to be overwritten
+    VkUtils::memoryBarrier(cmd,
+                           VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_NONE,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+
+    for (const Instance& instance: m_instances) {
+        if (!instance.dispatchThisFrame) {
+            continue;
+        }
+
+        const SkinningPushConstants pushConstants{
+            .baseVertices = instance.baseAddress,
+            .skinVertices = m_engine->getBufferAddress(instance.skinVertices),
+            .jointMatrices = m_engine->getBufferAddress(instance.jointMatrices[frameIndex]),
+            .outputVertices = instance.outputAddress,
+            .vertexCount = instance.vertexCount,
+        };
+        vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SkinningPushConstants),
+                           &pushConstants);
+
+        vkCmdDispatch(cmd, (instance.vertexCount + SKINNING_GROUP_SIZE - 1) / SKINNING_GROUP_SIZE, 1, 1);
+        m_engine->getFrameCounters().dispatches++;
+    }
+
+    // every pass drawing the instances pulls the skinned vertices
+    VkUtils::memoryBarrier(cmd,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "VkTypes.hpp"
+#include "Skeleton.hpp"
+
+class VulkanEngine;
+
+// must match local_size in skinning.comp
+constexpr uint32_t SKINNING_GROUP_SIZE = 64;
+// animated bounds are not tracked, the bind pose sphere is grown to cover the poses
+constexpr float SKINNED_BOUNDS_SCALE = 2.f;
+
+// joints and weights of one vertex, laid out for std430
+struct SkinVertex {
+    glm::uvec4 joints;
+    glm::vec4 weights;
+};
+
+struct SkinningPushConstants {
+    VkDeviceAddress baseVertices;
+    VkDeviceAddress skinVertices;
+    VkDeviceAddress jointMatrices;
+    VkDeviceAddress outputVertices;
+    uint32_t vertexCount;
+};
+
+struct SkinningStats {
+    uint32_t instances = 0;
+    uint32_t dispatches = 0;
+    uint32_t skippedHidden = 0;
+    uint32_t skippedIdle = 0;
+};
+
+// compute skinning of glTF skins. Every instance owns a skinned copy of its mesh's vertices that the
+// render object draws from, so the depth, shadow and color passes all reuse one dispatch per frame.
+// Instances that are culled or whose pose did not change keep last frame's vertices
+class GpuSkinning {
+public:
+    void init(VulkanEngine* engine);
+
+    // the base mesh stays owned by its render object. Returns the instance, which is skinned by the
+    // next dispatch whether it is visible or not
+    uint32_t addInstance(const GPUMeshBuffers& baseMesh, std::span<const SkinVertex> skinVertices,
+                         std::shared_ptr<const Skeleton> skeleton);
+    [[nodiscard]] VkDeviceAddress getOutputAddress(uint32_t instance) const { return m_instances[instance].outputAddress; }
+    void setRenderObject(uint32_t instance, uint32_t renderObject);
+
+    // advances the animations and poses the visible instances whose pose changed, the fence of this
+    // frame slot must have been waited on
+    void update(float time, uint32_t frameIndex, std::span<const uint32_t> drawList);
+
+    // records the uploads of new instances and the skinning dispatches, before any pass draws them
+    void dispatch(VkCommandBuffer cmd, uint32_t frameIndex);
+
+    [[nodiscard]] const SkinningStats& getStats() const { return m_stats; }
+
+    bool playing = true;
+    float speed = 1.f;
+
+private:
+    struct Instance {
+        std::shared_ptr<const Skeleton> skeleton;
+        VkDeviceAddress baseAddress = 0;
+        uint32_t vertexCount = 0;
+        uint32_t renderObject = UINT32_MAX;
+
+        AllocatedBuffer skinVertices{};
+        AllocatedBuffer output{};
+        VkDeviceAddress outputAddress = 0;
+        // written by the CPU, one per frame slot so a frame in flight keeps its matrices
+        AllocatedBuffer jointMatrices[FRAME_OVERLAP]{};
+
+        SkeletonPose pose;
+        float time = 0.f;
+        // the skinned vertices do not match the current pose yet
+        bool poseDirty = true;
+        // the output has never been written, shadows may draw the instance before the camera sees it
+        bool skinned = false;
+        bool dispatchThisFrame = false;
+    };
+
+    // the first copies of a new instance, recorded by the next dispatch
+    struct PendingCopy {
+        AllocatedBuffer staging;
+        VkBuffer skinVertices;
+        uint64_t size;
+    };
+
+    VulkanEngine* m_engine = nullptr;
+
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+
+    std::vector<Instance> m_instances;
+    std::vector<PendingCopy> m_copies;
+    // instance of every render object, UINT32_MAX for objects that are not skinned
+    std::vector<uint32_t> m_instanceOfObject;
+    float m_lastTime = -1.f;
+
+    SkinningStats m_stats;
+};
@@ -42,6 +42,9 @@ void VulkanSwapChain::createSwapChain() {
 
     uint32_t imageCount = capabilities.minImageCount;
 
+    // not every surface can be a transfer source, frame readback is off on the ones that cannot
+    m_readable = capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
     VkSwapchainCreateInfoKHR createInfo{
         .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
         .surface = m_ctx->getSurface(),
@@ -50,7 +53,8 @@ void VulkanSwapChain::createSwapChain() {
         .imageColorSpace = colorSpace,
         .imageExtent = extent,
         .imageArrayLayers = 1,
-        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                      (m_readable ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0u),
         .preTransform = capabilities.currentTransform,
         .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
         .presentMode = presentMode,
@@ -21,6 +21,8 @@ public:
     [[nodiscard]] VkExtent2D getExtent() const { return m_extent; }
     [[nodiscard]] const std::vector<VkImage> &getImages() const { return m_images; }
     [[nodiscard]] const std::vector<VkImageView> &getImageViews() const { return m_imageViews; }
+    // the presented images can be copied out for screenshots and recordings
+    [[nodiscard]] bool isReadable() const { return m_readable; }
 
     void init();
 
@@ -47,4 +49,5 @@ private:
     std::vector<VkImageView> m_imageViews;
     VkFormat m_imageFormat = VK_FORMAT_UNDEFINED;
     VkExtent2D m_extent{0, 0};
+    bool m_readable = false;
 };
@@ -0,0 +1,29 @@
+#include "VkSync.hpp"
+
+namespace VkUtils {
+    void memoryBarrier(
+        const VkCommandBuffer cmd,
+        const VkPipelineStageFlags2 srcStageMask,
+        const VkAccessFlags2 srcAccessMask,
+        const VkPipelineStageFlags2 dstStageMask,
+        const VkAccessFlags2 dstAccessMask
+    ) {
+        const VkMemoryBarrier2 memoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .pNext = nullptr,
+            .srcStageMask = srcStageMask,
+            .srcAccessMask = srcAccessMask,
+            .dstStageMask = dstStageMask,
+            .dstAccessMask = dstAccessMask,
+        };
+
+        const VkDependencyInfo depInfo{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .pNext = nullptr,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &memoryBarrier
+        };
+
+        vkCmdPipelineBarrier2(cmd, &depInfo);
+    }
+}
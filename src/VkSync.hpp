@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+namespace VkUtils {
+    // global memory barrier, used to order buffer writes against later reads in the same queue
+    void memoryBarrier(
+        VkCommandBuffer cmd,
+        VkPipelineStageFlags2 srcStageMask,
+        VkAccessFlags2 srcAccessMask,
+        VkPipelineStageFlags2 dstStageMask,
+        VkAccessFlags2 dstAccessMask
+    );
+}
@@ -9,6 +9,7 @@
 #include <format>
 #include <functional>
 #include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 #include <memory>
 #include <optional>
@@ -28,6 +29,9 @@
         }                                                                                                              \
     } while (0)
 
+constexpr unsigned int FRAME_OVERLAP = 2;
+constexpr unsigned int SHADOW_CASCADE_COUNT = 4;
+
 struct DeletionQueue {
     std::deque<std::function<void()>> deletors;
 
@@ -44,14 +48,6 @@ struct DeletionQueue {
     }
 };
 
-struct FrameData {
-    VkCommandPool commandPool;
-    VkCommandBuffer commandBuffer;
-    VkSemaphore swapChainSemaphore, renderSemaphore;
-    VkFence renderFence;
-    DeletionQueue deletionQueue;
-};
-
 struct AllocatedImage {
     VkImage image;
     VkImageView imageView;
@@ -73,6 +69,27 @@ struct AllocatedBuffer {
     VmaAllocationInfo info;
 };
 
+// GPU work the frame being recorded issues, for telemetry. Indirect calls count once
+struct FrameCounters {
+    uint32_t draws = 0;
+    uint32_t dispatches = 0;
+    // bytes copied from staging buffers into GPU memory
+    uint64_t uploadBytes = 0;
+};
+
+struct FrameData {
+    VkCommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    VkSemaphore swapChainSemaphore, renderSemaphore;
+    VkFence renderFence;
+    DeletionQueue deletionQueue;
+
+    AllocatedBuffer sceneDataBuffer;
+    // the scene set comes from the pool, or from the scene descriptor buffer when the device has one
+    VkDescriptorSet sceneDescriptor;
+    uint32_t sceneBufferSet;
+};
+
 struct Vertex {
     glm::vec3 position;
     float uv_x;
@@ -86,10 +103,61 @@ struct GPUMeshBuffers {
     AllocatedBuffer indexBuffer;
     AllocatedBuffer vertexBuffer;
     VkDeviceAddress vertexBufferAddress;
+    // object space bounding sphere, xyz center and w radius
+    glm::vec4 boundingSphere;
 };
 
 // push constants for our mesh object draws
+// the transform is read from the GPU scene buffer by object id
 struct GPUDrawPushConstants {
-    glm::mat4 worldMatrix;
     VkDeviceAddress vertexBuffer;
-};
\ No newline at end of file
+    uint32_t objectId;
+};
+
+// per-frame camera and global lighting data, shared by the geometry and light culling passes
+struct GPUSceneData {
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::mat4 viewProj;
+    glm::mat4 inverseProj;
+    glm::vec4 cameraPosition;
+    glm::vec4 ambientColor;
+    glm::uvec4 clusterGrid;  // xyz cluster counts, w active light count
+    glm::vec4 clusterParams; // xy screen size, z near plane, w far plane
+    glm::vec4 sunlightDirection; // xyz direction the light travels in
+    glm::vec4 sunlightColor;     // rgb color, w intensity
+    glm::mat4 cascadeViewProj[SHADOW_CASCADE_COUNT];
+    glm::vec4 cascadeSplits;     // view space far distance of every cascade
+    glm::uvec4 virtualTexture;   // x first indirection level, y mip count, z 1 when a texture is loaded
+};
+
+// one entry of the GPU scene buffer, laid out for std430
+struct GPUObjectData {
+    glm::mat4 transform;
+    glm::vec4 boundingSphere; // object space, xyz center and w radius
+    uint32_t materialIndex;
+    uint32_t padding[3];
+};
+
+// a single indexed draw of a mesh
+struct RenderObject {
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    VkBuffer indexBuffer;
+    VkDeviceAddress vertexBufferAddress;
+    // object space, xyz center and w radius
+    glm::vec4 boundingSphere;
+
+    glm::mat4 transform;
+    // static objects never move, which lets cached passes (e.g. distant shadow cascades) reuse their results
+    bool isStatic;
+    // the vertices are rewritten by the skinning pass, the transform is left to whoever placed it
+    bool isSkinned = false;
+    // low detail mesh rasterized by the CPU occlusion culler, NO_OCCLUDER_MESH if the object hides nothing
+    uint32_t occluderMesh = UINT32_MAX;
+
+    // slot in the GPU scene buffer
+    uint32_t objectId;
+    // mirrors the material of the GPU scene entry for passes that select objects by material
+    uint32_t materialIndex = 0;
+};
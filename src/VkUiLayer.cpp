@@ -0,0 +1,301 @@
+#include "VkUiLayer.hpp"
+
+#include <imgui.h>
+#include <imgui_impl_vulkan.h>
+
+#include "VkEngine.hpp"
+#include "VkImage.hpp"
+#include "VkPipeline.hpp"
+
+// FNV-1a, cheap enough to run over the whole draw data every frame
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+template<typename T>
+static uint64_t hashValue(uint64_t hash, const T& value) {
+    return hashBytes(hash, &value, sizeof(T));
+}
+
+// hashes everything that ends up in the layer, returns false if the draw data can not be cached
+static bool hashDrawData(const ImDrawData* drawData, uint64_t& outHash) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    if (drawData == nullptr) {
+        outHash = hash;
+        return true;
+    }
+
+    // pending font atlas uploads are applied by the render call
+    if (drawData->Textures != nullptr) {
+        for (const ImTextureData* texture: *drawData->Textures) {
+            if (texture->Status != ImTextureStatus_OK) {
+                return false;
+            }
+        }
+    }
+
+    hash = hashValue(hash, drawData->DisplayPos);
+    hash = hashValue(hash, drawData->DisplaySize);
+    hash = hashValue(hash, drawData->FramebufferScale);
+    hash = hashValue(hash, drawData->CmdListsCount);
+
+    for (const ImDrawList* drawList: drawData->CmdLists) {
+        hash = hashBytes(hash, drawList->VtxBuffer.Data, drawList->VtxBuffer.Size * sizeof(ImDrawVert));
+        hash = hashBytes(hash, drawList->IdxBuffer.Data, drawList->IdxBuffer.Size * sizeof(ImDrawIdx));
+
+        for (const ImDrawCmd& drawCmd: drawList->CmdBuffer) {
+            // user callbacks can draw anything
+            if (drawCmd.UserCallback != nullptr) {
+                return false;
+            }
+
+            hash = hashValue(hash, drawCmd.ClipRect);
+            // the same geometry can sample another texture, textures were checked to be uploaded above
+            hash = hashValue(hash, drawCmd.GetTexID());
+            hash = hashValue(hash, drawCmd.VtxOffset);
+            hash = hashValue(hash, drawCmd.IdxOffset);
+            hash = hashValue(hash, drawCmd.ElemCount);
+        }
+    }
+
+    outHash = hash;
+    return true;
+}
+
+void UiLayer::init(VulkanEngine* engine, VkFormat format, VkExtent2D extent) {
+    m_engine = engine;
+    const VkDevice device = engine->getContext()->getDevice();
+
+    m_layer.imageFormat = format;
+    m_layer.imageExtent = {extent.width, extent.height, 1};
+
+    const VkImageCreateInfo imageInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = nullptr,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = m_layer.imageExtent,
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+    };
+
+    constexpr VmaAllocationCreateInfo allocInfo = {
+        .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+        .requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+
+    VK_CHECK(vmaCreateImage(engine->getAllocator(), &imageInfo, &allocInfo, &m_layer.image, &m_layer.allocation, nullptr));
+
+    const VkImageViewCreateInfo viewInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = nullptr,
+        .image = m_layer.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        }
+    };
+
+    VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &m_layer.imageView));
+
+    // the layer matches the target size, so texels map 1:1
+    const VkSamplerCreateInfo samplerInfo{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = nullptr,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+    };
+
+    VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler));
+
+    {
+        DescriptorLayoutBuilder builder;
+        builder.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        m_descriptorLayout = builder.build(device, VK_SHADER_STAGE_FRAGMENT_BIT);
+    }
+
+    std::vector<DescriptorAllocator::PoolSizeRatio> sizes = {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+    };
+    m_descriptorAllocator.initPool(device, 1, sizes);
+
+    m_descriptorSet = m_descriptorAllocator.allocate(device, m_descriptorLayout);
+    {
+        DescriptorWriter writer;
+        writer.writeImage(0, m_layer.imageView, m_sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                          VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.updateSet(device, m_descriptorSet);
+    }
+
+    const VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .setLayoutCount = 1,
+        .pSetLayouts = &m_descriptorLayout,
+    };
+
+    VK_CHECK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &m_pipelineLayout));
+
+    VkShaderModule vertexShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/fullscreen.vert.spv", device, &vertexShader)) {
+        std::cerr << "Error when building the full screen vertex shader module" << std::endl;
+    }
+
+    VkShaderModule fragmentShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/uiComposite.frag.spv", device, &fragmentShader)) {
+        std::cerr << "Error when building the UI composite fragment shader module" << std::endl;
+    }
+
+    PipelineBuilder pipelineBuilder(engine->getContext());
+    pipelineBuilder.m_pipelineLayout = m_pipelineLayout;
+    pipelineBuilder.setShaders(vertexShader, fragmentShader);
+    pipelineBuilder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    pipelineBuilder.setPolygonMode(VK_POLYGON_MODE_FILL);
+    pipelineBuilder.setCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+    pipelineBuilder.setMultiSamplingNone();
+    pipelineBuilder.enableBlendingPremultiplied();
+    pipelineBuilder.disableDepthTest();
+    pipelineBuilder.setColorAttachmentFormat(format);
+    pipelineBuilder.setDepthFormat(VK_FORMAT_UNDEFINED);
+
+    m_compositePipeline = engine->getPipelineRegistry().getPipeline(pipelineBuilder);
+
+    VkUtils::destroyShaderModule(device, fragmentShader);
+    VkUtils::destroyShaderModule(device, vertexShader);
+
+    engine->getMainDeletionQueue().push_function([this, device] {
+        vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+
+        m_descriptorAllocator.destroyPool(device);
+        vkDestroyDescriptorSetLayout(device, m_descriptorLayout, nullptr);
+
+        vkDestroySampler(device, m_sampler, nullptr);
+        vkDestroyImageView(device, m_layer.imageView, nullptr);
+        vmaDestroyImage(m_engine->getAllocator(), m_layer.image, m_layer.allocation);
+    });
+}
+
+bool UiLayer::update(VkCommandBuffer cmd, ImDrawData* drawData) {
+    uint64_t hash = 0;
+    const bool cacheable = hashDrawData(drawData, hash);
+    if (cacheable && m_valid && hash == m_drawDataHash) {
+        return false;
+    }
+
+    // the old contents are cleared anyway. The barrier also orders this write after the previous composite
+    VkUtils::transitionImage(cmd, m_layer.image,
+                             VK_IMAGE_LAYOUT_UNDEFINED,
+                             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+    const VkRenderingAttachmentInfo colorAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .pNext = nullptr,
+        .imageView = m_layer.imageView,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = {.color = {.float32 = {0.f, 0.f, 0.f, 0.f}}},
+    };
+
+    const VkRenderingInfo renderInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .pNext = nullptr,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = {m_layer.imageExtent.width, m_layer.imageExtent.height},
+        },
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+    };
+
+    vkCmdBeginRendering(cmd, &renderInfo);
+
+    ImGui_ImplVulkan_RenderDrawData(drawData, cmd);
+
+    vkCmdEndRendering(cmd);
+
+    VkUtils::transitionImage(cmd, m_layer.image,
+                             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    m_drawDataHash = hash;
+    m_valid = cacheable;
+    m_renderCount++;
+
+    return true;
+}
+
+void UiLayer::composite(VkCommandBuffer cmd, VkImageView targetView, VkExtent2D targetExtent) const {
+    const VkRenderingAttachmentInfo colorAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .pNext = nullptr,
+        .imageView = targetView,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+    };
+
+    const VkRenderingInfo renderInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .pNext = nullptr,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = targetExtent,
+        },
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+    };
+
+    vkCmdBeginRendering(cmd, &renderInfo);
+
+    const VkViewport viewport{
+        .x = 0,
+        .y = 0,
+        .width = static_cast<float>(targetExtent.width),
+        .height = static_cast<float>(targetExtent.height),
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    };
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    const VkRect2D scissor{
+        .offset = {0, 0},
+        .extent = targetExtent,
+    };
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    compositeInPass(cmd);
+
+    vkCmdEndRendering(cmd);
+}
+
+void UiLayer::compositeInPass(VkCommandBuffer cmd) const {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_compositePipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+    vkCmdDraw(cmd, 3, 1, 0, 0);
+    m_engine->getFrameCounters().draws++;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkDescriptors.hpp"
+
+class VulkanEngine;
+struct ImDrawData;
+
+// ImGui rendered into its own layer. The layer is only re-rasterized when the draw data hash changes,
+// every other frame it is composited over the target with a single full screen triangle
+class UiLayer {
+public:
+    // the format has to match the one the ImGui backend pipeline was created with
+    void init(VulkanEngine* engine, VkFormat format, VkExtent2D extent);
+
+    // re-renders the layer if the draw data differs from the cached one, returns whether it did
+    bool update(VkCommandBuffer cmd, ImDrawData* drawData);
+
+    // blends the layer over the target, which must be in the color attachment layout
+    void composite(VkCommandBuffer cmd, VkImageView targetView, VkExtent2D targetExtent) const;
+
+    // draws the layer inside an already begun rendering pass with the same color format
+    void compositeInPass(VkCommandBuffer cmd) const;
+
+    void invalidate() { m_valid = false; }
+
+    [[nodiscard]] uint32_t getRenderCount() const { return m_renderCount; }
+
+private:
+    VulkanEngine* m_engine = nullptr;
+
+    AllocatedImage m_layer{};
+    VkSampler m_sampler = VK_NULL_HANDLE;
+
+    DescriptorAllocator m_descriptorAllocator{};
+    VkDescriptorSetLayout m_descriptorLayout = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_compositePipeline = VK_NULL_HANDLE;
+
+    uint64_t m_drawDataHash = 0;
+    bool m_valid = false;
+    uint32_t m_renderCount = 0;
+};
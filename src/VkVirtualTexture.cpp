@@ -0,0 +1,663 @@
+#include "VkVirtualTexture.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+#include "VkEngine.hpp"
+#include "VkImage.hpp"
+#include "VkPipeline.hpp"
+#include "VkSync.hpp"
+
+constexpr VkFormat VT_PAGE_CACHE_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+constexpr VkFormat VT_INDIRECTION_FORMAT = VK_FORMAT_R8G8B8A8_UINT;
+constexpr VkFormat VT_FEEDBACK_FORMAT = VK_FORMAT_R32_UINT;
+// the coarsest page is never evicted, so there is always something to fall back to
+constexpr uint32_t VT_PINNED_SLOT = 0;
+
+static_assert(VT_MAX_PAGES <= 256 && VT_CACHE_PAGES <= 256, "pages and slots are packed into 8 bits");
+static_assert(VT_MAX_PAGES == 1u << (VT_MAX_MIPS - 1), "every indirection level halves the pages down to one");
+
+static uint32_t packPage(uint32_t x, uint32_t y, uint32_t mip) {
+    return x | (y << 8) | (mip << 16);
+}
+
+static AllocatedImage createImage(VulkanEngine* engine, VkFormat format, VkExtent3D extent, uint32_t mipLevels,
+                                  VkImageUsageFlags usage) {
+    AllocatedImage image{
+        .imageExtent = extent,
+        .imageFormat = format,
+    };
+
+    const VkImageCreateInfo imageInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = nullptr,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = extent,
+        .mipLevels = mipLevels,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage,
+    };
+
+    constexpr VmaAllocationCreateInfo allocInfo = {
+        .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+        .requiredFlags = static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+
+    VK_CHECK(vmaCreateImage(engine->getAllocator(), &imageInfo, &allocInfo, &image.image, &image.allocation, nullptr));
+
+    const VkImageViewCreateInfo viewInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = nullptr,
+        .image = image.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = mipLevels,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        }
+    };
+
+    VK_CHECK(vkCreateImageView(engine->getContext()->getDevice(), &viewInfo, nullptr, &image.imageView));
+
+    return image;
+}
+
+void VirtualTexture::init(VulkanEngine* engine, JobSystem* jobSystem, VkDescriptorSetLayout sceneLayout,
+                          VkExtent2D drawExtent) {
+    m_engine = engine;
+    m_jobSystem = jobSystem;
+    const VkDevice device = engine->getContext()->getDevice();
+
+    m_pageCache = createImage(engine, VT_PAGE_CACHE_FORMAT,
+                              {VT_CACHE_PAGES * VT_PAGE_STRIDE, VT_CACHE_PAGES * VT_PAGE_STRIDE, 1}, 1,
+                              VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+    m_indirection = createImage(engine, VT_INDIRECTION_FORMAT, {VT_MAX_PAGES, VT_MAX_PAGES, 1}, VT_MAX_MIPS,
+                                VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+    m_feedbackExtent = {
+        std::max(drawExtent.width / VT_FEEDBACK_DIVISOR, 1u),
+        std::max(drawExtent.height / VT_FEEDBACK_DIVISOR, 1u),
+    };
+    m_feedbackImage = createImage(engine, VT_FEEDBACK_FORMAT, {m_feedbackExtent.width, m_feedbackExtent.height, 1}, 1,
+                                  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+
+    for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
+        m_readback[i] = engine->createBuffer(m_feedbackExtent.width * m_feedbackExtent.height * sizeof(uint32_t),
+                                             VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+        // the indirection table of every level fits behind the pages
+        constexpr uint64_t indirectionBytes = (VT_MAX_PAGES * VT_MAX_PAGES * 4 / 3 + 1) * sizeof(uint32_t);
+        m_staging[i] = engine->createBuffer(VT_UPLOADS_PER_FRAME * VT_PAGE_BYTES + indirectionBytes,
+                                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    }
+
+    // integer indirection entries cannot be filtered
+    VkSamplerCreateInfo samplerInfo{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = nullptr,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .minLod = 0.f,
+        .maxLod = static_cast<float>(VT_MAX_MIPS),
+    };
+    VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_nearestSampler));
+
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.maxLod = 0.f;
+    VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_linearSampler));
+
+    // an all zero table has no valid entry, virtual textured objects keep their vertex colors until pages arrive
+    engine->immediateSubmit([&](VkCommandBuffer cmd) {
+        const VkImageSubresourceRange range{
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = VT_MAX_MIPS,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        };
+        VkUtils::transitionImageRange(cmd, m_indirection.image, VK_IMAGE_LAYOUT_UNDEFINED,
+                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, range);
+
+        constexpr VkClearColorValue clearValue{.uint32 = {0, 0, 0, 0}};
+        vkCmdClearColorImage(cmd, m_indirection.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearValue, 1, &range);
+
+        VkUtils::transitionImageRange(cmd, m_indirection.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, range);
+        VkUtils::transitionImage(cmd, m_pageCache.image, VK_IMAGE_LAYOUT_UNDEFINED,
+                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    });
+
+    VkShaderModule vertexShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/coloredTriangleMesh.vert.spv", device, &vertexShader)) {
+        std::cerr << "Error when building the virtual texture feedback vertex shader module" << std::endl;
+    }
+
+    VkShaderModule fragmentShader;
+    if (!VkUtils::loadShaderModule(HELLFIRE_SHADER_DIR "/vtFeedback.frag.spv", device, &fragmentShader)) {
+        std::cerr << "Error when building the virtual texture feedback fragment shader module" << std::endl;
+    }
+
+    const VkPushConstantRange pushConstant{
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset = 0,
+        .size = sizeof(GPUDrawPushConstants),
+    };
+
+    const VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = nullptr,
+        .setLayoutCount = 1,
+        .pSetLayouts = &sceneLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstant,
+    };
+
+    VK_CHECK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &m_feedbackLayout));
+
+    // same visibility rules as the geometry pass, which has no depth buffer either
+    PipelineBuilder pipelineBuilder(engine->getContext());
+    pipelineBuilder.m_pipelineLayout = m_feedbackLayout;
+    pipelineBuilder.setShaders(vertexShader, fragmentShader);
+    pipelineBuilder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    pipelineBuilder.setPolygonMode(VK_POLYGON_MODE_FILL);
+    pipelineBuilder.setCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+    pipelineBuilder.setMultiSamplingNone();
+    pipelineBuilder.disableBlending();
+    pipelineBuilder.disableDepthTest();
+    pipelineBuilder.setColorAttachmentFormat(VT_FEEDBACK_FORMAT);
+    pipelineBuilder.setCreateFlags(engine->getScenePipelineFlags());
+
+    m_feedbackPipeline = engine->getPipelineRegistry().getPipeline(pipelineBuilder);
+
+    VkUtils::destroyShaderModule(device, fragmentShader);
+    VkUtils::destroyShaderModule(device, vertexShader);
+
+    engine->getMainDeletionQueue().push_function([this, device] {
+        // a read still running would write into a freed read
+        if (m_read) {
+            m_jobSystem->wait(m_read->counter);
+            m_read.reset();
+        }
+
+        vkDestroyPipelineLayout(device, m_feedbackLayout, nullptr);
+        for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
+            m_engine->destroyBuffer(m_staging[i]);
+            m_engine->destroyBuffer(m_readback[i]);
+        }
+        vkDestroySampler(device, m_linearSampler, nullptr);
+        vkDestroySampler(device, m_nearestSampler, nullptr);
+        for (const AllocatedImage* image: {&m_feedbackImage, &m_indirection, &m_pageCache}) {
+            vkDestroyImageView(device, image->imageView, nullptr);
+            vmaDestroyImage(m_engine->getAllocator(), image->image, image->allocation);
+        }
+    });
+}
+
+bool VirtualTexture::load(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << std::format("Failed to open virtual texture {}\n", path.string());
+        return false;
+    }
+
+    VirtualTextureHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    const uint32_t pagesPerSide = header.size / VT_PAGE_SIZE;
+    if (!file.good() || header.magic != VIRTUAL_TEXTURE_MAGIC || !std::has_single_bit(header.size) ||
+        pagesPerSide == 0 || pagesPerSide > VT_MAX_PAGES ||
+        header.mipCount != static_cast<uint32_t>(std::countr_zero(pagesPerSide)) + 1) {
+        std::cerr << std::format("{} is not a valid virtual texture\n", path.string());
+        return false;
+    }
+
+    // pages of the previous texture still being read are dropped
+    if (m_read) {
+        m_jobSystem->wait(m_read->counter);
+        m_read.reset();
+    }
+
+    m_path = path;
+    m_pagesPerSide = pagesPerSide;
+    m_mipCount = header.mipCount;
+
+    m_totalPages = 0;
+    for (uint32_t mip = 0; mip < m_mipCount; mip++) {
+        m_mipPageOffset[mip] = m_totalPages;
+        m_totalPages += getPageCount(mip) * getPageCount(mip);
+    }
+
+    // pages of the previous texture are overwritten as the new ones come in
+    m_slots.assign(VT_CACHE_PAGES * VT_CACHE_PAGES, Slot{});
+    m_slotOfPage.clear();
+    std::ranges::fill(m_readbackWritten, false);
+    m_indirectionDirty = true;
+    m_stats = {};
+
+    return true;
+}
+
+void VirtualTexture::update(uint32_t frameIndex) {
+    m_frame++;
+    m_uploads.clear();
+
+    if (!isLoaded()) {
+        return;
+    }
+
+    // every pixel of the feedback is a page request, the coarsest page is always wanted
+    m_requestCounts.clear();
+    const uint32_t coarsestPage = packPage(0, 0, m_mipCount - 1);
+    m_requestCounts[coarsestPage] = UINT32_MAX;
+
+    if (m_readbackWritten[frameIndex]) {
+        const AllocatedBuffer& readback = m_readback[frameIndex];
+        VK_CHECK(vmaInvalidateAllocation(m_engine->getAllocator(), readback.allocation, 0, VK_WHOLE_SIZE));
+
+        const auto* pages = static_cast<const uint32_t*>(readback.info.pMappedData);
+        const uint32_t pixelCount = m_feedbackExtent.width * m_feedbackExtent.height;
+        for (uint32_t i = 0; i < pixelCount; i++) {
+            if (pages[i] != VT_NO_PAGE) {
+                m_requestCounts[pages[i]]++;
+            }
+        }
+    }
+
+    // ancestors are wanted as much as their descendants, they are what a missing page falls back to
+    const size_t directRequests = m_requestCounts.size();
+    std::vector<PageRequest> direct;
+    direct.reserve(directRequests);
+    for (const auto& [page, count]: m_requestCounts) {
+        direct.push_back({page, count});
+    }
+    for (const PageRequest& request: direct) {
+        for (uint32_t parent = getParentPage(request.page); parent != VT_NO_PAGE; parent = getParentPage(parent)) {
+            uint32_t& count = m_requestCounts[parent];
+            count = std::max(count, request.count);
+        }
+    }
+
+    m_requests.clear();
+    for (const auto& [page, count]: m_requestCounts) {
+        const auto resident = m_slotOfPage.find(page);
+        if (resident != m_slotOfPage.end()) {
+            m_slots[resident->second].lastUsedFrame = m_frame;
+        } else {
+            m_requests.push_back({page, count});
+        }
+    }
+    m_stats.requestedPages = static_cast<uint32_t>(m_requestCounts.size());
+
+    // coarse pages first, they replace the largest fallback areas, then the pages covering most pixels
+    std::ranges::sort(m_requests, [](const PageRequest& a, const PageRequest& b) {
+        if ((a.page >> 16) != (b.page >> 16)) {
+            return (a.page >> 16) > (b.page >> 16);
+        }
+        return a.count > b.count;
+    });
+
+    // pages read by now are uploaded this frame, after the pages drawn this frame were marked above
+    takeReadPages(frameIndex);
+    startReadPages();
+
+    m_stats.residentPages = static_cast<uint32_t>(m_slotOfPage.size());
+
+    if (m_indirectionDirty) {
+        rebuildIndirection(frameIndex);
+    }
+}
+
+void VirtualTexture::upload(VkCommandBuffer cmd, uint32_t frameIndex) {
+    if (!m_uploads.empty()) {
+        VkUtils::transitionImage(cmd, m_pageCache.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+        std::vector<VkBufferImageCopy> regions;
+        regions.reserve(m_uploads.size());
+        for (const PageUpload& upload: m_uploads) {
+            regions.push_back(VkBufferImageCopy{
+                .bufferOffset = upload.stagingOffset,
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = 0,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+                .imageOffset = {
+                    static_cast<int32_t>(upload.slot % VT_CACHE_PAGES * VT_PAGE_STRIDE),
+                    static_cast<int32_t>(upload.slot / VT_CACHE_PAGES * VT_PAGE_STRIDE),
+                    0
+                },
+                .imageExtent = {VT_PAGE_STRIDE, VT_PAGE_STRIDE, 1},
+            });
+        }
+        vkCmdCopyBufferToImage(cmd, m_staging[frameIndex].buffer, m_pageCache.image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()),
+                               regions.data());
+        m_engine->getFrameCounters().uploadBytes += m_uploads.size() * VT_PAGE_BYTES;
+
+        VkUtils::transitionImage(cmd, m_pageCache.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        m_uploads.clear();
+    }
+
+    if (!m_indirectionDirty || !isLoaded()) {
+        return;
+    }
+
+    const uint32_t firstLevel = VT_MAX_MIPS - m_mipCount;
+    const VkImageSubresourceRange range{
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = firstLevel,
+        .levelCount = m_mipCount,
+        .baseArrayLayer = 0,
+        .layerCount = 1,
+    };
+    VkUtils::transitionImageRange(cmd, m_indirection.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, range);
+
+    VkBufferImageCopy regions[VT_MAX_MIPS];
+    for (uint32_t mip = 0; mip < m_mipCount; mip++) {
+        regions[mip] = VkBufferImageCopy{
+            .bufferOffset = VT_UPLOADS_PER_FRAME * VT_PAGE_BYTES + m_mipPageOffset[mip] * sizeof(uint32_t),
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = firstLevel + mip,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = {getPageCount(mip), getPageCount(mip), 1},
+        };
+        m_engine->getFrameCounters().uploadBytes += getPageCount(mip) * getPageCount(mip) * sizeof(uint32_t);
+    }
+    vkCmdCopyBufferToImage(cmd, m_staging[frameIndex].buffer, m_indirection.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_mipCount, regions);
+
+    VkUtils::transitionImageRange(cmd, m_indirection.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, range);
+    m_indirectionDirty = false;
+}
+
+void VirtualTexture::renderFeedback(
+    VkCommandBuffer cmd,
+    uint32_t frameIndex,
+    std::span<const RenderObject> objects,
+    std::span<const uint32_t> drawList
+) {
+    m_readbackWritten[frameIndex] = false;
+
+    const bool anyVisible = std::ranges::any_of(drawList, [&](uint32_t index) {
+        return objects[index].materialIndex == VIRTUAL_TEXTURE_MATERIAL;
+    });
+    if (!isLoaded() || !anyVisible) {
+        return;
+    }
+
+    VkUtils::transitionImage(cmd, m_feedbackImage.image, VK_IMAGE_LAYOUT_UNDEFINED,
+                             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+    VkRenderingAttachmentInfo colorAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .pNext = nullptr,
+        .imageView = m_feedbackImage.imageView,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+    };
+    colorAttachment.clearValue.color.uint32[0] = VT_NO_PAGE;
+
+    const VkRenderingInfo renderInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .pNext = nullptr,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = m_feedbackExtent,
+        },
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+    };
+
+    vkCmdBeginRendering(cmd, &renderInfo);
+
+    const VkViewport viewport{
+        .x = 0,
+        .y = 0,
+        .width = static_cast<float>(m_feedbackExtent.width),
+        .height = static_cast<float>(m_feedbackExtent.height),
+        .minDepth = 0.f,
+        .maxDepth = 1.f,
+    };
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    const VkRect2D scissor{
+        .offset = {0, 0},
+        .extent = m_feedbackExtent,
+    };
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_feedbackPipeline);
+    m_engine->bindSceneDescriptors(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_feedbackLayout);
+
+    for (const uint32_t index: drawList) {
+        const RenderObject& object = objects[index];
+        if (object.materialIndex != VIRTUAL_TEXTURE_MATERIAL) {
+            continue;
+        }
+
+        const GPUDrawPushConstants pushConstants{
+            .vertexBuffer = object.vertexBufferAddress,
+            .objectId = object.objectId,
+        };
+        vkCmdPushConstants(cmd, m_feedbackLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GPUDrawPushConstants),
+                           &pushConstants);
+        vkCmdBindIndexBuffer(cmd, object.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+        vkCmdDrawIndexed(cmd, object.indexCount, 1, object.firstIndex, 0, 0);
+        m_engine->getFrameCounters().draws++;
+    }
+
+    vkCmdEndRendering(cmd);
+
+    VkUtils::transitionImage(cmd, m_feedbackImage.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+    const VkBufferImageCopy region{
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {m_feedbackExtent.width, m_feedbackExtent.height, 1},
+    };
+    vkCmdCopyImageToBuffer(cmd, m_feedbackImage.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           m_readback[frameIndex].buffer, 1, &region);
+
+    // read by the CPU once this frame slot comes around again
+    VkUtils::memoryBarrier(cmd, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+
+    m_readbackWritten[frameIndex] = true;
+}
+
+glm::uvec4 VirtualTexture::getShaderParams() const {
+    if (!isLoaded()) {
+        return glm::uvec4(0, 1, 0, 0);
+    }
+    return glm::uvec4(VT_MAX_MIPS - m_mipCount, m_mipCount, 1, 0);
+}
+
+uint32_t VirtualTexture::getParentPage(uint32_t page) const {
+    const uint32_t mip = page >> 16;
+    if (mip + 1 >= m_mipCount) {
+        return VT_NO_PAGE;
+    }
+    return packPage((page & 0xFF) / 2, ((page >> 8) & 0xFF) / 2, mip + 1);
+}
+
+uint32_t VirtualTexture::findSlot() {
+    uint32_t oldest = VT_NO_PAGE;
+    for (uint32_t i = 0; i < m_slots.size(); i++) {
+        if (i == VT_PINNED_SLOT) {
+            continue;
+        }
+        if (m_slots[i].page == VT_NO_PAGE) {
+            return i;
+        }
+        // pages drawn this frame stay, evicting them would only bring them back next frame
+        if (m_slots[i].lastUsedFrame < m_frame &&
+            (oldest == VT_NO_PAGE || m_slots[i].lastUsedFrame < m_slots[oldest].lastUsedFrame)) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+bool VirtualTexture::getPageFileOffset(uint32_t page, uint64_t& outOffset) const {
+    const uint32_t mip = page >> 16;
+    const uint32_t x = page & 0xFF;
+    const uint32_t y = (page >> 8) & 0xFF;
+    if (mip >= m_mipCount || x >= getPageCount(mip) || y >= getPageCount(mip)) {
+        return false;
+    }
+
+    const uint64_t index = m_mipPageOffset[mip] + y * getPageCount(mip) + x;
+    outOffset = sizeof(VirtualTextureHeader) + index * VT_PAGE_BYTES;
+    return true;
+}
+
+void VirtualTexture::readPages(PageRead& read) {
+    // every read opens the file itself, streams are not shared between threads
+    std::ifstream file(read.path, std::ios::binary);
+    for (size_t i = 0; i < read.pages.size(); i++) {
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(read.fileOffsets[i]));
+        file.read(reinterpret_cast<char*>(read.data.data() + i * VT_PAGE_BYTES), VT_PAGE_BYTES);
+        read.succeeded[i] = file.good();
+    }
+}
+
+void VirtualTexture::takeReadPages(uint32_t frameIndex) {
+    if (!m_read || !m_read->counter.isDone()) {
+        return;
+    }
+
+    const uint32_t coarsestPage = packPage(0, 0, m_mipCount - 1);
+    auto* staging = static_cast<std::byte*>(m_staging[frameIndex].info.pMappedData);
+    for (size_t i = 0; i < m_read->pages.size(); i++) {
+        const uint32_t page = m_read->pages[i];
+        if (!m_read->succeeded[i]) {
+            std::cerr << std::format("Failed to read virtual texture page {:#x}\n", page);
+            continue;
+        }
+
+        // a page no slot can take is requested again by a later feedback
+        const uint32_t slot = page == coarsestPage ? VT_PINNED_SLOT : findSlot();
+        if (slot == VT_NO_PAGE) {
+            continue;
+        }
+
+        const uint64_t stagingOffset = m_uploads.size() * VT_PAGE_BYTES;
+        std::memcpy(staging + stagingOffset, m_read->data.data() + i * VT_PAGE_BYTES, VT_PAGE_BYTES);
+
+        Slot& target = m_slots[slot];
+        if (target.page != VT_NO_PAGE) {
+            m_slotOfPage.erase(target.page);
+            m_stats.evictedPages++;
+        }
+        target.page = page;
+        target.lastUsedFrame = m_frame;
+        m_slotOfPage[page] = slot;
+
+        m_uploads.push_back({slot, stagingOffset});
+        m_indirectionDirty = true;
+    }
+
+    m_stats.uploadedPages += static_cast<uint32_t>(m_uploads.size());
+    m_read.reset();
+}
+
+void VirtualTexture::startReadPages() {
+    if (m_read) {
+        m_stats.deferredPages = static_cast<uint32_t>(m_requests.size());
+        return;
+    }
+
+    auto read = std::make_unique<PageRead>();
+    read->path = m_path;
+    for (const PageRequest& request: m_requests) {
+        if (read->pages.size() >= VT_UPLOADS_PER_FRAME) {
+            break;
+        }
+
+        // taken in by this frame's takeReadPages
+        uint64_t fileOffset;
+        if (m_slotOfPage.contains(request.page) || !getPageFileOffset(request.page, fileOffset)) {
+            continue;
+        }
+        read->pages.push_back(request.page);
+        read->fileOffsets.push_back(fileOffset);
+    }
+    m_stats.deferredPages = static_cast<uint32_t>(m_requests.size() - read->pages.size());
+
+    if (read->pages.empty()) {
+        return;
+    }
+
+    read->data.resize(read->pages.size() * VT_PAGE_BYTES);
+    read->succeeded.resize(read->pages.size());
+
+    PageRead* pending = read.get();
+    m_jobSystem->run([pending] { readPages(*pending); }, &pending->counter);
+    m_read = std::move(read);
+}
+
+void VirtualTexture::rebuildIndirection(uint32_t frameIndex) {
+    auto* table = reinterpret_cast<uint32_t*>(static_cast<std::byte*>(m_staging[frameIndex].info.pMappedData) +
+                                              VT_UPLOADS_PER_FRAME * VT_PAGE_BYTES);
+
+    // from the coarsest mip down, so every missing page can copy its parent's entry
+    for (uint32_t mip = m_mipCount; mip-- > 0;) {
+        const uint32_t pages = getPageCount(mip);
+        for (uint32_t y = 0; y < pages; y++) {
+            for (uint32_t x = 0; x < pages; x++) {
+                uint32_t& entry = table[m_mipPageOffset[mip] + y * pages + x];
+
+                const auto resident = m_slotOfPage.find(packPage(x, y, mip));
+                if (resident != m_slotOfPage.end()) {
+                    const uint32_t slot = resident->second;
+                    entry = (slot % VT_CACHE_PAGES) | ((slot / VT_CACHE_PAGES) << 8) | (mip << 16) | (1u << 24);
+                } else if (mip + 1 < m_mipCount) {
+                    entry = table[m_mipPageOffset[mip + 1] + (y / 2) * getPageCount(mip + 1) + x / 2];
+                } else {
+                    entry = 0;
+                }
+            }
+        }
+    }
+}
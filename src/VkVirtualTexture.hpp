@@ -0,0 +1,149 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "VkTypes.hpp"
+#include "JobSystem.hpp"
+#include "VirtualTextureFile.hpp"
+
+class VulkanEngine;
+
+// indirection levels from VT_MAX_PAGES pages down to one, a 16k texture uses all of them
+constexpr uint32_t VT_MAX_MIPS = 8;
+constexpr uint32_t VT_FEEDBACK_DIVISOR = 8;
+constexpr uint32_t VT_NO_PAGE = UINT32_MAX;
+// objects with this material sample the virtual texture
+constexpr uint32_t VIRTUAL_TEXTURE_MATERIAL = 1;
+
+// physical page slots per side of the page cache, the cache memory does not depend on the texture size
+constexpr uint32_t VT_CACHE_PAGES = 16;
+constexpr uint32_t VT_UPLOADS_PER_FRAME = 16;
+
+struct VirtualTextureStats {
+    uint32_t residentPages = 0;
+    // distinct pages in the last feedback, including the ancestors of missing ones
+    uint32_t requestedPages = 0;
+    uint32_t uploadedPages = 0;
+    uint32_t evictedPages = 0;
+    // missing pages left for later frames by the upload budget
+    uint32_t deferredPages = 0;
+};
+
+// software virtual texturing. The texture is split into pages that are loaded on demand into a fixed page
+// cache. A low resolution feedback pass writes the page and mip every pixel wants, the CPU reads it back
+// FRAME_OVERLAP frames later and reads the missing pages on the job system within a budget. Pages are
+// uploaded once their read finished and the indirection table, in which missing pages point to their
+// closest resident ancestor, is redirected to them
+class VirtualTexture {
+public:
+    void init(VulkanEngine* engine, JobSystem* jobSystem, VkDescriptorSetLayout sceneLayout, VkExtent2D drawExtent);
+
+    // replaces the current texture, its pages stream in over the next frames
+    bool load(const std::filesystem::path& path);
+
+    // reads back the feedback this frame slot wrote last time, takes in the pages whose read finished and
+    // starts reading the next missing ones. The fence of this frame slot must have been waited on
+    void update(uint32_t frameIndex);
+
+    // records the page and indirection uploads picked by update
+    void upload(VkCommandBuffer cmd, uint32_t frameIndex);
+
+    // draws the page ids of the visible virtual textured objects and copies them to this frame slot's readback buffer
+    void renderFeedback(VkCommandBuffer cmd, uint32_t frameIndex, std::span<const RenderObject> objects,
+                        std::span<const uint32_t> drawList);
+
+    // x first indirection level, y mip count, z 1 when a texture is loaded
+    [[nodiscard]] glm::uvec4 getShaderParams() const;
+
+    [[nodiscard]] VkImageView getIndirectionView() const { return m_indirection.imageView; }
+    [[nodiscard]] VkImageView getPageCacheView() const { return m_pageCache.imageView; }
+    [[nodiscard]] VkSampler getIndirectionSampler() const { return m_nearestSampler; }
+    [[nodiscard]] VkSampler getPageCacheSampler() const { return m_linearSampler; }
+    [[nodiscard]] const VirtualTextureStats& getStats() const { return m_stats; }
+
+private:
+    struct Slot {
+        uint32_t page = VT_NO_PAGE;
+        uint64_t lastUsedFrame = 0;
+    };
+
+    struct PageRequest {
+        uint32_t page;
+        uint32_t count;
+    };
+
+    struct PageUpload {
+        uint32_t slot;
+        uint64_t stagingOffset;
+    };
+
+    // up to VT_UPLOADS_PER_FRAME pages read from the file on a worker
+    struct PageRead {
+        std::filesystem::path path;
+        std::vector<uint32_t> pages;
+        std::vector<uint64_t> fileOffsets;
+        std::vector<std::byte> data;
+        // written by the worker, read once the counter is done
+        std::vector<uint8_t> succeeded;
+        JobCounter counter;
+    };
+
+    [[nodiscard]] uint32_t getPageCount(uint32_t mip) const { return m_pagesPerSide >> mip; }
+    // the parent of the coarsest page is VT_NO_PAGE
+    [[nodiscard]] uint32_t getParentPage(uint32_t page) const;
+
+    [[nodiscard]] bool isLoaded() const { return !m_path.empty(); }
+
+    // a free slot or the least recently used one that is not used this frame, VT_NO_PAGE if there is none
+    uint32_t findSlot();
+    // false for pages outside the texture
+    bool getPageFileOffset(uint32_t page, uint64_t& outOffset) const;
+    static void readPages(PageRead& read);
+    // moves the pages of a finished read into this frame slot's staging buffer and into the cache
+    void takeReadPages(uint32_t frameIndex);
+    void startReadPages();
+    // writes the table for every mip into this frame slot's staging buffer
+    void rebuildIndirection(uint32_t frameIndex);
+
+    VulkanEngine* m_engine = nullptr;
+    JobSystem* m_jobSystem = nullptr;
+
+    AllocatedImage m_pageCache{};
+    AllocatedImage m_indirection{};
+    VkSampler m_nearestSampler = VK_NULL_HANDLE;
+    VkSampler m_linearSampler = VK_NULL_HANDLE;
+
+    AllocatedImage m_feedbackImage{};
+    VkExtent2D m_feedbackExtent{};
+    VkPipelineLayout m_feedbackLayout = VK_NULL_HANDLE;
+    VkPipeline m_feedbackPipeline = VK_NULL_HANDLE;
+
+    // per frame slot, written by the GPU and read after the slot's fence
+    AllocatedBuffer m_readback[FRAME_OVERLAP]{};
+    bool m_readbackWritten[FRAME_OVERLAP]{};
+    // per frame slot, pages first and the indirection table after them
+    AllocatedBuffer m_staging[FRAME_OVERLAP]{};
+
+    std::filesystem::path m_path;
+    uint32_t m_pagesPerSide = 0;
+    uint32_t m_mipCount = 0;
+    // first page of every mip in the file and in the indirection table
+    uint32_t m_mipPageOffset[VT_MAX_MIPS]{};
+    uint32_t m_totalPages = 0;
+
+    std::vector<Slot> m_slots;
+    std::unordered_map<uint32_t, uint32_t> m_slotOfPage;
+    std::unordered_map<uint32_t, uint32_t> m_requestCounts;
+    std::vector<PageRequest> m_requests;
+    std::vector<PageUpload> m_uploads;
+    // one read in flight at a time, its pages fill one frame's staging pages
+    std::unique_ptr<PageRead> m_read;
+    bool m_indirectionDirty = false;
+    uint64_t m_frame = 0;
+
+    VirtualTextureStats m_stats;
+};